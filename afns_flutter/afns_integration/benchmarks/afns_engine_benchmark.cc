@@ -0,0 +1,275 @@
+// 🚀 AFNS ENGINE BENCHMARKS
+// Google Benchmark suite over the engine's C ABI, 100 B to 10 MB sources
+//
+// Every benchmark takes the source size in bytes as its argument and runs
+// single-threaded and with 2..8 threads on one shared engine (the worker
+// pool's cap), so lock and cache contention shows up next to the
+// uncontended cost. Warm runs compile the same source every iteration and
+// measure the cache-hit path; cold runs change a counter in a trailing
+// comment first, so every iteration misses every cache and pays for
+// validation, rewriting and insertion.
+//
+// Built by ../CMakeLists.txt with -DAFNS_BUILD_BENCHMARKS=ON.
+//
+// For release-to-release tracking, write JSON and tag it with the build,
+// all on one command line:
+//   afns_engine_benchmark --benchmark_out=afns_engine_benchmark.json
+//       --benchmark_out_format=json
+//       --benchmark_context=release=<version> --benchmark_context=device=<model>
+// The engine stats after the run (see afns_engine_get_stats) go to stderr.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_engine_c_api.h"
+#include "afns_rewriter.h"
+#include "afns_utf.h"
+#include "afns_validator.h"
+
+namespace {
+
+constexpr int64_t kMinSourceBytes = 100;
+constexpr int64_t kMaxSourceBytes = 10'000'000;
+constexpr int kMaxThreads = 8;
+
+// Same table as afns_engine.cc
+constexpr flutter::afns::AFNSRewriteRule kRewriteRules[] = {
+    {"fun ", "Widget "},
+};
+
+// Trailing comment whose digits cold runs overwrite; fixed width, so the
+// source size never changes
+constexpr std::string_view kCounterComment = "// 0000000000000000\n";
+
+// Shared by every case and thread, so no two cold iterations of the
+// process compile the same source
+std::atomic<uint64_t> g_unique_sources{0};
+
+// Widget declarations the front end, rewriter and bytecode compiler all
+// accept, repeated up to |bytes|, then an entry point and the counter
+std::string MakeSource(size_t bytes) {
+    constexpr std::string_view kApex = "apex() { var i = 0; while i < 4 { i = i + FlutterText0(1); } "
+                                       "show(\"FlutterWindow\"); }\n";
+    std::string source;
+    source.reserve(bytes + 128);
+    const size_t body = bytes > kApex.size() + kCounterComment.size()
+                            ? bytes - kApex.size() - kCounterComment.size()
+                            : 0;
+    char declaration[96];
+    for (unsigned i = 0; i == 0 || source.size() < body; ++i) {
+        std::snprintf(declaration, sizeof(declaration),
+                      "fun FlutterText%u(text::i32) -> i32 { return text + %u; }\n", i, i % 97);
+        source += declaration;
+    }
+    source += kApex;
+    source += kCounterComment;
+    return source;
+}
+
+// One source per benchmark thread, plus an output buffer it reuses
+class SourceUnderTest {
+public:
+    explicit SourceUnderTest(const benchmark::State& state)
+        : source_(MakeSource(static_cast<size_t>(state.range(0)))),
+          output_(source_.size() * 2 + 4096) {}
+
+    const char* data() const { return source_.data(); }
+    size_t size() const { return source_.size(); }
+
+    char* out() { return output_.data(); }
+    size_t out_cap() const { return output_.size(); }
+    size_t* out_len() { return &out_len_; }
+
+    // A source nothing in this process compiled before
+    void MakeUnique() {
+        char digits[20];
+        std::snprintf(digits, sizeof(digits), "%016" PRIx64,
+                      g_unique_sources.fetch_add(1, std::memory_order_relaxed) + 1);
+        source_.replace(source_.size() - kCounterComment.size() + 3, 16, digits, 16);
+    }
+
+    // Grows the buffer after AFNS_ERROR_BUFFER_TOO_SMALL; false on errors
+    bool Check(benchmark::State& state, int status) {
+        if (status == AFNS_ERROR_BUFFER_TOO_SMALL) {
+            output_.resize(out_len_);
+            return true;
+        }
+        if (status != AFNS_OK) {
+            state.SkipWithError("engine call failed");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string source_;
+    std::vector<char> output_;
+    size_t out_len_ = 0;
+};
+
+void Finish(benchmark::State& state, const SourceUnderTest& source) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(source.size()));
+    // Averaged, each thread reports the size of its own source
+    state.counters["source_bytes"] =
+        benchmark::Counter(static_cast<double>(source.size()), benchmark::Counter::kAvgThreads);
+}
+
+template <bool kCold>
+void BM_CompileWidget(benchmark::State& state) {
+    SourceUnderTest source(state);
+    for (auto _ : state) {
+        if (kCold) {
+            source.MakeUnique();
+        }
+        if (!source.Check(state, compile_afns_widget(source.data(), source.size(), source.out(),
+                                                     source.out_cap(), source.out_len()))) {
+            return;
+        }
+    }
+    Finish(state, source);
+}
+
+template <bool kCold>
+void BM_CompileWidgetTree(benchmark::State& state) {
+    SourceUnderTest source(state);
+    for (auto _ : state) {
+        if (kCold) {
+            source.MakeUnique();
+        }
+        if (!source.Check(state, compile_afns_widget_tree(source.data(), source.size(), source.out(),
+                                                          source.out_cap(), source.out_len()))) {
+            return;
+        }
+    }
+    Finish(state, source);
+}
+
+template <bool kCold>
+void BM_ExecuteLogic(benchmark::State& state) {
+    SourceUnderTest source(state);
+    for (auto _ : state) {
+        if (kCold) {
+            source.MakeUnique();
+        }
+        if (!source.Check(state, execute_afns_logic(source.data(), source.size(), source.out(),
+                                                    source.out_cap(), source.out_len()))) {
+            return;
+        }
+    }
+    Finish(state, source);
+}
+
+// The malloc'ed-result shim, against compile_afns_widget's caller buffer
+void BM_CompileWidgetAlloc(benchmark::State& state) {
+    SourceUnderTest source(state);
+    for (auto _ : state) {
+        size_t length = 0;
+        char* widget = compile_afns_widget_alloc(source.data(), source.size(), &length);
+        if (widget == nullptr) {
+            state.SkipWithError("engine call failed");
+            return;
+        }
+        afns_free_result(widget);
+    }
+    Finish(state, source);
+}
+
+// ProcessAFNSCode is private to the engine; these are the two passes it is
+// made of when there is no front end, without the engine around them
+void BM_Validate(benchmark::State& state) {
+    SourceUnderTest source(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            flutter::afns::ValidateAFNSSource(std::string_view(source.data(), source.size())));
+    }
+    Finish(state, source);
+}
+
+void BM_ProcessRewrite(benchmark::State& state) {
+    static const flutter::afns::AFNSRewriter rewriter(kRewriteRules);
+    SourceUnderTest source(state);
+    std::string processed;
+    for (auto _ : state) {
+        rewriter.Rewrite(std::string_view(source.data(), source.size()), &processed);
+        benchmark::DoNotOptimize(processed.data());
+    }
+    Finish(state, source);
+}
+
+// The JNI string conversions, both ways, over the source as a Java string
+// would hold it
+void BM_Utf16ToUtf8(benchmark::State& state) {
+    SourceUnderTest source(state);
+    std::u16string utf16;
+    flutter::afns::AFNSUtf8ToUtf16(std::string_view(source.data(), source.size()), &utf16);
+    std::string utf8;
+    for (auto _ : state) {
+        flutter::afns::AFNSUtf16ToUtf8(utf16.data(), utf16.size(), &utf8);
+        benchmark::DoNotOptimize(utf8.data());
+    }
+    Finish(state, source);
+}
+
+void BM_Utf8ToUtf16(benchmark::State& state) {
+    SourceUnderTest source(state);
+    std::u16string utf16;
+    for (auto _ : state) {
+        flutter::afns::AFNSUtf8ToUtf16(std::string_view(source.data(), source.size()), &utf16);
+        benchmark::DoNotOptimize(utf16.data());
+    }
+    Finish(state, source);
+}
+
+// Each case at every threads count
+void Sizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->RangeMultiplier(10)->Range(kMinSourceBytes, kMaxSourceBytes)->ThreadRange(1, kMaxThreads)
+        ->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_CompileWidget, false)->Name("CompileWidget/warm")->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_CompileWidget, true)->Name("CompileWidget/cold")->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_CompileWidgetTree, false)->Name("CompileWidgetTree/warm")->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_CompileWidgetTree, true)->Name("CompileWidgetTree/cold")->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_ExecuteLogic, false)->Name("ExecuteLogic/warm")->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_ExecuteLogic, true)->Name("ExecuteLogic/cold")->Apply(Sizes);
+BENCHMARK(BM_CompileWidgetAlloc)->Name("CompileWidgetAlloc/warm")->Apply(Sizes);
+BENCHMARK(BM_Validate)->Name("ProcessAFNSCode/validate")->Apply(Sizes);
+BENCHMARK(BM_ProcessRewrite)->Name("ProcessAFNSCode/rewrite")->Apply(Sizes);
+BENCHMARK(BM_Utf16ToUtf8)->Name("Transcode/utf16_to_utf8")->Apply(Sizes);
+BENCHMARK(BM_Utf8ToUtf16)->Name("Transcode/utf8_to_utf16")->Apply(Sizes);
+
+std::string EngineStats() {
+    std::vector<char> stats(1 << 16);
+    size_t length = 0;
+    if (afns_engine_get_stats(stats.data(), stats.size(), &length) == AFNS_ERROR_BUFFER_TOO_SMALL) {
+        stats.resize(length);
+        afns_engine_get_stats(stats.data(), stats.size(), &length);
+    }
+    return std::string(stats.data(), length <= stats.size() ? length : 0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    // Created and prewarmed before the first timing, so no case pays for it
+    initialize_afns_engine();
+    afns_engine_prewarm();
+    benchmark::AddCustomContext("afns_source_bytes",
+                                std::to_string(kMinSourceBytes) + ".." + std::to_string(kMaxSourceBytes));
+    benchmark::RunSpecifiedBenchmarks();
+    std::fprintf(stderr, "afns_engine_stats: %s\n", EngineStats().c_str());
+    benchmark::Shutdown();
+    return 0;
+}
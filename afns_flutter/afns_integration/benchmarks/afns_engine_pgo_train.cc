@@ -0,0 +1,188 @@
+// 🚀 AFNS ENGINE PGO TRAINING
+// Drives an instrumented engine build (-DAFNS_PGO=generate) over real AFNS code
+//
+// Usage: afns_engine_pgo_train [--rounds=N] <file>...
+// .afns files are used whole; from any other file, such as the sample
+// apps' .dart sources, every string literal passed as `afnsCode:` or
+// `code:` is used. Each round compiles every source warm and cold (a
+// changed trailing comment misses every cache), as a widget, a widget tree
+// and a patch, executes it as logic and validates it, then compiles them
+// all as one batch and replays an edit session on each document; so the
+// profile weighs the cache-hit path against the compile path about the way
+// a rebuilding screen does. The profile is written when the process exits.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_engine_c_api.h"
+
+namespace {
+
+constexpr int kDefaultRounds = 200;
+
+// Literal prefixes the sample apps pass AFNS code under
+constexpr std::string_view kSourceArguments[] = {"afnsCode:", "code:"};
+
+bool EndsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+// The literal starting at |text|[|at|] ('...', "..." or '''...'''), or
+// nothing if there is none
+std::string_view ReadStringLiteral(std::string_view text, size_t at) {
+    while (at < text.size() && (text[at] == ' ' || text[at] == '\n' || text[at] == '\t' || text[at] == '\r')) {
+        ++at;
+    }
+    if (at >= text.size() || (text[at] != '\'' && text[at] != '"')) {
+        return {};
+    }
+    const std::string_view quote = text.substr(at, 3) == "'''" || text.substr(at, 3) == "\"\"\""
+                                       ? text.substr(at, 3)
+                                       : text.substr(at, 1);
+    const size_t begin = at + quote.size();
+    for (size_t i = begin; i + quote.size() <= text.size(); ++i) {
+        if (text[i] == '\\') {
+            ++i;
+        } else if (text.substr(i, quote.size()) == quote) {
+            return text.substr(begin, i - begin);
+        } else if (quote.size() == 1 && text[i] == '\n') {
+            return {};
+        }
+    }
+    return {};
+}
+
+void AddSources(const std::string& path, std::string_view text, std::vector<std::string>* sources) {
+    if (EndsWith(path, ".afns")) {
+        sources->emplace_back(text);
+        return;
+    }
+    for (std::string_view argument : kSourceArguments) {
+        for (size_t at = text.find(argument); at != std::string_view::npos;
+             at = text.find(argument, at + argument.size())) {
+            const std::string_view literal = ReadStringLiteral(text, at + argument.size());
+            if (!literal.empty()) {
+                sources->emplace_back(literal);
+            }
+        }
+    }
+}
+
+// Output buffer grown on AFNS_ERROR_BUFFER_TOO_SMALL, like the Dart arena;
+// an execute retry gets the held result and does not run the logic again
+class Output {
+public:
+    template <typename Call>
+    void Run(Call call) {
+        size_t length = 0;
+        if (call(buffer_.data(), buffer_.size(), &length) == AFNS_ERROR_BUFFER_TOO_SMALL) {
+            buffer_.resize(length);
+            call(buffer_.data(), buffer_.size(), &length);
+        }
+    }
+
+private:
+    std::vector<char> buffer_ = std::vector<char>(1 << 16);
+};
+
+void Train(const std::vector<std::string>& sources, int rounds) {
+    Output output;
+    std::vector<uint64_t> offsets(1, 0);
+    std::string blob;
+    for (const std::string& source : sources) {
+        blob += source;
+        offsets.push_back(blob.size());
+    }
+    std::vector<uint64_t> result_offsets(offsets.size());
+
+    for (int round = 0; round < rounds; ++round) {
+        const std::string comment = "\n// round " + std::to_string(round) + "\n";
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const std::string& warm = sources[i];
+            const std::string cold = warm + comment;
+            const std::string widget_id = "train_" + std::to_string(i);
+            for (const std::string* source : {&warm, &cold}) {
+                const char* in = source->data();
+                const size_t in_len = source->size();
+                output.Run([&](char* out, size_t cap, size_t* len) {
+                    return compile_afns_widget(in, in_len, out, cap, len);
+                });
+                output.Run([&](char* out, size_t cap, size_t* len) {
+                    return compile_afns_widget_tree(in, in_len, out, cap, len);
+                });
+                output.Run([&](char* out, size_t cap, size_t* len) {
+                    return compile_afns_widget_patch(widget_id.data(), widget_id.size(), in, in_len,
+                                                     out, cap, len);
+                });
+                output.Run([&](char* out, size_t cap, size_t* len) {
+                    return execute_afns_logic(in, in_len, out, cap, len);
+                });
+                size_t error_offset = 0;
+                validate_afns_code(in, in_len, &error_offset);
+            }
+        }
+
+        output.Run([&](char* out, size_t cap, size_t* len) {
+            return compile_afns_widget_batch(offsets.data(), sources.size(), blob.data(),
+                                             result_offsets.data(), out, cap, len);
+        });
+
+        // A live-edit session: type the comment at the end, then delete it
+        for (const std::string& source : sources) {
+            const int64_t document = afns_document_open(source.data(), source.size());
+            if (document <= 0) {
+                continue;
+            }
+            for (size_t typed = 0; typed < comment.size(); ++typed) {
+                afns_document_edit(document, source.size() + typed, 0, &comment[typed], 1);
+                output.Run([&](char* out, size_t cap, size_t* len) {
+                    return afns_document_compile(document, out, cap, len);
+                });
+            }
+            afns_document_edit(document, source.size(), comment.size(), nullptr, 0);
+            output.Run([&](char* out, size_t cap, size_t* len) {
+                return afns_document_compile(document, out, cap, len);
+            });
+            afns_document_close(document);
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    int rounds = kDefaultRounds;
+    std::vector<std::string> sources;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (argument.substr(0, 9) == "--rounds=") {
+            rounds = std::atoi(argv[i] + 9);
+            continue;
+        }
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "afns_engine_pgo_train: cannot read %s\n", argv[i]);
+            return 1;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        AddSources(argv[i], text.str(), &sources);
+    }
+    if (sources.empty() || rounds <= 0) {
+        std::fprintf(stderr, "usage: afns_engine_pgo_train [--rounds=N] <file>...\n");
+        return 1;
+    }
+
+    initialize_afns_engine();
+    afns_engine_prewarm();
+    Train(sources, rounds);
+    std::fprintf(stderr, "afns_engine_pgo_train: %zu sources, %d rounds\n", sources.size(), rounds);
+    return 0;
+}
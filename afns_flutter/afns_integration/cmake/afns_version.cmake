@@ -0,0 +1,19 @@
+# 🚀 AFNS ENGINE VERSION
+# Run as a script (cmake -P) on every build by the afns_version target:
+# writes AFNS_VERSION_OUTPUT from AFNS_VERSION_TEMPLATE with
+# AFNS_ENGINE_VERSION set to AFNS_PROJECT_VERSION plus a hash of the engine
+# sources in AFNS_ENGINE_DIR. The file is only touched when that changes,
+# so an unchanged tree recompiles nothing.
+
+file(GLOB afns_version_sources ${AFNS_ENGINE_DIR}/*.h ${AFNS_ENGINE_DIR}/*.cc)
+list(SORT afns_version_sources)
+set(afns_version_hashes "")
+foreach(source ${afns_version_sources})
+    file(SHA256 ${source} afns_source_hash)
+    string(APPEND afns_version_hashes "${afns_source_hash}")
+endforeach()
+string(SHA256 afns_sources_hash "${afns_version_hashes}")
+string(SUBSTRING ${afns_sources_hash} 0 16 afns_sources_hash)
+
+set(AFNS_ENGINE_VERSION "${AFNS_PROJECT_VERSION}+${afns_sources_hash}")
+configure_file(${AFNS_VERSION_TEMPLATE} ${AFNS_VERSION_OUTPUT} @ONLY)
@@ -6,34 +6,379 @@ library afns_runtime;
 import 'dart:ffi';
 import 'dart:typed_data';
 import 'dart:isolate';
+import 'dart:async';
 import 'dart:convert';
+import 'dart:developer' as developer;
+import 'package:ffi/ffi.dart';
 import 'package:flutter/material.dart';
+import 'package:flutter/scheduler.dart';
 import 'package:flutter/widgets.dart';
 
 // FFI Interface for AFNS Engine
-typedef CompileAFNSWidgetNative = Pointer<Utf8> Function(Pointer<Utf8> afns_code);
-typedef CompileAFNSWidgetNativeDart = Pointer<Utf8> Function(Pointer<Utf8> afns_code);
+// Buffer-style calls, see engine/afns_engine_c_api.h: input is UTF-8 bytes +
+// length, output goes into a caller-owned buffer.
+typedef CompileAFNSWidgetNative = Int32 Function(
+    Pointer<Uint8> input, Size inputLen, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef CompileAFNSWidgetNativeDart = int Function(
+    Pointer<Uint8> input, int inputLen, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
 
-typedef ExecuteAFNSLogicNative = Pointer<Utf8> Function(Pointer<Utf8> afns_code);
-typedef ExecuteAFNSLogicNativeDart = Pointer<Utf8> Function(Pointer<Utf8> afns_code);
+typedef ExecuteAFNSLogicNative = Int32 Function(
+    Pointer<Uint8> input, Size inputLen, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef ExecuteAFNSLogicNativeDart = int Function(
+    Pointer<Uint8> input, int inputLen, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef CompileAFNSWidgetTreeNative = Int32 Function(
+    Pointer<Uint8> input, Size inputLen, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef CompileAFNSWidgetTreeNativeDart = int Function(
+    Pointer<Uint8> input, int inputLen, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef CompileAFNSWidgetBatchNative = Int32 Function(Pointer<Uint64> inOffsets, Size count,
+    Pointer<Uint8> inBlob, Pointer<Uint64> outOffsets, Pointer<Uint8> outBlob, Size outBlobCap,
+    Pointer<Size> outBlobLen);
+typedef CompileAFNSWidgetBatchNativeDart = int Function(Pointer<Uint64> inOffsets, int count,
+    Pointer<Uint8> inBlob, Pointer<Uint64> outOffsets, Pointer<Uint8> outBlob, int outBlobCap,
+    Pointer<Size> outBlobLen);
+
+typedef CompileAFNSWidgetPatchNative = Int32 Function(Pointer<Uint8> widgetId, Size widgetIdLen,
+    Pointer<Uint8> input, Size inputLen, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef CompileAFNSWidgetPatchNativeDart = int Function(Pointer<Uint8> widgetId, int widgetIdLen,
+    Pointer<Uint8> input, int inputLen, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef ResetAFNSWidgetPatchNative = Void Function(Pointer<Uint8> widgetId, Size widgetIdLen);
+typedef ResetAFNSWidgetPatchNativeDart = void Function(Pointer<Uint8> widgetId, int widgetIdLen);
+
+typedef InitDartApiNative = IntPtr Function(Pointer<Void> data);
+typedef InitDartApiNativeDart = int Function(Pointer<Void> data);
+
+typedef AsyncAFNSCallNative = Int64 Function(
+    Pointer<Uint8> widgetId, Size widgetIdLen, Pointer<Uint8> input, Size inputLen, Int64 port);
+typedef AsyncAFNSCallNativeDart = int Function(
+    Pointer<Uint8> widgetId, int widgetIdLen, Pointer<Uint8> input, int inputLen, int port);
+
+typedef CancelAFNSRequestNative = Int32 Function(Int64 requestId);
+typedef CancelAFNSRequestNativeDart = int Function(int requestId);
 
 typedef InitializeAFNSEngineNative = Void Function();
 typedef InitializeAFNSEngineNativeDart = void Function();
 
-typedef GetAFNSStateNative = Pointer<Utf8> Function();
-typedef GetAFNSStateNativeDart = Pointer<Utf8> Function();
+typedef StartupPhaseNative = Int64 Function(Int32 phase);
+typedef StartupPhaseNativeDart = int Function(int phase);
+
+typedef LoadAFNSBundleNative = Int32 Function(Pointer<Utf8> path);
+typedef LoadAFNSBundleNativeDart = int Function(Pointer<Utf8> path);
+
+typedef EnableDiskCacheNative = Int32 Function(Pointer<Utf8> directory, Size byteCap);
+typedef EnableDiskCacheNativeDart = int Function(Pointer<Utf8> directory, int byteCap);
+
+typedef GetAFNSStateNative = Int32 Function(Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef GetAFNSStateNativeDart = int Function(Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef GetAFNSStateVersionNative = Uint64 Function();
+typedef GetAFNSStateVersionNativeDart = int Function();
+
+typedef UpdateAFNSStateNative = Int32 Function(Pointer<Uint8> input, Size inputLen);
+typedef UpdateAFNSStateNativeDart = int Function(Pointer<Uint8> input, int inputLen);
+
+typedef SetAFNSStateIntNative = Int32 Function(Pointer<Uint8> path, Size pathLen, Int64 value);
+typedef SetAFNSStateIntNativeDart = int Function(Pointer<Uint8> path, int pathLen, int value);
+
+typedef SetAFNSStateDoubleNative = Int32 Function(Pointer<Uint8> path, Size pathLen, Double value);
+typedef SetAFNSStateDoubleNativeDart = int Function(Pointer<Uint8> path, int pathLen, double value);
+
+typedef SetAFNSStateBoolNative = Int32 Function(Pointer<Uint8> path, Size pathLen, Int32 value);
+typedef SetAFNSStateBoolNativeDart = int Function(Pointer<Uint8> path, int pathLen, int value);
+
+typedef SetAFNSStateStringNative = Int32 Function(
+    Pointer<Uint8> path, Size pathLen, Pointer<Uint8> value, Size valueLen);
+typedef SetAFNSStateStringNativeDart = int Function(
+    Pointer<Uint8> path, int pathLen, Pointer<Uint8> value, int valueLen);
+
+typedef RemoveAFNSStateNative = Int32 Function(Pointer<Uint8> path, Size pathLen);
+typedef RemoveAFNSStateNativeDart = int Function(Pointer<Uint8> path, int pathLen);
+
+typedef FlushAFNSStateNative = Int32 Function();
+typedef FlushAFNSStateNativeDart = int Function();
+
+typedef BindAFNSLogicNative = Int64 Function(Pointer<Uint8> input, Size inputLen, Int64 port);
+typedef BindAFNSLogicNativeDart = int Function(Pointer<Uint8> input, int inputLen, int port);
+
+typedef UnbindAFNSNative = Void Function(Int64 binding);
+typedef UnbindAFNSNativeDart = void Function(int binding);
+
+typedef SetAFNSTraceFlowNative = Void Function(Uint64 flowId);
+typedef SetAFNSTraceFlowNativeDart = void Function(int flowId);
+
+typedef DumpAFNSTraceNative = Int32 Function(
+    Int32 format, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef DumpAFNSTraceNativeDart = int Function(
+    int format, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+// Context variants of the calls above; the first argument is an
+// afns_context handle (see afns_engine_c_api.h)
+typedef CreateAFNSContextNative = Pointer<Void> Function();
+typedef CreateAFNSContextNativeDart = Pointer<Void> Function();
+
+typedef ContextAFNSBufferCallNative = Int32 Function(Pointer<Void> context,
+    Pointer<Uint8> input, Size inputLen, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef ContextAFNSBufferCallNativeDart = int Function(Pointer<Void> context,
+    Pointer<Uint8> input, int inputLen, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef ContextCompileAFNSWidgetPatchNative = Int32 Function(Pointer<Void> context,
+    Pointer<Uint8> widgetId, Size widgetIdLen, Pointer<Uint8> input, Size inputLen,
+    Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef ContextCompileAFNSWidgetPatchNativeDart = int Function(Pointer<Void> context,
+    Pointer<Uint8> widgetId, int widgetIdLen, Pointer<Uint8> input, int inputLen,
+    Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef ContextResetAFNSWidgetPatchNative = Void Function(
+    Pointer<Void> context, Pointer<Uint8> widgetId, Size widgetIdLen);
+typedef ContextResetAFNSWidgetPatchNativeDart = void Function(
+    Pointer<Void> context, Pointer<Uint8> widgetId, int widgetIdLen);
+
+typedef ContextGetAFNSStateNative = Int32 Function(
+    Pointer<Void> context, Pointer<Uint8> out, Size outCap, Pointer<Size> outLen);
+typedef ContextGetAFNSStateNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> out, int outCap, Pointer<Size> outLen);
+
+typedef ContextGetAFNSStateVersionNative = Uint64 Function(Pointer<Void> context);
+typedef ContextGetAFNSStateVersionNativeDart = int Function(Pointer<Void> context);
+
+// Also afns_context_state_remove
+typedef ContextUpdateAFNSStateNative = Int32 Function(
+    Pointer<Void> context, Pointer<Uint8> input, Size inputLen);
+typedef ContextUpdateAFNSStateNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> input, int inputLen);
+
+typedef ContextSetAFNSStateIntNative = Int32 Function(
+    Pointer<Void> context, Pointer<Uint8> path, Size pathLen, Int64 value);
+typedef ContextSetAFNSStateIntNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> path, int pathLen, int value);
+
+typedef ContextSetAFNSStateDoubleNative = Int32 Function(
+    Pointer<Void> context, Pointer<Uint8> path, Size pathLen, Double value);
+typedef ContextSetAFNSStateDoubleNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> path, int pathLen, double value);
+
+typedef ContextSetAFNSStateBoolNative = Int32 Function(
+    Pointer<Void> context, Pointer<Uint8> path, Size pathLen, Int32 value);
+typedef ContextSetAFNSStateBoolNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> path, int pathLen, int value);
+
+typedef ContextSetAFNSStateStringNative = Int32 Function(Pointer<Void> context,
+    Pointer<Uint8> path, Size pathLen, Pointer<Uint8> value, Size valueLen);
+typedef ContextSetAFNSStateStringNativeDart = int Function(Pointer<Void> context,
+    Pointer<Uint8> path, int pathLen, Pointer<Uint8> value, int valueLen);
 
-typedef UpdateAFNSStateNative = Void Function(Pointer<Utf8> state);
-typedef UpdateAFNSStateNativeDart = void Function(Pointer<Utf8> state);
+typedef ContextFlushAFNSStateNative = Int32 Function(Pointer<Void> context);
+typedef ContextFlushAFNSStateNativeDart = int Function(Pointer<Void> context);
+
+// Also afns_context_bind_widget
+typedef ContextAsyncAFNSCallNative = Int64 Function(Pointer<Void> context,
+    Pointer<Uint8> widgetId, Size widgetIdLen, Pointer<Uint8> input, Size inputLen, Int64 port);
+typedef ContextAsyncAFNSCallNativeDart = int Function(Pointer<Void> context,
+    Pointer<Uint8> widgetId, int widgetIdLen, Pointer<Uint8> input, int inputLen, int port);
+
+typedef ContextCancelAFNSRequestNative = Int32 Function(Pointer<Void> context, Int64 requestId);
+typedef ContextCancelAFNSRequestNativeDart = int Function(Pointer<Void> context, int requestId);
+
+typedef ContextBindAFNSLogicNative = Int64 Function(
+    Pointer<Void> context, Pointer<Uint8> input, Size inputLen, Int64 port);
+typedef ContextBindAFNSLogicNativeDart = int Function(
+    Pointer<Void> context, Pointer<Uint8> input, int inputLen, int port);
+
+typedef ContextUnbindAFNSNative = Void Function(Pointer<Void> context, Int64 binding);
+typedef ContextUnbindAFNSNativeDart = void Function(Pointer<Void> context, int binding);
+
+// Status codes from afns_engine_c_api.h
+const int _afnsOk = 0;
+const int _afnsBufferTooSmall = 1;
+const int _afnsAsyncCompleted = 0;
+const int _afnsTraceFormatChromeJson = 0;
+const int _afnsTraceFormatPerfetto = 1;
+
+// 🎯 PENDING ASYNC REQUEST
+// [id] can be passed to AFNSRuntime.cancelAFNSRequest; [result] completes
+// with null when the request was cancelled or superseded by a newer one
+// for the same widget id.
+class AFNSAsyncRequest<T> {
+  final int id;
+  final Future<T?> result;
+
+  const AFNSAsyncRequest(this.id, this.result);
+}
+
+// 🎯 NATIVE ARENA
+// One malloc'ed input and output buffer reused by every FFI call and grown
+// on demand, so calls don't leak or allocate a native string each time.
+class _AFNSNativeArena {
+  Pointer<Uint8> _input = nullptr;
+  int _inputCap = 0;
+  Pointer<Uint8> _output = nullptr;
+  int _outputCap = 0;
+  Pointer<Uint64> _offsets = nullptr;
+  int _offsetsCap = 0;
+  final Pointer<Size> _outLen = malloc<Size>();
+
+  // Encodes [a] and [b] back to back into the input buffer for calls that
+  // take two strings; returns both byte lengths
+  (int, int) writeInputPair(String a, String b) {
+    final first = utf8.encode(a);
+    final second = utf8.encode(b);
+    _ensureInput(first.length + second.length);
+    _input.asTypedList(first.length + second.length)
+      ..setAll(0, first)
+      ..setAll(first.length, second);
+    return (first.length, second.length);
+  }
+
+  // Encodes [text] into the input buffer and returns its byte length
+  int writeInput(String text) {
+    final bytes = utf8.encode(text);
+    _ensureInput(bytes.length);
+    _input.asTypedList(bytes.length).setAll(0, bytes);
+    return bytes.length;
+  }
+
+  Pointer<Uint8> get input => _input;
+
+  // Like readOutput but returns a view of the raw bytes, valid until the
+  // next call on this arena
+  Uint8List? readOutputBytes(int Function(Pointer<Uint8> out, int outCap, Pointer<Size> outLen) invoke) {
+    final length = _invoke(invoke);
+    if (length == null) return null;
+    return _output.asTypedList(length);
+  }
+
+  // Calls [invoke] with the output buffer, growing it once if the engine
+  // reports it too small, and decodes the result. Retrying an execute
+  // returns the result the engine held from the first call rather than
+  // running the logic again.
+  String? readOutput(int Function(Pointer<Uint8> out, int outCap, Pointer<Size> outLen) invoke) {
+    final length = _invoke(invoke);
+    if (length == null) return null;
+    return utf8.decode(_output.asTypedList(length));
+  }
+
+  int? _invoke(int Function(Pointer<Uint8> out, int outCap, Pointer<Size> outLen) invoke) {
+    if (_outputCap == 0) _ensureOutput(4096);
+    var status = invoke(_output, _outputCap, _outLen);
+    if (status == _afnsBufferTooSmall) {
+      _ensureOutput(_outLen.value);
+      status = invoke(_output, _outputCap, _outLen);
+    }
+    return status == _afnsOk ? _outLen.value : null;
+  }
+
+  // Packs [sources] as offsets + one blob, runs the batch call and unpacks
+  // the results in input order
+  List<String>? compileBatch(List<String> sources, CompileAFNSWidgetBatchNativeDart batch) {
+    final count = sources.length;
+    final encoded = sources.map(utf8.encode).toList();
+    final total = encoded.fold<int>(0, (sum, bytes) => sum + bytes.length);
+    _ensureInput(total);
+    _ensureOffsets(2 * (count + 1));
+
+    final inOffsets = _offsets.asTypedList(count + 1);
+    var pos = 0;
+    for (var i = 0; i < count; i++) {
+      inOffsets[i] = pos;
+      _input.elementAt(pos).asTypedList(encoded[i].length).setAll(0, encoded[i]);
+      pos += encoded[i].length;
+    }
+    inOffsets[count] = pos;
+
+    final outOffsetsPtr = _offsets.elementAt(count + 1);
+    final length = _invoke((out, outCap, outLen) =>
+        batch(_offsets, count, _input, outOffsetsPtr, out, outCap, outLen));
+    if (length == null) return null;
+
+    final outOffsets = outOffsetsPtr.asTypedList(count + 1);
+    final blob = _output.asTypedList(length);
+    return List<String>.generate(
+        count, (i) => utf8.decode(blob.sublist(outOffsets[i], outOffsets[i + 1])));
+  }
+
+  // Allocated even for empty input (a batch of empty strings included), so
+  // _input is never dereferenced as nullptr
+  void _ensureInput(int required) {
+    if (required <= _inputCap && _inputCap > 0) return;
+    if (_inputCap > 0) malloc.free(_input);
+    _inputCap = _grow(required);
+    _input = malloc<Uint8>(_inputCap);
+  }
+
+  void _ensureOffsets(int required) {
+    if (required <= _offsetsCap) return;
+    if (_offsetsCap > 0) malloc.free(_offsets);
+    _offsetsCap = _grow(required);
+    _offsets = malloc<Uint64>(_offsetsCap);
+  }
+
+  void _ensureOutput(int required) {
+    if (required <= _outputCap) return;
+    if (_outputCap > 0) malloc.free(_output);
+    _outputCap = _grow(required);
+    _output = malloc<Uint8>(_outputCap);
+  }
+
+  static int _grow(int required) {
+    var cap = 256;
+    while (cap < required) {
+      cap *= 2;
+    }
+    return cap;
+  }
+}
 
 // 🎯 MAIN AFNS RUNTIME CLASS
+// 🎯 ENGINE CONTEXT OF THIS ISOLATE
+// Statics are per isolate, so every isolate that initializes AFNSRuntime
+// holds its own engine context: its own state, bindings and requests on
+// top of the engine's shared caches. Destroyed once the isolate exits.
+class _AFNSContext implements Finalizable {
+  _AFNSContext(this.handle, NativeFinalizer destroy) {
+    destroy.attach(this, handle);
+  }
+
+  final Pointer<Void> handle;
+}
+
 class AFNSRuntime {
   static DynamicLibrary? _afnsLib;
+  static _AFNSContext? _context;
   static CompileAFNSWidgetNativeDart? _compileWidget;
+  static CompileAFNSWidgetBatchNativeDart? _compileWidgetBatch;
+  static CompileAFNSWidgetTreeNativeDart? _compileWidgetTree;
+  static CompileAFNSWidgetPatchNativeDart? _compileWidgetPatch;
+  static ResetAFNSWidgetPatchNativeDart? _resetWidgetPatch;
   static ExecuteAFNSLogicNativeDart? _executeLogic;
   static InitializeAFNSEngineNativeDart? _initializeEngine;
   static GetAFNSStateNativeDart? _getState;
   static UpdateAFNSStateNativeDart? _updateState;
+  static GetAFNSStateVersionNativeDart? _getStateVersion;
+  static int _cachedStateVersion = -1;
+  static String? _cachedState;
+  static AsyncAFNSCallNativeDart? _compileWidgetAsync;
+  static AsyncAFNSCallNativeDart? _executeLogicAsync;
+  static CancelAFNSRequestNativeDart? _cancelRequest;
+  static ReceivePort? _asyncPort;
+  static final Map<int, Completer<String?>> _pendingRequests = {};
+  static final _AFNSNativeArena _arena = _AFNSNativeArena();
+  static final Map<String, AFNSLiveWidgetTree> _liveTrees = {};
+  static SetAFNSStateIntNativeDart? _stateSetInt;
+  static SetAFNSStateDoubleNativeDart? _stateSetDouble;
+  static SetAFNSStateBoolNativeDart? _stateSetBool;
+  static SetAFNSStateStringNativeDart? _stateSetString;
+  static RemoveAFNSStateNativeDart? _stateRemove;
+  static FlushAFNSStateNativeDart? _stateFlush;
+  static bool _stateFlushScheduled = false;
+  static AsyncAFNSCallNativeDart? _bindWidget;
+  static BindAFNSLogicNativeDart? _bindLogic;
+  static UnbindAFNSNativeDart? _unbind;
+  static ReceivePort? _bindingPort;
+  static final Map<int, void Function(Object?)> _bindings = {};
+  static final Map<String, int> _widgetBindings = {};
+  static SetAFNSTraceFlowNativeDart? _setTraceFlow;
 
   // Platform-specific library names
   static const Map<String, String> _platformLibs = {
@@ -45,7 +390,13 @@ class AFNSRuntime {
   };
 
   // Initialize AFNS Runtime
-  static Future<void> initialize() async {
+  // |bundlePath| names a bundle written at build time by afns_bundle_build;
+  // sources in it are served precompiled instead of compiled on first use.
+  // |cacheDirectory| (the app's cache directory) keeps what is compiled at
+  // run time for the next launch. |prewarm| warms the compiler on an engine
+  // worker so the first widget does not pay for it.
+  static Future<void> initialize(
+      {String? bundlePath, String? cacheDirectory, bool prewarm = true}) async {
     try {
       // Platform detection
       String platform = '';
@@ -68,25 +419,33 @@ class AFNSRuntime {
           .lookup<NativeFunction<CompileAFNSWidgetNative>>('compile_afns_widget')
           .asFunction();
 
-      _executeLogic = _afnsLib!
-          .lookup<NativeFunction<ExecuteAFNSLogicNative>>('execute_afns_logic')
+      _compileWidgetBatch = _afnsLib!
+          .lookup<NativeFunction<CompileAFNSWidgetBatchNative>>('compile_afns_widget_batch')
           .asFunction();
 
       _initializeEngine = _afnsLib!
           .lookup<NativeFunction<InitializeAFNSEngineNative>>('initialize_afns_engine')
           .asFunction();
 
-      _getState = _afnsLib!
-          .lookup<NativeFunction<GetAFNSStateNative>>('get_afns_state')
-          .asFunction();
-
-      _updateState = _afnsLib!
-          .lookup<NativeFunction<UpdateAFNSStateNative>>('update_afns_state')
-          .asFunction();
-
       // Initialize AFNS Engine
       _initializeEngine?.();
 
+      _initializeContext();
+
+      if (bundlePath != null) {
+        _loadBundle(bundlePath);
+      }
+      if (cacheDirectory != null) {
+        _enableDiskCache(cacheDirectory);
+      }
+      if (prewarm) {
+        _afnsLib!
+            .lookup<NativeFunction<InitializeAFNSEngineNative>>('afns_engine_prewarm')
+            .asFunction<InitializeAFNSEngineNativeDart>()();
+      }
+
+      _initializeAsync();
+
       print('🚀 AFNS Runtime initialized successfully!');
     } catch (e) {
       print('❌ AFNS Runtime initialization failed: $e');
@@ -98,9 +457,12 @@ class AFNSRuntime {
   static Widget compileAFNSWidget(String afnsCode) {
     try {
       if (_compileWidget != null) {
-        final result = _compileWidget!(afnsCode.toNativeUtf8());
-        final widgetCode = result.toDartString();
-        return _parseWidgetFromCode(widgetCode);
+        final inputLen = _arena.writeInput(afnsCode);
+        final widgetCode = _traced('AFNS compileAFNSWidget', () => _arena.readOutput(
+            (out, outCap, outLen) => _compileWidget!(_arena.input, inputLen, out, outCap, outLen)));
+        if (widgetCode != null) {
+          return _parseWidgetFromCode(widgetCode);
+        }
       }
     } catch (e) {
       print('❌ AFNS Widget compilation failed: $e');
@@ -110,13 +472,402 @@ class AFNSRuntime {
     return _generateFallbackWidget(afnsCode);
   }
 
+  // 🎯 COMPILE AFNS CODE TO A BINARY WIDGET TREE
+  // Walks the engine's tree in place instead of re-parsing widget text;
+  // falls back to the text path if the engine speaks another schema.
+  static Widget compileAFNSWidgetTree(String afnsCode) {
+    try {
+      if (_compileWidgetTree != null) {
+        final inputLen = _arena.writeInput(afnsCode);
+        final bytes = _traced('AFNS compileAFNSWidgetTree', () => _arena.readOutputBytes(
+            (out, outCap, outLen) => _compileWidgetTree!(_arena.input, inputLen, out, outCap, outLen)));
+        final tree = bytes == null ? null : AFNSWidgetTree.tryParse(bytes);
+        if (tree != null) {
+          return tree.build();
+        }
+      }
+    } catch (e) {
+      print('❌ AFNS widget tree compilation failed: $e');
+    }
+    return compileAFNSWidget(afnsCode);
+  }
+
+  // 🎯 COMPILE AFNS CODE TO A LIVE WIDGET TREE
+  // Keeps one tree per [widgetId] and applies only what changed since the
+  // last call, so after a state update Flutter rebuilds just the nodes that
+  // changed. Every call with the same id returns the same widget.
+  static Widget compileAFNSLiveWidget(String widgetId, String afnsCode) {
+    try {
+      // A second try after getting out of step starts from an empty tree
+      for (var attempt = 0; attempt < 2 && _compileWidgetPatch != null; attempt++) {
+        final live = _liveTrees.putIfAbsent(widgetId, AFNSLiveWidgetTree.new);
+        final (idLen, codeLen) = _arena.writeInputPair(widgetId, afnsCode);
+        final bytes = _traced('AFNS compileAFNSLiveWidget', () => _arena.readOutputBytes(
+            (out, outCap, outLen) => _compileWidgetPatch!(
+                _arena.input, idLen, _arena.input.elementAt(idLen), codeLen, out, outCap, outLen)));
+        if (bytes == null) break;
+        if (live.apply(bytes)) {
+          return live.widget;
+        }
+        resetAFNSLiveWidget(widgetId);
+      }
+    } catch (e) {
+      print('❌ AFNS live widget compilation failed: $e');
+    }
+    return compileAFNSWidgetTree(afnsCode);
+  }
+
+  // Drops the tree kept for [widgetId], e.g. when its screen goes away
+  static void resetAFNSLiveWidget(String widgetId) {
+    _liveTrees.remove(widgetId);
+    if (_resetWidgetPatch != null) {
+      final idLen = _arena.writeInput(widgetId);
+      _resetWidgetPatch!(_arena.input, idLen);
+    }
+  }
+
+  // A missing or stale bundle only costs the compile it would have saved
+  static void _loadBundle(String bundlePath) {
+    final loadBundle = _afnsLib!
+        .lookup<NativeFunction<LoadAFNSBundleNative>>('afns_bundle_load')
+        .asFunction<LoadAFNSBundleNativeDart>();
+    final path = bundlePath.toNativeUtf8();
+    try {
+      if (loadBundle(path) != _afnsOk) {
+        print('❌ AFNS bundle not loaded: $bundlePath');
+      }
+    } finally {
+      malloc.free(path);
+    }
+  }
+
+  // Microseconds from library load to each startup phase reached so far,
+  // keyed by phase name (AFNS_STARTUP_* in afns_engine_c_api.h)
+  static Map<String, int> startupPhases() {
+    if (_afnsLib == null) {
+      return const {};
+    }
+    final phaseMicros = _afnsLib!
+        .lookup<NativeFunction<StartupPhaseNative>>('afns_startup_phase_us')
+        .asFunction<StartupPhaseNativeDart>();
+    const names = [
+      'library_loaded',
+      'engine_create_begin',
+      'engine_created',
+      'compiler_resolved',
+      'prewarm_begin',
+      'prewarm_done',
+    ];
+    final phases = <String, int>{};
+    for (var i = 0; i < names.length; i++) {
+      final micros = phaseMicros(i);
+      if (micros >= 0) {
+        phases[names[i]] = micros;
+      }
+    }
+    return phases;
+  }
+
+  // Engine counters, latency histograms and cache stats, as documented for
+  // afns_engine_get_stats in afns_engine_c_api.h; empty without the engine
+  static Map<String, dynamic> engineStats() {
+    if (_afnsLib == null) {
+      return const {};
+    }
+    final getStats = _afnsLib!
+        .lookup<NativeFunction<GetAFNSStateNative>>('afns_engine_get_stats')
+        .asFunction<GetAFNSStateNativeDart>();
+    final json = _arena.readOutput(getStats);
+    return json == null ? const {} : jsonDecode(json) as Map<String, dynamic>;
+  }
+
+  // 🎯 ENGINE TRACING
+  // Records the engine's stage spans until stopTracing, see afns_trace_start;
+  // while on, calls from Dart also show up as timeline slices whose flow
+  // links them to the engine spans they caused
+  static void startTracing() {
+    if (_afnsLib == null) {
+      return;
+    }
+    _afnsLib!
+        .lookup<NativeFunction<InitializeAFNSEngineNative>>('afns_trace_start')
+        .asFunction<InitializeAFNSEngineNativeDart>()();
+    _setTraceFlow = _afnsLib!
+        .lookup<NativeFunction<SetAFNSTraceFlowNative>>('afns_trace_set_flow')
+        .asFunction();
+  }
+
+  static void stopTracing() {
+    if (_afnsLib == null) {
+      return;
+    }
+    _afnsLib!
+        .lookup<NativeFunction<InitializeAFNSEngineNative>>('afns_trace_stop')
+        .asFunction<InitializeAFNSEngineNativeDart>()();
+    _setTraceFlow = null;
+  }
+
+  // Spans since startTracing as Chrome trace JSON, or a binary Perfetto
+  // trace with [perfetto]; null without the engine
+  static Uint8List? dumpTrace({bool perfetto = false}) {
+    if (_afnsLib == null) {
+      return null;
+    }
+    final dump = _afnsLib!
+        .lookup<NativeFunction<DumpAFNSTraceNative>>('afns_trace_dump')
+        .asFunction<DumpAFNSTraceNativeDart>();
+    final format = perfetto ? _afnsTraceFormatPerfetto : _afnsTraceFormatChromeJson;
+    // Spans recorded between the size query and the copy can outgrow the
+    // buffer again while tracing is on
+    for (var attempt = 0; attempt < 3; attempt++) {
+      final bytes = _arena.readOutputBytes((out, outCap, outLen) => dump(format, out, outCap, outLen));
+      if (bytes != null) {
+        return Uint8List.fromList(bytes);
+      }
+    }
+    return null;
+  }
+
+  // Runs [call] in a timeline slice and hands its flow id to the engine for
+  // the spans the call records; just runs it while not tracing
+  static T _traced<T>(String name, T Function() call) {
+    final setTraceFlow = _setTraceFlow;
+    if (setTraceFlow == null) {
+      return call();
+    }
+    final flow = developer.Flow.begin();
+    developer.Timeline.startSync(name, flow: flow);
+    setTraceFlow(flow.id);
+    try {
+      return call();
+    } finally {
+      setTraceFlow(0);
+      developer.Timeline.finishSync();
+    }
+  }
+
+  static void _enableDiskCache(String cacheDirectory) {
+    final enableDiskCache = _afnsLib!
+        .lookup<NativeFunction<EnableDiskCacheNative>>('afns_enable_disk_cache')
+        .asFunction<EnableDiskCacheNativeDart>();
+    final directory = '$cacheDirectory/afns_compile_cache'.toNativeUtf8();
+    try {
+      if (enableDiskCache(directory, 0) != _afnsOk) {
+        print('❌ AFNS disk cache not enabled: $cacheDirectory');
+      }
+    } finally {
+      malloc.free(directory);
+    }
+  }
+
+  // Binds the calls that read or change state to this isolate's context,
+  // keeping the signatures of their context-less counterparts
+  static void _initializeContext() {
+    final createContext = _afnsLib!
+        .lookup<NativeFunction<CreateAFNSContextNative>>('afns_context_create')
+        .asFunction<CreateAFNSContextNativeDart>();
+    final destroy =
+        NativeFinalizer(_afnsLib!.lookup<NativeFinalizerFunction>('afns_context_destroy'));
+    final context = _AFNSContext(createContext(), destroy);
+    _context = context;
+
+    final compileWidgetTree = _afnsLib!
+        .lookup<NativeFunction<ContextAFNSBufferCallNative>>('afns_context_compile_widget_tree')
+        .asFunction<ContextAFNSBufferCallNativeDart>();
+    _compileWidgetTree = (input, inputLen, out, outCap, outLen) =>
+        compileWidgetTree(context.handle, input, inputLen, out, outCap, outLen);
+
+    final compileWidgetPatch = _afnsLib!
+        .lookup<NativeFunction<ContextCompileAFNSWidgetPatchNative>>(
+            'afns_context_compile_widget_patch')
+        .asFunction<ContextCompileAFNSWidgetPatchNativeDart>();
+    _compileWidgetPatch = (widgetId, widgetIdLen, input, inputLen, out, outCap, outLen) =>
+        compileWidgetPatch(
+            context.handle, widgetId, widgetIdLen, input, inputLen, out, outCap, outLen);
+
+    final resetWidgetPatch = _afnsLib!
+        .lookup<NativeFunction<ContextResetAFNSWidgetPatchNative>>(
+            'afns_context_widget_patch_reset')
+        .asFunction<ContextResetAFNSWidgetPatchNativeDart>();
+    _resetWidgetPatch =
+        (widgetId, widgetIdLen) => resetWidgetPatch(context.handle, widgetId, widgetIdLen);
+
+    final executeLogic = _afnsLib!
+        .lookup<NativeFunction<ContextAFNSBufferCallNative>>('afns_context_execute_logic')
+        .asFunction<ContextAFNSBufferCallNativeDart>();
+    _executeLogic = (input, inputLen, out, outCap, outLen) =>
+        executeLogic(context.handle, input, inputLen, out, outCap, outLen);
+
+    final getState = _afnsLib!
+        .lookup<NativeFunction<ContextGetAFNSStateNative>>('afns_context_get_state')
+        .asFunction<ContextGetAFNSStateNativeDart>();
+    _getState = (out, outCap, outLen) => getState(context.handle, out, outCap, outLen);
+
+    final updateState = _afnsLib!
+        .lookup<NativeFunction<ContextUpdateAFNSStateNative>>('afns_context_update_state')
+        .asFunction<ContextUpdateAFNSStateNativeDart>();
+    _updateState = (input, inputLen) => updateState(context.handle, input, inputLen);
+
+    final getStateVersion = _afnsLib!
+        .lookup<NativeFunction<ContextGetAFNSStateVersionNative>>('afns_context_state_version')
+        .asFunction<ContextGetAFNSStateVersionNativeDart>();
+    _getStateVersion = () => getStateVersion(context.handle);
+
+    final stateSetInt = _afnsLib!
+        .lookup<NativeFunction<ContextSetAFNSStateIntNative>>('afns_context_state_set_int')
+        .asFunction<ContextSetAFNSStateIntNativeDart>();
+    _stateSetInt = (path, pathLen, value) => stateSetInt(context.handle, path, pathLen, value);
+    final stateSetDouble = _afnsLib!
+        .lookup<NativeFunction<ContextSetAFNSStateDoubleNative>>('afns_context_state_set_double')
+        .asFunction<ContextSetAFNSStateDoubleNativeDart>();
+    _stateSetDouble =
+        (path, pathLen, value) => stateSetDouble(context.handle, path, pathLen, value);
+    final stateSetBool = _afnsLib!
+        .lookup<NativeFunction<ContextSetAFNSStateBoolNative>>('afns_context_state_set_bool')
+        .asFunction<ContextSetAFNSStateBoolNativeDart>();
+    _stateSetBool = (path, pathLen, value) => stateSetBool(context.handle, path, pathLen, value);
+    final stateSetString = _afnsLib!
+        .lookup<NativeFunction<ContextSetAFNSStateStringNative>>('afns_context_state_set_string')
+        .asFunction<ContextSetAFNSStateStringNativeDart>();
+    _stateSetString = (path, pathLen, value, valueLen) =>
+        stateSetString(context.handle, path, pathLen, value, valueLen);
+    final stateRemove = _afnsLib!
+        .lookup<NativeFunction<ContextUpdateAFNSStateNative>>('afns_context_state_remove')
+        .asFunction<ContextUpdateAFNSStateNativeDart>();
+    _stateRemove = (path, pathLen) => stateRemove(context.handle, path, pathLen);
+    final stateFlush = _afnsLib!
+        .lookup<NativeFunction<ContextFlushAFNSStateNative>>('afns_context_state_flush')
+        .asFunction<ContextFlushAFNSStateNativeDart>();
+    _stateFlush = () => stateFlush(context.handle);
+  }
+
+  // Async calls post their results to one shared port, routed by request id
+  static void _initializeAsync() {
+    // Engines built without the Dart SDK leave out the port calls
+    if (!_afnsLib!.providesSymbol('afns_init_dart_api')) {
+      print('❌ AFNS async API unavailable: engine built without Dart SDK');
+      return;
+    }
+    final initDartApi = _afnsLib!
+        .lookup<NativeFunction<InitDartApiNative>>('afns_init_dart_api')
+        .asFunction<InitDartApiNativeDart>();
+    if (initDartApi(NativeApi.initializeApiDLData) != 0) {
+      print('❌ AFNS async API unavailable: Dart API version mismatch');
+      return;
+    }
+
+    final context = _context!;
+    final compileWidgetAsync = _afnsLib!
+        .lookup<NativeFunction<ContextAsyncAFNSCallNative>>('afns_context_compile_widget_async')
+        .asFunction<ContextAsyncAFNSCallNativeDart>();
+    _compileWidgetAsync = (widgetId, widgetIdLen, input, inputLen, port) =>
+        compileWidgetAsync(context.handle, widgetId, widgetIdLen, input, inputLen, port);
+    final executeLogicAsync = _afnsLib!
+        .lookup<NativeFunction<ContextAsyncAFNSCallNative>>('afns_context_execute_logic_async')
+        .asFunction<ContextAsyncAFNSCallNativeDart>();
+    _executeLogicAsync = (widgetId, widgetIdLen, input, inputLen, port) =>
+        executeLogicAsync(context.handle, widgetId, widgetIdLen, input, inputLen, port);
+    final cancelRequest = _afnsLib!
+        .lookup<NativeFunction<ContextCancelAFNSRequestNative>>('afns_context_cancel_request')
+        .asFunction<ContextCancelAFNSRequestNativeDart>();
+    _cancelRequest = (requestId) => cancelRequest(context.handle, requestId);
+
+    _asyncPort = ReceivePort()
+      ..listen((message) {
+        final reply = message as List;
+        final completer = _pendingRequests.remove(reply[0] as int);
+        completer?.complete(reply[1] == _afnsAsyncCompleted ? reply[2] as String : null);
+      });
+
+    final bindWidget = _afnsLib!
+        .lookup<NativeFunction<ContextAsyncAFNSCallNative>>('afns_context_bind_widget')
+        .asFunction<ContextAsyncAFNSCallNativeDart>();
+    _bindWidget = (widgetId, widgetIdLen, input, inputLen, port) =>
+        bindWidget(context.handle, widgetId, widgetIdLen, input, inputLen, port);
+    final bindLogic = _afnsLib!
+        .lookup<NativeFunction<ContextBindAFNSLogicNative>>('afns_context_bind_logic')
+        .asFunction<ContextBindAFNSLogicNativeDart>();
+    _bindLogic = (input, inputLen, port) => bindLogic(context.handle, input, inputLen, port);
+    final unbind = _afnsLib!
+        .lookup<NativeFunction<ContextUnbindAFNSNative>>('afns_context_unbind')
+        .asFunction<ContextUnbindAFNSNativeDart>();
+    _unbind = (binding) => unbind(context.handle, binding);
+
+    // [binding, result]; a result can still arrive just after an unbind
+    _bindingPort = ReceivePort()
+      ..listen((message) {
+        final reply = message as List;
+        _bindings[reply[0] as int]?.call(reply[1]);
+      });
+  }
+
+  static AFNSAsyncRequest<String> _submitAsync(
+      AsyncAFNSCallNativeDart? call, String widgetId, String afnsCode) {
+    if (call == null || _asyncPort == null) {
+      return AFNSAsyncRequest(0, Future.value(null));
+    }
+    final (idLen, codeLen) = _arena.writeInputPair(widgetId, afnsCode);
+    final id = _traced('AFNS submitAsync', () => call(_arena.input, idLen,
+        _arena.input.elementAt(idLen), codeLen, _asyncPort!.sendPort.nativePort));
+    if (id <= 0) {
+      return AFNSAsyncRequest(0, Future.value(null));
+    }
+    // Results arrive through the event loop, never before this runs
+    final completer = Completer<String?>();
+    _pendingRequests[id] = completer;
+    return AFNSAsyncRequest(id, completer.future);
+  }
+
+  // 🎯 COMPILE AFNS WIDGET OFF THE UI THREAD
+  // A newer call with the same [widgetId] supersedes older pending ones.
+  static AFNSAsyncRequest<Widget> compileAFNSWidgetAsync(String widgetId, String afnsCode) {
+    final request = _submitAsync(_compileWidgetAsync, widgetId, afnsCode);
+    return AFNSAsyncRequest(request.id,
+        request.result.then((code) => code == null ? null : _parseWidgetFromCode(code)));
+  }
+
+  // 🎯 EXECUTE AFNS LOGIC OFF THE UI THREAD
+  static AFNSAsyncRequest<dynamic> executeAFNSLogicAsync(String widgetId, String afnsCode) {
+    final request = _submitAsync(_executeLogicAsync, widgetId, afnsCode);
+    return AFNSAsyncRequest(request.id,
+        request.result.then((json) => json == null ? null : _parseResultFromJson(json)));
+  }
+
+  // Returns true if the request was still pending; its future completes null
+  static bool cancelAFNSRequest(int requestId) {
+    return _cancelRequest != null && _cancelRequest!(requestId) == _afnsOk;
+  }
+
+  // 🎯 COMPILE MANY AFNS WIDGETS IN ONE NATIVE CALL
+  static List<Widget> compileAFNSWidgets(List<String> afnsCodes) {
+    try {
+      if (_compileWidgetBatch != null) {
+        final widgetCodes = _traced(
+            'AFNS compileAFNSWidgets', () => _arena.compileBatch(afnsCodes, _compileWidgetBatch!));
+        if (widgetCodes != null) {
+          return widgetCodes.map(_parseWidgetFromCode).toList();
+        }
+      }
+    } catch (e) {
+      print('❌ AFNS batch compilation failed: $e');
+    }
+
+    // Fallback: Generate each widget from its AFNS code structure
+    return afnsCodes.map(_generateFallbackWidget).toList();
+  }
+
   // 🎯 EXECUTE AFNS LOGIC
   static dynamic executeAFNSLogic(String afnsCode) {
     try {
       if (_executeLogic != null) {
-        final result = _executeLogic!(afnsCode.toNativeUtf8());
-        final resultJson = result.toDartString();
-        return _parseResultFromJson(resultJson);
+        // Retrying after a resize reruns the logic, so the arena keeps its
+        // high-water mark and a resize only happens once per size class
+        final inputLen = _arena.writeInput(afnsCode);
+        final resultJson = _traced('AFNS executeAFNSLogic', () => _arena.readOutput(
+            (out, outCap, outLen) => _executeLogic!(_arena.input, inputLen, out, outCap, outLen)));
+        if (resultJson != null) {
+          return _parseResultFromJson(resultJson);
+        }
       }
     } catch (e) {
       print('❌ AFNS Logic execution failed: $e');
@@ -130,8 +881,17 @@ class AFNSRuntime {
   static String getAFNSState() {
     try {
       if (_getState != null) {
-        final result = _getState!();
-        return result.toDartString();
+        // Only copy the state across FFI when its version moved
+        final version = _getStateVersion?.call() ?? -1;
+        if (version >= 0 && version == _cachedStateVersion && _cachedState != null) {
+          return _cachedState!;
+        }
+        final state = _arena.readOutput(_getState!);
+        if (state != null) {
+          _cachedStateVersion = version;
+          _cachedState = state;
+          return state;
+        }
       }
     } catch (e) {
       print('❌ AFNS State retrieval failed: $e');
@@ -143,13 +903,114 @@ class AFNSRuntime {
   static void updateAFNSState(String state) {
     try {
       if (_updateState != null) {
-        _updateState!(state.toNativeUtf8());
+        final inputLen = _arena.writeInput(state);
+        _updateState!(_arena.input, inputLen);
       }
     } catch (e) {
       print('❌ AFNS State update failed: $e');
     }
   }
 
+  // 🎯 SET KEYED AFNS STATE
+  // [value] is an int, double, bool or String; null removes the path. Every
+  // binding that read [path] reruns once at the next frame, however many
+  // paths were set before it.
+  static void setAFNSState(String path, Object? value) {
+    try {
+      if (_stateFlush == null) return;
+      final int status;
+      if (value is String) {
+        final (pathLen, valueLen) = _arena.writeInputPair(path, value);
+        status = _stateSetString!(_arena.input, pathLen, _arena.input.elementAt(pathLen), valueLen);
+      } else {
+        final pathLen = _arena.writeInput(path);
+        status = switch (value) {
+          null => _stateRemove!(_arena.input, pathLen),
+          int() => _stateSetInt!(_arena.input, pathLen, value),
+          double() => _stateSetDouble!(_arena.input, pathLen, value),
+          bool() => _stateSetBool!(_arena.input, pathLen, value ? 1 : 0),
+          _ => throw ArgumentError.value(value, 'value', 'not an int, double, bool or String'),
+        };
+      }
+      if (status == _afnsOk) {
+        _scheduleStateFlush();
+      }
+    } catch (e) {
+      print('❌ AFNS State update failed: $e');
+    }
+  }
+
+  static void _scheduleStateFlush() {
+    if (_stateFlushScheduled) return;
+    _stateFlushScheduled = true;
+    SchedulerBinding.instance.scheduleFrameCallback((_) {
+      _stateFlushScheduled = false;
+      _stateFlush!();
+    });
+    SchedulerBinding.instance.ensureVisualUpdate();
+  }
+
+  // 🎯 BIND AN AFNS WIDGET TO STATE
+  // Like compileAFNSLiveWidget, but the engine recompiles the widget on its
+  // own whenever state it read changes and sends just the changed nodes.
+  // The returned widget stays the same; call unbindAFNSWidget when its
+  // screen goes away.
+  static Widget bindAFNSWidget(String widgetId, String afnsCode) {
+    unbindAFNSWidget(widgetId);
+    final live = AFNSLiveWidgetTree();
+    _liveTrees[widgetId] = live;
+    if (!_bindWidgetInto(live, widgetId, afnsCode)) {
+      _liveTrees.remove(widgetId);
+      return compileAFNSWidgetTree(afnsCode);
+    }
+    return live.widget;
+  }
+
+  static bool _bindWidgetInto(AFNSLiveWidgetTree live, String widgetId, String afnsCode) {
+    if (_bindWidget == null || _bindingPort == null) return false;
+    final (idLen, codeLen) = _arena.writeInputPair(widgetId, afnsCode);
+    final binding = _bindWidget!(_arena.input, idLen, _arena.input.elementAt(idLen), codeLen,
+        _bindingPort!.sendPort.nativePort);
+    if (binding <= 0) return false;
+    _widgetBindings[widgetId] = binding;
+    _bindings[binding] = (result) {
+      if (result == null) {
+        print('❌ AFNS bound widget does not compile: $widgetId');
+      } else if (!live.apply(result as Uint8List)) {
+        // Out of step: bind again, the next patch starts from an empty tree
+        unbindAFNS(binding);
+        _bindWidgetInto(live, widgetId, afnsCode);
+      }
+    };
+    return true;
+  }
+
+  static void unbindAFNSWidget(String widgetId) {
+    final binding = _widgetBindings.remove(widgetId);
+    if (binding != null) {
+      unbindAFNS(binding);
+      _liveTrees.remove(widgetId);
+    }
+  }
+
+  // 🎯 BIND AFNS LOGIC TO STATE
+  // [onResult] gets what executeAFNSLogic would return, now and after every
+  // change to state the logic read. Returns the binding for unbindAFNS, 0
+  // if the engine cannot bind.
+  static int bindAFNSLogic(String afnsCode, void Function(dynamic result) onResult) {
+    if (_bindLogic == null || _bindingPort == null) return 0;
+    final inputLen = _arena.writeInput(afnsCode);
+    final binding = _bindLogic!(_arena.input, inputLen, _bindingPort!.sendPort.nativePort);
+    if (binding <= 0) return 0;
+    _bindings[binding] = (result) => onResult(_parseResultFromJson(result as String));
+    return binding;
+  }
+
+  static void unbindAFNS(int binding) {
+    _bindings.remove(binding);
+    _unbind?.call(binding);
+  }
+
   // 🎯 HELPER METHODS
 
   // Parse generated Flutter widget code
@@ -267,6 +1128,371 @@ class AFNSRuntime {
   }
 }
 
+// 🎯 AFNS BINARY WIDGET TREE
+// Reader for the format in engine/afns_widget_tree.h. Nodes and properties
+// are read from the byte view on demand; only strings that a widget
+// actually shows are decoded.
+class AFNSWidgetTree {
+  static const int _magic = 0x54574641; // "AFWT"
+  static const int _versionMajor = 1;
+  static const int _none = 0xFFFFFFFF;
+  static const int _headerSize = 32;
+  static const int _nodeSize = 24;
+  static const int _propertySize = 16;
+
+  // AFNSWidgetType
+  static const int typeWindow = 1;
+  static const int typeButton = 2;
+  static const int typeTextField = 3;
+  static const int typeListBox = 4;
+  static const int typeDialog = 5;
+  static const int typeText = 6;
+  static const int typeColumn = 7;
+  static const int typeRow = 8;
+  static const int typeContainer = 9;
+
+  // AFNSPropertyType
+  static const int _propString = 0;
+  static const int _propInt = 1;
+  static const int _propDouble = 2;
+  static const int _propBool = 3;
+
+  final ByteData _data;
+  final int nodeCount;
+  final int _propertyCount;
+  final int _stringCount;
+  final int _nodesStart;
+  final int _propertiesStart;
+  final int _stringOffsetsStart;
+  final int _blobStart;
+
+  AFNSWidgetTree._(this._data, this.nodeCount, this._propertyCount, this._stringCount)
+      : _nodesStart = _headerSize,
+        _propertiesStart = _headerSize + _align(nodeCount * _nodeSize),
+        _stringOffsetsStart =
+            _headerSize + _align(nodeCount * _nodeSize) + _align(_propertyCount * _propertySize),
+        _blobStart = _headerSize +
+            _align(nodeCount * _nodeSize) +
+            _align(_propertyCount * _propertySize) +
+            _align((_stringCount + 1) * 4);
+
+  static int _align(int size) => (size + 7) & ~7;
+
+  // Returns null on a bad magic, an unknown major version or a truncated
+  // buffer, all checked from the header alone
+  static AFNSWidgetTree? tryParse(Uint8List bytes) {
+    if (bytes.lengthInBytes < _headerSize) return null;
+    final data = ByteData.sublistView(bytes);
+    if (data.getUint32(0, Endian.little) != _magic ||
+        data.getUint16(4, Endian.little) != _versionMajor ||
+        data.getUint32(24, Endian.little) > bytes.lengthInBytes) {
+      return null;
+    }
+    return AFNSWidgetTree._(
+      data,
+      data.getUint32(8, Endian.little),
+      data.getUint32(12, Endian.little),
+      data.getUint32(16, Endian.little),
+    );
+  }
+
+  int nodeType(int node) => _data.getUint16(_nodesStart + node * _nodeSize, Endian.little);
+  String nodeName(int node) => string(_data.getUint32(_nodesStart + node * _nodeSize + 4, Endian.little));
+  int _propertyCountOf(int node) => _data.getUint16(_nodesStart + node * _nodeSize + 2, Endian.little);
+  int _firstProperty(int node) => _data.getUint32(_nodesStart + node * _nodeSize + 8, Endian.little);
+  int _firstChild(int node) => _data.getUint32(_nodesStart + node * _nodeSize + 12, Endian.little);
+  int _nextSibling(int node) => _data.getUint32(_nodesStart + node * _nodeSize + 16, Endian.little);
+
+  String string(int index) {
+    final start = _data.getUint32(_stringOffsetsStart + index * 4, Endian.little);
+    final end = _data.getUint32(_stringOffsetsStart + (index + 1) * 4, Endian.little);
+    return utf8.decode(Uint8List.sublistView(_data, _blobStart + start, _blobStart + end));
+  }
+
+  Iterable<int> children(int node) sync* {
+    for (var child = _firstChild(node); child != _none; child = _nextSibling(child)) {
+      yield child;
+    }
+  }
+
+  Iterable<int> get roots sync* {
+    if (nodeCount == 0) return;
+    for (var root = 0; root != _none; root = _nextSibling(root)) {
+      yield root;
+    }
+  }
+
+  // Property value by key, or null; keys are compared after decoding
+  Object? property(int node, String key) {
+    final first = _firstProperty(node);
+    for (var i = 0; i < _propertyCountOf(node); i++) {
+      final offset = _propertiesStart + (first + i) * _propertySize;
+      if (string(_data.getUint32(offset, Endian.little)) != key) continue;
+      final type = _data.getUint16(offset + 4, Endian.little);
+      switch (type) {
+        case _propString:
+          return string(_data.getUint64(offset + 8, Endian.little));
+        case _propInt:
+          return _data.getInt64(offset + 8, Endian.little);
+        case _propDouble:
+          return _data.getFloat64(offset + 8, Endian.little);
+        case _propBool:
+          return _data.getUint64(offset + 8, Endian.little) != 0;
+      }
+    }
+    return null;
+  }
+
+  Widget build() {
+    final widgets = roots.map(buildNode).toList();
+    if (widgets.isEmpty) return const SizedBox.shrink();
+    if (widgets.length == 1) return widgets.first;
+    return Column(mainAxisSize: MainAxisSize.min, children: widgets);
+  }
+
+  Widget buildNode(int node) => buildWidget(nodeType(node), nodeName(node),
+      (key) => property(node, key), children(node).map(buildNode).toList());
+
+  // Flutter widget for one node, also used by AFNSLiveWidgetTree
+  static Widget buildWidget(
+      int type, String name, Object? Function(String key) property, List<Widget> children) {
+    String? text(String key) => property(key)?.toString();
+    final width = (property('width') as num?)?.toDouble();
+    final height = (property('height') as num?)?.toDouble();
+
+    Widget widget;
+    switch (type) {
+      case typeWindow:
+        widget = Column(mainAxisSize: MainAxisSize.min, children: [
+          Text(text('title') ?? 'AFNS Window',
+              style: const TextStyle(fontSize: 18, fontWeight: FontWeight.bold)),
+          ...children,
+        ]);
+        break;
+      case typeButton:
+        widget = ElevatedButton(
+          onPressed: property('enabled') == false ? null : () {},
+          child: Text(text('text') ?? 'AFNS Button'),
+        );
+        break;
+      case typeTextField:
+        widget = TextField(decoration: InputDecoration(hintText: text('placeholder')));
+        break;
+      case typeListBox:
+        widget = ListView(shrinkWrap: true, children: children);
+        break;
+      case typeDialog:
+        widget = AlertDialog(
+          title: Text(text('title') ?? ''),
+          content: Text(text('message') ?? ''),
+        );
+        break;
+      case typeText:
+        widget = Text(text('text') ?? '');
+        break;
+      case typeColumn:
+        widget = Column(mainAxisSize: MainAxisSize.min, children: children);
+        break;
+      case typeRow:
+        widget = Row(mainAxisSize: MainAxisSize.min, children: children);
+        break;
+      case typeContainer:
+        widget = Container(child: children.isEmpty ? null : children.first);
+        break;
+      default:
+        widget = Container(
+          child: children.isEmpty ? Text('AFNS Widget: $name') : Column(children: children),
+        );
+    }
+
+    if (width != null || height != null) {
+      widget = SizedBox(width: width, height: height, child: widget);
+    }
+    return widget;
+  }
+}
+
+// 🎯 AFNS LIVE WIDGET TREE
+// Mirror of the engine's tree for one widget id, kept current by the
+// patches of engine/afns_widget_diff.h. Each node notifies only its own
+// view and caches that view, so a rebuild stops at nodes a patch did not
+// touch.
+class AFNSLiveWidgetTree {
+  static const int _magic = 0x50574641; // "AFWP"
+  static const int _versionMajor = 1;
+  static const int _none = 0xFFFFFFFF;
+  static const int _headerSize = 32;
+  static const int _opSize = 24;
+
+  // AFNSWidgetPatchKind
+  static const int _opInsert = 0;
+  static const int _opRemove = 1;
+  static const int _opMove = 2;
+  static const int _opSetProperty = 3;
+  static const int _opRemoveProperty = 4;
+
+  final Map<int, _AFNSLiveNode> _nodes = {};
+  final _AFNSLiveNode _roots = _AFNSLiveNode(-1, -1, '');
+  int _generation = 0;
+
+  Widget get widget => _roots.view;
+
+  // False if [bytes] is not a patch for the current generation or names a
+  // node that does not exist; the tree is then out of step with the engine
+  // and must be reset
+  bool apply(Uint8List bytes) {
+    if (bytes.lengthInBytes < _headerSize) return false;
+    final data = ByteData.sublistView(bytes);
+    if (data.getUint32(0, Endian.little) != _magic ||
+        data.getUint16(4, Endian.little) != _versionMajor ||
+        data.getUint32(20, Endian.little) > bytes.lengthInBytes) {
+      return false;
+    }
+    final opCount = data.getUint32(8, Endian.little);
+    final stringCount = data.getUint32(12, Endian.little);
+    final base = data.getUint32(24, Endian.little);
+    final stringsStart = _headerSize + AFNSWidgetTree._align(opCount * _opSize);
+    final blobStart = stringsStart + AFNSWidgetTree._align((stringCount + 1) * 4);
+
+    String string(int index) {
+      final start = data.getUint32(stringsStart + index * 4, Endian.little);
+      final end = data.getUint32(stringsStart + (index + 1) * 4, Endian.little);
+      return utf8.decode(Uint8List.sublistView(data, blobStart + start, blobStart + end));
+    }
+
+    final dirty = <_AFNSLiveNode>{};
+    if (base == 0) {
+      _nodes.clear();
+      _roots.children.clear();
+      dirty.add(_roots);
+    } else if (base != _generation) {
+      return false;
+    }
+
+    try {
+      for (var i = 0; i < opCount; i++) {
+        final op = _headerSize + i * _opSize;
+        final kind = data.getUint16(op, Endian.little);
+        final type = data.getUint16(op + 2, Endian.little);
+        final id = data.getUint32(op + 4, Endian.little);
+        final parentOrKey = data.getUint32(op + 8, Endian.little);
+        final after = data.getUint32(op + 12, Endian.little);
+        final value = op + 16;
+
+        if (kind == _opInsert) {
+          final node = _AFNSLiveNode(id, type, string(data.getUint32(value, Endian.little)));
+          _nodes[id] = node;
+          if (!_place(node, parentOrKey, after, dirty)) return false;
+          continue;
+        }
+        final node = _nodes[id];
+        if (node == null) return false;
+        switch (kind) {
+          case _opRemove:
+            dirty.add(node.parent!);
+            node.parent!.children.remove(node);
+            _forget(node);
+            break;
+          case _opMove:
+            dirty.add(node.parent!);
+            node.parent!.children.remove(node);
+            if (!_place(node, parentOrKey, after, dirty)) return false;
+            break;
+          case _opSetProperty:
+            node.properties[string(parentOrKey)] = switch (type) {
+              AFNSWidgetTree._propString => string(data.getUint32(value, Endian.little)),
+              AFNSWidgetTree._propInt => data.getInt64(value, Endian.little),
+              AFNSWidgetTree._propDouble => data.getFloat64(value, Endian.little),
+              _ => data.getUint64(value, Endian.little) != 0,
+            };
+            dirty.add(node);
+            break;
+          case _opRemoveProperty:
+            node.properties.remove(string(parentOrKey));
+            dirty.add(node);
+            break;
+          default:
+            return false;
+        }
+      }
+    } on RangeError {
+      return false;
+    }
+
+    _generation = data.getUint32(28, Endian.little);
+    for (final node in dirty) {
+      node.changed();
+    }
+    return true;
+  }
+
+  bool _place(_AFNSLiveNode node, int parentId, int afterId, Set<_AFNSLiveNode> dirty) {
+    final parent = parentId == _none ? _roots : _nodes[parentId];
+    if (parent == null) return false;
+    final siblings = parent.children;
+    var index = 0;
+    if (afterId != _none) {
+      // Appending is the common case, keep it O(1)
+      index = siblings.isNotEmpty && siblings.last.id == afterId
+          ? siblings.length
+          : siblings.indexWhere((sibling) => sibling.id == afterId) + 1;
+      if (index == 0) return false;
+    }
+    siblings.insert(index, node);
+    node.parent = parent;
+    dirty.add(parent);
+    return true;
+  }
+
+  void _forget(_AFNSLiveNode node) {
+    _nodes.remove(node.id);
+    for (final child in node.children) {
+      _forget(child);
+    }
+  }
+}
+
+class _AFNSLiveNode extends ChangeNotifier {
+  _AFNSLiveNode(this.id, this.type, this.name);
+
+  final int id;
+  final int type;
+  final String name;
+  final Map<String, Object> properties = {};
+  final List<_AFNSLiveNode> children = [];
+  _AFNSLiveNode? parent;
+
+  // One widget instance per node: a parent rebuilding hands Flutter the
+  // identical child widget, which it skips
+  late final Widget view = _AFNSLiveNodeView(key: ValueKey(id), node: this);
+
+  void changed() => notifyListeners();
+}
+
+class _AFNSLiveNodeView extends StatelessWidget {
+  final _AFNSLiveNode node;
+
+  const _AFNSLiveNodeView({Key? key, required this.node}) : super(key: key);
+
+  @override
+  Widget build(BuildContext context) {
+    return ListenableBuilder(
+      listenable: node,
+      builder: (context, _) {
+        final children = node.children.map((child) => child.view).toList();
+        if (node.id < 0) {
+          // The top level, laid out like AFNSWidgetTree.build
+          if (children.isEmpty) return const SizedBox.shrink();
+          if (children.length == 1) return children.first;
+          return Column(mainAxisSize: MainAxisSize.min, children: children);
+        }
+        return AFNSWidgetTree.buildWidget(
+            node.type, node.name, (key) => node.properties[key], children);
+      },
+    );
+  }
+}
+
 // 🎯 AFNS-SPECIFIC WIDGET CLASSES
 
 class AFNSAppWidget extends StatelessWidget {
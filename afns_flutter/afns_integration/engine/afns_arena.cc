@@ -0,0 +1,117 @@
+// 🚀 AFNS COMPILE ARENA
+// Bump allocation for per-compilation temporaries, released in one step
+
+#include "afns_arena.h"
+
+#include <algorithm>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // anonymous namespace
+
+AFNSArena::AFNSArena(size_t block_size)
+    : block_size_(block_size) {}
+
+void* AFNSArena::Allocate(size_t size, size_t alignment) {
+    ++allocation_count_;
+    size_t start = blocks_.empty() ? 0 : AlignUp(offset_, alignment);
+    if (blocks_.empty() || start + size > blocks_[current_].size) {
+        NextBlock(size, alignment);
+        start = offset_;
+    }
+    // Padding counts as in use so Rewind can restore the total exactly
+    bytes_in_use_ += start - offset_ + size;
+    offset_ = start + size;
+    peak_bytes_ = std::max(peak_bytes_, bytes_in_use_);
+    return blocks_[current_].data.get() + start;
+}
+
+void AFNSArena::NextBlock(size_t size, size_t alignment) {
+    // The tail of the block being left is wasted but still counted
+    if (!blocks_.empty()) {
+        bytes_in_use_ += blocks_[current_].size - offset_;
+    }
+    const size_t next = blocks_.empty() ? 0 : current_ + 1;
+    // operator new[] memory is aligned for any fundamental type
+    const size_t needed = size + (alignment > alignof(std::max_align_t) ? alignment : 0);
+    if (next == blocks_.size() || blocks_[next].size < needed) {
+        const size_t block_size = std::max(block_size_, needed);
+        blocks_.insert(blocks_.begin() + next, Block{std::unique_ptr<char[]>(new char[block_size]), block_size});
+        bytes_reserved_ += block_size;
+    }
+    current_ = next;
+    offset_ = 0;
+    if (alignment > alignof(std::max_align_t)) {
+        const auto address = reinterpret_cast<uintptr_t>(blocks_[current_].data.get());
+        offset_ = AlignUp(address, alignment) - address;
+        bytes_in_use_ += offset_;
+    }
+}
+
+void AFNSArena::Rewind(const Mark& mark) {
+    current_ = mark.block;
+    offset_ = mark.offset;
+    bytes_in_use_ = mark.bytes_in_use;
+}
+
+void AFNSArena::Reset() {
+    Rewind({0, 0, 0});
+    if (bytes_reserved_ <= kMaxRetainedBytes) {
+        return;
+    }
+    // Keep blocks in order until the limit, dropping the ones that do not fit
+    size_t retained = 0;
+    auto kept = std::remove_if(blocks_.begin(), blocks_.end(), [&retained](const Block& block) {
+        if (retained + block.size > kMaxRetainedBytes) {
+            return true;
+        }
+        retained += block.size;
+        return false;
+    });
+    blocks_.erase(kept, blocks_.end());
+    bytes_reserved_ = retained;
+}
+
+AFNSArena* ThreadAFNSArena() {
+    thread_local AFNSArena arena;
+    return &arena;
+}
+
+AFNSArenaScope::AFNSArenaScope(AFNSArena* arena)
+    : arena_(arena),
+      mark_(arena->GetMark()),
+      allocation_count_(arena->allocation_count()),
+      outer_peak_bytes_(arena->peak_bytes()) {
+    arena_->set_peak_bytes(mark_.bytes_in_use);
+}
+
+AFNSArenaScope::~AFNSArenaScope() {
+    const size_t peak = arena_->peak_bytes();
+    if (mark_.bytes_in_use == 0) {
+        // Outermost scope: also trim what an oversized request left behind
+        arena_->Reset();
+    } else {
+        arena_->Rewind(mark_);
+    }
+    arena_->set_peak_bytes(std::max(outer_peak_bytes_, peak));
+}
+
+uint64_t AFNSArenaScope::allocations() const {
+    return arena_->allocation_count() - allocation_count_;
+}
+
+size_t AFNSArenaScope::peak_bytes() const {
+    return arena_->peak_bytes() - mark_.bytes_in_use;
+}
+
+} // namespace afns
+
+} // namespace flutter
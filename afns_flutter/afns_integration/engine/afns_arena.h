@@ -0,0 +1,161 @@
+// 🚀 AFNS COMPILE ARENA
+// Bump allocation for per-compilation temporaries, released in one step
+
+#ifndef FLUTTER_AFNS_AFNS_ARENA_H_
+#define FLUTTER_AFNS_AFNS_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// 🎯 AFNS ARENA
+// Hands out memory from a list of blocks by bumping a cursor; individual
+// frees are no-ops. Rewinding to a mark (or Reset) releases everything
+// allocated since in O(1) and keeps the blocks for the next request, so a
+// warmed-up arena stops calling malloc. Not thread-safe: use one arena per
+// thread (see ThreadAFNSArena).
+class AFNSArena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    // Blocks beyond this are freed by Reset so one huge request does not
+    // pin its memory on the thread forever
+    static constexpr size_t kMaxRetainedBytes = 1024 * 1024;
+
+    struct Mark {
+        size_t block;
+        size_t offset;
+        size_t bytes_in_use;
+    };
+
+    explicit AFNSArena(size_t block_size = kDefaultBlockSize);
+
+    AFNSArena(const AFNSArena&) = delete;
+    AFNSArena& operator=(const AFNSArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    Mark GetMark() const { return {current_, offset_, bytes_in_use_}; }
+    void Rewind(const Mark& mark);
+    void Reset();
+
+    size_t bytes_in_use() const { return bytes_in_use_; }
+    size_t bytes_reserved() const { return bytes_reserved_; }
+    uint64_t allocation_count() const { return allocation_count_; }
+
+    // High-water mark of bytes_in_use(), settable so scopes can measure
+    size_t peak_bytes() const { return peak_bytes_; }
+    void set_peak_bytes(size_t peak_bytes) { peak_bytes_ = peak_bytes; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    // Moves the cursor to a block with room for |size| bytes at |alignment|
+    void NextBlock(size_t size, size_t alignment);
+
+    const size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+
+    size_t bytes_in_use_ = 0;
+    size_t bytes_reserved_ = 0;
+    size_t peak_bytes_ = 0;
+    uint64_t allocation_count_ = 0;
+};
+
+// The calling thread's arena, created on first use
+AFNSArena* ThreadAFNSArena();
+
+// 🎯 AFNS ARENA SCOPE
+// Everything allocated from |arena| during the scope is released when it
+// ends. Scopes nest; containers using the arena must be destroyed first, so
+// declare the scope before them.
+class AFNSArenaScope {
+public:
+    explicit AFNSArenaScope(AFNSArena* arena);
+    ~AFNSArenaScope();
+
+    AFNSArenaScope(const AFNSArenaScope&) = delete;
+    AFNSArenaScope& operator=(const AFNSArenaScope&) = delete;
+
+    AFNSArena* arena() const { return arena_; }
+
+    // Allocations and peak arena bytes since the scope opened
+    uint64_t allocations() const;
+    size_t peak_bytes() const;
+
+private:
+    AFNSArena* arena_;
+    AFNSArena::Mark mark_;
+    uint64_t allocation_count_;
+    size_t outer_peak_bytes_;
+};
+
+// Standard allocator over an AFNSArena; a null arena falls back to the heap
+// so arena-aware code also runs without one
+template <typename T>
+class AFNSArenaAllocator {
+public:
+    using value_type = T;
+
+    AFNSArenaAllocator(AFNSArena* arena = nullptr) noexcept : arena_(arena) {}
+
+    template <typename U>
+    AFNSArenaAllocator(const AFNSArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (arena_ == nullptr) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        if (arena_ == nullptr) {
+            ::operator delete(p);
+        }
+    }
+
+    AFNSArena* arena() const noexcept { return arena_; }
+
+private:
+    AFNSArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const AFNSArenaAllocator<T>& a, const AFNSArenaAllocator<U>& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const AFNSArenaAllocator<T>& a, const AFNSArenaAllocator<U>& b) noexcept {
+    return a.arena() != b.arena();
+}
+
+template <typename T>
+using AFNSArenaVector = std::vector<T, AFNSArenaAllocator<T>>;
+
+using AFNSArenaString = std::basic_string<char, std::char_traits<char>, AFNSArenaAllocator<char>>;
+
+template <typename K, typename V>
+using AFNSArenaHashMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                                            AFNSArenaAllocator<std::pair<const K, V>>>;
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_ARENA_H_
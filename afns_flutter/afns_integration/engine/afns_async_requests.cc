@@ -0,0 +1,72 @@
+// 🚀 AFNS ASYNC REQUEST TRACKING
+// Request ids, cancellation and per-widget supersession for async calls
+
+#include "afns_async_requests.h"
+
+namespace flutter {
+
+namespace afns {
+
+std::shared_ptr<AFNSAsyncRequestTracker::Request>
+AFNSAsyncRequestTracker::Begin(std::string_view widget_id) {
+    auto request = std::make_shared<Request>();
+    request->widget_id = std::string(widget_id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    request->id = next_id_++;
+    in_flight_[request->id] = request;
+
+    if (!widget_id.empty()) {
+        auto latest = latest_by_widget_.find(request->widget_id);
+        if (latest != latest_by_widget_.end()) {
+            auto stale = in_flight_.find(latest->second);
+            if (stale != in_flight_.end()) {
+                Retire(*stale->second, AFNSAsyncStatus::kSuperseded);
+            }
+            latest->second = request->id;
+        } else {
+            latest_by_widget_.emplace(request->widget_id, request->id);
+        }
+    }
+    return request;
+}
+
+bool AFNSAsyncRequestTracker::Cancel(uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = in_flight_.find(request_id);
+    if (it == in_flight_.end()) {
+        return false;
+    }
+    return Retire(*it->second, AFNSAsyncStatus::kCancelled);
+}
+
+AFNSAsyncStatus AFNSAsyncRequestTracker::Finish(const std::shared_ptr<Request>& request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_.erase(request->id);
+    if (!request->widget_id.empty()) {
+        auto latest = latest_by_widget_.find(request->widget_id);
+        if (latest != latest_by_widget_.end() && latest->second == request->id) {
+            latest_by_widget_.erase(latest);
+        }
+    }
+
+    // Cancel/supersede after the work ran still wins: the caller asked not
+    // to see this result
+    Retire(*request, AFNSAsyncStatus::kCompleted);
+    return static_cast<AFNSAsyncStatus>(request->state.load(std::memory_order_acquire));
+}
+
+size_t AFNSAsyncRequestTracker::in_flight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_.size();
+}
+
+bool AFNSAsyncRequestTracker::Retire(Request& request, AFNSAsyncStatus status) {
+    int32_t expected = Request::kLive;
+    return request.state.compare_exchange_strong(expected, static_cast<int32_t>(status),
+                                                 std::memory_order_acq_rel);
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,71 @@
+// 🚀 AFNS ASYNC REQUEST TRACKING
+// Request ids, cancellation and per-widget supersession for async calls
+
+#ifndef FLUTTER_AFNS_AFNS_ASYNC_REQUESTS_H_
+#define FLUTTER_AFNS_AFNS_ASYNC_REQUESTS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace flutter {
+
+namespace afns {
+
+// Final outcome reported to a completion callback. Values are part of the
+// C ABI (AFNS_ASYNC_* in afns_engine_c_api.h).
+enum class AFNSAsyncStatus : int32_t {
+    kCompleted = 0,
+    kCancelled = 1,
+    // A newer request for the same widget id replaced this one
+    kSuperseded = 2,
+};
+
+// 🎯 AFNS ASYNC REQUEST TRACKER
+// Hands out request ids and remembers the newest request per widget id.
+// Starting a request for a widget marks the previous one superseded, so a
+// worker that has not picked it up yet skips it entirely.
+class AFNSAsyncRequestTracker {
+public:
+    struct Request {
+        uint64_t id = 0;
+        std::string widget_id;
+
+        // Still worth running: not cancelled or superseded so far
+        bool IsLive() const { return state.load(std::memory_order_acquire) == kLive; }
+
+    private:
+        friend class AFNSAsyncRequestTracker;
+        static constexpr int32_t kLive = -1;
+        std::atomic<int32_t> state{kLive};
+    };
+
+    // An empty |widget_id| opts out of supersession
+    std::shared_ptr<Request> Begin(std::string_view widget_id);
+
+    // Returns false if the request already finished or never existed
+    bool Cancel(uint64_t request_id);
+
+    // Retires |request| and returns how it ended
+    AFNSAsyncStatus Finish(const std::shared_ptr<Request>& request);
+
+    size_t in_flight() const;
+
+private:
+    static bool Retire(Request& request, AFNSAsyncStatus status);
+
+    mutable std::mutex mutex_;
+    uint64_t next_id_ = 1;
+    std::unordered_map<uint64_t, std::shared_ptr<Request>> in_flight_;
+    std::unordered_map<std::string, uint64_t> latest_by_widget_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_ASYNC_REQUESTS_H_
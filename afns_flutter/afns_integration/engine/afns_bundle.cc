@@ -0,0 +1,364 @@
+// 🚀 AFNS PRECOMPILED BUNDLE
+// Build-time compiled widgets, widget trees and bytecode, mapped read-only at startup
+
+#include "afns_bundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "afns_widget_cache.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "AFNS bundles are read in host order, which must be little-endian"
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr uint64_t kFNVOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFNVPrime = 1099511628211ull;
+
+// FNV-1a continued over |bytes|, so spans can be checksummed in sequence
+uint64_t Checksum(uint64_t hash, std::string_view bytes) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= kFNVPrime;
+    }
+    return hash;
+}
+
+size_t AlignUp(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+void PadTo8(std::string* out) {
+    out->append(AlignUp(out->size()) - out->size(), '\0');
+}
+
+void Fail(std::string* error, const char* message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+}
+
+// Maps |path| read-only and shared; null on failure
+const char* MapFile(const std::string& path, size_t* size, std::string* error) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        Fail(error, "cannot_open");
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        Fail(error, "truncated");
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        Fail(error, "cannot_map");
+        return nullptr;
+    }
+    // The view keeps the mapping object alive
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        Fail(error, "cannot_map");
+        return nullptr;
+    }
+    *size = static_cast<size_t>(file_size.QuadPart);
+    return static_cast<const char*>(view);
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Fail(error, "cannot_open");
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        Fail(error, "truncated");
+        return nullptr;
+    }
+    // MAP_SHARED over a read-only file: clean pages backed by the file,
+    // shared with every process mapping it
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        Fail(error, "cannot_map");
+        return nullptr;
+    }
+    *size = static_cast<size_t>(info.st_size);
+    return static_cast<const char*>(view);
+#endif
+}
+
+void UnmapFile(const char* data, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+}
+
+} // anonymous namespace
+
+void AFNSBundleWriter::Add(std::string_view source, std::string_view widget, std::string_view tree,
+                           std::string_view bytecode) {
+    entries_.push_back(Pending{HashAFNSSource(source, 0), std::string(source), std::string(widget),
+                               std::string(tree), std::string(bytecode)});
+}
+
+void AFNSBundleWriter::AddIdentifier(std::string_view name) {
+    identifiers_.emplace_back(name);
+}
+
+std::string AFNSBundleWriter::Finish(std::string_view engine_version) const {
+    // Sorted for binary search; stable so the first of duplicates wins
+    std::vector<const Pending*> sorted;
+    sorted.reserve(entries_.size());
+    for (const Pending& entry : entries_) {
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Pending* a, const Pending* b) { return a->key < b->key; });
+    std::vector<const Pending*> unique;
+    unique.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        bool duplicate = false;
+        for (size_t j = unique.size(); j > 0 && unique[j - 1]->key == sorted[i]->key; --j) {
+            duplicate = duplicate || unique[j - 1]->source == sorted[i]->source;
+        }
+        if (!duplicate) {
+            unique.push_back(sorted[i]);
+        }
+    }
+
+    std::string blob;
+    bool fits = true;
+    auto append = [&blob, &fits](std::string_view bytes, bool aligned) {
+        if (aligned) {
+            PadTo8(&blob);
+        }
+        AFNSBundleSpan span{static_cast<uint32_t>(blob.size()), static_cast<uint32_t>(bytes.size())};
+        fits = fits && blob.size() + bytes.size() <= UINT32_MAX;
+        blob.append(bytes.data(), bytes.size());
+        return span;
+    };
+
+    std::vector<AFNSBundleEntry> entries;
+    entries.reserve(unique.size());
+    for (const Pending* pending : unique) {
+        AFNSBundleEntry entry;
+        entry.key = pending->key;
+        entry.source = append(pending->source, false);
+        entry.widget = append(pending->widget, false);
+        // Trees are read in place, so they keep the alignment of their records
+        entry.tree = append(pending->tree, true);
+        entry.bytecode = append(pending->bytecode, false);
+        uint64_t checksum = kFNVOffsetBasis;
+        checksum = Checksum(checksum, pending->source);
+        checksum = Checksum(checksum, pending->widget);
+        checksum = Checksum(checksum, pending->tree);
+        checksum = Checksum(checksum, pending->bytecode);
+        entry.checksum = checksum;
+        entries.push_back(entry);
+    }
+    std::vector<AFNSBundleSpan> identifiers;
+    identifiers.reserve(identifiers_.size());
+    for (const std::string& name : identifiers_) {
+        identifiers.push_back(append(name, false));
+    }
+    if (!fits) {
+        return std::string();
+    }
+
+    std::string index;
+    index.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AFNSBundleEntry));
+    index.append(reinterpret_cast<const char*>(identifiers.data()),
+                 identifiers.size() * sizeof(AFNSBundleSpan));
+
+    AFNSBundleHeader header;
+    header.magic = kAFNSBundleMagic;
+    header.version_major = kAFNSBundleVersionMajor;
+    header.version_minor = kAFNSBundleVersionMinor;
+    header.engine_version = HashAFNSSource(engine_version, 0);
+    header.index_checksum = Checksum(kFNVOffsetBasis, index);
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.identifier_count = static_cast<uint32_t>(identifiers.size());
+    header.blob_offset = AlignUp(sizeof(header) + index.size());
+    header.total_size = header.blob_offset + blob.size();
+
+    std::string out;
+    out.reserve(header.total_size);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out += index;
+    PadTo8(&out);
+    out += blob;
+    return out;
+}
+
+AFNSBundle::AFNSBundle(const char* data, size_t size, std::string owned, bool mapped)
+    : data_(data), size_(size), owned_(std::move(owned)), mapped_(mapped) {
+    if (!mapped_) {
+        data_ = owned_.data();
+    }
+}
+
+AFNSBundle::~AFNSBundle() {
+    if (mapped_) {
+        UnmapFile(data_, size_);
+    }
+}
+
+std::unique_ptr<AFNSBundle> AFNSBundle::Open(const std::string& path, std::string_view engine_version,
+                                             std::string* error) {
+    size_t size = 0;
+    const char* data = MapFile(path, &size, error);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    std::unique_ptr<AFNSBundle> bundle(new AFNSBundle(data, size, std::string(), true));
+    if (!bundle->Validate(engine_version, error)) {
+        return nullptr;
+    }
+    return bundle;
+}
+
+std::unique_ptr<AFNSBundle> AFNSBundle::FromBytes(std::string_view bytes,
+                                                  std::string_view engine_version,
+                                                  std::string* error) {
+    std::unique_ptr<AFNSBundle> bundle(new AFNSBundle(nullptr, bytes.size(), std::string(bytes), false));
+    if (!bundle->Validate(engine_version, error)) {
+        return nullptr;
+    }
+    return bundle;
+}
+
+bool AFNSBundle::Validate(std::string_view engine_version, std::string* error) {
+    if (size_ < sizeof(AFNSBundleHeader) || reinterpret_cast<uintptr_t>(data_) % 8 != 0) {
+        Fail(error, "truncated");
+        return false;
+    }
+    header_ = reinterpret_cast<const AFNSBundleHeader*>(data_);
+    if (header_->magic != kAFNSBundleMagic) {
+        Fail(error, "not_a_bundle");
+        return false;
+    }
+    if (header_->version_major != kAFNSBundleVersionMajor ||
+        header_->engine_version != HashAFNSSource(engine_version, 0)) {
+        Fail(error, "version_mismatch");
+        return false;
+    }
+    const uint64_t index_size = static_cast<uint64_t>(header_->entry_count) * sizeof(AFNSBundleEntry) +
+                                static_cast<uint64_t>(header_->identifier_count) * sizeof(AFNSBundleSpan);
+    if (header_->total_size != size_ || header_->blob_offset % 8 != 0 ||
+        header_->blob_offset < sizeof(AFNSBundleHeader) + index_size ||
+        header_->blob_offset > size_) {
+        Fail(error, "truncated");
+        return false;
+    }
+    const char* index = data_ + sizeof(AFNSBundleHeader);
+    if (Checksum(kFNVOffsetBasis, std::string_view(index, static_cast<size_t>(index_size))) !=
+        header_->index_checksum) {
+        Fail(error, "checksum_mismatch");
+        return false;
+    }
+
+    entries_ = reinterpret_cast<const AFNSBundleEntry*>(index);
+    identifiers_ = reinterpret_cast<const AFNSBundleSpan*>(
+        index + header_->entry_count * sizeof(AFNSBundleEntry));
+    blob_ = data_ + header_->blob_offset;
+    blob_size_ = size_ - static_cast<size_t>(header_->blob_offset);
+
+    auto in_blob = [this](const AFNSBundleSpan& span) {
+        return span.offset <= blob_size_ && span.length <= blob_size_ - span.offset;
+    };
+    for (size_t i = 0; i < header_->entry_count; ++i) {
+        const AFNSBundleEntry& entry = entries_[i];
+        if ((i > 0 && entries_[i - 1].key > entry.key) || !in_blob(entry.source) ||
+            !in_blob(entry.widget) || !in_blob(entry.tree) || !in_blob(entry.bytecode) ||
+            (header_->blob_offset + entry.tree.offset) % 8 != 0) {
+            Fail(error, "bad_index");
+            return false;
+        }
+    }
+    for (size_t i = 0; i < header_->identifier_count; ++i) {
+        if (!in_blob(identifiers_[i])) {
+            Fail(error, "bad_index");
+            return false;
+        }
+    }
+
+    entry_state_.reset(new std::atomic<uint8_t>[header_->entry_count]);
+    for (size_t i = 0; i < header_->entry_count; ++i) {
+        entry_state_[i].store(kUnchecked, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+std::string_view AFNSBundle::Span(const AFNSBundleSpan& span) const {
+    return std::string_view(blob_ + span.offset, span.length);
+}
+
+std::string_view AFNSBundle::identifier(size_t index) const {
+    return index < header_->identifier_count ? Span(identifiers_[index]) : std::string_view();
+}
+
+bool AFNSBundle::CheckEntry(size_t index) const {
+    const uint8_t state = entry_state_[index].load(std::memory_order_acquire);
+    if (state != kUnchecked) {
+        return state == kValid;
+    }
+    // Racing first uses compute the same answer
+    const AFNSBundleEntry& entry = entries_[index];
+    uint64_t checksum = kFNVOffsetBasis;
+    checksum = Checksum(checksum, Span(entry.source));
+    checksum = Checksum(checksum, Span(entry.widget));
+    checksum = Checksum(checksum, Span(entry.tree));
+    checksum = Checksum(checksum, Span(entry.bytecode));
+    const bool valid = checksum == entry.checksum;
+    entry_state_[index].store(valid ? kValid : kDamaged, std::memory_order_release);
+    return valid;
+}
+
+bool AFNSBundle::Find(std::string_view source, AFNSBundleItem* item) const {
+    const uint64_t key = HashAFNSSource(source, 0);
+    const AFNSBundleEntry* end = entries_ + header_->entry_count;
+    const AFNSBundleEntry* it = std::lower_bound(
+        entries_, end, key, [](const AFNSBundleEntry& entry, uint64_t k) { return entry.key < k; });
+    for (; it != end && it->key == key; ++it) {
+        if (Span(it->source) != source) {
+            continue;
+        }
+        if (!CheckEntry(static_cast<size_t>(it - entries_))) {
+            return false;
+        }
+        item->widget = Span(it->widget);
+        item->tree = Span(it->tree);
+        item->bytecode = Span(it->bytecode);
+        return true;
+    }
+    return false;
+}
+
+} // namespace afns
+
+} // namespace flutter
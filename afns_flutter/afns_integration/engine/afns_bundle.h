@@ -0,0 +1,159 @@
+// 🚀 AFNS PRECOMPILED BUNDLE
+// Build-time compiled widgets, widget trees and bytecode, mapped read-only at startup
+
+#ifndef FLUTTER_AFNS_AFNS_BUNDLE_H_
+#define FLUTTER_AFNS_AFNS_BUNDLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// File format, all integers little-endian, sections 8-byte aligned:
+//
+//   header      AFNSBundleHeader (48 bytes)
+//   entries     entry_count x AFNSBundleEntry (48 bytes), sorted by key
+//   identifiers identifier_count x AFNSBundleSpan (8 bytes)
+//   blob        everything the spans point at, from blob_offset
+//
+// index_checksum covers the entries and identifiers, each entry's
+// checksum covers the bytes of its four spans. The index is checked when
+// the bundle is opened; an entry is checked the first time it is used, so
+// opening costs only the pages of the index. Readers reject another major
+// version or a bundle from another engine version.
+constexpr uint32_t kAFNSBundleMagic = 0x424E4641;  // "AFNB"
+constexpr uint16_t kAFNSBundleVersionMajor = 1;
+constexpr uint16_t kAFNSBundleVersionMinor = 0;
+
+struct AFNSBundleHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint64_t engine_version;  // HashAFNSSource(engine version, 0)
+    uint64_t index_checksum;
+    uint32_t entry_count;
+    uint32_t identifier_count;
+    uint64_t blob_offset;
+    uint64_t total_size;
+};
+
+// Bytes [offset, offset + length) of the blob
+struct AFNSBundleSpan {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct AFNSBundleEntry {
+    uint64_t key;       // HashAFNSSource(source, 0)
+    uint64_t checksum;
+    AFNSBundleSpan source;
+    AFNSBundleSpan widget;    // CompileAFNSWidget output
+    AFNSBundleSpan tree;      // CompileAFNSWidgetTree output, see afns_widget_tree.h
+    AFNSBundleSpan bytecode;  // SerializeAFNSBytecode output, empty if not compilable
+};
+
+static_assert(sizeof(AFNSBundleHeader) == 48, "file layout");
+static_assert(sizeof(AFNSBundleSpan) == 8, "file layout");
+static_assert(sizeof(AFNSBundleEntry) == 48, "file layout");
+
+// Views into a bundle's mapping, valid while the bundle is alive
+struct AFNSBundleItem {
+    std::string_view widget;
+    std::string_view tree;
+    std::string_view bytecode;
+};
+
+// 🎯 AFNS BUNDLE WRITER
+// Collects compiled sources at build time; Finish() lays them out. A
+// source added twice keeps its first artifacts.
+class AFNSBundleWriter {
+public:
+    void Add(std::string_view source, std::string_view widget, std::string_view tree,
+             std::string_view bytecode);
+
+    // Names to intern when the bundle is loaded, before any tree is built
+    void AddIdentifier(std::string_view name);
+
+    // Empty if the content does not fit 32-bit offsets
+    std::string Finish(std::string_view engine_version) const;
+
+private:
+    struct Pending {
+        uint64_t key;
+        std::string source;
+        std::string widget;
+        std::string tree;
+        std::string bytecode;
+    };
+
+    std::vector<Pending> entries_;
+    std::vector<std::string> identifiers_;
+};
+
+// 🎯 AFNS BUNDLE
+// A bundle file mapped read-only and shared: nothing is parsed or copied
+// at open beyond checking the index, and the pages stay shareable with
+// every other process mapping the same file. Lookups are lock-free.
+class AFNSBundle {
+public:
+    ~AFNSBundle();
+
+    AFNSBundle(const AFNSBundle&) = delete;
+    AFNSBundle& operator=(const AFNSBundle&) = delete;
+
+    // Null with |*error| set (when given) if the file cannot be mapped or
+    // fails the format, version or index checks
+    static std::unique_ptr<AFNSBundle> Open(const std::string& path, std::string_view engine_version,
+                                            std::string* error);
+
+    // Same checks on bytes already in memory, which are copied
+    static std::unique_ptr<AFNSBundle> FromBytes(std::string_view bytes,
+                                                 std::string_view engine_version, std::string* error);
+
+    // False if |source| is not in the bundle or its entry is damaged
+    bool Find(std::string_view source, AFNSBundleItem* item) const;
+
+    size_t entry_count() const { return header_->entry_count; }
+    size_t identifier_count() const { return header_->identifier_count; }
+    std::string_view identifier(size_t index) const;
+
+    // Whole mapping, for diagnostics
+    size_t size() const { return size_; }
+
+private:
+    enum : uint8_t { kUnchecked = 0, kValid = 1, kDamaged = 2 };
+
+    AFNSBundle(const char* data, size_t size, std::string owned, bool mapped);
+
+    // Verifies the layout; false with |*error| set
+    bool Validate(std::string_view engine_version, std::string* error);
+    std::string_view Span(const AFNSBundleSpan& span) const;
+    bool CheckEntry(size_t index) const;
+
+    const char* data_;
+    size_t size_;
+    std::string owned_;  // FromBytes copies
+    bool mapped_;
+
+    const AFNSBundleHeader* header_ = nullptr;
+    const AFNSBundleEntry* entries_ = nullptr;
+    const AFNSBundleSpan* identifiers_ = nullptr;
+    const char* blob_ = nullptr;
+    size_t blob_size_ = 0;
+
+    // Per entry: kUnchecked until first used
+    std::unique_ptr<std::atomic<uint8_t>[]> entry_state_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_BUNDLE_H_
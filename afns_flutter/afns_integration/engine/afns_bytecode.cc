@@ -0,0 +1,1531 @@
+// 🚀 AFNS LOGIC BYTECODE
+// Single-pass compiler from AFNS handler logic to register bytecode
+
+#include "afns_bytecode.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "afns_tiering.h"
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+// Registers are 8-bit operands
+constexpr uint32_t kMaxRegisters = 255;
+constexpr size_t kMaxCodeSize = 0xFFFF;
+constexpr size_t kMaxConstants = 0xFFFF;
+// Blocks, parentheses, call arguments and prefix operators each recurse in
+// the parser; deeper input is a compile error rather than a stack overflow.
+// A parenthesis level takes about 1.5 KB of stack, so this stays well
+// inside the 512 KB of a secondary thread on macOS and iOS.
+constexpr uint32_t kMaxNesting = 128;
+constexpr uint16_t kUnresolvedFunction = 0xFFFF;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "AFNS bytecode is serialized in host order, which must be little-endian"
+#endif
+
+// Serialized layout: SerializedHeader, constant_count x SerializedConstant,
+// function_count x SerializedFunction, every function's code in order, then
+// the bytes of string constants and function names
+constexpr uint32_t kSerializedMagic = 0x43424641;  // "AFBC"
+
+struct SerializedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t function_count;
+    uint32_t constant_count;
+};
+
+struct SerializedConstant {
+    uint8_t type;  // AFNSValueType
+    uint8_t reserved[3];
+    uint32_t length;
+    uint64_t bits;  // payload, or the offset of a string's bytes
+};
+
+struct SerializedFunction {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t code_length;
+    uint16_t register_count;
+    uint8_t parameter_count;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(SerializedConstant) == 16, "serialized layout");
+static_assert(sizeof(SerializedFunction) == 16, "serialized layout");
+
+// Sequential reads from a serialized blob that fail instead of overrunning
+class SerializedReader {
+public:
+    explicit SerializedReader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    bool Read(T* value) {
+        return ReadBytes(value, sizeof(T));
+    }
+
+    bool ReadBytes(void* out, size_t size) {
+        if (size > data_.size() - pos_) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        std::memcpy(out, data_.data() + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    // Bytes of the trailing string area, which starts at |strings_|
+    bool String(uint64_t offset, uint64_t length, std::string_view* out) const {
+        const size_t area = data_.size() - strings_;
+        if (offset > area || length > area - offset) {
+            return false;
+        }
+        *out = data_.substr(strings_ + offset, length);
+        return true;
+    }
+
+    void StartStrings() { strings_ = pos_; }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    size_t strings_ = 0;
+};
+
+// Operand checks for loaded code, the invariants the compiler guarantees
+// for what it emits; tier superinstructions are never serialized
+bool IsValidLoadedCode(const AFNSBytecodeFunction& function,
+                       const std::vector<AFNSBytecodeFunction>& functions,
+                       size_t constant_count) {
+    const std::vector<AFNSInstruction>& code = function.code;
+    if (code.empty()) {
+        return false;
+    }
+    const AFNSOpcode last = code.back().op;
+    if (last != AFNSOpcode::kReturn && last != AFNSOpcode::kReturnNone &&
+        last != AFNSOpcode::kJump && last != AFNSOpcode::kLoop) {
+        return false;
+    }
+    const uint32_t registers = function.register_count;
+    for (size_t pc = 0; pc < code.size(); ++pc) {
+        const AFNSInstruction& instruction = code[pc];
+        const bool a_ok = instruction.a < registers;
+        const bool b_ok = instruction.b < registers;
+        const bool c_ok = instruction.c < registers;
+        bool ok = false;
+        switch (instruction.op) {
+        case AFNSOpcode::kLoadConst:
+            ok = a_ok && instruction.bx() < constant_count;
+            break;
+        case AFNSOpcode::kLoadNone:
+        case AFNSOpcode::kReturn:
+            ok = a_ok;
+            break;
+        case AFNSOpcode::kMove:
+        case AFNSOpcode::kNot:
+        case AFNSOpcode::kNegate:
+        case AFNSOpcode::kShow:
+        case AFNSOpcode::kLoadState:
+            ok = a_ok && b_ok;
+            break;
+        case AFNSOpcode::kAdd:
+        case AFNSOpcode::kSubtract:
+        case AFNSOpcode::kMultiply:
+        case AFNSOpcode::kDivide:
+        case AFNSOpcode::kModulo:
+        case AFNSOpcode::kEqual:
+        case AFNSOpcode::kNotEqual:
+        case AFNSOpcode::kLess:
+        case AFNSOpcode::kLessEqual:
+        case AFNSOpcode::kGreater:
+        case AFNSOpcode::kGreaterEqual:
+            ok = a_ok && b_ok && c_ok;
+            break;
+        // Only Loop may go backwards, since only Loop is charged to the
+        // step budget
+        case AFNSOpcode::kJump:
+            ok = instruction.bx() > pc && instruction.bx() < code.size();
+            break;
+        case AFNSOpcode::kLoop:
+            ok = instruction.bx() <= pc;
+            break;
+        case AFNSOpcode::kJumpIfFalse:
+        case AFNSOpcode::kJumpIfTrue:
+            ok = a_ok && instruction.bx() > pc && instruction.bx() < code.size();
+            break;
+        case AFNSOpcode::kCall:
+            // Arguments occupy the caller's registers from A on
+            ok = instruction.bx() < functions.size() &&
+                 instruction.a + std::max<uint32_t>(functions[instruction.bx()].parameter_count, 1) <=
+                     registers;
+            break;
+        case AFNSOpcode::kReturnNone:
+            ok = true;
+            break;
+        default:
+            ok = false;
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* const kOpcodeNames[] = {
+#define AFNS_OPCODE_NAME(name) #name,
+    AFNS_OPCODES(AFNS_OPCODE_NAME)
+#undef AFNS_OPCODE_NAME
+};
+
+enum class Tok : uint8_t {
+    kEnd,
+    kInvalid,
+    kIdentifier,
+    kInteger,
+    kFloat,
+    kString,
+    kTrue,
+    kFalse,
+    kFun,
+    kApex,
+    kVar,
+    kIf,
+    kElse,
+    kWhile,
+    kLoop,
+    kBreak,
+    kContinue,
+    kReturn,
+    kReserved,  // keywords of constructs the compiler does not handle
+    kLeftParen,
+    kRightParen,
+    kLeftBrace,
+    kRightBrace,
+    kLeftBracket,
+    kRightBracket,
+    kComma,
+    kSemicolon,
+    kDoubleColon,
+    kArrow,
+    kAssign,
+    kEqual,
+    kNotEqual,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+    kPlus,
+    kMinus,
+    kStar,
+    kSlash,
+    kPercent,
+    kAndAnd,
+    kOrOr,
+    kBang,
+};
+
+struct Token {
+    Tok kind = Tok::kEnd;
+    std::string_view text;
+    size_t offset = 0;
+};
+
+struct Keyword {
+    std::string_view text;
+    Tok kind;
+};
+
+constexpr Keyword kKeywords[] = {
+    {"fun", Tok::kFun}, {"apex", Tok::kApex}, {"var", Tok::kVar},
+    {"if", Tok::kIf}, {"else", Tok::kElse}, {"while", Tok::kWhile},
+    {"loop", Tok::kLoop}, {"break", Tok::kBreak}, {"continue", Tok::kContinue},
+    {"return", Tok::kReturn}, {"true", Tok::kTrue}, {"false", Tok::kFalse},
+    {"check", Tok::kReserved}, {"match", Tok::kReserved}, {"for", Tok::kReserved},
+    {"in", Tok::kReserved}, {"import", Tok::kReserved}, {"struct", Tok::kReserved},
+    {"enum", Tok::kReserved}, {"impl", Tok::kReserved}, {"trait", Tok::kReserved},
+    {"mod", Tok::kReserved}, {"pub", Tok::kReserved}, {"priv", Tok::kReserved},
+    {"unsafe", Tok::kReserved}, {"async", Tok::kReserved}, {"await", Tok::kReserved},
+    {"actor", Tok::kReserved}, {"lambda", Tok::kReserved}, {"define", Tok::kReserved},
+    {"type", Tok::kReserved}, {"typedef", Tok::kReserved},
+};
+
+inline bool IsIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Same token shapes as src/lexer, minus what the compiler never needs
+class Lexer {
+public:
+    explicit Lexer(std::string_view source) : source_(source) {}
+
+    Token Next() {
+        SkipTrivia();
+        Token token;
+        token.offset = pos_;
+        if (pos_ >= source_.size()) {
+            return token;
+        }
+
+        const size_t start = pos_;
+        const char c = source_[pos_];
+        if (IsIdentifierStart(c)) {
+            while (pos_ < source_.size() &&
+                   (IsIdentifierStart(source_[pos_]) || IsDigit(source_[pos_]))) {
+                ++pos_;
+            }
+            token.text = source_.substr(start, pos_ - start);
+            token.kind = Tok::kIdentifier;
+            for (const Keyword& keyword : kKeywords) {
+                if (keyword.text == token.text) {
+                    token.kind = keyword.kind;
+                    break;
+                }
+            }
+            return token;
+        }
+        if (IsDigit(c)) {
+            token.kind = LexNumber();
+        } else if (c == '"' || c == '\'') {
+            token.kind = LexString(c);
+        } else {
+            token.kind = LexPunctuation();
+        }
+        token.text = source_.substr(start, pos_ - start);
+        return token;
+    }
+
+private:
+    void SkipTrivia() {
+        while (pos_ < source_.size()) {
+            const char c = source_[pos_];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++pos_;
+            } else if (source_.compare(pos_, 2, "//") == 0) {
+                const size_t end = source_.find('\n', pos_);
+                pos_ = end == std::string_view::npos ? source_.size() : end;
+            } else if (source_.compare(pos_, 2, "/*") == 0) {
+                const size_t end = source_.find("*/", pos_ + 2);
+                pos_ = end == std::string_view::npos ? source_.size() : end + 2;
+            } else {
+                return;
+            }
+        }
+    }
+
+    Tok LexNumber() {
+        Tok kind = Tok::kInteger;
+        while (pos_ < source_.size() && IsDigit(source_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ + 1 < source_.size() && source_[pos_] == '.' && IsDigit(source_[pos_ + 1])) {
+            kind = Tok::kFloat;
+            for (++pos_; pos_ < source_.size() && IsDigit(source_[pos_]); ++pos_) {
+            }
+        }
+        if (pos_ < source_.size() && (source_[pos_] == 'e' || source_[pos_] == 'E')) {
+            size_t exponent = pos_ + 1;
+            if (exponent < source_.size() && (source_[exponent] == '+' || source_[exponent] == '-')) {
+                ++exponent;
+            }
+            if (exponent < source_.size() && IsDigit(source_[exponent])) {
+                kind = Tok::kFloat;
+                for (pos_ = exponent; pos_ < source_.size() && IsDigit(source_[pos_]); ++pos_) {
+                }
+            }
+        }
+        return kind;
+    }
+
+    Tok LexString(char quote) {
+        for (++pos_; pos_ < source_.size(); ++pos_) {
+            if (source_[pos_] == '\\') {
+                ++pos_;
+            } else if (source_[pos_] == quote) {
+                ++pos_;
+                return Tok::kString;
+            }
+        }
+        return Tok::kInvalid;
+    }
+
+    Tok LexPunctuation() {
+        const char c = source_[pos_++];
+        const char next = pos_ < source_.size() ? source_[pos_] : '\0';
+        auto pair = [this](Tok kind) {
+            ++pos_;
+            return kind;
+        };
+        switch (c) {
+        case '(': return Tok::kLeftParen;
+        case ')': return Tok::kRightParen;
+        case '{': return Tok::kLeftBrace;
+        case '}': return Tok::kRightBrace;
+        case '[': return Tok::kLeftBracket;
+        case ']': return Tok::kRightBracket;
+        case ',': return Tok::kComma;
+        case ';': return Tok::kSemicolon;
+        case '+': return Tok::kPlus;
+        case '*': return Tok::kStar;
+        case '/': return Tok::kSlash;
+        case '%': return Tok::kPercent;
+        case ':': return next == ':' ? pair(Tok::kDoubleColon) : Tok::kInvalid;
+        case '-': return next == '>' ? pair(Tok::kArrow) : Tok::kMinus;
+        case '=': return next == '=' ? pair(Tok::kEqual) : Tok::kAssign;
+        case '!': return next == '=' ? pair(Tok::kNotEqual) : Tok::kBang;
+        case '<': return next == '=' ? pair(Tok::kLessEqual) : Tok::kLess;
+        case '>': return next == '=' ? pair(Tok::kGreaterEqual) : Tok::kGreater;
+        case '&': return next == '&' ? pair(Tok::kAndAnd) : Tok::kInvalid;
+        case '|': return next == '|' ? pair(Tok::kOrOr) : Tok::kInvalid;
+        }
+        return Tok::kInvalid;
+    }
+
+    std::string_view source_;
+    size_t pos_ = 0;
+};
+
+// Opcodes whose A operand is only written, so the result of such an
+// instruction can be redirected to another register
+bool WritesOnlyA(AFNSOpcode op) {
+    switch (op) {
+    case AFNSOpcode::kCall:
+    case AFNSOpcode::kShow:
+    case AFNSOpcode::kJump:
+    case AFNSOpcode::kLoop:
+    case AFNSOpcode::kJumpIfFalse:
+    case AFNSOpcode::kJumpIfTrue:
+    case AFNSOpcode::kReturn:
+    case AFNSOpcode::kReturnNone:
+    case AFNSOpcode::kCount:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Output of the flutter_handle_* builtins, as src/interpreter prints it
+struct StatusBuiltin {
+    std::string_view name;
+    std::string_view output;
+};
+
+constexpr StatusBuiltin kStatusBuiltins[] = {
+    {"flutter_handle_save",
+     "🔄 Flutter Status: Project saved successfully\n💾 Flutter Save Action: Completed"},
+    {"flutter_handle_load",
+     "🔄 Flutter Status: Project loaded successfully\n📂 Flutter Load Action: Completed"},
+    {"flutter_handle_run",
+     "🔄 Flutter Status: Application running\n🚀 Flutter Run Action: Completed"},
+    {"flutter_handle_debug",
+     "🔄 Flutter Status: Debug mode active\n🐛 Flutter Debug Action: Completed"},
+};
+
+constexpr std::string_view kStatusPrefix = "🔄 Flutter Status: ";
+
+} // anonymous namespace
+
+// 🎯 AFNS LOGIC COMPILER
+// Recursive descent straight to bytecode. Every local gets a fixed register
+// when declared and temporaries are stacked above the locals, so variable
+// access costs no lookup at run time. The first error stops compilation:
+// the lexer is replaced by end-of-input and every loop unwinds.
+class AFNSLogicCompiler {
+public:
+    explicit AFNSLogicCompiler(AFNSBytecodeProgram* program)
+        : program_(program), lexer_(program->source_) {}
+
+    void Compile() {
+        Advance();
+        Advance();
+
+        // Function 0 holds the top-level statements
+        program_->functions_.emplace_back();
+        program_->functions_[0].name = "<top-level>";
+        default_arguments_.emplace_back();
+        FunctionState top_level;
+        fs_ = &top_level;
+
+        bool has_statements = false;
+        while (current_.kind != Tok::kEnd) {
+            if (current_.kind == Tok::kFun || current_.kind == Tok::kApex) {
+                FunctionDeclaration();
+            } else {
+                has_statements = true;
+                Statement();
+            }
+        }
+
+        const uint16_t entry = EntryFunction(has_statements);
+        if (entry != kUnresolvedFunction) {
+            const uint32_t base = fs_->free_reg;
+            for (uint16_t constant : default_arguments_[entry]) {
+                EmitBx(AFNSOpcode::kLoadConst, AllocRegister(), constant);
+            }
+            SetFree(base + 1);
+            EmitBx(AFNSOpcode::kCall, static_cast<uint8_t>(base), entry);
+            Emit(AFNSOpcode::kReturn, static_cast<uint8_t>(base));
+        } else {
+            Emit(AFNSOpcode::kReturnNone);
+        }
+
+        ResolveCalls();
+        if (error_.empty()) {
+            program_->ok_ = true;
+        } else {
+            program_->error_ = std::move(error_);
+            program_->error_offset_ = error_offset_;
+        }
+    }
+
+private:
+    struct Local {
+        std::string_view name;
+        uint8_t reg;
+        uint32_t depth;
+    };
+
+    struct LoopState {
+        size_t start;
+        std::vector<size_t> breaks;
+    };
+
+    struct FunctionState {
+        uint16_t index = 0;
+        std::vector<Local> locals;
+        uint32_t depth = 0;
+        uint32_t free_reg = 0;
+        std::vector<LoopState> loops;
+
+        // Highest jump target so far; an instruction that ends at a target
+        // does not run on every path into it
+        size_t last_label = 0;
+    };
+
+    struct PendingCall {
+        uint16_t function;
+        size_t pc;
+        std::string_view name;
+        uint32_t argument_count;
+        size_t offset;
+    };
+
+    // ---- tokens ----
+
+    void Advance() {
+        current_ = next_;
+        next_ = failed() ? Token{Tok::kEnd, {}, current_.offset} : lexer_.Next();
+    }
+
+    bool Match(Tok kind) {
+        if (current_.kind != kind) {
+            return false;
+        }
+        Advance();
+        return true;
+    }
+
+    Token Expect(Tok kind, const char* message) {
+        Token token = current_;
+        if (!Match(kind)) {
+            Fail(message, current_.offset);
+        }
+        return token;
+    }
+
+    // Statement terminator; optional before a closing brace or the end
+    void ExpectSemicolon() {
+        if (!Match(Tok::kSemicolon) && current_.kind != Tok::kRightBrace &&
+            current_.kind != Tok::kEnd) {
+            Fail("expected ';'", current_.offset);
+        }
+    }
+
+    bool failed() const { return !error_.empty(); }
+
+    // Held by every parse function that recurses; past kMaxNesting the
+    // compile fails and the caller unwinds at once
+    class NestingScope {
+    public:
+        explicit NestingScope(AFNSLogicCompiler* compiler) : compiler_(compiler) {
+            if (++compiler_->nesting_ > kMaxNesting) {
+                compiler_->Fail("nesting too deep", compiler_->current_.offset);
+            }
+        }
+        ~NestingScope() { --compiler_->nesting_; }
+
+        NestingScope(const NestingScope&) = delete;
+        NestingScope& operator=(const NestingScope&) = delete;
+
+    private:
+        AFNSLogicCompiler* compiler_;
+    };
+
+    void Fail(std::string message, size_t offset) {
+        if (failed()) {
+            return;
+        }
+        error_ = std::move(message);
+        error_offset_ = offset;
+        current_ = Token{Tok::kEnd, {}, offset};
+        next_ = current_;
+    }
+
+    // ---- emission ----
+
+    AFNSBytecodeFunction& Function() { return program_->functions_[fs_->index]; }
+
+    size_t Emit(AFNSOpcode op, uint8_t a = 0, uint8_t b = 0, uint8_t c = 0) {
+        std::vector<AFNSInstruction>& code = Function().code;
+        if (code.size() >= kMaxCodeSize) {
+            Fail("function too long", current_.offset);
+            return 0;
+        }
+        code.push_back(AFNSInstruction{op, a, b, c});
+        return code.size() - 1;
+    }
+
+    size_t EmitBx(AFNSOpcode op, uint8_t a, uint16_t bx) {
+        return Emit(op, a, static_cast<uint8_t>(bx & 0xFF), static_cast<uint8_t>(bx >> 8));
+    }
+
+    size_t Label() {
+        const size_t pos = Function().code.size();
+        fs_->last_label = std::max(fs_->last_label, pos);
+        return pos;
+    }
+
+    void PatchJump(size_t pc) {
+        const size_t target = Label();
+        AFNSInstruction& jump = Function().code[pc];
+        jump.b = static_cast<uint8_t>(target & 0xFF);
+        jump.c = static_cast<uint8_t>(target >> 8);
+    }
+
+    // Points the instruction that just produced temporary |from| at |to|
+    bool RetargetLast(uint8_t from, uint8_t to) {
+        std::vector<AFNSInstruction>& code = Function().code;
+        if (code.empty() || fs_->last_label >= code.size() || code.back().a != from ||
+            !WritesOnlyA(code.back().op) || from < fs_->locals.size()) {
+            return false;
+        }
+        code.back().a = to;
+        return true;
+    }
+
+    uint16_t AddConstant(AFNSValue value) {
+        std::vector<AFNSValue>& constants = program_->constants_;
+        if (constants.size() >= kMaxConstants) {
+            Fail("too many constants", current_.offset);
+            return 0;
+        }
+        constants.push_back(value);
+        return static_cast<uint16_t>(constants.size() - 1);
+    }
+
+    uint16_t StringConstant(std::string text) {
+        auto it = string_constants_.find(text);
+        if (it != string_constants_.end()) {
+            return it->second;
+        }
+        if (text.size() > UINT32_MAX) {
+            Fail("string literal too long", current_.offset);
+            return 0;
+        }
+        const std::string& stored = program_->strings_.emplace_back(std::move(text));
+        const uint16_t index = AddConstant(
+            AFNSValue::String(stored.data(), static_cast<uint32_t>(stored.size())));
+        string_constants_.emplace(stored, index);
+        return index;
+    }
+
+    uint16_t IntConstant(int64_t integer) {
+        auto it = int_constants_.find(integer);
+        if (it != int_constants_.end()) {
+            return it->second;
+        }
+        const uint16_t index = AddConstant(AFNSValue::Int(integer));
+        int_constants_.emplace(integer, index);
+        return index;
+    }
+
+    uint16_t BoolConstant(bool boolean) {
+        int32_t& index = boolean ? true_constant_ : false_constant_;
+        if (index < 0) {
+            index = AddConstant(AFNSValue::Bool(boolean));
+        }
+        return static_cast<uint16_t>(index);
+    }
+
+    // ---- registers ----
+
+    uint8_t AllocRegister() {
+        if (fs_->free_reg >= kMaxRegisters) {
+            Fail("too many registers", current_.offset);
+            return 0;
+        }
+        SetFree(fs_->free_reg + 1);
+        return static_cast<uint8_t>(fs_->free_reg - 1);
+    }
+
+    void SetFree(uint32_t free_reg) {
+        if (free_reg > kMaxRegisters) {
+            Fail("too many registers", current_.offset);
+            return;
+        }
+        fs_->free_reg = free_reg;
+        uint16_t& register_count = Function().register_count;
+        register_count = std::max<uint16_t>(register_count, static_cast<uint16_t>(free_reg));
+    }
+
+    // Puts the value of |reg| into register |base| (the first free one)
+    uint8_t ToTemporary(uint32_t base, uint8_t reg) {
+        if (reg != base) {
+            SetFree(base);
+            Emit(AFNSOpcode::kMove, AllocRegister(), reg);
+        }
+        return static_cast<uint8_t>(base);
+    }
+
+    void ExpressionInto(uint8_t reg) {
+        const uint32_t base = fs_->free_reg;
+        const uint8_t value = Expression();
+        if (value != reg && !RetargetLast(value, reg)) {
+            Emit(AFNSOpcode::kMove, reg, value);
+        }
+        SetFree(std::max<uint32_t>(base, reg + 1u));
+    }
+
+    const Local* FindLocal(std::string_view name) const {
+        for (auto it = fs_->locals.rbegin(); it != fs_->locals.rend(); ++it) {
+            if (it->name == name) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    void DeclareLocal(std::string_view name, uint8_t reg) {
+        fs_->locals.push_back(Local{name, reg, fs_->depth});
+    }
+
+    // ---- declarations ----
+
+    // Zero value of a parameter type, passed when a handler is the entry
+    uint16_t DefaultArgument(std::string_view type) {
+        static constexpr std::string_view kIntegerTypes[] = {
+            "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "isize", "usize", "int",
+        };
+        if (std::find(std::begin(kIntegerTypes), std::end(kIntegerTypes), type) !=
+            std::end(kIntegerTypes)) {
+            return IntConstant(0);
+        }
+        if (type == "f32" || type == "f64" || type == "float") {
+            return AddConstant(AFNSValue::Float(0.0));
+        }
+        if (type == "bool") {
+            return BoolConstant(false);
+        }
+        if (type == "string" || type == "str" || type == "char") {
+            return StringConstant(std::string());
+        }
+        return AddConstant(AFNSValue::None());
+    }
+
+    // Type annotations are not checked; returns the base type name
+    std::string_view SkipType() {
+        const Token name = Expect(Tok::kIdentifier, "expected type");
+        uint32_t depth = 0;
+        do {
+            if (current_.kind == Tok::kLess || current_.kind == Tok::kLeftBracket) {
+                ++depth;
+            } else if (depth > 0 &&
+                       (current_.kind == Tok::kGreater || current_.kind == Tok::kRightBracket)) {
+                --depth;
+            } else if (depth == 0 || current_.kind == Tok::kEnd) {
+                break;
+            }
+            Advance();
+        } while (depth > 0);
+        return name.text;
+    }
+
+    // fun name(parameters) -> type { ... }, or apex() { ... }
+    void FunctionDeclaration() {
+        Match(Tok::kFun);
+        const Token name = current_;
+        if (!Match(Tok::kIdentifier) && !Match(Tok::kApex)) {
+            Fail("expected function name", name.offset);
+            return;
+        }
+        if (program_->functions_.size() >= kUnresolvedFunction) {
+            Fail("too many functions", name.offset);
+            return;
+        }
+
+        const uint16_t index = static_cast<uint16_t>(program_->functions_.size());
+        program_->functions_.emplace_back();
+        program_->functions_[index].name = std::string(name.text);
+        default_arguments_.emplace_back();
+
+        FunctionState state;
+        state.index = index;
+        FunctionState* enclosing = fs_;
+        fs_ = &state;
+
+        Expect(Tok::kLeftParen, "expected '('");
+        while (current_.kind == Tok::kIdentifier) {
+            const Token parameter = current_;
+            Advance();
+            std::string_view type;
+            if (Match(Tok::kDoubleColon)) {
+                type = SkipType();
+            }
+            default_arguments_[index].push_back(DefaultArgument(type));
+            DeclareLocal(parameter.text, AllocRegister());
+            if (!Match(Tok::kComma)) {
+                break;
+            }
+        }
+        Expect(Tok::kRightParen, "expected ')'");
+        if (Match(Tok::kArrow)) {
+            SkipType();
+        }
+        program_->functions_[index].parameter_count = static_cast<uint8_t>(state.locals.size());
+
+        Block();
+        Emit(AFNSOpcode::kReturnNone);
+        fs_ = enclosing;
+
+        for (uint16_t other : functions_by_name_[name.text]) {
+            if (program_->functions_[other].parameter_count ==
+                program_->functions_[index].parameter_count) {
+                Fail("duplicate function '" + std::string(name.text) + "'", name.offset);
+            }
+        }
+        functions_by_name_[name.text].push_back(index);
+    }
+
+    uint16_t EntryFunction(bool has_statements) const {
+        auto apex = functions_by_name_.find("apex");
+        if (apex != functions_by_name_.end()) {
+            return apex->second.front();
+        }
+        if (!has_statements && program_->functions_.size() > 1) {
+            return 1;
+        }
+        return kUnresolvedFunction;
+    }
+
+    void ResolveCalls() {
+        for (const PendingCall& call : calls_) {
+            if (failed()) {
+                return;
+            }
+            auto it = functions_by_name_.find(call.name);
+            if (it == functions_by_name_.end()) {
+                Fail("unknown function '" + std::string(call.name) + "'", call.offset);
+                return;
+            }
+            uint16_t callee = kUnresolvedFunction;
+            for (uint16_t candidate : it->second) {
+                if (program_->functions_[candidate].parameter_count == call.argument_count) {
+                    callee = candidate;
+                }
+            }
+            if (callee == kUnresolvedFunction) {
+                Fail("wrong number of arguments to '" + std::string(call.name) + "'", call.offset);
+                return;
+            }
+            AFNSInstruction& instruction = program_->functions_[call.function].code[call.pc];
+            instruction.b = static_cast<uint8_t>(callee & 0xFF);
+            instruction.c = static_cast<uint8_t>(callee >> 8);
+        }
+    }
+
+    // ---- statements ----
+
+    void Statement() {
+        switch (current_.kind) {
+        case Tok::kVar:
+            VariableDeclaration();
+            break;
+        case Tok::kIf:
+            IfStatement();
+            break;
+        case Tok::kWhile:
+            WhileStatement();
+            break;
+        case Tok::kLoop:
+            LoopStatement();
+            break;
+        case Tok::kBreak:
+        case Tok::kContinue:
+            BreakOrContinue();
+            break;
+        case Tok::kReturn:
+            ReturnStatement();
+            break;
+        case Tok::kLeftBrace:
+            Block();
+            break;
+        case Tok::kSemicolon:
+            Advance();
+            break;
+        case Tok::kFun:
+        case Tok::kApex:
+            Fail("functions can only be declared at the top level", current_.offset);
+            break;
+        case Tok::kReserved:
+            Fail("'" + std::string(current_.text) + "' is not supported", current_.offset);
+            break;
+        case Tok::kIdentifier:
+            if (next_.kind == Tok::kAssign) {
+                Assignment();
+                break;
+            }
+            ExpressionStatement();
+            break;
+        default:
+            ExpressionStatement();
+            break;
+        }
+    }
+
+    void Block() {
+        const NestingScope nesting(this);
+        Expect(Tok::kLeftBrace, "expected '{'");
+        ++fs_->depth;
+        while (current_.kind != Tok::kRightBrace && current_.kind != Tok::kEnd) {
+            Statement();
+        }
+        Expect(Tok::kRightBrace, "expected '}'");
+
+        std::vector<Local>& locals = fs_->locals;
+        while (!locals.empty() && locals.back().depth == fs_->depth) {
+            locals.pop_back();
+        }
+        --fs_->depth;
+        SetFree(static_cast<uint32_t>(locals.size()));
+    }
+
+    void VariableDeclaration() {
+        Advance();
+        const Token name = Expect(Tok::kIdentifier, "expected variable name");
+        if (Match(Tok::kDoubleColon)) {
+            SkipType();
+        }
+        Expect(Tok::kAssign, "expected '='");
+        // The initializer still sees an outer variable of the same name
+        const uint8_t reg = static_cast<uint8_t>(fs_->free_reg);
+        ExpressionInto(reg);
+        ExpectSemicolon();
+        DeclareLocal(name.text, reg);
+        SetFree(reg + 1u);
+    }
+
+    void Assignment() {
+        const Local* local = FindLocal(current_.text);
+        if (local == nullptr) {
+            Fail("undefined variable '" + std::string(current_.text) + "'", current_.offset);
+            return;
+        }
+        const uint8_t reg = local->reg;
+        Advance();
+        Advance();
+        ExpressionInto(reg);
+        ExpectSemicolon();
+    }
+
+    void ExpressionStatement() {
+        const uint32_t base = fs_->free_reg;
+        Expression();
+        SetFree(base);
+        ExpectSemicolon();
+    }
+
+    // Emits a conditional jump over what follows, to be patched
+    size_t Condition() {
+        const uint32_t base = fs_->free_reg;
+        const uint8_t condition = Expression();
+        SetFree(base);
+        return EmitBx(AFNSOpcode::kJumpIfFalse, condition, 0);
+    }
+
+    void IfStatement() {
+        Advance();
+        const size_t skip_then = Condition();
+        Block();
+        if (!Match(Tok::kElse)) {
+            PatchJump(skip_then);
+            return;
+        }
+        const size_t skip_else = EmitBx(AFNSOpcode::kJump, 0, 0);
+        PatchJump(skip_then);
+        if (current_.kind == Tok::kIf) {
+            IfStatement();
+        } else {
+            Block();
+        }
+        PatchJump(skip_else);
+    }
+
+    void WhileStatement() {
+        Advance();
+        const size_t start = Label();
+        const size_t exit = Condition();
+        LoopBody(start);
+        PatchJump(exit);
+        PatchBreaks();
+    }
+
+    void LoopStatement() {
+        Advance();
+        LoopBody(Label());
+        PatchBreaks();
+    }
+
+    void LoopBody(size_t start) {
+        fs_->loops.push_back(LoopState{start, {}});
+        Block();
+        EmitBx(AFNSOpcode::kLoop, 0, static_cast<uint16_t>(start));
+    }
+
+    void PatchBreaks() {
+        if (fs_->loops.empty()) {
+            return;
+        }
+        for (size_t pc : fs_->loops.back().breaks) {
+            PatchJump(pc);
+        }
+        fs_->loops.pop_back();
+    }
+
+    void BreakOrContinue() {
+        const Token keyword = current_;
+        Advance();
+        if (fs_->loops.empty()) {
+            Fail("'" + std::string(keyword.text) + "' outside of a loop", keyword.offset);
+            return;
+        }
+        LoopState& loop = fs_->loops.back();
+        if (keyword.kind == Tok::kBreak) {
+            loop.breaks.push_back(EmitBx(AFNSOpcode::kJump, 0, 0));
+        } else {
+            EmitBx(AFNSOpcode::kLoop, 0, static_cast<uint16_t>(loop.start));
+        }
+        ExpectSemicolon();
+    }
+
+    void ReturnStatement() {
+        Advance();
+        if (current_.kind == Tok::kSemicolon || current_.kind == Tok::kRightBrace) {
+            Emit(AFNSOpcode::kReturnNone);
+        } else {
+            const uint32_t base = fs_->free_reg;
+            Emit(AFNSOpcode::kReturn, Expression());
+            SetFree(base);
+        }
+        ExpectSemicolon();
+    }
+
+    // ---- expressions ----
+    //
+    // Each returns the register holding the value: a local's own register,
+    // or the first free register at entry, which then stays allocated.
+
+    uint8_t Expression() {
+        const NestingScope nesting(this);
+        return failed() ? 0 : LogicalOr();
+    }
+
+    uint8_t LogicalOr() { return ShortCircuit(Tok::kOrOr, AFNSOpcode::kJumpIfTrue, &AFNSLogicCompiler::LogicalAnd); }
+
+    uint8_t LogicalAnd() { return ShortCircuit(Tok::kAndAnd, AFNSOpcode::kJumpIfFalse, &AFNSLogicCompiler::Equality); }
+
+    uint8_t ShortCircuit(Tok op, AFNSOpcode jump, uint8_t (AFNSLogicCompiler::*operand)()) {
+        const uint32_t base = fs_->free_reg;
+        uint8_t result = (this->*operand)();
+        if (current_.kind != op) {
+            return result;
+        }
+        result = ToTemporary(base, result);
+        std::vector<size_t> exits;
+        while (Match(op)) {
+            exits.push_back(EmitBx(jump, result, 0));
+            const uint8_t right = (this->*operand)();
+            if (right != result) {
+                Emit(AFNSOpcode::kMove, result, right);
+            }
+            SetFree(base + 1);
+        }
+        for (size_t pc : exits) {
+            PatchJump(pc);
+        }
+        return result;
+    }
+
+    uint8_t EmitBinary(AFNSOpcode op, uint32_t base, uint8_t left, uint8_t right) {
+        SetFree(base);
+        const uint8_t result = AllocRegister();
+        Emit(op, result, left, right);
+        return result;
+    }
+
+    uint8_t Equality() {
+        const uint32_t base = fs_->free_reg;
+        uint8_t left = Comparison();
+        for (;;) {
+            AFNSOpcode op;
+            if (current_.kind == Tok::kEqual) {
+                op = AFNSOpcode::kEqual;
+            } else if (current_.kind == Tok::kNotEqual) {
+                op = AFNSOpcode::kNotEqual;
+            } else {
+                return left;
+            }
+            Advance();
+            left = EmitBinary(op, base, left, Comparison());
+        }
+    }
+
+    uint8_t Comparison() {
+        const uint32_t base = fs_->free_reg;
+        uint8_t left = Term();
+        for (;;) {
+            AFNSOpcode op;
+            switch (current_.kind) {
+            case Tok::kLess: op = AFNSOpcode::kLess; break;
+            case Tok::kLessEqual: op = AFNSOpcode::kLessEqual; break;
+            case Tok::kGreater: op = AFNSOpcode::kGreater; break;
+            case Tok::kGreaterEqual: op = AFNSOpcode::kGreaterEqual; break;
+            default: return left;
+            }
+            Advance();
+            left = EmitBinary(op, base, left, Term());
+        }
+    }
+
+    uint8_t Term() {
+        const uint32_t base = fs_->free_reg;
+        uint8_t left = Factor();
+        for (;;) {
+            AFNSOpcode op;
+            if (current_.kind == Tok::kPlus) {
+                op = AFNSOpcode::kAdd;
+            } else if (current_.kind == Tok::kMinus) {
+                op = AFNSOpcode::kSubtract;
+            } else {
+                return left;
+            }
+            Advance();
+            left = EmitBinary(op, base, left, Factor());
+        }
+    }
+
+    uint8_t Factor() {
+        const uint32_t base = fs_->free_reg;
+        uint8_t left = Unary();
+        for (;;) {
+            AFNSOpcode op;
+            switch (current_.kind) {
+            case Tok::kStar: op = AFNSOpcode::kMultiply; break;
+            case Tok::kSlash: op = AFNSOpcode::kDivide; break;
+            case Tok::kPercent: op = AFNSOpcode::kModulo; break;
+            default: return left;
+            }
+            Advance();
+            left = EmitBinary(op, base, left, Unary());
+        }
+    }
+
+    uint8_t Unary() {
+        const uint32_t base = fs_->free_reg;
+        if (current_.kind == Tok::kMinus &&
+            (next_.kind == Tok::kInteger || next_.kind == Tok::kFloat)) {
+            // Folded, which also makes the most negative integer writable
+            Advance();
+            return NumberLiteral(true);
+        }
+        AFNSOpcode op;
+        if (current_.kind == Tok::kBang) {
+            op = AFNSOpcode::kNot;
+        } else if (current_.kind == Tok::kMinus) {
+            op = AFNSOpcode::kNegate;
+        } else {
+            return Primary();
+        }
+        Advance();
+        const NestingScope nesting(this);
+        const uint8_t operand = failed() ? 0 : Unary();
+        SetFree(base);
+        const uint8_t result = AllocRegister();
+        Emit(op, result, operand);
+        return result;
+    }
+
+    uint8_t LoadConstant(uint16_t constant) {
+        const uint8_t result = AllocRegister();
+        EmitBx(AFNSOpcode::kLoadConst, result, constant);
+        return result;
+    }
+
+    uint8_t NumberLiteral(bool negative) {
+        const Token literal = current_;
+        Advance();
+        // Both parsers need a terminated buffer or a leading sign in it
+        char buffer[64];
+        if (literal.text.size() + 2 > sizeof(buffer)) {
+            Fail("number literal too long", literal.offset);
+            return 0;
+        }
+        size_t length = 0;
+        if (negative) {
+            buffer[length++] = '-';
+        }
+        literal.text.copy(buffer + length, literal.text.size());
+        length += literal.text.size();
+        buffer[length] = '\0';
+
+        if (literal.kind == Tok::kFloat) {
+            return LoadConstant(AddConstant(AFNSValue::Float(std::strtod(buffer, nullptr))));
+        }
+        int64_t integer = 0;
+        const auto parsed = std::from_chars(buffer, buffer + length, integer);
+        if (parsed.ec != std::errc() || parsed.ptr != buffer + length) {
+            Fail("integer literal out of range", literal.offset);
+            return 0;
+        }
+        return LoadConstant(IntConstant(integer));
+    }
+
+    static std::string Unescape(std::string_view quoted) {
+        std::string text;
+        const std::string_view body = quoted.substr(1, quoted.size() - 2);
+        text.reserve(body.size());
+        for (size_t i = 0; i < body.size(); ++i) {
+            if (body[i] != '\\' || i + 1 == body.size()) {
+                text.push_back(body[i]);
+                continue;
+            }
+            switch (body[++i]) {
+            case 'n': text.push_back('\n'); break;
+            case 't': text.push_back('\t'); break;
+            case 'r': text.push_back('\r'); break;
+            case '0': text.push_back('\0'); break;
+            default: text.push_back(body[i]); break;
+            }
+        }
+        return text;
+    }
+
+    uint8_t Primary() {
+        const Token token = current_;
+        switch (token.kind) {
+        case Tok::kInteger:
+        case Tok::kFloat:
+            return NumberLiteral(false);
+        case Tok::kString:
+            Advance();
+            return LoadConstant(StringConstant(Unescape(token.text)));
+        case Tok::kTrue:
+        case Tok::kFalse:
+            Advance();
+            return LoadConstant(BoolConstant(token.kind == Tok::kTrue));
+        case Tok::kLeftParen: {
+            Advance();
+            const uint8_t result = Expression();
+            Expect(Tok::kRightParen, "expected ')'");
+            return result;
+        }
+        case Tok::kIdentifier: {
+            Advance();
+            if (current_.kind == Tok::kLeftParen) {
+                return Call(token);
+            }
+            const Local* local = FindLocal(token.text);
+            if (local == nullptr) {
+                Fail("undefined variable '" + std::string(token.text) + "'", token.offset);
+                return 0;
+            }
+            return local->reg;
+        }
+        case Tok::kReserved:
+            Fail("'" + std::string(token.text) + "' is not supported", token.offset);
+            return 0;
+        default:
+            Fail("expected expression", token.offset);
+            return 0;
+        }
+    }
+
+    // Arguments go to consecutive registers starting at the result register,
+    // which become the callee's first registers
+    uint32_t Arguments(uint32_t base) {
+        Expect(Tok::kLeftParen, "expected '('");
+        uint32_t count = 0;
+        if (current_.kind != Tok::kRightParen) {
+            do {
+                if (base + count >= kMaxRegisters) {
+                    Fail("too many arguments", current_.offset);
+                    break;
+                }
+                ExpressionInto(static_cast<uint8_t>(base + count));
+                ++count;
+            } while (Match(Tok::kComma));
+        }
+        Expect(Tok::kRightParen, "expected ')'");
+        return count;
+    }
+
+    uint8_t Call(Token name) {
+        const uint32_t base = fs_->free_reg;
+
+        if (name.text == "show" || name.text == "println" || name.text == "flutter_update_status") {
+            const bool status = name.text == "flutter_update_status";
+            if (status) {
+                LoadConstant(StringConstant(std::string(kStatusPrefix)));
+            }
+            Expect(Tok::kLeftParen, "expected '('");
+            uint8_t text = Expression();
+            Expect(Tok::kRightParen, "expected ')'");
+            if (status) {
+                SetFree(base + 1);
+                Emit(AFNSOpcode::kAdd, static_cast<uint8_t>(base), static_cast<uint8_t>(base), text);
+                text = static_cast<uint8_t>(base);
+            }
+            SetFree(base);
+            const uint8_t result = AllocRegister();
+            Emit(AFNSOpcode::kShow, result, text);
+            return result;
+        }
+        if (name.text == "state") {
+            Expect(Tok::kLeftParen, "expected '('");
+            const uint8_t path = Expression();
+            Expect(Tok::kRightParen, "expected ')'");
+            SetFree(base);
+            const uint8_t result = AllocRegister();
+            Emit(AFNSOpcode::kLoadState, result, path);
+            return result;
+        }
+        for (const StatusBuiltin& builtin : kStatusBuiltins) {
+            if (name.text == builtin.name) {
+                if (Arguments(base) != 0) {
+                    Fail(std::string(name.text) + "() takes no arguments", name.offset);
+                    return 0;
+                }
+                const uint8_t result = LoadConstant(StringConstant(std::string(builtin.output)));
+                Emit(AFNSOpcode::kShow, result, result);
+                return result;
+            }
+        }
+
+        const uint32_t count = Arguments(base);
+        SetFree(base + 1);
+        const size_t pc = EmitBx(AFNSOpcode::kCall, static_cast<uint8_t>(base), kUnresolvedFunction);
+        calls_.push_back(PendingCall{fs_->index, pc, name.text, count, name.offset});
+        return static_cast<uint8_t>(base);
+    }
+
+    AFNSBytecodeProgram* program_;
+    Lexer lexer_;
+    Token current_;
+    Token next_;
+    FunctionState* fs_ = nullptr;
+
+    std::string error_;
+    size_t error_offset_ = 0;
+    uint32_t nesting_ = 0;
+
+    std::unordered_map<std::string_view, std::vector<uint16_t>> functions_by_name_;
+    std::vector<std::vector<uint16_t>> default_arguments_;
+    std::vector<PendingCall> calls_;
+
+    // Keys view the program's own copies
+    std::unordered_map<std::string_view, uint16_t> string_constants_;
+    std::unordered_map<int64_t, uint16_t> int_constants_;
+    int32_t true_constant_ = -1;
+    int32_t false_constant_ = -1;
+};
+
+AFNSBytecodeProgram::AFNSBytecodeProgram(std::string_view source) : source_(source) {}
+
+AFNSBytecodeProgram::~AFNSBytecodeProgram() = default;
+
+std::string AFNSBytecodeProgram::Disassemble() const {
+    std::string text;
+    char line[96];
+    for (size_t f = 0; f < functions_.size(); ++f) {
+        const AFNSBytecodeFunction& function = functions_[f];
+        std::snprintf(line, sizeof(line), "function %zu %s params=%u registers=%u\n", f,
+                      function.name.c_str(), static_cast<unsigned>(function.parameter_count),
+                      static_cast<unsigned>(function.register_count));
+        text += line;
+        for (size_t pc = 0; pc < function.code.size(); ++pc) {
+            const AFNSInstruction& instruction = function.code[pc];
+            std::snprintf(line, sizeof(line), "  %04zu %-12s %3u %3u %3u  ; bx=%u\n", pc,
+                          kOpcodeNames[static_cast<size_t>(instruction.op)],
+                          static_cast<unsigned>(instruction.a), static_cast<unsigned>(instruction.b),
+                          static_cast<unsigned>(instruction.c), static_cast<unsigned>(instruction.bx()));
+            text += line;
+        }
+    }
+    return text;
+}
+
+std::shared_ptr<const AFNSBytecodeProgram> CompileAFNSLogic(std::string_view source) {
+    std::shared_ptr<AFNSBytecodeProgram> program(new AFNSBytecodeProgram(source));
+    AFNSLogicCompiler compiler(program.get());
+    compiler.Compile();
+    if (program->ok_) {
+        program->tiers_ = std::make_unique<AFNSTierState>(*program);
+    }
+    return program;
+}
+
+std::string SerializeAFNSBytecode(const AFNSBytecodeProgram& program) {
+    if (!program.ok()) {
+        return std::string();
+    }
+    const std::vector<AFNSBytecodeFunction>& functions = program.functions();
+    const std::vector<AFNSValue>& constants = program.constants();
+
+    std::string records;
+    std::string strings;
+    SerializedHeader header{kSerializedMagic, kAFNSBytecodeFormatVersion,
+                            static_cast<uint32_t>(functions.size()),
+                            static_cast<uint32_t>(constants.size())};
+    records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const AFNSValue& value : constants) {
+        SerializedConstant constant{};
+        constant.type = static_cast<uint8_t>(value.type);
+        constant.length = value.length;
+        if (value.type == AFNSValueType::kString) {
+            constant.bits = strings.size();
+            strings.append(value.chars, value.length);
+        } else {
+            std::memcpy(&constant.bits, &value.integer, sizeof(constant.bits));
+        }
+        records.append(reinterpret_cast<const char*>(&constant), sizeof(constant));
+    }
+    for (const AFNSBytecodeFunction& function : functions) {
+        SerializedFunction record{};
+        record.name_offset = static_cast<uint32_t>(strings.size());
+        record.name_length = static_cast<uint32_t>(function.name.size());
+        record.code_length = static_cast<uint32_t>(function.code.size());
+        record.register_count = function.register_count;
+        record.parameter_count = function.parameter_count;
+        strings += function.name;
+        records.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    for (const AFNSBytecodeFunction& function : functions) {
+        records.append(reinterpret_cast<const char*>(function.code.data()),
+                       function.code.size() * sizeof(AFNSInstruction));
+    }
+    return records + strings;
+}
+
+std::shared_ptr<const AFNSBytecodeProgram> LoadAFNSBytecode(std::string_view source,
+                                                            std::string_view data) {
+    SerializedReader reader(data);
+    SerializedHeader header;
+    if (!reader.Read(&header) || header.magic != kSerializedMagic ||
+        header.version != kAFNSBytecodeFormatVersion || header.function_count == 0 ||
+        header.function_count > kUnresolvedFunction || header.constant_count > kMaxConstants) {
+        return nullptr;
+    }
+
+    std::vector<SerializedConstant> constants(header.constant_count);
+    std::vector<SerializedFunction> records(header.function_count);
+    if (!reader.ReadBytes(constants.data(), constants.size() * sizeof(SerializedConstant)) ||
+        !reader.ReadBytes(records.data(), records.size() * sizeof(SerializedFunction))) {
+        return nullptr;
+    }
+
+    std::shared_ptr<AFNSBytecodeProgram> program(new AFNSBytecodeProgram(source));
+    program->functions_.resize(records.size());
+    for (size_t f = 0; f < records.size(); ++f) {
+        const SerializedFunction& record = records[f];
+        AFNSBytecodeFunction& function = program->functions_[f];
+        if (record.code_length == 0 || record.code_length > kMaxCodeSize ||
+            record.register_count > kMaxRegisters || record.parameter_count > record.register_count) {
+            return nullptr;
+        }
+        function.code.resize(record.code_length);
+        if (!reader.ReadBytes(function.code.data(), function.code.size() * sizeof(AFNSInstruction))) {
+            return nullptr;
+        }
+        function.register_count = record.register_count;
+        function.parameter_count = record.parameter_count;
+    }
+    if (program->functions_[0].parameter_count != 0) {
+        return nullptr;
+    }
+
+    reader.StartStrings();
+    for (size_t f = 0; f < records.size(); ++f) {
+        std::string_view name;
+        if (!reader.String(records[f].name_offset, records[f].name_length, &name)) {
+            return nullptr;
+        }
+        program->functions_[f].name = std::string(name);
+    }
+    program->constants_.reserve(constants.size());
+    for (const SerializedConstant& constant : constants) {
+        AFNSValue value = AFNSValue::None();
+        switch (static_cast<AFNSValueType>(constant.type)) {
+        case AFNSValueType::kNone:
+            break;
+        case AFNSValueType::kBool:
+            value = AFNSValue::Bool((constant.bits & 0xFF) != 0);
+            break;
+        case AFNSValueType::kInt:
+        case AFNSValueType::kFloat:
+            value.type = static_cast<AFNSValueType>(constant.type);
+            std::memcpy(&value.integer, &constant.bits, sizeof(constant.bits));
+            break;
+        case AFNSValueType::kString: {
+            std::string_view text;
+            if (!reader.String(constant.bits, constant.length, &text)) {
+                return nullptr;
+            }
+            const std::string& stored = program->strings_.emplace_back(text);
+            value = AFNSValue::String(stored.data(), constant.length);
+            break;
+        }
+        default:
+            return nullptr;
+        }
+        program->constants_.push_back(value);
+    }
+
+    for (const AFNSBytecodeFunction& function : program->functions_) {
+        if (!IsValidLoadedCode(function, program->functions_, program->constants_.size())) {
+            return nullptr;
+        }
+    }
+    program->ok_ = true;
+    program->tiers_ = std::make_unique<AFNSTierState>(*program);
+    return program;
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,247 @@
+// 🚀 AFNS LOGIC BYTECODE
+// Register-based bytecode for handler logic and the compiler producing it
+
+#ifndef FLUTTER_AFNS_AFNS_BYTECODE_H_
+#define FLUTTER_AFNS_AFNS_BYTECODE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_source_cache.h"
+
+namespace flutter {
+
+namespace afns {
+
+enum class AFNSValueType : uint8_t {
+    kNone,
+    kBool,
+    kInt,
+    kFloat,
+    kString,
+};
+
+// One register. Trivially copyable so the VM moves values with plain
+// stores; string bytes live in the program's constants or in the running
+// thread's arena and are only valid for one execution.
+struct AFNSValue {
+    AFNSValueType type;
+    uint32_t length;  // string bytes
+    union {
+        bool boolean;
+        int64_t integer;
+        double number;
+        const char* chars;
+    };
+
+    static AFNSValue None() {
+        AFNSValue value;
+        value.type = AFNSValueType::kNone;
+        value.length = 0;
+        value.integer = 0;
+        return value;
+    }
+    static AFNSValue Bool(bool boolean) {
+        AFNSValue value = None();
+        value.type = AFNSValueType::kBool;
+        value.boolean = boolean;
+        return value;
+    }
+    static AFNSValue Int(int64_t integer) {
+        AFNSValue value = None();
+        value.type = AFNSValueType::kInt;
+        value.integer = integer;
+        return value;
+    }
+    static AFNSValue Float(double number) {
+        AFNSValue value = None();
+        value.type = AFNSValueType::kFloat;
+        value.number = number;
+        return value;
+    }
+    static AFNSValue String(const char* chars, uint32_t length) {
+        AFNSValue value = None();
+        value.type = AFNSValueType::kString;
+        value.length = length;
+        value.chars = chars;
+        return value;
+    }
+
+    std::string_view string() const { return std::string_view(chars, length); }
+};
+
+// Instruction set. Operands: A, B, C are register numbers of the current
+// frame, Bx is the 16-bit B|C<<8 (constant index, function index or
+// absolute jump target).
+#define AFNS_OPCODES(V)                                                        \
+    V(LoadConst)     /* R[A] = K[Bx]                                       */ \
+    V(LoadNone)      /* R[A] = none                                        */ \
+    V(Move)          /* R[A] = R[B]                                        */ \
+    V(Add)           /* R[A] = R[B] + R[C], concatenates if either is text */ \
+    V(Subtract)      /* R[A] = R[B] - R[C]                                 */ \
+    V(Multiply)      /* R[A] = R[B] * R[C]                                 */ \
+    V(Divide)        /* R[A] = R[B] / R[C]                                 */ \
+    V(Modulo)        /* R[A] = R[B] % R[C]                                 */ \
+    V(Equal)         /* R[A] = R[B] == R[C]                                */ \
+    V(NotEqual)      /* R[A] = R[B] != R[C]                                */ \
+    V(Less)          /* R[A] = R[B] < R[C]                                 */ \
+    V(LessEqual)     /* R[A] = R[B] <= R[C]                                */ \
+    V(Greater)       /* R[A] = R[B] > R[C]                                 */ \
+    V(GreaterEqual)  /* R[A] = R[B] >= R[C]                                */ \
+    V(Not)           /* R[A] = !R[B]                                       */ \
+    V(Negate)        /* R[A] = -R[B]                                       */ \
+    V(Jump)          /* pc = Bx, forward only                              */ \
+    V(Loop)          /* pc = Bx, backward; charged to the step budget      */ \
+    V(JumpIfFalse)   /* if !R[A] pc = Bx                                   */ \
+    V(JumpIfTrue)    /* if R[A] pc = Bx                                    */ \
+    V(Call)          /* R[A] = F[Bx](R[A], R[A+1], ...)                    */ \
+    V(Show)          /* output R[B], R[A] = none                           */ \
+    V(LoadState)     /* R[A] = state at path R[B], none if unset           */ \
+    V(Return)        /* return R[A]                                        */ \
+    V(ReturnNone)    /* return none                                        */ \
+    AFNS_TIER_OPCODES(V)
+
+// Superinstructions only the optimizing tier (afns_tiering.h) emits. Each
+// replaces the first instruction of a baseline sequence and reads its other
+// operands from the TierData words after it, so optimized code keeps the
+// baseline's length and pc numbering. Every one guards its integer
+// operands and deoptimizes to the baseline instruction at the same pc.
+//   *IntConst:        R[A] = K[Bx]; R[D.a] = R[D.b] op K[Bx]
+//   *IntBranch:       R[A] = R[B] cmp R[C]; if false pc = D.Bx
+//   *IntConstBranch:  R[A] = K[Bx]; R[D1.a] = R[D1.b] cmp K[Bx];
+//                     if false pc = D2.Bx
+#define AFNS_TIER_OPCODES(V)                                                   \
+    V(AddIntConst)                                                             \
+    V(SubtractIntConst)                                                        \
+    V(MultiplyIntConst)                                                        \
+    V(LessIntBranch)                                                           \
+    V(LessEqualIntBranch)                                                      \
+    V(GreaterIntBranch)                                                        \
+    V(GreaterEqualIntBranch)                                                   \
+    V(EqualIntBranch)                                                          \
+    V(NotEqualIntBranch)                                                       \
+    V(LessIntConstBranch)                                                      \
+    V(LessEqualIntConstBranch)                                                 \
+    V(GreaterIntConstBranch)                                                   \
+    V(GreaterEqualIntConstBranch)                                              \
+    V(EqualIntConstBranch)                                                     \
+    V(NotEqualIntConstBranch)                                                  \
+    V(TierData)      /* operands of the superinstruction before it */
+
+enum class AFNSOpcode : uint8_t {
+#define AFNS_OPCODE_ENUM(name) k##name,
+    AFNS_OPCODES(AFNS_OPCODE_ENUM)
+#undef AFNS_OPCODE_ENUM
+    kCount,
+};
+
+struct AFNSInstruction {
+    AFNSOpcode op;
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+
+    uint16_t bx() const { return static_cast<uint16_t>(b | (c << 8)); }
+};
+
+static_assert(sizeof(AFNSInstruction) == 4, "instructions are one word");
+
+class AFNSTierState;
+
+struct AFNSBytecodeFunction {
+    std::string name;
+    uint8_t parameter_count = 0;
+
+    // Frame size; parameters are registers 0..parameter_count-1 and every
+    // local has its own register, resolved when compiling
+    uint16_t register_count = 0;
+
+    std::vector<AFNSInstruction> code;
+};
+
+// 🎯 AFNS BYTECODE PROGRAM
+// Compiled form of one source. Function 0 runs the top-level statements and
+// then the entry point: apex() if declared, otherwise the first function
+// when the source is only declarations (an event handler), called with
+// default arguments. Immutable once built and shared between threads.
+class AFNSBytecodeProgram {
+public:
+    ~AFNSBytecodeProgram();
+
+    AFNSBytecodeProgram(const AFNSBytecodeProgram&) = delete;
+    AFNSBytecodeProgram& operator=(const AFNSBytecodeProgram&) = delete;
+
+    const std::string& source() const { return source_; }
+
+    // False if the source uses something the compiler does not handle;
+    // error() and error_offset() (bytes into source()) say what
+    bool ok() const { return ok_; }
+    const std::string& error() const { return error_; }
+    size_t error_offset() const { return error_offset_; }
+
+    const std::vector<AFNSBytecodeFunction>& functions() const { return functions_; }
+    const std::vector<AFNSValue>& constants() const { return constants_; }
+
+    // One line per instruction, for debugging
+    std::string Disassemble() const;
+
+    // Hotness counters and optimized code; null unless ok(). Mutable
+    // behind a const program the way a cache is.
+    AFNSTierState* tiers() const { return tiers_.get(); }
+
+private:
+    friend class AFNSLogicCompiler;
+    friend std::shared_ptr<const AFNSBytecodeProgram> CompileAFNSLogic(std::string_view source);
+    friend std::shared_ptr<const AFNSBytecodeProgram> LoadAFNSBytecode(std::string_view source,
+                                                                       std::string_view data);
+
+    explicit AFNSBytecodeProgram(std::string_view source);
+
+    std::string source_;
+    bool ok_ = false;
+    std::string error_;
+    size_t error_offset_ = 0;
+
+    std::vector<AFNSBytecodeFunction> functions_;
+    std::vector<AFNSValue> constants_;
+
+    // Bytes of string constants; deque elements never move
+    std::deque<std::string> strings_;
+
+    std::unique_ptr<AFNSTierState> tiers_;
+};
+
+// Never null; check ok() on the result. Handles variables, arithmetic,
+// comparisons, if/else, while, loop, break/continue, functions and the
+// show/println/flutter_update_status/flutter_handle_* builtins, and
+// state("path") for reading keyed engine state.
+std::shared_ptr<const AFNSBytecodeProgram> CompileAFNSLogic(std::string_view source);
+
+// Version of the SerializeAFNSBytecode layout; LoadAFNSBytecode rejects
+// any other. 2: LoadState
+constexpr uint32_t kAFNSBytecodeFormatVersion = 2;
+
+// Machine-independent form of an ok() program (host order, which must be
+// little-endian), for storing compiled handlers ahead of time. Empty for a
+// program that is not ok().
+std::string SerializeAFNSBytecode(const AFNSBytecodeProgram& program);
+
+// Rebuilds what SerializeAFNSBytecode wrote for |source| without compiling.
+// The code is checked as it is read (opcodes, jump targets, operand ranges)
+// so a damaged blob is rejected instead of run; null if it is.
+std::shared_ptr<const AFNSBytecodeProgram> LoadAFNSBytecode(std::string_view source,
+                                                            std::string_view data);
+
+// Bytecode by source hash, failed compiles included so they are not retried
+using AFNSBytecodeCache = AFNSSourceCache<AFNSBytecodeProgram>;
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_BYTECODE_H_
@@ -0,0 +1,408 @@
+// 🚀 AFNS PERSISTENT COMPILE CACHE
+// Compiled artifacts kept on disk across restarts, written in the background
+
+#include "afns_disk_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "afns_widget_cache.h"
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr uint32_t kEntryMagic = 0x43444641;  // "AFDC"
+constexpr uint16_t kEntryVersion = 1;
+constexpr size_t kKeyNameLength = 16;  // hex digits before ".<kind>"
+
+// Recency updates waiting for the writer; past this they are dropped,
+// which only makes pruning after a restart less precise
+constexpr size_t kMaxQueuedTouches = 1024;
+
+struct EntryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t kind;
+    uint8_t reserved;
+    uint64_t engine_version;
+    uint32_t source_length;
+    uint32_t payload_length;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(EntryHeader) == 32, "file layout");
+
+uint64_t EntryChecksum(std::string_view source, std::string_view payload) {
+    return HashAFNSSource(payload, HashAFNSSource(source, 0));
+}
+
+bool IsKind(char c) {
+    return c == static_cast<char>(AFNSDiskCacheKind::kWidget) ||
+           c == static_cast<char>(AFNSDiskCacheKind::kTree) ||
+           c == static_cast<char>(AFNSDiskCacheKind::kBytecode);
+}
+
+// Key of a "<16 hex digits>.<kind>" file name
+bool ParseEntryName(const std::string& name, uint64_t* key, AFNSDiskCacheKind* kind) {
+    if (name.size() != kKeyNameLength + 2 || name[kKeyNameLength] != '.' ||
+        !IsKind(name[kKeyNameLength + 1])) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < kKeyNameLength; ++i) {
+        const char c = name[i];
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = static_cast<uint64_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = static_cast<uint64_t>(c - 'a' + 10);
+        } else {
+            return false;
+        }
+        value = value << 4 | digit;
+    }
+    *key = value;
+    *kind = static_cast<AFNSDiskCacheKind>(name[kKeyNameLength + 1]);
+    return true;
+}
+
+} // anonymous namespace
+
+AFNSDiskCache::AFNSDiskCache(std::string directory, std::string_view engine_version,
+                             size_t byte_cap)
+    : directory_(std::move(directory)),
+      version_seed_(HashAFNSSource(engine_version, 0)),
+      byte_cap_(byte_cap),
+      writer_(&AFNSDiskCache::WriterLoop, this) {}
+
+AFNSDiskCache::~AFNSDiskCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_one();
+    writer_.join();
+}
+
+uint64_t AFNSDiskCache::Key(AFNSDiskCacheKind kind, std::string_view source) const {
+    return HashAFNSSource(source, version_seed_ ^ (static_cast<uint64_t>(kind) << 56));
+}
+
+std::string AFNSDiskCache::PathFor(uint64_t key, AFNSDiskCacheKind kind) const {
+    char name[kKeyNameLength + 3];
+    std::snprintf(name, sizeof(name), "%016llx.%c", static_cast<unsigned long long>(key),
+                  static_cast<char>(kind));
+    return directory_ + "/" + name;
+}
+
+const AFNSDiskCache::PendingWrite* AFNSDiskCache::FindQueuedLocked(uint64_t key, AFNSDiskCacheKind kind,
+                                                                    std::string_view source) const {
+    for (const auto* queue : {&pending_, &in_flight_}) {
+        auto it = queue->find(key);
+        if (it != queue->end() && it->second.kind == kind && it->second.source == source) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+bool AFNSDiskCache::Lookup(AFNSDiskCacheKind kind, std::string_view source, std::string* payload) {
+    const uint64_t key = Key(kind, source);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const PendingWrite* queued = FindQueuedLocked(key, kind, source)) {
+            *payload = queued->payload;
+            ++hits_;
+            return true;
+        }
+        auto it = index_.find(key);
+        if (!scanned_ || it == index_.end() || it->second.kind != kind) {
+            ++misses_;
+            return false;
+        }
+    }
+
+    const std::string path = PathFor(key, kind);
+    const bool found = ReadEntry(path, kind, source, payload);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (found) {
+        ++hits_;
+        if (it != index_.end()) {
+            it->second.last_used = ++tick_;
+        }
+        // Recency survives a restart through the mtime; no hurry to write it
+        if (touched_.size() < kMaxQueuedTouches) {
+            touched_.push_back(path);
+        }
+        return true;
+    }
+    ++misses_;
+    if (it != index_.end()) {
+        bytes_used_ -= it->second.bytes;
+        index_.erase(it);
+        doomed_.push_back(path);
+        work_ready_.notify_one();
+    }
+    return false;
+}
+
+void AFNSDiskCache::Store(AFNSDiskCacheKind kind, std::string_view source, std::string payload) {
+    if (source.size() > UINT32_MAX || payload.size() > UINT32_MAX) {
+        return;
+    }
+    const uint64_t key = Key(kind, source);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_[key] = PendingWrite{kind, std::string(source), std::move(payload), ++store_sequence_};
+    }
+    work_ready_.notify_one();
+}
+
+void AFNSDiskCache::Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_ready_.notify_one();
+    work_done_.wait(lock, [this] {
+        // Touches ride along with the next write, they do not wake the writer
+        return scanned_ && !writing_ && pending_.empty() && doomed_.empty();
+    });
+}
+
+AFNSDiskCacheStats AFNSDiskCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AFNSDiskCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.writes = writes_;
+    stats.write_failures = write_failures_;
+    stats.evictions = evictions_;
+    stats.entries = index_.size();
+    stats.bytes_used = bytes_used_;
+    stats.byte_cap = byte_cap_;
+    return stats;
+}
+
+bool AFNSDiskCache::ReadEntry(const std::string& path, AFNSDiskCacheKind kind,
+                              std::string_view source, std::string* payload) const {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    EntryHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == kEntryMagic &&
+              header.version == kEntryVersion && header.kind == static_cast<uint8_t>(kind) &&
+              header.engine_version == version_seed_ && header.source_length == source.size();
+    std::string stored_source;
+    std::string stored_payload;
+    if (ok) {
+        stored_source.resize(header.source_length);
+        ok = std::fread(&stored_source[0], 1, stored_source.size(), file) == stored_source.size() &&
+             stored_source == source;
+    }
+    if (ok) {
+        stored_payload.resize(header.payload_length);
+        ok = std::fread(&stored_payload[0], 1, stored_payload.size(), file) == stored_payload.size() &&
+             std::fgetc(file) == EOF &&
+             EntryChecksum(stored_source, stored_payload) == header.checksum;
+    }
+    std::fclose(file);
+    if (ok) {
+        *payload = std::move(stored_payload);
+    }
+    return ok;
+}
+
+void AFNSDiskCache::WriterLoop() {
+    ScanDirectory();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_ready_.wait(lock, [this] {
+            return stopping_ || !pending_.empty() || !doomed_.empty();
+        });
+        if (pending_.empty() && doomed_.empty() && touched_.empty()) {
+            if (stopping_) {
+                return;
+            }
+            continue;
+        }
+
+        in_flight_.swap(pending_);
+        std::vector<std::pair<uint64_t, const PendingWrite*>> writes;
+        writes.reserve(in_flight_.size());
+        for (const auto& [key, write] : in_flight_) {
+            writes.emplace_back(key, &write);
+        }
+        std::sort(writes.begin(), writes.end(), [](const auto& a, const auto& b) {
+            return a.second->sequence < b.second->sequence;
+        });
+        std::vector<std::string> touched;
+        touched.swap(touched_);
+        std::vector<std::string> doomed;
+        doomed.swap(doomed_);
+        writing_ = true;
+
+        // Disk work runs unlocked so lookups and stores never wait on it;
+        // lookups still find the batch in in_flight_, which only this
+        // thread changes
+        lock.unlock();
+        std::error_code error;
+        for (const std::string& path : doomed) {
+            std::filesystem::remove(path, error);
+        }
+        for (const std::string& path : touched) {
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        }
+        for (const auto& [key, write] : writes) {
+            size_t bytes = 0;
+            const bool written = WriteEntry(key, *write, &bytes);
+            std::lock_guard<std::mutex> index_lock(mutex_);
+            if (!written) {
+                ++write_failures_;
+                continue;
+            }
+            ++writes_;
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+                bytes_used_ -= it->second.bytes;
+            }
+            index_[key] = IndexEntry{write->kind, bytes, ++tick_};
+            bytes_used_ += bytes;
+        }
+        lock.lock();
+        in_flight_.clear();
+
+        std::vector<std::string> evicted;
+        PruneLocked(&evicted);
+        if (!evicted.empty()) {
+            lock.unlock();
+            for (const std::string& path : evicted) {
+                std::filesystem::remove(path, error);
+            }
+            lock.lock();
+        }
+        writing_ = false;
+        work_done_.notify_all();
+    }
+}
+
+void AFNSDiskCache::ScanDirectory() {
+    struct Found {
+        uint64_t key;
+        IndexEntry entry;
+        std::filesystem::file_time_type modified;
+    };
+    std::vector<Found> found;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    for (std::filesystem::directory_iterator it(directory_, error), end; !error && it != end;
+         it.increment(error)) {
+        const std::filesystem::path& path = it->path();
+        if (path.extension() == ".tmp") {
+            // Left by a write that never got renamed
+            std::filesystem::remove(path, error);
+            continue;
+        }
+        uint64_t key;
+        AFNSDiskCacheKind kind;
+        if (!it->is_regular_file(error) || !ParseEntryName(path.filename().string(), &key, &kind)) {
+            continue;
+        }
+        const uintmax_t bytes = it->file_size(error);
+        const auto modified = it->last_write_time(error);
+        if (!error) {
+            found.push_back(Found{key, IndexEntry{kind, static_cast<size_t>(bytes), 0}, modified});
+        }
+        error.clear();
+    }
+    std::sort(found.begin(), found.end(),
+              [](const Found& a, const Found& b) { return a.modified < b.modified; });
+
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Found& file : found) {
+            file.entry.last_used = ++tick_;
+            bytes_used_ += file.entry.bytes;
+            index_.emplace(file.key, file.entry);
+        }
+        scanned_ = true;
+        PruneLocked(&evicted);
+    }
+    for (const std::string& path : evicted) {
+        std::filesystem::remove(path, error);
+    }
+    work_done_.notify_all();
+}
+
+bool AFNSDiskCache::WriteEntry(uint64_t key, const PendingWrite& write, size_t* bytes) {
+    EntryHeader header;
+    header.magic = kEntryMagic;
+    header.version = kEntryVersion;
+    header.kind = static_cast<uint8_t>(write.kind);
+    header.reserved = 0;
+    header.engine_version = version_seed_;
+    header.source_length = static_cast<uint32_t>(write.source.size());
+    header.payload_length = static_cast<uint32_t>(write.payload.size());
+    header.checksum = EntryChecksum(write.source, write.payload);
+
+    // Readers only ever see a complete file or none: the rename is atomic,
+    // and a file torn by a crash fails its checksum
+    const std::string path = PathFor(key, write.kind);
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(write.source.data(), 1, write.source.size(), file) == write.source.size() &&
+              std::fwrite(write.payload.data(), 1, write.payload.size(), file) == write.payload.size();
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporary, path, error);
+        ok = !error;
+    }
+    if (!ok) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    *bytes = sizeof(header) + write.source.size() + write.payload.size();
+    return true;
+}
+
+void AFNSDiskCache::PruneLocked(std::vector<std::string>* doomed) {
+    if (bytes_used_ <= byte_cap_) {
+        return;
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> by_age;  // (last_used, key)
+    by_age.reserve(index_.size());
+    for (const auto& [key, entry] : index_) {
+        by_age.emplace_back(entry.last_used, key);
+    }
+    std::sort(by_age.begin(), by_age.end());
+    for (const auto& [last_used, key] : by_age) {
+        if (bytes_used_ <= byte_cap_) {
+            break;
+        }
+        auto it = index_.find(key);
+        bytes_used_ -= it->second.bytes;
+        doomed->push_back(PathFor(key, it->second.kind));
+        index_.erase(it);
+        ++evictions_;
+    }
+}
+
+} // namespace afns
+
+} // namespace flutter
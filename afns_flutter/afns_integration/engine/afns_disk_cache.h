@@ -0,0 +1,135 @@
+// 🚀 AFNS PERSISTENT COMPILE CACHE
+// Compiled artifacts kept on disk across restarts, written in the background
+
+#ifndef FLUTTER_AFNS_AFNS_DISK_CACHE_H_
+#define FLUTTER_AFNS_AFNS_DISK_CACHE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// What a cached file holds; part of the key, so one source can have all three
+enum class AFNSDiskCacheKind : uint8_t {
+    kWidget = 'w',    // CompileAFNSWidget output
+    kTree = 't',      // CompileAFNSWidgetTree output
+    kBytecode = 'b',  // SerializeAFNSBytecode output
+};
+
+// Snapshot of cache counters, safe to copy out to callers
+struct AFNSDiskCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t writes = 0;
+    uint64_t write_failures = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes_used = 0;
+    size_t byte_cap = 0;
+};
+
+// 🎯 AFNS DISK CACHE
+// One file per artifact in |directory|, named by the content hash of the
+// source seeded with the engine version, so an engine upgrade or rebuild
+// from changed sources starts from an empty key space and old files age out. Every file repeats the source
+// and carries a checksum: a collision or a torn file reads as a miss and
+// the file is dropped.
+//
+// Compiles never wait on the disk for writes. Store() only queues; a
+// writer thread owned by the cache writes each file to a temporary name
+// and renames it into place, then prunes least recently used files past
+// |byte_cap|. The same thread indexes the directory at startup and
+// Lookup() misses without I/O until that is done, or for keys not in the
+// index; a hit reads one small file instead of compiling.
+class AFNSDiskCache {
+public:
+    static constexpr size_t kDefaultByteCap = 32 * 1024 * 1024;
+
+    AFNSDiskCache(std::string directory, std::string_view engine_version,
+                  size_t byte_cap = kDefaultByteCap);
+
+    // Writes what is still queued, then stops the writer
+    ~AFNSDiskCache();
+
+    AFNSDiskCache(const AFNSDiskCache&) = delete;
+    AFNSDiskCache& operator=(const AFNSDiskCache&) = delete;
+
+    bool Lookup(AFNSDiskCacheKind kind, std::string_view source, std::string* payload);
+
+    // Queues |payload| for |source|; replaces a queued write of the same key
+    void Store(AFNSDiskCacheKind kind, std::string_view source, std::string payload);
+
+    // Blocks until the startup scan and every write queued so far are done
+    void Flush();
+
+    AFNSDiskCacheStats GetStats() const;
+
+private:
+    struct IndexEntry {
+        AFNSDiskCacheKind kind;
+        size_t bytes;
+        uint64_t last_used;  // tick, larger is more recent
+    };
+
+    struct PendingWrite {
+        AFNSDiskCacheKind kind;
+        std::string source;
+        std::string payload;
+        uint64_t sequence;  // store order, so a batch lands oldest first
+    };
+
+    uint64_t Key(AFNSDiskCacheKind kind, std::string_view source) const;
+    const PendingWrite* FindQueuedLocked(uint64_t key, AFNSDiskCacheKind kind,
+                                         std::string_view source) const;
+    std::string PathFor(uint64_t key, AFNSDiskCacheKind kind) const;
+    bool ReadEntry(const std::string& path, AFNSDiskCacheKind kind, std::string_view source,
+                   std::string* payload) const;
+
+    // Writer thread
+    void WriterLoop();
+    void ScanDirectory();
+    bool WriteEntry(uint64_t key, const PendingWrite& write, size_t* bytes);
+    void PruneLocked(std::vector<std::string>* doomed);
+
+    const std::string directory_;
+    const uint64_t version_seed_;
+    const size_t byte_cap_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    bool scanned_ = false;
+    bool stopping_ = false;
+    bool writing_ = false;
+    std::unordered_map<uint64_t, IndexEntry> index_;
+    std::unordered_map<uint64_t, PendingWrite> pending_;
+    std::unordered_map<uint64_t, PendingWrite> in_flight_;  // batch being written
+    uint64_t store_sequence_ = 0;
+    std::vector<std::string> touched_;  // files of hits, to get a fresh mtime
+    std::vector<std::string> doomed_;   // damaged files, to delete
+    uint64_t tick_ = 0;
+    size_t bytes_used_ = 0;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t writes_ = 0;
+    uint64_t write_failures_ = 0;
+    uint64_t evictions_ = 0;
+
+    std::thread writer_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_DISK_CACHE_H_
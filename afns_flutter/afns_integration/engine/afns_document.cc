@@ -0,0 +1,105 @@
+// 🚀 AFNS INCREMENTAL DOCUMENTS
+// Edit-delta sessions that only reprocess the touched top-level declarations
+
+#include "afns_document.h"
+
+namespace flutter {
+
+namespace afns {
+
+AFNSDocument::AFNSDocument(AFNSDeclarationProcessor processor, std::string_view text)
+    : processor_(std::move(processor)), text_(text) {
+    size_t pos = 0;
+    while (pos < text_.size()) {
+        const size_t end = FindAFNSDeclarationEnd(text_, pos);
+        const size_t output_start = processed_.size();
+        processor_(std::string_view(text_).substr(pos, end - pos), &processed_);
+        declarations_.push_back(Declaration{end - pos, processed_.size() - output_start});
+        pos = end;
+    }
+    last_reprocessed_bytes_ = text_.size();
+}
+
+bool AFNSDocument::ApplyEdit(size_t offset, size_t delete_len, std::string_view insert_text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (offset > text_.size() || delete_len > text_.size() - offset) {
+        return false;
+    }
+
+    // Everything before the first declaration containing |offset| is kept
+    size_t first = 0;
+    size_t source_start = 0;
+    size_t output_start = 0;
+    while (first + 1 < declarations_.size() &&
+           source_start + declarations_[first].source_length <= offset) {
+        source_start += declarations_[first].source_length;
+        output_start += declarations_[first].output_length;
+        ++first;
+    }
+
+    text_.replace(offset, delete_len, insert_text.data(), insert_text.size());
+    const size_t old_edit_end = offset + delete_len;
+    const size_t new_edit_end = offset + insert_text.size();
+
+    // Rescan from the start of that declaration. Once a new boundary past
+    // the edit maps onto an old boundary, the text and scanner state from
+    // there on are identical, so the remaining old declarations are reused.
+    std::vector<Declaration> fresh;
+    std::string fresh_output;
+    size_t resync = declarations_.size();
+    size_t old_index = first;
+    size_t old_boundary = source_start;  // start of declarations_[old_index]
+    size_t pos = source_start;
+    const std::string_view text(text_);
+
+    while (pos < text.size()) {
+        const size_t end = FindAFNSDeclarationEnd(text, pos);
+        const size_t output_before = fresh_output.size();
+        processor_(text.substr(pos, end - pos), &fresh_output);
+        fresh.push_back(Declaration{end - pos, fresh_output.size() - output_before});
+        pos = end;
+
+        if (pos < new_edit_end) {
+            continue;
+        }
+        const size_t old_pos = pos - new_edit_end + old_edit_end;
+        while (old_index < declarations_.size() && old_boundary < old_pos) {
+            old_boundary += declarations_[old_index].source_length;
+            ++old_index;
+        }
+        if (old_boundary == old_pos && old_index < declarations_.size()) {
+            resync = old_index;
+            break;
+        }
+    }
+
+    size_t replaced_output = 0;
+    for (size_t i = first; i < resync; ++i) {
+        replaced_output += declarations_[i].output_length;
+    }
+    processed_.replace(output_start, replaced_output, fresh_output);
+    declarations_.erase(declarations_.begin() + first, declarations_.begin() + resync);
+    declarations_.insert(declarations_.begin() + first, fresh.begin(), fresh.end());
+
+    last_reprocessed_bytes_ = pos - source_start;
+    return true;
+}
+
+std::string AFNSDocument::text() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return text_;
+}
+
+std::string AFNSDocument::processed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return processed_;
+}
+
+size_t AFNSDocument::last_reprocessed_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_reprocessed_bytes_;
+}
+
+} // namespace afns
+
+} // namespace flutter
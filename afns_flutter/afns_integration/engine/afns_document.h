@@ -0,0 +1,67 @@
+// 🚀 AFNS INCREMENTAL DOCUMENTS
+// Edit-delta sessions that only reprocess the touched top-level declarations
+
+#ifndef FLUTTER_AFNS_AFNS_DOCUMENT_H_
+#define FLUTTER_AFNS_AFNS_DOCUMENT_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_rewriter.h"
+
+namespace flutter {
+
+namespace afns {
+
+// Appends the processed form of one top-level declaration to |output|
+using AFNSDeclarationProcessor =
+    std::function<void(std::string_view declaration, std::string* output)>;
+
+// 🎯 AFNS DOCUMENT
+// Keeps the source, its processed output, the split of both into top-level
+// declarations (see FindAFNSDeclarationEnd).
+// An edit rescans from the start of the first declaration it touches until
+// the split lines up with the old one again, so the processing work tracks
+// the edit size rather than the file size. The processor must handle each
+// declaration on its own; with the rewriter that means no rule may span
+// lines (the built-in table does not).
+class AFNSDocument {
+public:
+    AFNSDocument(AFNSDeclarationProcessor processor, std::string_view text);
+
+    // Replaces |delete_len| bytes at |offset| with |insert_text|. Returns
+    // false, leaving the document untouched, if the range is out of bounds.
+    bool ApplyEdit(size_t offset, size_t delete_len, std::string_view insert_text);
+
+    // Copies under the document lock, safe against concurrent edits
+    std::string text() const;
+    std::string processed() const;
+
+    // Source bytes reprocessed by the last edit, for latency accounting
+    size_t last_reprocessed_bytes() const;
+
+private:
+    struct Declaration {
+        size_t source_length;
+        size_t output_length;
+    };
+
+    const AFNSDeclarationProcessor processor_;
+
+    mutable std::mutex mutex_;
+    std::string text_;
+    std::string processed_;
+    std::vector<Declaration> declarations_;
+    size_t last_reprocessed_bytes_ = 0;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_DOCUMENT_H_
@@ -1,236 +1,986 @@
 // 🚀 AFNS ENGINE DIRECT FLUTTER INTEGRATION
 // Native Flutter Engine Extension for AFNS Language Support
-
-#include "flutter/engine/embedder/embedder.h"
-#include "flutter/runtime/dart_vm_data.h"
-#include "flutter/shell/platform/android/android_shell_holder.h"
-#include "flutter/shell/platform/android/platform_view_android_jni_impl.h"
-#include "flutter/shell/platform/linux/flutter_application.h"
-#include "flutter/shell/platform/windows/flutter_application.h"
-#include "flutter/shell/platform/macos/flutter_application.h"
-
+//
+// The platform-neutral core: no Flutter, Dart or JNI headers. The C ABI is
+// in afns_engine_c_api.cc, Dart port delivery in afns_engine_dart.cc and the
+// platform hooks in afns_engine_<platform>.cc.
+
+#include "afns_engine.h"
+
+#include "afns_metrics.h"
+#include "afns_startup.h"
+#include "afns_tiering.h"
+#include "afns_trace.h"
+#include "afns_version.h"
+#include "afns_vm.h"
+#include "afns_widget_tree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace flutter {
 
 namespace afns {
 
-// 🎯 AFNS FLUTTER ENGINE EXTENSION
-class AFNSEngineExtension {
-public:
-    // Constructor və initialization
-    AFNSEngineExtension();
-    ~AFNSEngineExtension();
-    
-    // AFNS kodunu compile et və Flutter widget-ə çevir
-    std::string CompileAFNSWidget(const std::string& afns_code);
-    
-    // AFNS logic-ini execute et və result qaytar
-    std::string ExecuteAFNSLogic(const std::string& afns_code);
-    
-    // AFNS runtime bridge Flutter ilə
-    void InitializeAFNSEngine(DartVMRef vm_ref);
-    
-    // AFNS-specific state management
-    void UpdateAFNSSState(const std::string& state);
-    std::string GetAFNSSState();
+// AFNS syntax -> Flutter equivalents, applied by ProcessAFNSCode in one pass
+// Planned: check -> switch/case, var -> final/const
+constexpr AFNSRewriteRule kAFNSRewriteRules[] = {
+    {"fun ", "Widget "},
+};
 
-private:
-    // AFNS Compiler Integration
-    std::string internal_afns_state_;
-    std::unique_ptr<void*> afns_compiler_handle_;
-    
-    // Helper methods
-    std::string ProcessAFNSCode(const std::string& code);
-    bool ValidateAFNSCode(const std::string& code);
+// Interned at startup so the names nearly every widget uses get the same
+// low ids in every run
+constexpr std::string_view kAFNSWellKnownIdentifiers[] = {
+    "id", "text", "title", "message", "placeholder", "enabled",
+    "x", "y", "width", "height",
+    "FlutterWindow", "FlutterButton", "FlutterTextField", "FlutterListBox",
+    "FlutterDialog", "FlutterText", "FlutterColumn", "FlutterRow", "FlutterContainer",
 };
 
+// Run once by Prewarm so the compiler and VM pages are faulted in before the
+// first real widget needs them
+constexpr std::string_view kAFNSPrewarmSource =
+    "fun FlutterText(text::i32) -> i32 { return text; } "
+    "apex() { var i = 0; while i < 2 { i = i + FlutterText(1); } show(\"FlutterWindow\"); }";
+
+// Source and result bytes of one compile/execute entry point call
+inline void RecordAFNSBytes(size_t in, size_t out) {
+    AddAFNSCounter(AFNSMetricCounter::kBytesIn, in);
+    AddAFNSCounter(AFNSMetricCounter::kBytesOut, out);
+}
+
 // 🚀 IMPLEMENTATION
-AFNSEngineExtension::AFNSEngineExtension() {
+const std::string& AFNSEngineVersion() {
+    static const std::string version =
+        std::string(kAFNSEngineBuildVersion) + "/bytecode-" + std::to_string(kAFNSBytecodeFormatVersion);
+    return version;
+}
+
+AFNSEngineExtension::AFNSEngineExtension()
+    : widget_cache_(AFNSEngineVersion()),
+      widget_tree_cache_(AFNSEngineVersion()),
+      rewriter_(kAFNSRewriteRules),
+      default_context_(std::make_shared<AFNSEngineContext>()) {
     // AFNS Engine initialization
-    internal_afns_state_ = "AFNS_ENGINE_ACTIVE";
+    for (std::string_view name : kAFNSWellKnownIdentifiers) {
+        identifiers_.Intern(name);
+    }
 }
 
 AFNSEngineExtension::~AFNSEngineExtension() {
     // Cleanup AFNS resources
 }
 
-std::string AFNSEngineExtension::CompileAFNSWidget(const std::string& afns_code) {
+std::string AFNSEngineExtension::CompileAFNSWidget(std::string_view afns_code) {
+    AFNSMetricScope timer(AFNSMetricTimer::kCompileWidget);
+    AFNSTraceSpan trace("compile_widget");
+    std::string widget = BuildAFNSWidget(afns_code);
+    RecordAFNSBytes(afns_code.size(), widget.size());
+    return widget;
+}
+
+std::string AFNSEngineExtension::BuildAFNSWidget(std::string_view afns_code) {
     // Parse AFNS code and generate Flutter widget
     if (!ValidateAFNSCode(afns_code)) {
         return "error: invalid_afns_code";
     }
     
-    std::string processed_code = ProcessAFNSCode(afns_code);
+    AFNSDiskCache* disk_cache = disk_cache_.load(std::memory_order_acquire);
+    {
+        AFNSTraceSpan trace("cache_lookup");
+        std::string cached_widget;
+        if (widget_cache_.Lookup(afns_code, &cached_widget)) {
+            return cached_widget;
+        }
+        AFNSBundleItem bundled;
+        if (FindInBundle(afns_code, &bundled)) {
+            return std::string(bundled.widget);
+        }
+        if (disk_cache != nullptr && disk_cache->Lookup(AFNSDiskCacheKind::kWidget, afns_code, &cached_widget)) {
+            widget_cache_.Insert(afns_code, cached_widget);
+            return cached_widget;
+        }
+    }
     
     // Generate Flutter widget from AFNS
-    return std::string("Flutter Widget Generated from AFNS: ") + processed_code;
+    // Processed straight into the result, no processed-code temporary
+    std::string widget = "Flutter Widget Generated from AFNS: ";
+    AppendProcessedAFNSCode(afns_code, &widget);
+    widget_cache_.Insert(afns_code, widget);
+    if (disk_cache != nullptr) {
+        disk_cache->Store(AFNSDiskCacheKind::kWidget, afns_code, widget);
+    }
+    return widget;
 }
 
-std::string AFNSEngineExtension::ExecuteAFNSLogic(const std::string& afns_code) {
-    // Execute AFNS logic and return result
+std::shared_ptr<AFNSEngineContext> AFNSEngineExtension::CreateAFNSContext() {
+    return std::make_shared<AFNSEngineContext>();
+}
+
+bool AFNSEngineExtension::CompileAFNSWidgetTree(std::string_view afns_code, std::string* tree) {
+    return CompileAFNSWidgetTree(default_context_.get(), afns_code, tree);
+}
+
+bool AFNSEngineExtension::CompileAFNSWidgetTree(AFNSEngineContext* context,
+                                                std::string_view afns_code, std::string* tree) {
+    AFNSMetricScope timer(AFNSMetricTimer::kCompileTree);
+    AFNSTraceSpan trace("compile_widget_tree");
+    const bool ok = BuildAFNSWidgetTree(context, afns_code, tree);
+    RecordAFNSBytes(afns_code.size(), ok ? tree->size() : 0);
+    return ok;
+}
+
+bool AFNSEngineExtension::BuildAFNSWidgetTree(AFNSEngineContext* context,
+                                              std::string_view afns_code, std::string* tree) {
     if (!ValidateAFNSCode(afns_code)) {
-        return "error: invalid_afns_logic";
+        return false;
+    }
+    AFNSDiskCache* disk_cache = disk_cache_.load(std::memory_order_acquire);
+    {
+        AFNSTraceSpan trace("cache_lookup");
+        if (widget_tree_cache_.Lookup(afns_code, tree)) {
+            return true;
+        }
+        AFNSBundleItem bundled;
+        if (FindInBundle(afns_code, &bundled)) {
+            tree->assign(bundled.tree.data(), bundled.tree.size());
+            return true;
+        }
+        if (disk_cache != nullptr && disk_cache->Lookup(AFNSDiskCacheKind::kTree, afns_code, tree)) {
+            widget_tree_cache_.Insert(afns_code, *tree);
+            return true;
+        }
     }
     
-    std::string processed_code = ProcessAFNSCode(afns_code);
+    // Builder temporaries live in this thread's arena and are released in
+    // one step when the scope ends; only the finished tree is copied out
+    AFNSArenaScope scope(ThreadAFNSArena());
+    AFNSStateReadScope reads;
+    bool parsed;
+    {
+        AFNSTraceSpan trace("build_widget_tree");
+        AFNSWidgetTreeBuilder builder(&identifiers_, scope.arena());
+        parsed = ParseAFNSWidgetTree(afns_code, &builder, &context->state_store_);
+        if (parsed) {
+            *tree = builder.Finish();
+        }
+    }
+    RecordCompileMemory(scope);
+    if (!parsed) {
+        return false;  // nested deeper than kAFNSWidgetTreeMaxDepth
+    }
     
-    // AFNS logic execution
-    internal_afns_state_ = "EXECUTED: " + processed_code;
+    // A tree that read state is only good until the state changes, so it
+    // is rebuilt every time rather than cached
+    if (!reads.empty()) {
+        return true;
+    }
+    widget_tree_cache_.Insert(afns_code, *tree);
+    if (disk_cache != nullptr) {
+        disk_cache->Store(AFNSDiskCacheKind::kTree, afns_code, *tree);
+    }
+    return true;
+}
+
+bool AFNSEngineExtension::CompileAFNSWidgetPatch(std::string_view widget_id, std::string_view afns_code,
+                                                 size_t patch_cap, std::string* patch) {
+    return CompileAFNSWidgetPatch(default_context_.get(), widget_id, afns_code, patch_cap, patch);
+}
+
+bool AFNSEngineExtension::CompileAFNSWidgetPatch(AFNSEngineContext* context,
+                                                 std::string_view widget_id, std::string_view afns_code,
+                                                 size_t patch_cap, std::string* patch) {
+    AFNSMetricScope timer(AFNSMetricTimer::kCompilePatch);
+    AFNSTraceSpan trace("compile_widget_patch");
+    std::string tree;
+    if (!BuildAFNSWidgetTree(context, afns_code, &tree)) {
+        RecordAFNSBytes(afns_code.size(), 0);
+        return false;
+    }
+    std::shared_ptr<AFNSWidgetTreeDiffer> differ = context->WidgetDiffer(widget_id);
+    AFNSTraceSpan diff_trace("diff_widget_tree");
+    const bool ok = differ->Diff(tree, patch_cap, patch);
+    RecordAFNSBytes(afns_code.size(), ok ? patch->size() : 0);
+    return ok;
+}
+
+void AFNSEngineExtension::ResetAFNSWidgetPatches(std::string_view widget_id) {
+    ResetAFNSWidgetPatches(default_context_.get(), widget_id);
+}
+
+void AFNSEngineExtension::ResetAFNSWidgetPatches(AFNSEngineContext* context,
+                                                 std::string_view widget_id) {
+    context->ResetWidgetDiffer(widget_id);
+}
+
+std::string AFNSEngineExtension::BuildAFNSBundle(const AFNSPackedStringsView& sources) {
+    AFNSBundleWriter writer;
+    std::string tree;
+    for (size_t i = 0; i < sources.count; ++i) {
+        const std::string_view code = sources.Get(i);
+        AFNSStateReadScope reads;
+        if (!CompileAFNSWidgetTree(code, &tree) || !reads.empty()) {
+            // Trees that read state are never precompiled, see CompileAFNSWidgetTree
+            continue;
+        }
+        std::shared_ptr<const AFNSBytecodeProgram> program = CompileAFNSLogicCached(code);
+        writer.Add(code, CompileAFNSWidget(code), tree,
+                   program->ok() ? SerializeAFNSBytecode(*program) : std::string());
+    }
+    
+    // The names those trees interned, so a loading engine gives them the
+    // same ids before it builds anything itself
+    const size_t identifier_count = identifiers_.GetStats().entries;
+    for (uint32_t id = 0; id < identifier_count; ++id) {
+        writer.AddIdentifier(identifiers_.Get(id));
+    }
+    return writer.Finish(AFNSEngineVersion());
+}
+
+bool AFNSEngineExtension::LoadAFNSBundle(const std::string& path, std::string* error) {
+    std::unique_ptr<AFNSBundle> bundle = AFNSBundle::Open(path, AFNSEngineVersion(), error);
+    if (bundle == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < bundle->identifier_count(); ++i) {
+        identifiers_.Intern(bundle->identifier(i));
+    }
     
-    return processed_code;
+    std::lock_guard<std::mutex> lock(bundles_mutex_);
+    auto loaded = std::make_unique<const LoadedBundle>(
+        LoadedBundle{std::move(bundle), newest_bundle_.load(std::memory_order_relaxed)});
+    newest_bundle_.store(loaded.get(), std::memory_order_release);
+    bundles_.push_back(std::move(loaded));
+    return true;
 }
 
-void AFNSEngineExtension::InitializeAFNSEngine(DartVMRef vm_ref) {
-    // Initialize AFNS engine with Dart VM
-    // Setup AFNS-Flutter bridge
+bool AFNSEngineExtension::EnableDiskCache(const std::string& directory, size_t byte_cap) {
+    std::lock_guard<std::mutex> lock(disk_cache_mutex_);
+    if (disk_cache_owner_ != nullptr || directory.empty()) {
+        return false;
+    }
+    disk_cache_owner_ = std::make_unique<AFNSDiskCache>(
+        directory, AFNSEngineVersion(), byte_cap == 0 ? AFNSDiskCache::kDefaultByteCap : byte_cap);
+    disk_cache_.store(disk_cache_owner_.get(), std::memory_order_release);
+    return true;
 }
 
-void AFNSEngineExtension::UpdateAFNSSState(const std::string& state) {
-    internal_afns_state_ = state;
+AFNSDiskCacheStats AFNSEngineExtension::GetDiskCacheStats() const {
+    const AFNSDiskCache* disk_cache = disk_cache_.load(std::memory_order_acquire);
+    return disk_cache != nullptr ? disk_cache->GetStats() : AFNSDiskCacheStats();
 }
 
-std::string AFNSEngineExtension::GetAFNSSState() {
-    return internal_afns_state_;
+bool AFNSEngineExtension::FindInBundle(std::string_view code, AFNSBundleItem* item) const {
+    for (const LoadedBundle* loaded = newest_bundle_.load(std::memory_order_acquire);
+         loaded != nullptr; loaded = loaded->older) {
+        if (loaded->bundle->Find(code, item)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-std::string AFNSEngineExtension::ProcessAFNSCode(const std::string& code) {
-    // AFNS code preprocessing
-    std::string result = code;
+void AFNSEngineExtension::CompileAFNSWidgetBatch(const AFNSPackedStringsView& sources,
+                                                 AFNSPackedStrings* results) {
+    results->offsets.assign(1, 0);
+    results->blob.clear();
+    results->offsets.reserve(sources.count + 1);
+    if (sources.count > 0) {
+        // Widget output is the source plus a short prefix, size for that once
+        const size_t source_bytes = static_cast<size_t>(sources.offsets[sources.count] - sources.offsets[0]);
+        results->blob.reserve(source_bytes + source_bytes / 8 + sources.count * 64);
+    }
     
-    // Replace AFNS syntax with Flutter equivalents
-    // Example: fun -> function, check -> switch/case, var -> final/const
+    // Items are independent: compile them across the worker pool into
+    // per-item slots, then pack in input order
+    AFNSTraceSpan trace("compile_widget_batch");
+    std::vector<std::string> widgets(sources.count);
+    const uint64_t flow = CurrentAFNSTraceFlow();
+    worker_pool_.ParallelFor(sources.count, [this, &sources, &widgets, flow](size_t i) {
+        AFNSTraceFlowScope flow_scope(flow);
+        widgets[i] = CompileAFNSWidget(sources.Get(i));
+    });
     
-    // Sample replacements:
-    size_t pos = 0;
-    while ((pos = result.find("fun ", pos)) != std::string::npos) {
-        result.replace(pos, 4, "Widget ");
-        pos += 6;
+    for (const std::string& widget : widgets) {
+        results->Append(widget);
     }
+}
+
+std::string AFNSEngineExtension::ExecuteAFNSLogic(std::string_view afns_code) {
+    return ExecuteAFNSLogic(default_context_.get(), afns_code);
+}
+
+std::string AFNSEngineExtension::ExecuteAFNSLogic(AFNSEngineContext* context,
+                                                  std::string_view afns_code) {
+    // Execute AFNS logic and return result
+    AFNSMetricScope timer(AFNSMetricTimer::kExecute);
+    AFNSTraceSpan trace("execute_logic");
+    if (!ValidateAFNSCode(afns_code)) {
+        RecordAFNSBytes(afns_code.size(), 0);
+        return "error: invalid_afns_logic";
+    }
+    
+    // AFNS logic execution
+    std::shared_ptr<const AFNSBytecodeProgram> program = CompileAFNSLogicCached(afns_code);
+    std::string result;
+    if (program->ok()) {
+        AFNSTraceSpan run_trace("run_logic");
+        const auto start = std::chrono::steady_clock::now();
+        AFNSLogicResult run = RunAFNSLogic(*program, kAFNSDefaultStepBudget, &context->state_store_);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        RecordLogicRun(static_cast<uint64_t>(
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                       run.ok());
+        if (!run.ok()) {
+            result = "error: " + run.error;
+        } else {
+            result = run.output.empty() ? std::move(run.value) : std::move(run.output);
+        }
+    } else {
+        logic_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+        result = ProcessAFNSCode(afns_code);
+    }
+    
+    // The state records that an execute ran, not what it produced: a
+    // bounded marker instead of a copy of output that can reach 1 MB, or
+    // of the whole processed program on the fallback path
+    char executed[64];
+    std::snprintf(executed, sizeof(executed), "EXECUTED: %zu bytes, hash %016" PRIx64,
+                  result.size(), HashAFNSSource(result, 0));
+    context->PublishState(executed);
+    RecordAFNSBytes(afns_code.size(), result.size());
     
     return result;
 }
 
-bool AFNSEngineExtension::ValidateAFNSCode(const std::string& code) {
-    // Basic AFNS syntax validation
-    return !code.empty() && code.length() > 0;
+uint64_t AFNSEngineExtension::CompileAFNSWidgetAsync(std::string_view widget_id,
+                                                     std::string_view afns_code,
+                                                     AFNSCompletionCallback done) {
+    return SubmitAsync(default_context_.get(), false, widget_id, afns_code, std::move(done));
 }
 
-} // namespace afns
+uint64_t AFNSEngineExtension::CompileAFNSWidgetAsync(AFNSEngineContext* context,
+                                                     std::string_view widget_id,
+                                                     std::string_view afns_code,
+                                                     AFNSCompletionCallback done) {
+    return SubmitAsync(context, false, widget_id, afns_code, std::move(done));
+}
 
-} // namespace flutter
+std::string AFNSEngineExtension::ExecuteAFNSLogic(AFNSEngineContext* context,
+                                                  std::string_view afns_code, size_t result_cap) {
+    std::string result;
+    if (context->TakeHeldExecuteResult(afns_code, &result)) {
+        return result;
+    }
+    const uint64_t store_version = context->state_store_.version();
+    result = ExecuteAFNSLogic(context, afns_code);
+    if (result.size() > result_cap) {
+        context->HoldExecuteResult(afns_code, result, store_version);
+    }
+    return result;
+}
+
+uint64_t AFNSEngineExtension::ExecuteAFNSLogicAsync(std::string_view widget_id,
+                                                    std::string_view afns_code,
+                                                    AFNSCompletionCallback done) {
+    return SubmitAsync(default_context_.get(), true, widget_id, afns_code, std::move(done));
+}
+
+uint64_t AFNSEngineExtension::ExecuteAFNSLogicAsync(AFNSEngineContext* context,
+                                                    std::string_view widget_id,
+                                                    std::string_view afns_code,
+                                                    AFNSCompletionCallback done) {
+    return SubmitAsync(context, true, widget_id, afns_code, std::move(done));
+}
 
-// 🔥 NATIVE FLUTTER PLATFORM INTEGRATION
+bool AFNSEngineExtension::CancelAFNSRequest(uint64_t request_id) {
+    return CancelAFNSRequest(default_context_.get(), request_id);
+}
 
-// Android Integration
-extern "C" {
+bool AFNSEngineExtension::CancelAFNSRequest(AFNSEngineContext* context, uint64_t request_id) {
+    return context->async_requests_.Cancel(request_id);
+}
 
-JNIEXPORT jstring JNICALL
-Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidget(
-    JNIEnv* env, 
-    jobject instance, 
-    jstring afns_code
-) {
-    flutter::afns::AFNSEngineExtension afns_engine;
+uint64_t AFNSEngineExtension::SubmitAsync(AFNSEngineContext* context, bool execute,
+                                          std::string_view widget_id, std::string_view afns_code,
+                                          AFNSCompletionCallback done) {
+    auto request = context->async_requests_.Begin(widget_id);
+    const uint64_t request_id = request->id;
     
-    const char* code = env->GetStringUTFChars(afns_code, nullptr);
-    std::string result = afns_engine.CompileAFNSWidget(std::string(code));
-    env->ReleaseStringUTFChars(afns_code, code);
+    // The task keeps the context alive; its caller may drop it meanwhile
+    worker_pool_.Post([this, context = context->shared_from_this(), execute, request,
+                       code = std::string(afns_code), done = std::move(done),
+                       flow = CurrentAFNSTraceFlow(), queued = AFNSTraceStamp()] {
+        AFNSTraceFlowScope flow_scope(flow);
+        RecordAFNSTraceSpanSince("worker_queue", queued);
+        
+        // Skip work that was cancelled or superseded while queued
+        std::string result;
+        if (request->IsLive()) {
+            result = execute ? ExecuteAFNSLogic(context.get(), code) : CompileAFNSWidget(code);
+        }
+        
+        const AFNSAsyncStatus status = context->async_requests_.Finish(request);
+        if (status != AFNSAsyncStatus::kCompleted) {
+            result.clear();
+        }
+        AFNSTraceSpan trace("deliver_result");
+        done(request->id, status, result);
+    });
     
-    return env->NewStringUTF(result.c_str());
+    return request_id;
+}
+
+uint64_t AFNSEngineExtension::OpenAFNSDocument(std::string_view afns_code) {
+    // Declarations are processed one by one
+    auto process = [this](std::string_view declaration, std::string* output) {
+        AppendProcessedAFNSCode(declaration, output);
+    };
+    auto document = std::make_shared<AFNSDocument>(process, afns_code);
+    std::lock_guard<std::mutex> lock(documents_mutex_);
+    const uint64_t handle = next_document_++;
+    documents_.emplace(handle, std::move(document));
+    return handle;
+}
+
+bool AFNSEngineExtension::EditAFNSDocument(uint64_t document, size_t offset, size_t delete_len,
+                                           std::string_view insert_text) {
+    std::shared_ptr<AFNSDocument> target = FindDocument(document);
+    return target != nullptr && target->ApplyEdit(offset, delete_len, insert_text);
+}
+
+bool AFNSEngineExtension::CompileAFNSDocument(uint64_t document, std::string* widget) {
+    std::shared_ptr<AFNSDocument> target = FindDocument(document);
+    if (target == nullptr) {
+        return false;
+    }
+    
+    // Same contract as CompileAFNSWidget, minus the rewrite of unchanged code
+    if (!ValidateAFNSCode(target->text())) {
+        *widget = "error: invalid_afns_code";
+        return true;
+    }
+    std::string processed_code = target->processed();
+    if (processed_code.empty()) {
+        *widget = "error: invalid_afns_code";
+        return true;
+    }
+    *widget = std::string("Flutter Widget Generated from AFNS: ") + processed_code;
+    return true;
+}
+
+void AFNSEngineExtension::CloseAFNSDocument(uint64_t document) {
+    std::lock_guard<std::mutex> lock(documents_mutex_);
+    documents_.erase(document);
+}
+
+std::shared_ptr<AFNSDocument> AFNSEngineExtension::FindDocument(uint64_t document) {
+    std::lock_guard<std::mutex> lock(documents_mutex_);
+    auto it = documents_.find(document);
+    return it == documents_.end() ? nullptr : it->second;
+}
+
+void AFNSEngineExtension::UpdateAFNSSState(const std::string& state) {
+    default_context_->UpdateAFNSSState(state);
+}
+
+std::string AFNSEngineExtension::GetAFNSSState() {
+    return default_context_->GetAFNSSState();
 }
 
-JNIEXPORT jstring JNICALL
-Java_io_flutter_plugin_afns_AFNSEngine_nativeExecuteAFNSLogic(
-    JNIEnv* env, 
-    jobject instance, 
-    jstring afns_code
-) {
-    flutter::afns::AFNSEngineExtension afns_engine;
+uint64_t AFNSEngineExtension::GetAFNSStateVersion() const {
+    return default_context_->GetAFNSStateVersion();
+}
+
+std::shared_ptr<const AFNSStateSnapshot> AFNSEngineExtension::GetAFNSStateSnapshot() const {
+    return default_context_->GetAFNSStateSnapshot();
+}
+
+void AFNSEngineExtension::SetAFNSStateValue(std::string_view path, AFNSStateValue value) {
+    default_context_->SetAFNSStateValue(path, std::move(value));
+}
+
+void AFNSEngineExtension::RemoveAFNSStateValue(std::string_view path) {
+    default_context_->RemoveAFNSStateValue(path);
+}
+
+// Declared in afns_engine_context.h
+struct AFNSEngineBinding {
+    uint64_t id = 0;
+    bool execute = false;
+    std::string widget_id;
+    std::string code;
+    AFNSEngineExtension::AFNSBindingCallback done;
     
-    const char* code = env->GetStringUTFChars(afns_code, nullptr);
-    std::string result = afns_engine.ExecuteAFNSLogic(std::string(code));
-    env->ReleaseStringUTFChars(afns_code, code);
+    // Guarded by the context's bindings_mutex_
+    bool bound = true;
+    bool running = false;
+    bool rerun = false;
     
-    return env->NewStringUTF(result.c_str());
+    // Paths flushed during the current run that were not known to be its
+    // dependencies yet; the run may have read them before they changed
+    std::vector<std::string> missed;
+};
+
+uint64_t AFNSEngineExtension::BindAFNS(bool execute, std::string_view widget_id,
+                                       std::string_view afns_code, AFNSBindingCallback done) {
+    return BindAFNS(default_context_.get(), execute, widget_id, afns_code, std::move(done));
 }
 
-} // extern "C"
+uint64_t AFNSEngineExtension::BindAFNS(AFNSEngineContext* context, bool execute,
+                                       std::string_view widget_id, std::string_view afns_code,
+                                       AFNSBindingCallback done) {
+    auto binding = std::make_shared<AFNSEngineBinding>();
+    binding->execute = execute;
+    binding->widget_id.assign(widget_id.data(), widget_id.size());
+    binding->code.assign(afns_code.data(), afns_code.size());
+    binding->done = std::move(done);
+    binding->running = true;
+    if (!execute) {
+        context->ResetWidgetDiffer(widget_id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+        binding->id = context->next_binding_++;
+        context->bindings_.emplace(binding->id, binding);
+    }
+    const uint64_t id = binding->id;
+    RunBinding(context->shared_from_this(), std::move(binding));
+    return id;
+}
 
-// 🎯 FLUTTER ENGINE INTEGRATION
-namespace {
+void AFNSEngineExtension::CloseAFNSContext(AFNSEngineContext* context) {
+    std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+    for (auto& entry : context->bindings_) {
+        entry.second->bound = false;
+        context->state_dependencies_.Remove(entry.first);
+    }
+    context->bindings_.clear();
+}
 
-// Global AFNS Engine Instance
-std::unique_ptr<flutter::afns::AFNSEngineExtension> g_afns_engine;
+void AFNSEngineExtension::UnbindAFNS(uint64_t binding) {
+    UnbindAFNS(default_context_.get(), binding);
+}
 
-flutter::afns::AFNSEngineExtension* GetAFNSEngine() {
-    if (!g_afns_engine) {
-        g_afns_engine = std::make_unique<flutter::afns::AFNSEngineExtension>();
+void AFNSEngineExtension::UnbindAFNS(AFNSEngineContext* context, uint64_t binding) {
+    std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+    auto it = context->bindings_.find(binding);
+    if (it == context->bindings_.end()) {
+        return;
     }
-    return g_afns_engine.get();
+    it->second->bound = false;
+    context->bindings_.erase(it);
+    context->state_dependencies_.Remove(binding);
 }
 
-} // anonymous namespace
+size_t AFNSEngineExtension::FlushAFNSState() {
+    return FlushAFNSState(default_context_.get());
+}
+
+size_t AFNSEngineExtension::FlushAFNSState(AFNSEngineContext* context) {
+    std::vector<std::string> changes = context->state_store_.TakeChanges();
+    if (changes.empty()) {
+        return 0;
+    }
+    
+    std::vector<std::shared_ptr<AFNSEngineBinding>> started;
+    size_t scheduled = 0;
+    {
+        std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+        for (auto& entry : context->bindings_) {
+            if (entry.second->running) {
+                std::vector<std::string>& missed = entry.second->missed;
+                missed.insert(missed.end(), changes.begin(), changes.end());
+            }
+        }
+        for (uint64_t id : context->state_dependencies_.Dependents(changes)) {
+            auto it = context->bindings_.find(id);
+            if (it == context->bindings_.end()) {
+                continue;
+            }
+            ++scheduled;
+            AFNSEngineBinding& binding = *it->second;
+            if (binding.running) {
+                // Coalesced into one run after the current one
+                binding.rerun = true;
+            } else {
+                binding.running = true;
+                started.push_back(it->second);
+            }
+        }
+    }
+    std::shared_ptr<AFNSEngineContext> owner = context->shared_from_this();
+    for (std::shared_ptr<AFNSEngineBinding>& binding : started) {
+        RunBinding(owner, std::move(binding));
+    }
+    return scheduled;
+}
 
-// Platform-specific implementations
+void AFNSEngineExtension::RunBinding(std::shared_ptr<AFNSEngineContext> context,
+                                     std::shared_ptr<AFNSEngineBinding> binding) {
+    worker_pool_.Post([this, context = std::move(context), binding = std::move(binding),
+                       flow = CurrentAFNSTraceFlow(), queued = AFNSTraceStamp()] {
+        AFNSTraceFlowScope flow_scope(flow);
+        RecordAFNSTraceSpanSince("worker_queue", queued);
+        for (;;) {
+            // Whatever this run reads becomes what the binding depends on
+            std::string result;
+            bool ok = true;
+            std::vector<std::string> paths;
+            {
+                AFNSStateReadScope reads;
+                if (binding->execute) {
+                    result = ExecuteAFNSLogic(context.get(), binding->code);
+                } else {
+                    ok = CompileAFNSWidgetPatch(context.get(), binding->widget_id, binding->code,
+                                                SIZE_MAX, &result);
+                }
+                paths = reads.TakePaths();
+            }
+            {
+                std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+                if (!binding->bound) {
+                    binding->running = false;
+                    return;
+                }
+                context->state_dependencies_.Set(binding->id, paths);
+            }
+            
+            {
+                AFNSTraceSpan trace("deliver_result");
+                binding->done(binding->id, ok, result);
+            }
+            
+            std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+            bool rerun = binding->rerun;
+            for (const std::string& path : binding->missed) {
+                rerun = rerun || std::binary_search(paths.begin(), paths.end(), path);
+            }
+            binding->rerun = false;
+            binding->missed.clear();
+            if (!binding->bound || !rerun) {
+                binding->running = false;
+                return;
+            }
+        }
+    });
+}
 
-#ifdef ANDROID
-// Android Flutter Integration
-extern "C" {
+void AFNSEngineExtension::SetWidgetCacheBudget(size_t byte_budget) {
+    // Split between the text and binary caches, text widgets are larger
+    widget_cache_.SetByteBudget(byte_budget - byte_budget / 4);
+    widget_tree_cache_.SetByteBudget(byte_budget / 4);
+}
 
-JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
-    // Initialize AFNS Engine for Android
-    GetAFNSEngine();
-    return JNI_VERSION_1_6;
+AFNSWidgetCacheStats AFNSEngineExtension::GetWidgetCacheStats() const {
+    AFNSWidgetCacheStats stats = widget_cache_.GetStats();
+    const AFNSWidgetCacheStats tree = widget_tree_cache_.GetStats();
+    stats.hits += tree.hits;
+    stats.misses += tree.misses;
+    stats.evictions += tree.evictions;
+    stats.entries += tree.entries;
+    stats.bytes_used += tree.bytes_used;
+    stats.byte_budget += tree.byte_budget;
+    return stats;
 }
 
-} // extern "C"
-#endif
+AFNSInternTableStats AFNSEngineExtension::GetInternTableStats() const {
+    return identifiers_.GetStats();
+}
+
+AFNSCompileMemoryStats AFNSEngineExtension::GetCompileMemoryStats() const {
+    AFNSCompileMemoryStats stats;
+    stats.compiles = compiles_.load(std::memory_order_relaxed);
+    stats.arena_allocations = compile_arena_allocations_.load(std::memory_order_relaxed);
+    stats.last_arena_allocations = last_compile_arena_allocations_.load(std::memory_order_relaxed);
+    stats.last_peak_bytes = last_compile_peak_bytes_.load(std::memory_order_relaxed);
+    stats.max_peak_bytes = max_compile_peak_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AFNSEngineExtension::RecordCompileMemory(const AFNSArenaScope& scope) {
+    const uint64_t allocations = scope.allocations();
+    const size_t peak_bytes = scope.peak_bytes();
+    compiles_.fetch_add(1, std::memory_order_relaxed);
+    compile_arena_allocations_.fetch_add(allocations, std::memory_order_relaxed);
+    last_compile_arena_allocations_.store(allocations, std::memory_order_relaxed);
+    last_compile_peak_bytes_.store(peak_bytes, std::memory_order_relaxed);
+    size_t max_peak = max_compile_peak_bytes_.load(std::memory_order_relaxed);
+    while (peak_bytes > max_peak &&
+           !max_compile_peak_bytes_.compare_exchange_weak(max_peak, peak_bytes,
+                                                          std::memory_order_relaxed)) {
+    }
+}
 
-#ifdef LINUX
-// Linux Flutter Integration
-extern "C" {
+AFNSLogicStats AFNSEngineExtension::GetLogicStats() const {
+    AFNSLogicStats stats;
+    stats.executions = logic_executions_.load(std::memory_order_relaxed);
+    stats.runtime_errors = logic_runtime_errors_.load(std::memory_order_relaxed);
+    stats.bytecode_compiles = logic_bytecode_compiles_.load(std::memory_order_relaxed);
+    stats.fallbacks = logic_fallbacks_.load(std::memory_order_relaxed);
+    stats.last_run_ns = last_logic_run_ns_.load(std::memory_order_relaxed);
+    stats.max_run_ns = max_logic_run_ns_.load(std::memory_order_relaxed);
+    stats.total_run_ns = total_logic_run_ns_.load(std::memory_order_relaxed);
+    const AFNSTieringStats tiering = GetAFNSTieringStats();
+    stats.tier_ups = tiering.tier_ups;
+    stats.deoptimizations = tiering.deoptimizations;
+    return stats;
+}
 
-int afns_linux_init() {
-    // Initialize AFNS Engine for Linux
-    GetAFNSEngine();
-    return 0;
+void AFNSEngineExtension::SetLogicTiering(bool enabled) {
+    SetAFNSTieringEnabled(enabled);
 }
 
-} // extern "C"
-#endif
+std::string AFNSEngineExtension::GetAFNSEngineStats() {
+    AFNSStatsWriter stats;
+    stats.BeginObject("metrics");
+    stats.Metrics(GetAFNSMetrics());
+    stats.EndObject();
+    
+    const AFNSWidgetCacheStats caches[] = {widget_cache_.GetStats(), widget_tree_cache_.GetStats()};
+    const char* const cache_names[] = {"widget_cache", "widget_tree_cache"};
+    for (size_t i = 0; i < 2; ++i) {
+        const AFNSWidgetCacheStats& cache = caches[i];
+        stats.BeginObject(cache_names[i]);
+        stats.UInt("hits", cache.hits);
+        stats.UInt("misses", cache.misses);
+        stats.Double("hit_ratio", cache.hits + cache.misses == 0
+                                      ? 0.0
+                                      : static_cast<double>(cache.hits) / (cache.hits + cache.misses));
+        stats.UInt("evictions", cache.evictions);
+        stats.UInt("entries", cache.entries);
+        stats.UInt("bytes_used", cache.bytes_used);
+        stats.UInt("byte_budget", cache.byte_budget);
+        stats.EndObject();
+    }
+    
+    const AFNSInternTableStats identifiers = GetInternTableStats();
+    stats.BeginObject("identifiers");
+    stats.UInt("entries", identifiers.entries);
+    stats.UInt("bytes_used", identifiers.bytes_used);
+    stats.UInt("lookups", identifiers.lookups);
+    stats.Double("hit_ratio", identifiers.hit_ratio());
+    stats.EndObject();
+    
+    const AFNSCompileMemoryStats memory = GetCompileMemoryStats();
+    stats.BeginObject("compile_memory");
+    stats.UInt("compiles", memory.compiles);
+    stats.UInt("arena_allocations", memory.arena_allocations);
+    stats.UInt("last_peak_bytes", memory.last_peak_bytes);
+    stats.UInt("max_peak_bytes", memory.max_peak_bytes);
+    stats.EndObject();
+    
+    const AFNSLogicStats logic = GetLogicStats();
+    stats.BeginObject("logic");
+    stats.UInt("executions", logic.executions);
+    stats.UInt("runtime_errors", logic.runtime_errors);
+    stats.UInt("bytecode_compiles", logic.bytecode_compiles);
+    stats.UInt("fallbacks", logic.fallbacks);
+    stats.UInt("max_run_ns", logic.max_run_ns);
+    stats.UInt("total_run_ns", logic.total_run_ns);
+    stats.UInt("tier_ups", logic.tier_ups);
+    stats.UInt("deoptimizations", logic.deoptimizations);
+    stats.EndObject();
+    
+    const AFNSDiskCacheStats disk = GetDiskCacheStats();
+    stats.BeginObject("disk_cache");
+    stats.Bool("enabled", disk_cache_.load(std::memory_order_acquire) != nullptr);
+    stats.UInt("hits", disk.hits);
+    stats.UInt("misses", disk.misses);
+    stats.UInt("writes", disk.writes);
+    stats.UInt("write_failures", disk.write_failures);
+    stats.UInt("evictions", disk.evictions);
+    stats.UInt("entries", disk.entries);
+    stats.UInt("bytes_used", disk.bytes_used);
+    stats.EndObject();
+    
+    stats.BeginObject("state");
+    // Of the default context, plus how many contexts exist
+    AFNSEngineContext* context = default_context_.get();
+    stats.UInt("contexts", AFNSEngineContext::live_count());
+    stats.UInt("version", context->GetAFNSStateVersion());
+    stats.UInt("paths", context->state_store_.size());
+    {
+        std::lock_guard<std::mutex> lock(context->bindings_mutex_);
+        stats.UInt("bindings", context->bindings_.size());
+        stats.UInt("dependency_paths", context->state_dependencies_.path_count());
+    }
+    stats.EndObject();
+    
+    stats.BeginObject("startup_us");
+    for (size_t i = 0; i < static_cast<size_t>(AFNSStartupPhase::kCount); ++i) {
+        const auto phase = static_cast<AFNSStartupPhase>(i);
+        const int64_t micros = AFNSStartupPhaseMicros(phase);
+        if (micros >= 0) {
+            stats.Int(AFNSStartupPhaseName(phase), micros);
+        }
+    }
+    stats.EndObject();
+    
+    stats.Bool("bundle_loaded", newest_bundle_.load(std::memory_order_acquire) != nullptr);
+    stats.UInt("worker_threads", worker_pool_.thread_count());
+    return stats.Finish();
+}
 
-#ifdef WINDOWS
-// Windows Flutter Integration
-extern "C" {
+void AFNSEngineExtension::RecordLogicRun(uint64_t run_ns, bool ok) {
+    logic_executions_.fetch_add(1, std::memory_order_relaxed);
+    if (!ok) {
+        logic_runtime_errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    last_logic_run_ns_.store(run_ns, std::memory_order_relaxed);
+    total_logic_run_ns_.fetch_add(run_ns, std::memory_order_relaxed);
+    uint64_t max_run = max_logic_run_ns_.load(std::memory_order_relaxed);
+    while (run_ns > max_run &&
+           !max_logic_run_ns_.compare_exchange_weak(max_run, run_ns, std::memory_order_relaxed)) {
+    }
+}
 
-BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved) {
-    switch (fdwReason) {
-    case DLL_PROCESS_ATTACH:
-        // Initialize AFNS Engine for Windows
-        GetAFNSEngine();
-        break;
-    case DLL_PROCESS_DETACH:
-        // Cleanup AFNS Engine
-        g_afns_engine.reset();
-        break;
+std::shared_ptr<const AFNSBytecodeProgram> AFNSEngineExtension::CompileAFNSLogicCached(
+    std::string_view code) {
+    std::shared_ptr<const AFNSBytecodeProgram> program = bytecode_cache_.Lookup(code);
+    if (program != nullptr) {
+        return program;
+    }
+    AFNSBundleItem bundled;
+    if (FindInBundle(code, &bundled) && !bundled.bytecode.empty()) {
+        program = LoadAFNSBytecode(code, bundled.bytecode);
+    }
+    AFNSDiskCache* disk_cache = disk_cache_.load(std::memory_order_acquire);
+    std::string stored;
+    if (program == nullptr && disk_cache != nullptr &&
+        disk_cache->Lookup(AFNSDiskCacheKind::kBytecode, code, &stored)) {
+        program = LoadAFNSBytecode(code, stored);
     }
-    return TRUE;
+    if (program == nullptr) {
+        AFNSMetricScope timer(AFNSMetricTimer::kCompileLogic);
+        AFNSTraceSpan trace("compile_logic");
+        program = CompileAFNSLogic(code);
+        logic_bytecode_compiles_.fetch_add(1, std::memory_order_relaxed);
+        if (disk_cache != nullptr && program->ok()) {
+            disk_cache->Store(AFNSDiskCacheKind::kBytecode, code, SerializeAFNSBytecode(*program));
+        }
+    }
+    bytecode_cache_.Insert(program);
+    return program;
 }
 
-} // extern "C"
-#endif
+void AFNSEngineExtension::Prewarm() {
+    worker_pool_.Post([this] {
+        MarkAFNSStartupPhase(AFNSStartupPhase::kPrewarmBegin);
+        // Only looked up: nothing consumes its AST yet, see afns_frontend.h
+        Compiler();
+        CompileAFNSLogic(kAFNSPrewarmSource);
+        MarkAFNSStartupPhase(AFNSStartupPhase::kPrewarmDone);
+    });
+}
 
-#ifdef MACOS
-// macOS Flutter Integration
-extern "C" {
+const AFNSFrontend* AFNSEngineExtension::Compiler() {
+    std::call_once(afns_compiler_once_, [this] {
+        afns_compiler_handle_ = AFNSFrontend::Get();
+        MarkAFNSStartupPhase(AFNSStartupPhase::kCompilerResolved);
+    });
+    return afns_compiler_handle_;
+}
 
-int afns_macos_init() {
-    // Initialize AFNS Engine for macOS
-    GetAFNSEngine();
-    return 0;
+void AFNSEngineExtension::AppendProcessedAFNSCode(std::string_view code, std::string* output) {
+    AFNSMetricScope timer(AFNSMetricTimer::kProcess);
+    AFNSTraceSpan trace("rewrite");
+    // AFNS code preprocessing
+    // Replace AFNS syntax with Flutter equivalents textually, every rule in
+    // one pass. This is the only definition of the widget text: it does not
+    // depend on whether the Rust front end loaded, so a build with libafns
+    // and one without produce the same widgets and cache entries.
+    rewriter_.AppendRewrite(code, output);
 }
 
-} // extern "C"
-#endif
+std::string AFNSEngineExtension::ProcessAFNSCode(std::string_view code) {
+    std::string processed;
+    AppendProcessedAFNSCode(code, &processed);
+    return processed;
+}
+
+AFNSValidationResult AFNSEngineExtension::CheckAFNSCode(std::string_view afns_code) const {
+    return ValidateAFNSSource(afns_code);
+}
+
+bool AFNSEngineExtension::ValidateAFNSCode(std::string_view code) const {
+    // AFNS syntax pre-validation: brackets, literals, UTF-8, control bytes
+    // in one scan, so bad input is rejected before any rewriting
+    AFNSMetricScope timer(AFNSMetricTimer::kValidate);
+    AFNSTraceSpan trace("validate");
+    return ValidateAFNSSource(code).ok();
+}
+
+
+// 🎯 ENGINE INSTANCE
+namespace {
+
+// Global AFNS Engine Instance
+//
+// Startup is staged. The platform load hooks (JNI_OnLoad, DllMain,
+// afns_linux_init, afns_macos_init in afns_engine_<platform>.cc) only
+// timestamp kLibraryLoaded: DllMain runs under the loader lock, where
+// creating threads or loading libraries can deadlock, and the others sit on
+// the app's launch path. The engine is created by the first entry point
+// that needs it, or earlier by initialize_afns_engine, and the front end is
+// resolved on first use or by afns_engine_prewarm in the background. Each
+// stage is timestamped, see afns_startup.h.
+//
+// Threading model: the engine is created once, whichever thread gets there
+// first, and lives until afns_engine_shutdown (the next caller then creates
+// another). While it lives every entry point may be called from any thread
+// at the same time:
+// CompileAFNSWidget and ExecuteAFNSLogic share only the internally locked
+// widget cache, and the engine state is an immutable snapshot per context
+// whose pointer is copied and swapped under a short per-context lock, so a
+// state reader waits at most for a pointer swap, never for a writer's work.
+// Every entry point loads g_afns_engine; only creation and shutdown take
+// the mutex, which owns the engine.
+std::atomic<AFNSEngineExtension*> g_afns_engine{nullptr};
+std::mutex g_afns_engine_mutex;
+std::unique_ptr<AFNSEngineExtension> g_afns_engine_owner;
+
+} // anonymous namespace
+
+AFNSEngineExtension* GetAFNSEngine() {
+    AFNSEngineExtension* engine = g_afns_engine.load(std::memory_order_acquire);
+    if (engine != nullptr) {
+        return engine;
+    }
+    std::lock_guard<std::mutex> lock(g_afns_engine_mutex);
+    if (g_afns_engine_owner == nullptr) {
+        MarkAFNSStartupPhase(AFNSStartupPhase::kEngineCreateBegin);
+        g_afns_engine_owner = std::make_unique<AFNSEngineExtension>();
+        MarkAFNSStartupPhase(AFNSStartupPhase::kEngineCreated);
+        g_afns_engine.store(g_afns_engine_owner.get(), std::memory_order_release);
+    }
+    return g_afns_engine_owner.get();
+}
+
+void ShutdownAFNSEngine() {
+    std::unique_ptr<AFNSEngineExtension> engine;
+    {
+        std::lock_guard<std::mutex> lock(g_afns_engine_mutex);
+        g_afns_engine.store(nullptr, std::memory_order_release);
+        engine = std::move(g_afns_engine_owner);
+    }
+    // Joins the worker pool and the disk cache writer, outside the lock
+    engine.reset();
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,396 @@
+// 🚀 AFNS ENGINE EXTENSION
+// Platform-neutral compile/execute/state core shared by every platform glue
+
+#ifndef FLUTTER_AFNS_AFNS_ENGINE_H_
+#define FLUTTER_AFNS_AFNS_ENGINE_H_
+
+#include "afns_arena.h"
+#include "afns_async_requests.h"
+#include "afns_bundle.h"
+#include "afns_bytecode.h"
+#include "afns_disk_cache.h"
+#include "afns_document.h"
+#include "afns_engine_context.h"
+#include "afns_frontend.h"
+#include "afns_intern_table.h"
+#include "afns_packed_strings.h"
+#include "afns_rewriter.h"
+#include "afns_state_store.h"
+#include "afns_validator.h"
+#include "afns_widget_cache.h"
+#include "afns_widget_diff.h"
+#include "afns_worker_pool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// What an afns_context handle of the C ABI (afns_engine_c_api.h) holds
+struct afns_context {
+    std::shared_ptr<flutter::afns::AFNSEngineContext> context;
+};
+
+namespace flutter {
+
+namespace afns {
+
+// Arena use of compilations that ran (cache hits allocate nothing)
+struct AFNSCompileMemoryStats {
+    uint64_t compiles = 0;
+    uint64_t arena_allocations = 0;
+    uint64_t last_arena_allocations = 0;
+    size_t last_peak_bytes = 0;
+    size_t max_peak_bytes = 0;
+};
+
+// ExecuteAFNSLogic runs; times cover the bytecode run, not compilation
+struct AFNSLogicStats {
+    uint64_t executions = 0;
+    uint64_t runtime_errors = 0;
+    uint64_t bytecode_compiles = 0;
+    
+    // Code the bytecode compiler does not handle, returned processed instead
+    uint64_t fallbacks = 0;
+    
+    uint64_t last_run_ns = 0;
+    uint64_t max_run_ns = 0;
+    uint64_t total_run_ns = 0;
+    
+    // Hot functions moved to optimized code, and guards that sent one back
+    // (process-wide)
+    uint64_t tier_ups = 0;
+    uint64_t deoptimizations = 0;
+    
+    double average_run_us() const {
+        return executions == 0 ? 0.0 : static_cast<double>(total_run_ns) / 1000.0 / executions;
+    }
+};
+
+// 🎯 AFNS FLUTTER ENGINE EXTENSION
+class AFNSEngineExtension {
+public:
+    // Constructor və initialization
+    AFNSEngineExtension();
+    ~AFNSEngineExtension();
+    
+    // AFNS kodunu compile et və Flutter widget-ə çevir
+    std::string CompileAFNSWidget(std::string_view afns_code);
+    
+    // Hər izolyat üçün ayrı kontekst
+    // Calls that read or change state take the context to use; their
+    // overloads without one use the default context, which the JNI entry
+    // points and the context-less C ABI share. A context lives as long as
+    // its last reference, bindings and async work still running for it
+    // included.
+    std::shared_ptr<AFNSEngineContext> CreateAFNSContext();
+    AFNSEngineContext* default_context() { return default_context_.get(); }
+    
+    // Unbinds every binding of |context|, for when its owner goes away
+    void CloseAFNSContext(AFNSEngineContext* context);
+    
+    // AFNS kodunu binary widget tree-yə çevir
+    // See afns_widget_tree.h for the format. Returns false for invalid code
+    // and for widgets nested deeper than kAFNSWidgetTreeMaxDepth.
+    bool CompileAFNSWidgetTree(std::string_view afns_code, std::string* tree);
+    bool CompileAFNSWidgetTree(AFNSEngineContext* context, std::string_view afns_code,
+                               std::string* tree);
+    
+    // Widget id üçün yalnız dəyişən node-ları göndər
+    // Compiles the code to a widget tree and writes the afns_widget_diff.h
+    // patch from the tree last committed for |widget_id|; the new tree is
+    // committed when the patch fits |patch_cap|, so a caller that grows its
+    // buffer and retries gets the same patch. Returns false for invalid
+    // code. ResetAFNSWidgetPatches forgets a widget and its next patch
+    // starts from an empty tree.
+    bool CompileAFNSWidgetPatch(std::string_view widget_id, std::string_view afns_code,
+                                size_t patch_cap, std::string* patch);
+    bool CompileAFNSWidgetPatch(AFNSEngineContext* context, std::string_view widget_id,
+                                std::string_view afns_code, size_t patch_cap, std::string* patch);
+    void ResetAFNSWidgetPatches(std::string_view widget_id);
+    void ResetAFNSWidgetPatches(AFNSEngineContext* context, std::string_view widget_id);
+    
+    // Build zamanı hazırlanmış bundle
+    // BuildAFNSBundle compiles every valid source (widget, widget tree and
+    // bytecode) into the afns_bundle.h format, for a build step to write
+    // out. LoadAFNSBundle maps one read-only; from then on compiling a
+    // bundled source is a lookup. Every loaded bundle is searched, newest
+    // first, so a later load wins for sources more than one holds.
+    // Bundles from another engine version are refused.
+    std::string BuildAFNSBundle(const AFNSPackedStringsView& sources);
+    bool LoadAFNSBundle(const std::string& path, std::string* error);
+    
+    // Restart-lar arasında qalan compile cache
+    // Off until given a directory, normally the app's cache directory.
+    // Widgets, trees and bytecode are then also looked up there after the
+    // memory caches and the bundle, and fresh compiles are written there in
+    // the background. Only the first call takes effect; |byte_cap| 0 means
+    // AFNSDiskCache::kDefaultByteCap.
+    bool EnableDiskCache(const std::string& directory, size_t byte_cap);
+    AFNSDiskCacheStats GetDiskCacheStats() const;
+    
+    // Çoxlu AFNS widget-ini bir native çağırışda compile et
+    // Item i of |results| is the widget for source i; an invalid item gets
+    // its error string and the rest of the batch still compiles
+    void CompileAFNSWidgetBatch(const AFNSPackedStringsView& sources, AFNSPackedStrings* results);
+    
+    // AFNS logic-ini execute et və result qaytar
+    // Runs the code as bytecode and returns what it showed, or else what
+    // its entry point returned; "error: <name>" if it failed at run time.
+    // Code the bytecode compiler does not handle is returned processed.
+    std::string ExecuteAFNSLogic(std::string_view afns_code);
+    std::string ExecuteAFNSLogic(AFNSEngineContext* context, std::string_view afns_code);
+    
+    // For callers that copy the result into a buffer of |result_cap| bytes:
+    // a result that does not fit is held by the context and returned to
+    // the next call with the same code without running it again, so a
+    // caller that grows its buffer and retries gets the result of one run.
+    // Any change to the context's state in between drops it.
+    std::string ExecuteAFNSLogic(AFNSEngineContext* context, std::string_view afns_code,
+                                 size_t result_cap);
+    
+    // Runs on an engine worker once an async request ends; |result| is empty
+    // unless |status| is kCompleted
+    using AFNSCompletionCallback =
+        std::function<void(uint64_t request_id, AFNSAsyncStatus status, const std::string& result)>;
+    
+    // UI thread-i bloklamadan compile/execute et
+    // Both return a request id at once and finish on a worker. A newer
+    // request with the same non-empty |widget_id| supersedes older pending
+    // ones, which then complete as kSuperseded without being processed.
+    uint64_t CompileAFNSWidgetAsync(std::string_view widget_id, std::string_view afns_code,
+                                    AFNSCompletionCallback done);
+    uint64_t CompileAFNSWidgetAsync(AFNSEngineContext* context, std::string_view widget_id,
+                                    std::string_view afns_code, AFNSCompletionCallback done);
+    uint64_t ExecuteAFNSLogicAsync(std::string_view widget_id, std::string_view afns_code,
+                                   AFNSCompletionCallback done);
+    uint64_t ExecuteAFNSLogicAsync(AFNSEngineContext* context, std::string_view widget_id,
+                                   std::string_view afns_code, AFNSCompletionCallback done);
+    
+    // Returns false if the request already completed; ids are per context
+    bool CancelAFNSRequest(uint64_t request_id);
+    bool CancelAFNSRequest(AFNSEngineContext* context, uint64_t request_id);
+    
+    // Canlı redaktor üçün incremental sessiya
+    // Open a document once, then send edits; compiling reuses the output of
+    // every top-level declaration the edits did not touch. Handles are never
+    // 0; operations on an unknown handle fail.
+    uint64_t OpenAFNSDocument(std::string_view afns_code);
+    bool EditAFNSDocument(uint64_t document, size_t offset, size_t delete_len,
+                          std::string_view insert_text);
+    bool CompileAFNSDocument(uint64_t document, std::string* widget);
+    void CloseAFNSDocument(uint64_t document);
+    
+    // AFNS kodunu yoxla, ilk xətanın yerini qaytar
+    // The same check every compile/execute runs first; the offset is in
+    // bytes from the start of |afns_code|
+    AFNSValidationResult CheckAFNSCode(std::string_view afns_code) const;
+    
+    // Arxa planda ilkin isitmə
+    // Resolves the Rust front end and runs kAFNSPrewarmSource through the
+    // bytecode compiler on a worker, leaving the caches
+    // untouched, so the first real compile does not pay for it. Returns at
+    // once; progress shows up as the kPrewarm* startup phases.
+    void Prewarm();
+    
+    // AFNS-specific state management
+    // Of the default context; see AFNSEngineContext for the others
+    void UpdateAFNSSState(const std::string& state);
+    std::string GetAFNSSState();
+    
+    // Wait-free version check, readers can skip work while it is unchanged
+    uint64_t GetAFNSStateVersion() const;
+    
+    // Current snapshot without copying the state text. Unlike the version
+    // check this is not wait-free: it copies the pointer under a short
+    // per-context lock, see AFNSEngineContext.
+    std::shared_ptr<const AFNSStateSnapshot> GetAFNSStateSnapshot() const;
+    
+    // Açarlı state: yol üzrə tipli dəyərlər
+    // `state("path")` in logic and in widget arguments reads these. A set
+    // is visible to the next read at once but only reruns the bindings that
+    // read the path at the next FlushAFNSState. Setting the value a path
+    // already has changes nothing.
+    void SetAFNSStateValue(std::string_view path, AFNSStateValue value);
+    void RemoveAFNSStateValue(std::string_view path);
+    
+    // Runs on an engine worker with a binding's newest result: a widget
+    // patch (see CompileAFNSWidgetPatch), or what ExecuteAFNSLogic returned.
+    // |ok| is false only for widget code that does not compile.
+    using AFNSBindingCallback =
+        std::function<void(uint64_t binding, bool ok, const std::string& result)>;
+    
+    // State-ə bağlı widget və logic-lər
+    // A binding runs once on a worker right away, then again each time a
+    // flush reports a path its latest run read, and never two runs at once:
+    // changes that arrive during a run make one more run after it. A widget
+    // binding starts the patches for |widget_id| from an empty tree and
+    // gets every later one in order. Ids are never 0 and unbinding an
+    // unknown id does nothing; a run that was already delivering its result
+    // when the binding went away still calls back once.
+    uint64_t BindAFNS(bool execute, std::string_view widget_id, std::string_view afns_code,
+                      AFNSBindingCallback done);
+    uint64_t BindAFNS(AFNSEngineContext* context, bool execute, std::string_view widget_id,
+                      std::string_view afns_code, AFNSBindingCallback done);
+    void UnbindAFNS(uint64_t binding);
+    void UnbindAFNS(AFNSEngineContext* context, uint64_t binding);
+    
+    // Hər kadrda bir dəfə
+    // Coalesces the state changes since the last flush and reruns the
+    // bindings that read them; meant to be called once per vsync. Returns
+    // how many bindings were scheduled.
+    size_t FlushAFNSState();
+    size_t FlushAFNSState(AFNSEngineContext* context);
+    
+    // Compiled widget cache tuning and counters. The budget is split, 3/4
+    // for widget text and 1/4 for binary widget trees; the stats add up
+    // both caches, GetAFNSEngineStats reports each on its own.
+    void SetWidgetCacheBudget(size_t byte_budget);
+    AFNSWidgetCacheStats GetWidgetCacheStats() const;
+    
+    // Identifier table size and hit ratio
+    AFNSInternTableStats GetInternTableStats() const;
+    
+    // Per-compile temporary allocations and peak arena bytes
+    AFNSCompileMemoryStats GetCompileMemoryStats() const;
+    
+    // Handler execution counts and latency
+    AFNSLogicStats GetLogicStats() const;
+    
+    // Isti funksiyaların optimallaşdırılmasını aç/bağla
+    // On by default. Off keeps every handler on baseline bytecode; the
+    // optimized tier is bytecode too, so this is a policy switch, not a
+    // requirement on targets without executable memory such as iOS.
+    void SetLogicTiering(bool enabled);
+    
+    // Bütün statistikalar bir JSON obyektində
+    // The metrics of afns_metrics.h (latency histograms of every entry
+    // point and stage, bytes in and out) next to the cache, identifier,
+    // memory, logic, disk cache, state and startup stats above. The
+    // histograms merge without locking; the rest cost what their getters do.
+    std::string GetAFNSEngineStats();
+
+private:
+    // AFNS Compiler Integration
+    // Rust lexer/parser, resolved by Prewarm rather than in the
+    // constructor, which runs under the platform loader hooks; null when
+    // the library is not available. Nothing parses with it yet: widget
+    // text comes from the rewriter and logic from the bytecode compiler.
+    std::once_flag afns_compiler_once_;
+    const AFNSFrontend* afns_compiler_handle_ = nullptr;
+    
+    // Handlers are compiled once per distinct source
+    AFNSBytecodeCache bytecode_cache_;
+    
+    // Widget type names and property keys shared by every compilation
+    AFNSInternTable identifiers_;
+    
+    // Hot widget rebuilds are served from here instead of reprocessing
+    AFNSWidgetCache widget_cache_;
+    AFNSWidgetCache widget_tree_cache_;
+    
+    // Precompiled sources, consulted after the caches. Loaded bundles form
+    // a list from newest_bundle_ back to the first, published with one
+    // atomic store; none is unmapped until the engine goes away, so readers
+    // walk the list without a lock.
+    struct LoadedBundle {
+        std::unique_ptr<const AFNSBundle> bundle;
+        const LoadedBundle* older;
+    };
+    std::atomic<const LoadedBundle*> newest_bundle_{nullptr};
+    std::mutex bundles_mutex_;
+    std::vector<std::unique_ptr<const LoadedBundle>> bundles_;
+    
+    // Set once by EnableDiskCache
+    std::atomic<AFNSDiskCache*> disk_cache_{nullptr};
+    std::mutex disk_cache_mutex_;
+    std::unique_ptr<AFNSDiskCache> disk_cache_owner_;
+    
+    // Compiled form of kAFNSRewriteRules
+    const AFNSRewriter rewriter_;
+    
+    // State of the JNI entry points and the context-less C ABI
+    const std::shared_ptr<AFNSEngineContext> default_context_;
+    
+    // Open incremental documents by handle
+    std::mutex documents_mutex_;
+    uint64_t next_document_ = 1;
+    std::unordered_map<uint64_t, std::shared_ptr<AFNSDocument>> documents_;
+    
+    // Totals behind GetCompileMemoryStats
+    std::atomic<uint64_t> compiles_{0};
+    std::atomic<uint64_t> compile_arena_allocations_{0};
+    std::atomic<uint64_t> last_compile_arena_allocations_{0};
+    std::atomic<size_t> last_compile_peak_bytes_{0};
+    std::atomic<size_t> max_compile_peak_bytes_{0};
+    
+    // Totals behind GetLogicStats
+    std::atomic<uint64_t> logic_executions_{0};
+    std::atomic<uint64_t> logic_runtime_errors_{0};
+    std::atomic<uint64_t> logic_bytecode_compiles_{0};
+    std::atomic<uint64_t> logic_fallbacks_{0};
+    std::atomic<uint64_t> last_logic_run_ns_{0};
+    std::atomic<uint64_t> max_logic_run_ns_{0};
+    std::atomic<uint64_t> total_logic_run_ns_{0};
+    
+    // Batch items and async requests run here; threads start on first use.
+    // Declared last so it is destroyed first: its destructor drains tasks
+    // that still use the caches, documents, contexts and totals above.
+    AFNSWorkerPool worker_pool_;
+    
+    // Helper methods
+    std::shared_ptr<AFNSDocument> FindDocument(uint64_t document);
+    void RecordCompileMemory(const AFNSArenaScope& scope);
+    void RecordLogicRun(uint64_t run_ns, bool ok);
+    bool FindInBundle(std::string_view code, AFNSBundleItem* item) const;
+    std::shared_ptr<const AFNSBytecodeProgram> CompileAFNSLogicCached(std::string_view code);
+    void RunBinding(std::shared_ptr<AFNSEngineContext> context,
+                    std::shared_ptr<AFNSEngineBinding> binding);
+    std::string BuildAFNSWidget(std::string_view afns_code);
+    bool BuildAFNSWidgetTree(AFNSEngineContext* context, std::string_view afns_code,
+                             std::string* tree);
+    uint64_t SubmitAsync(AFNSEngineContext* context, bool execute, std::string_view widget_id,
+                         std::string_view afns_code, AFNSCompletionCallback done);
+    const AFNSFrontend* Compiler();
+    void AppendProcessedAFNSCode(std::string_view code, std::string* output);
+    std::string ProcessAFNSCode(std::string_view code);
+    bool ValidateAFNSCode(std::string_view code) const;
+};
+
+// Seeds every widget cache, disk cache and bundle key: the build's version
+// (afns_version.h, the project version plus a hash of the engine sources)
+// and the bytecode format, so no build reads entries another one wrote.
+// Whether libafns loaded is not part of it; no output depends on that.
+const std::string& AFNSEngineVersion();
+
+// The process-wide engine behind the C ABI and the platform glue, created
+// by whichever caller gets here first; see afns_engine.cc for startup
+AFNSEngineExtension* GetAFNSEngine();
+
+// Destroys the engine, joining its threads, for afns_engine_shutdown; no
+// entry point may run during the call, and the next GetAFNSEngine creates
+// a new one. Never from DllMain or another loader-lock context.
+void ShutdownAFNSEngine();
+
+// Buffer arguments of the C ABI: null is only valid for zero bytes
+inline bool IsValidInput(const char* in, size_t in_len) {
+    return in != nullptr || in_len == 0;
+}
+
+// The context behind an afns_context handle of the C ABI; NULL stands for
+// the default context
+inline AFNSEngineContext* ResolveAFNSContext(afns_context* handle) {
+    return handle != nullptr ? handle->context.get() : GetAFNSEngine()->default_context();
+}
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_ENGINE_H_
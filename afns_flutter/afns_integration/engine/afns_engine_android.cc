@@ -0,0 +1,375 @@
+// 🚀 AFNS ENGINE ANDROID INTEGRATION
+// JNI entry points of io.flutter.plugin.afns.AFNSEngine and JNI_OnLoad
+
+#if defined(__ANDROID__)
+
+#include <jni.h>
+
+#include "afns_engine.h"
+#include "afns_engine_c_api.h"
+#include "afns_packed_strings.h"
+#include "afns_startup.h"
+#include "afns_trace.h"
+#include "afns_utf.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using flutter::afns::GetAFNSEngine;
+
+namespace {
+
+// The source of a *Direct JNI entry point; false when |in| is not a direct
+// ByteBuffer or |in_len| is out of range
+bool GetDirectInput(JNIEnv* env, jobject in, jint in_len, std::string_view* code) {
+    const char* data = static_cast<const char*>(env->GetDirectBufferAddress(in));
+    if (data == nullptr || in_len < 0 || in_len > env->GetDirectBufferCapacity(in)) {
+        return false;
+    }
+    *code = std::string_view(data, static_cast<size_t>(in_len));
+    return true;
+}
+
+// Direct ByteBuffer protocol shared by the *Direct JNI entry points: the
+// result is copied into |out| only if it fits, and its full length is
+// returned either way, so a caller seeing a length above the capacity
+// grows its buffer and retries. Compile retries hit the widget cache;
+// execute retries get the result the engine held from the first call, so
+// the logic only runs once. Returns -1 when |out| is not a direct
+// ByteBuffer, as do the entry points for a bad input.
+jlong WriteDirectResult(JNIEnv* env, const std::string& result, jobject out) {
+    flutter::afns::AFNSTraceSpan trace("copy_result");
+    char* data = static_cast<char*>(env->GetDirectBufferAddress(out));
+    const jlong capacity = env->GetDirectBufferCapacity(out);
+    if (data == nullptr || capacity < 0) {
+        return -1;
+    }
+    const jlong length = static_cast<jlong>(result.size());
+    if (length <= capacity) {
+        std::memcpy(data, result.data(), result.size());
+    }
+    return length;
+}
+
+// Engine workers are attached to the JVM on first use and detached when
+// the worker thread exits
+JNIEnv* AttachCurrentThreadToJVM(JavaVM* vm) {
+    struct Attachment {
+        JavaVM* vm = nullptr;
+        JNIEnv* env = nullptr;
+        ~Attachment() {
+            if (vm != nullptr) {
+                vm->DetachCurrentThread();
+            }
+        }
+    };
+    thread_local Attachment attachment;
+    if (attachment.env != nullptr) {
+        return attachment.env;
+    }
+    
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        return env;  // attached by someone else, leave it to them
+    }
+    if (vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        return nullptr;
+    }
+    attachment.vm = vm;
+    attachment.env = env;
+    return env;
+}
+
+// Transcodes the Java string's own UTF-16 instead of asking for modified
+// UTF-8, which the VM would build in a second copy. Nothing but the
+// transcoding runs while the string is held critical: the worst-case
+// buffer is reserved before, and trimmed after, so neither allocates
+// inside the critical region.
+std::string CopyJavaString(JNIEnv* env, jstring value) {
+    flutter::afns::AFNSTraceSpan trace("jni_string_in");
+    std::string utf8;
+    if (value == nullptr) {
+        return utf8;
+    }
+    const size_t length = static_cast<size_t>(env->GetStringLength(value));
+    utf8.reserve(flutter::afns::AFNSUtf16ToUtf8Capacity(length));
+    const jchar* chars = env->GetStringCritical(value, nullptr);
+    if (chars == nullptr) {
+        return std::string();  // OutOfMemoryError pending
+    }
+    flutter::afns::AFNSUtf16ToUtf8(reinterpret_cast<const char16_t*>(chars), length, &utf8);
+    env->ReleaseStringCritical(value, chars);
+    // Mostly-ASCII code leaves two thirds of the reservation unused
+    if (utf8.capacity() > utf8.size() + utf8.size() / 2) {
+        utf8.shrink_to_fit();
+    }
+    return utf8;
+}
+
+// NewStringUTF expects modified UTF-8, which encodes code points past
+// U+FFFF and NUL differently; hand the VM UTF-16 instead
+jstring NewJavaString(JNIEnv* env, std::string_view utf8) {
+    flutter::afns::AFNSTraceSpan trace("jni_string_out");
+    std::u16string utf16;
+    flutter::afns::AFNSUtf8ToUtf16(utf8, &utf16);
+    return env->NewString(reinterpret_cast<const jchar*>(utf16.data()), static_cast<jsize>(utf16.size()));
+}
+
+// Wraps a Java AFNSResultCallback:
+//   interface AFNSResultCallback { void onAFNSResult(long requestId, int status, String result); }
+// The global ref is released after the single completion call.
+flutter::afns::AFNSEngineExtension::AFNSCompletionCallback
+MakeJavaCompletionCallback(JNIEnv* env, jobject callback) {
+    JavaVM* vm = nullptr;
+    env->GetJavaVM(&vm);
+    jobject callback_ref = env->NewGlobalRef(callback);
+    
+    return [vm, callback_ref](uint64_t request_id, flutter::afns::AFNSAsyncStatus status,
+                              const std::string& result) {
+        JNIEnv* worker_env = AttachCurrentThreadToJVM(vm);
+        if (worker_env == nullptr) {
+            return;
+        }
+        jclass callback_class = worker_env->GetObjectClass(callback_ref);
+        jmethodID on_result = worker_env->GetMethodID(callback_class, "onAFNSResult",
+                                                      "(JILjava/lang/String;)V");
+        jstring java_result = NewJavaString(worker_env, result);
+        worker_env->CallVoidMethod(callback_ref, on_result, static_cast<jlong>(request_id),
+                                   static_cast<jint>(status), java_result);
+        if (worker_env->ExceptionCheck()) {
+            worker_env->ExceptionClear();
+        }
+        worker_env->DeleteLocalRef(java_result);
+        worker_env->DeleteLocalRef(callback_class);
+        worker_env->DeleteGlobalRef(callback_ref);
+    };
+}
+
+} // anonymous namespace
+
+// 🔥 NATIVE FLUTTER PLATFORM INTEGRATION
+extern "C" {
+
+JNIEXPORT jstring JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidget(
+    JNIEnv* env, 
+    jobject instance, 
+    jstring afns_code
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    // Reuse the long-lived engine so its caches survive between calls
+    flutter::afns::AFNSEngineExtension* afns_engine = GetAFNSEngine();
+    
+    const std::string code = CopyJavaString(env, afns_code);
+    return NewJavaString(env, afns_engine->CompileAFNSWidget(code));
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeExecuteAFNSLogic(
+    JNIEnv* env, 
+    jobject instance, 
+    jstring afns_code
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    // Reuse the long-lived engine so its caches survive between calls
+    flutter::afns::AFNSEngineExtension* afns_engine = GetAFNSEngine();
+    
+    const std::string code = CopyJavaString(env, afns_code);
+    return NewJavaString(env, afns_engine->ExecuteAFNSLogic(code));
+}
+
+// Zero-copy variants: |in| and |out| are direct java.nio.ByteBuffers holding
+// UTF-8, so no Java strings are created or transcoded on the hot path.
+// Java: native long nativeCompileAFNSWidgetDirect(ByteBuffer in, int inLen, ByteBuffer out);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidgetDirect(
+    JNIEnv* env,
+    jobject instance,
+    jobject in,
+    jint in_len,
+    jobject out
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    std::string_view code;
+    if (!GetDirectInput(env, in, in_len, &code)) {
+        return -1;
+    }
+    return WriteDirectResult(env, GetAFNSEngine()->CompileAFNSWidget(code), out);
+}
+
+// Java: native long nativeExecuteAFNSLogicDirect(ByteBuffer in, int inLen, ByteBuffer out);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeExecuteAFNSLogicDirect(
+    JNIEnv* env,
+    jobject instance,
+    jobject in,
+    jint in_len,
+    jobject out
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    std::string_view code;
+    if (!GetDirectInput(env, in, in_len, &code)) {
+        return -1;
+    }
+    flutter::afns::AFNSEngineExtension* afns_engine = GetAFNSEngine();
+    const jlong capacity = env->GetDirectBufferCapacity(out);
+    return WriteDirectResult(env,
+                             afns_engine->ExecuteAFNSLogic(afns_engine->default_context(), code,
+                                                           capacity < 0 ? 0 : static_cast<size_t>(capacity)),
+                             out);
+}
+
+// Binary widget tree (see afns_widget_tree.h) into a direct ByteBuffer, same
+// protocol as above; returns -2 when the AFNS code is invalid.
+// Java: native long nativeCompileAFNSWidgetTreeDirect(ByteBuffer in, int inLen, ByteBuffer out);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidgetTreeDirect(
+    JNIEnv* env,
+    jobject instance,
+    jobject in,
+    jint in_len,
+    jobject out
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    std::string_view code;
+    if (!GetDirectInput(env, in, in_len, &code)) {
+        return -1;
+    }
+    std::string tree;
+    if (!GetAFNSEngine()->CompileAFNSWidgetTree(code, &tree)) {
+        return -2;
+    }
+    return WriteDirectResult(env, tree, out);
+}
+
+// Batch variant over direct ByteBuffers in native byte order: |in_offsets|
+// holds count + 1 longs into |in_blob|, |out_offsets| receives count + 1
+// longs into |out_blob|. Same length/needs-resize protocol as above, applied
+// to |out_blob|; |out_offsets| is always filled when the input is valid.
+// Java: native long nativeCompileAFNSWidgetBatch(ByteBuffer inOffsets, int count,
+//     ByteBuffer inBlob, ByteBuffer outOffsets, ByteBuffer outBlob);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidgetBatch(
+    JNIEnv* env,
+    jobject instance,
+    jobject in_offsets,
+    jint count,
+    jobject in_blob,
+    jobject out_offsets,
+    jobject out_blob
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    const jlong offsets_bytes = (static_cast<jlong>(count) + 1) * static_cast<jlong>(sizeof(uint64_t));
+    flutter::afns::AFNSPackedStringsView sources;
+    sources.offsets = static_cast<const uint64_t*>(env->GetDirectBufferAddress(in_offsets));
+    sources.count = count < 0 ? 0 : static_cast<size_t>(count);
+    sources.blob = static_cast<const char*>(env->GetDirectBufferAddress(in_blob));
+    uint64_t* result_offsets = static_cast<uint64_t*>(env->GetDirectBufferAddress(out_offsets));
+    const jlong in_blob_capacity = env->GetDirectBufferCapacity(in_blob);
+    if (count < 0 || sources.offsets == nullptr || result_offsets == nullptr ||
+        env->GetDirectBufferCapacity(in_offsets) < offsets_bytes ||
+        env->GetDirectBufferCapacity(out_offsets) < offsets_bytes ||
+        in_blob_capacity < 0 || !sources.IsValid(static_cast<size_t>(in_blob_capacity))) {
+        return -1;
+    }
+    
+    flutter::afns::AFNSPackedStrings results;
+    GetAFNSEngine()->CompileAFNSWidgetBatch(sources, &results);
+    std::memcpy(result_offsets, results.offsets.data(), results.offsets.size() * sizeof(uint64_t));
+    return WriteDirectResult(env, results.blob, out_blob);
+}
+
+// Async variants: return the request id at once, |callback| receives the
+// result on an engine worker thread.
+// Java: native long nativeCompileAFNSWidgetAsync(String widgetId, String code,
+//     AFNSResultCallback callback);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCompileAFNSWidgetAsync(
+    JNIEnv* env,
+    jobject instance,
+    jstring widget_id,
+    jstring afns_code,
+    jobject callback
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    return static_cast<jlong>(GetAFNSEngine()->CompileAFNSWidgetAsync(
+        CopyJavaString(env, widget_id), CopyJavaString(env, afns_code),
+        MakeJavaCompletionCallback(env, callback)));
+}
+
+// Java: native long nativeExecuteAFNSLogicAsync(String widgetId, String code,
+//     AFNSResultCallback callback);
+JNIEXPORT jlong JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeExecuteAFNSLogicAsync(
+    JNIEnv* env,
+    jobject instance,
+    jstring widget_id,
+    jstring afns_code,
+    jobject callback
+) {
+    flutter::afns::AFNSTraceSpan trace("jni_entry");
+    return static_cast<jlong>(GetAFNSEngine()->ExecuteAFNSLogicAsync(
+        CopyJavaString(env, widget_id), CopyJavaString(env, afns_code),
+        MakeJavaCompletionCallback(env, callback)));
+}
+
+// Java: native void nativeSetAFNSTracing(boolean enabled);
+JNIEXPORT void JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeSetAFNSTracing(
+    JNIEnv* env,
+    jobject instance,
+    jboolean enabled
+) {
+    if (enabled) {
+        flutter::afns::StartAFNSTracing();
+    } else {
+        flutter::afns::StopAFNSTracing();
+    }
+}
+
+// Spans since tracing was turned on, see afns_trace_dump; |format| takes the
+// AFNS_TRACE_FORMAT_* values.
+// Java: native byte[] nativeDumpAFNSTrace(int format);
+JNIEXPORT jbyteArray JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeDumpAFNSTrace(
+    JNIEnv* env,
+    jobject instance,
+    jint format
+) {
+    const std::string trace = flutter::afns::DumpAFNSTrace(
+        format == AFNS_TRACE_FORMAT_PERFETTO ? flutter::afns::AFNSTraceFormat::kPerfetto
+                                             : flutter::afns::AFNSTraceFormat::kChromeJson);
+    jbyteArray bytes = env->NewByteArray(static_cast<jsize>(trace.size()));
+    if (bytes != nullptr) {
+        env->SetByteArrayRegion(bytes, 0, static_cast<jsize>(trace.size()),
+                                reinterpret_cast<const jbyte*>(trace.data()));
+    }
+    return bytes;
+}
+
+// Java: native boolean nativeCancelAFNSRequest(long requestId);
+JNIEXPORT jboolean JNICALL
+Java_io_flutter_plugin_afns_AFNSEngine_nativeCancelAFNSRequest(
+    JNIEnv* env,
+    jobject instance,
+    jlong request_id
+) {
+    return GetAFNSEngine()->CancelAFNSRequest(static_cast<uint64_t>(request_id)) ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
+
+// Android Flutter Integration
+extern "C" {
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+    // The engine is created on first use, see GetAFNSEngine
+    flutter::afns::MarkAFNSStartupPhase(flutter::afns::AFNSStartupPhase::kLibraryLoaded);
+    return JNI_VERSION_1_6;
+}
+
+} // extern "C"
+
+#endif  // defined(__ANDROID__)
@@ -0,0 +1,451 @@
+// 🚀 AFNS ENGINE C ABI INTEGRATION
+// The afns_engine_c_api.h exports on top of GetAFNSEngine, for every platform
+//
+// The Dart port calls (afns_init_dart_api, the *_async and afns_bind_*
+// exports) need the Dart SDK and are in afns_engine_dart.cc.
+
+#include "afns_engine_c_api.h"
+
+#include "afns_engine.h"
+#include "afns_startup.h"
+#include "afns_trace.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using flutter::afns::GetAFNSEngine;
+using flutter::afns::IsValidInput;
+using flutter::afns::ResolveAFNSContext;
+
+namespace {
+
+// Shared by the C ABI exports below
+int CopyResultToBuffer(const std::string& result, char* out, size_t out_cap, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("copy_result");
+    if (out_len == nullptr || (out == nullptr && out_cap > 0)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    *out_len = result.size();
+    if (result.size() > out_cap) {
+        return AFNS_ERROR_BUFFER_TOO_SMALL;
+    }
+    std::memcpy(out, result.data(), result.size());
+    return AFNS_OK;
+}
+
+char* DuplicateResult(const std::string& result, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("copy_result");
+    char* copy = static_cast<char*>(std::malloc(result.size() + 1));
+    if (copy == nullptr) {
+        return nullptr;
+    }
+    std::memcpy(copy, result.data(), result.size());
+    copy[result.size()] = '\0';
+    if (out_len != nullptr) {
+        *out_len = result.size();
+    }
+    return copy;
+}
+
+int SetDartState(afns_context* context, const char* path, size_t path_len,
+                 flutter::afns::AFNSStateValue value) {
+    if (!IsValidInput(path, path_len) || path_len == 0) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    ResolveAFNSContext(context)->SetAFNSStateValue(std::string_view(path, path_len),
+                                                   std::move(value));
+    return AFNS_OK;
+}
+
+} // anonymous namespace
+
+// 🎯 C ABI INTEGRATION (Dart FFI on Linux, Windows and macOS)
+// See afns_engine_c_api.h for the calling convention.
+static_assert(static_cast<int>(flutter::afns::AFNSAsyncStatus::kCompleted) == AFNS_ASYNC_COMPLETED &&
+              static_cast<int>(flutter::afns::AFNSAsyncStatus::kCancelled) == AFNS_ASYNC_CANCELLED &&
+              static_cast<int>(flutter::afns::AFNSAsyncStatus::kSuperseded) == AFNS_ASYNC_SUPERSEDED,
+              "C ABI async status codes must match AFNSAsyncStatus");
+static_assert(static_cast<int>(flutter::afns::AFNSValidationError::kEmpty) == AFNS_VALIDATION_EMPTY &&
+              static_cast<int>(flutter::afns::AFNSValidationError::kUnbalancedBracket) ==
+                  AFNS_VALIDATION_UNBALANCED_BRACKET &&
+              static_cast<int>(flutter::afns::AFNSValidationError::kUnterminatedString) ==
+                  AFNS_VALIDATION_UNTERMINATED_STRING &&
+              static_cast<int>(flutter::afns::AFNSValidationError::kUnterminatedComment) ==
+                  AFNS_VALIDATION_UNTERMINATED_COMMENT &&
+              static_cast<int>(flutter::afns::AFNSValidationError::kInvalidUtf8) ==
+                  AFNS_VALIDATION_INVALID_UTF8 &&
+              static_cast<int>(flutter::afns::AFNSValidationError::kControlCharacter) ==
+                  AFNS_VALIDATION_CONTROL_CHARACTER,
+              "C ABI validation codes must match AFNSValidationError");
+extern "C" {
+
+int compile_afns_widget(const char* in, size_t in_len,
+                        char* out, size_t out_cap, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    std::string result = GetAFNSEngine()->CompileAFNSWidget(std::string_view(in, in_len));
+    return CopyResultToBuffer(result, out, out_cap, out_len);
+}
+
+int compile_afns_widget_tree(const char* in, size_t in_len,
+                             char* out, size_t out_cap, size_t* out_len) {
+    return afns_context_compile_widget_tree(nullptr, in, in_len, out, out_cap, out_len);
+}
+
+int compile_afns_widget_patch(const char* widget_id, size_t widget_id_len, const char* in, size_t in_len,
+                              char* out, size_t out_cap, size_t* out_len) {
+    return afns_context_compile_widget_patch(nullptr, widget_id, widget_id_len, in, in_len, out,
+                                             out_cap, out_len);
+}
+
+void afns_widget_patch_reset(const char* widget_id, size_t widget_id_len) {
+    afns_context_widget_patch_reset(nullptr, widget_id, widget_id_len);
+}
+
+int validate_afns_code(const char* in, size_t in_len, size_t* error_offset) {
+    if (in == nullptr && in_len > 0) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    const flutter::afns::AFNSValidationResult result =
+        GetAFNSEngine()->CheckAFNSCode(std::string_view(in == nullptr ? "" : in, in_len));
+    if (error_offset != nullptr) {
+        *error_offset = result.offset;
+    }
+    return static_cast<int>(result.error);
+}
+
+int compile_afns_widget_batch(const uint64_t* in_offsets, size_t count, const char* in_blob,
+                              uint64_t* out_offsets, char* out_blob, size_t out_blob_cap,
+                              size_t* out_blob_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    flutter::afns::AFNSPackedStringsView sources{in_offsets, count, in_blob};
+    if (in_offsets == nullptr || out_offsets == nullptr ||
+        !sources.IsValid(count > 0 ? static_cast<size_t>(in_offsets[count]) : 0)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    flutter::afns::AFNSPackedStrings results;
+    GetAFNSEngine()->CompileAFNSWidgetBatch(sources, &results);
+    std::memcpy(out_offsets, results.offsets.data(), results.offsets.size() * sizeof(uint64_t));
+    return CopyResultToBuffer(results.blob, out_blob, out_blob_cap, out_blob_len);
+}
+
+int execute_afns_logic(const char* in, size_t in_len,
+                       char* out, size_t out_cap, size_t* out_len) {
+    return afns_context_execute_logic(nullptr, in, in_len, out, out_cap, out_len);
+}
+
+int afns_engine_get_stats(char* out, size_t out_cap, size_t* out_len) {
+    return CopyResultToBuffer(GetAFNSEngine()->GetAFNSEngineStats(), out, out_cap, out_len);
+}
+
+void afns_trace_start(void) {
+    flutter::afns::StartAFNSTracing();
+}
+
+void afns_trace_stop(void) {
+    flutter::afns::StopAFNSTracing();
+}
+
+void afns_trace_set_flow(uint64_t flow_id) {
+    flutter::afns::SetAFNSTraceFlow(flow_id);
+}
+
+int afns_trace_dump(int format, char* out, size_t out_cap, size_t* out_len) {
+    using flutter::afns::AFNSTraceFormat;
+    if (format != AFNS_TRACE_FORMAT_CHROME_JSON && format != AFNS_TRACE_FORMAT_PERFETTO) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    const AFNSTraceFormat trace_format =
+        format == AFNS_TRACE_FORMAT_PERFETTO ? AFNSTraceFormat::kPerfetto : AFNSTraceFormat::kChromeJson;
+    return CopyResultToBuffer(flutter::afns::DumpAFNSTrace(trace_format), out, out_cap, out_len);
+}
+
+int get_afns_state(char* out, size_t out_cap, size_t* out_len) {
+    return afns_context_get_state(nullptr, out, out_cap, out_len);
+}
+
+uint64_t get_afns_state_version(void) {
+    return afns_context_state_version(nullptr);
+}
+
+int update_afns_state(const char* in, size_t in_len) {
+    return afns_context_update_state(nullptr, in, in_len);
+}
+
+void initialize_afns_engine(void) {
+    GetAFNSEngine();
+}
+
+void afns_engine_prewarm(void) {
+    GetAFNSEngine()->Prewarm();
+}
+
+void afns_engine_shutdown(void) {
+    flutter::afns::ShutdownAFNSEngine();
+}
+
+int64_t afns_startup_phase_us(int phase) {
+    if (phase < 0 || phase >= static_cast<int>(flutter::afns::AFNSStartupPhase::kCount)) {
+        return -1;
+    }
+    return flutter::afns::AFNSStartupPhaseMicros(static_cast<flutter::afns::AFNSStartupPhase>(phase));
+}
+
+int afns_bundle_build(const uint64_t* in_offsets, size_t count, const char* in_blob,
+                      const char* path) {
+    flutter::afns::AFNSPackedStringsView sources{in_offsets, count, in_blob};
+    if (in_offsets == nullptr || path == nullptr ||
+        !sources.IsValid(count > 0 ? static_cast<size_t>(in_offsets[count]) : 0)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    const std::string bundle = GetAFNSEngine()->BuildAFNSBundle(sources);
+    if (bundle.empty()) {
+        return AFNS_ERROR_IO;
+    }
+    
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        return AFNS_ERROR_IO;
+    }
+    const bool written = std::fwrite(bundle.data(), 1, bundle.size(), file) == bundle.size();
+    return std::fclose(file) == 0 && written ? AFNS_OK : AFNS_ERROR_IO;
+}
+
+int afns_enable_disk_cache(const char* directory, size_t byte_cap) {
+    if (directory == nullptr) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return GetAFNSEngine()->EnableDiskCache(directory, byte_cap) ? AFNS_OK
+                                                                 : AFNS_ERROR_INVALID_ARGUMENT;
+}
+
+int afns_bundle_load(const char* path) {
+    if (path == nullptr) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return GetAFNSEngine()->LoadAFNSBundle(path, nullptr) ? AFNS_OK : AFNS_ERROR_IO;
+}
+
+void afns_set_logic_tiering(int enabled) {
+    GetAFNSEngine()->SetLogicTiering(enabled != 0);
+}
+
+int64_t afns_document_open(const char* in, size_t in_len) {
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return static_cast<int64_t>(GetAFNSEngine()->OpenAFNSDocument(std::string_view(in, in_len)));
+}
+
+int afns_document_edit(int64_t document, size_t offset, size_t delete_len,
+                       const char* insert, size_t insert_len) {
+    if (!IsValidInput(insert, insert_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return GetAFNSEngine()->EditAFNSDocument(static_cast<uint64_t>(document), offset, delete_len,
+                                             std::string_view(insert, insert_len))
+        ? AFNS_OK : AFNS_ERROR_INVALID_ARGUMENT;
+}
+
+int afns_document_compile(int64_t document, char* out, size_t out_cap, size_t* out_len) {
+    std::string widget;
+    if (!GetAFNSEngine()->CompileAFNSDocument(static_cast<uint64_t>(document), &widget)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return CopyResultToBuffer(widget, out, out_cap, out_len);
+}
+
+void afns_document_close(int64_t document) {
+    GetAFNSEngine()->CloseAFNSDocument(static_cast<uint64_t>(document));
+}
+
+int afns_cancel_request(int64_t request_id) {
+    return afns_context_cancel_request(nullptr, request_id);
+}
+
+int afns_state_set_int(const char* path, size_t path_len, int64_t value) {
+    return afns_context_state_set_int(nullptr, path, path_len, value);
+}
+
+int afns_state_set_double(const char* path, size_t path_len, double value) {
+    return afns_context_state_set_double(nullptr, path, path_len, value);
+}
+
+int afns_state_set_bool(const char* path, size_t path_len, int value) {
+    return afns_context_state_set_bool(nullptr, path, path_len, value);
+}
+
+int afns_state_set_string(const char* path, size_t path_len, const char* value, size_t value_len) {
+    return afns_context_state_set_string(nullptr, path, path_len, value, value_len);
+}
+
+int afns_state_remove(const char* path, size_t path_len) {
+    return afns_context_state_remove(nullptr, path, path_len);
+}
+
+int afns_state_flush(void) {
+    return afns_context_state_flush(nullptr);
+}
+
+void afns_unbind(int64_t binding) {
+    afns_context_unbind(nullptr, binding);
+}
+
+afns_context* afns_context_create(void) {
+    return new afns_context{GetAFNSEngine()->CreateAFNSContext()};
+}
+
+void afns_context_destroy(afns_context* context) {
+    if (context == nullptr) {
+        return;
+    }
+    GetAFNSEngine()->CloseAFNSContext(context->context.get());
+    delete context;
+}
+
+int afns_context_execute_logic(afns_context* context, const char* in, size_t in_len,
+                               char* out, size_t out_cap, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    std::string result = GetAFNSEngine()->ExecuteAFNSLogic(ResolveAFNSContext(context),
+                                                           std::string_view(in, in_len),
+                                                           out == nullptr ? 0 : out_cap);
+    return CopyResultToBuffer(result, out, out_cap, out_len);
+}
+
+int afns_context_compile_widget_tree(afns_context* context, const char* in, size_t in_len,
+                                     char* out, size_t out_cap, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    std::string tree;
+    if (!GetAFNSEngine()->CompileAFNSWidgetTree(ResolveAFNSContext(context),
+                                                std::string_view(in, in_len), &tree)) {
+        return AFNS_ERROR_INVALID_SOURCE;
+    }
+    return CopyResultToBuffer(tree, out, out_cap, out_len);
+}
+
+int afns_context_compile_widget_patch(afns_context* context, const char* widget_id,
+                                      size_t widget_id_len, const char* in, size_t in_len,
+                                      char* out, size_t out_cap, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len) || !IsValidInput(widget_id, widget_id_len) || widget_id_len == 0) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    std::string patch;
+    if (!GetAFNSEngine()->CompileAFNSWidgetPatch(ResolveAFNSContext(context),
+                                                  std::string_view(widget_id, widget_id_len),
+                                                  std::string_view(in, in_len),
+                                                  out == nullptr ? 0 : out_cap, &patch)) {
+        return AFNS_ERROR_INVALID_SOURCE;
+    }
+    return CopyResultToBuffer(patch, out, out_cap, out_len);
+}
+
+void afns_context_widget_patch_reset(afns_context* context, const char* widget_id,
+                                     size_t widget_id_len) {
+    if (IsValidInput(widget_id, widget_id_len)) {
+        GetAFNSEngine()->ResetAFNSWidgetPatches(ResolveAFNSContext(context),
+                                                std::string_view(widget_id, widget_id_len));
+    }
+}
+
+int afns_context_get_state(afns_context* context, char* out, size_t out_cap, size_t* out_len) {
+    return CopyResultToBuffer(ResolveAFNSContext(context)->GetAFNSSState(), out, out_cap, out_len);
+}
+
+int afns_context_update_state(afns_context* context, const char* in, size_t in_len) {
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    ResolveAFNSContext(context)->UpdateAFNSSState(std::string(in, in_len));
+    return AFNS_OK;
+}
+
+uint64_t afns_context_state_version(afns_context* context) {
+    return ResolveAFNSContext(context)->GetAFNSStateVersion();
+}
+
+int afns_context_state_set_int(afns_context* context, const char* path, size_t path_len,
+                               int64_t value) {
+    return SetDartState(context, path, path_len, flutter::afns::AFNSStateValue::Int(value));
+}
+
+int afns_context_state_set_double(afns_context* context, const char* path, size_t path_len,
+                                  double value) {
+    return SetDartState(context, path, path_len, flutter::afns::AFNSStateValue::Float(value));
+}
+
+int afns_context_state_set_bool(afns_context* context, const char* path, size_t path_len,
+                                int value) {
+    return SetDartState(context, path, path_len, flutter::afns::AFNSStateValue::Bool(value != 0));
+}
+
+int afns_context_state_set_string(afns_context* context, const char* path, size_t path_len,
+                                  const char* value, size_t value_len) {
+    if (!IsValidInput(value, value_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return SetDartState(context, path, path_len,
+                        flutter::afns::AFNSStateValue::String(std::string_view(value, value_len)));
+}
+
+int afns_context_state_remove(afns_context* context, const char* path, size_t path_len) {
+    if (!IsValidInput(path, path_len) || path_len == 0) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    ResolveAFNSContext(context)->RemoveAFNSStateValue(std::string_view(path, path_len));
+    return AFNS_OK;
+}
+
+int afns_context_state_flush(afns_context* context) {
+    return static_cast<int>(GetAFNSEngine()->FlushAFNSState(ResolveAFNSContext(context)));
+}
+
+int afns_context_cancel_request(afns_context* context, int64_t request_id) {
+    return GetAFNSEngine()->CancelAFNSRequest(ResolveAFNSContext(context),
+                                              static_cast<uint64_t>(request_id))
+        ? AFNS_OK : AFNS_ERROR_INVALID_ARGUMENT;
+}
+
+void afns_context_unbind(afns_context* context, int64_t binding) {
+    GetAFNSEngine()->UnbindAFNS(ResolveAFNSContext(context), static_cast<uint64_t>(binding));
+}
+
+char* compile_afns_widget_alloc(const char* in, size_t in_len, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len)) {
+        return nullptr;
+    }
+    return DuplicateResult(GetAFNSEngine()->CompileAFNSWidget(std::string_view(in, in_len)), out_len);
+}
+
+char* execute_afns_logic_alloc(const char* in, size_t in_len, size_t* out_len) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!IsValidInput(in, in_len)) {
+        return nullptr;
+    }
+    return DuplicateResult(GetAFNSEngine()->ExecuteAFNSLogic(std::string_view(in, in_len)), out_len);
+}
+
+char* get_afns_state_alloc(size_t* out_len) {
+    return DuplicateResult(GetAFNSEngine()->GetAFNSSState(), out_len);
+}
+
+void afns_free_result(char* result) {
+    std::free(result);
+}
+
+} // extern "C"
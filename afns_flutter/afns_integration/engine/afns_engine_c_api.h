@@ -0,0 +1,314 @@
+// 🚀 AFNS ENGINE C ABI
+// Plain C exports for Dart FFI and other non-JNI hosts (Linux, Windows, macOS)
+
+#ifndef FLUTTER_AFNS_AFNS_ENGINE_C_API_H_
+#define FLUTTER_AFNS_AFNS_ENGINE_C_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define AFNS_EXPORT __declspec(dllexport)
+#else
+#define AFNS_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Status codes returned by every buffer-style export
+enum {
+    AFNS_OK = 0,
+    // |out_cap| was too small; |*out_len| holds the required size and
+    // nothing was written
+    AFNS_ERROR_BUFFER_TOO_SMALL = 1,
+    AFNS_ERROR_INVALID_ARGUMENT = -1,
+    // The async calls need afns_init_dart_api first
+    AFNS_ERROR_NOT_INITIALIZED = -2,
+    // The AFNS source failed validation
+    AFNS_ERROR_INVALID_SOURCE = -3,
+    // A file could not be read, written or accepted
+    AFNS_ERROR_IO = -4,
+};
+
+// Status field of async completion messages
+enum {
+    AFNS_ASYNC_COMPLETED = 0,
+    AFNS_ASYNC_CANCELLED = 1,
+    // A newer request for the same widget id replaced this one
+    AFNS_ASYNC_SUPERSEDED = 2,
+};
+
+// Result of validate_afns_code
+enum {
+    AFNS_VALIDATION_OK = 0,
+    AFNS_VALIDATION_EMPTY = 1,
+    AFNS_VALIDATION_UNBALANCED_BRACKET = 2,
+    AFNS_VALIDATION_UNTERMINATED_STRING = 3,
+    AFNS_VALIDATION_UNTERMINATED_COMMENT = 4,
+    AFNS_VALIDATION_INVALID_UTF8 = 5,
+    AFNS_VALIDATION_CONTROL_CHARACTER = 6,
+};
+
+// Buffer-style calls: |in| is UTF-8 of |in_len| bytes (no terminator
+// needed), the result is written to the caller-owned |out| without a
+// terminator and its length stored in |*out_len|. Callers keep one arena,
+// grow it on AFNS_ERROR_BUFFER_TOO_SMALL and retry. The logic of an
+// execute only runs once: its context keeps a result that did not fit and
+// hands it to the retry with the same code, unless the context's state
+// changed in between.
+AFNS_EXPORT int compile_afns_widget(const char* in, size_t in_len,
+                                    char* out, size_t out_cap, size_t* out_len);
+AFNS_EXPORT int execute_afns_logic(const char* in, size_t in_len,
+                                   char* out, size_t out_cap, size_t* out_len);
+
+// Binary widget tree (afns_widget_tree.h) instead of widget text. Fails with
+// AFNS_ERROR_INVALID_SOURCE when the code does not validate or its widget
+// calls nest more than 512 deep.
+AFNS_EXPORT int compile_afns_widget_tree(const char* in, size_t in_len,
+                                         char* out, size_t out_cap, size_t* out_len);
+
+// Incremental widget trees: the engine keeps the last tree it returned for
+// each non-empty |widget_id| and writes only what changed, as an
+// afns_widget_diff.h patch, with the buffer protocol above. After
+// AFNS_ERROR_BUFFER_TOO_SMALL the retry gets the same patch. A patch with
+// base generation 0 starts from an empty tree; afns_widget_patch_reset
+// forgets a widget, e.g. when its view goes away or the caller lost its
+// copy of the tree.
+AFNS_EXPORT int compile_afns_widget_patch(const char* widget_id, size_t widget_id_len,
+                                          const char* in, size_t in_len,
+                                          char* out, size_t out_cap, size_t* out_len);
+AFNS_EXPORT void afns_widget_patch_reset(const char* widget_id, size_t widget_id_len);
+
+// Runs the pre-validation every compile/execute starts with. Returns an
+// AFNS_VALIDATION_* code, with the byte offset of the first error in
+// |*error_offset| (optional), or AFNS_ERROR_INVALID_ARGUMENT.
+AFNS_EXPORT int validate_afns_code(const char* in, size_t in_len, size_t* error_offset);
+
+// Compiles |count| widgets in one call. Source i is
+// in_blob[in_offsets[i], in_offsets[i + 1]) and result i is written the same
+// way: |out_offsets| must have room for count + 1 entries and is always
+// filled on success or AFNS_ERROR_BUFFER_TOO_SMALL, the growth protocol
+// applies to |out_blob|. A bad item yields its error string in place.
+AFNS_EXPORT int compile_afns_widget_batch(const uint64_t* in_offsets, size_t count,
+                                          const char* in_blob,
+                                          uint64_t* out_offsets, char* out_blob,
+                                          size_t out_blob_cap, size_t* out_blob_len);
+
+AFNS_EXPORT int get_afns_state(char* out, size_t out_cap, size_t* out_len);
+AFNS_EXPORT int update_afns_state(const char* in, size_t in_len);
+
+// Bumped on every state change; poll it and only fetch the state when it
+// moved. Wait-free.
+AFNS_EXPORT uint64_t get_afns_state_version(void);
+
+// Startup phases, in the order a normal launch reaches them
+enum {
+    AFNS_STARTUP_LIBRARY_LOADED = 0,
+    AFNS_STARTUP_ENGINE_CREATE_BEGIN = 1,
+    AFNS_STARTUP_ENGINE_CREATED = 2,
+    AFNS_STARTUP_COMPILER_RESOLVED = 3,
+    AFNS_STARTUP_PREWARM_BEGIN = 4,
+    AFNS_STARTUP_PREWARM_DONE = 5,
+};
+
+// The engine is created on first use; initialize_afns_engine does it now
+// instead. afns_engine_prewarm also resolves the front end and warms the
+// compiler on a worker thread and returns at once.
+AFNS_EXPORT void initialize_afns_engine(void);
+AFNS_EXPORT void afns_engine_prewarm(void);
+
+// Destroys the engine: waits for its workers and async requests, then
+// drops every context, document, binding and cache. A host that unloads
+// the library (FreeLibrary, dlclose) calls this first, from an ordinary
+// thread; nothing tears the engine down from the loader. No other call may
+// run during it, and contexts and documents from before it are gone. The
+// next call creates a fresh engine.
+AFNS_EXPORT void afns_engine_shutdown(void);
+
+// Microseconds from library load to an AFNS_STARTUP_* phase, or -1 if the
+// phase has not been reached
+AFNS_EXPORT int64_t afns_startup_phase_us(int phase);
+
+// Precompiled bundles. afns_bundle_build compiles |count| sources (packed
+// as for compile_afns_widget_batch; invalid ones are left out) and writes
+// the bundle to |path|, for a build step run with the same engine build the
+// app ships (the version includes a hash of the engine sources).
+// afns_bundle_load maps it read-only at startup, after
+// which compiling a bundled source costs a lookup. AFNS_ERROR_IO also
+// covers a bundle that is damaged or from another engine version.
+AFNS_EXPORT int afns_bundle_build(const uint64_t* in_offsets, size_t count, const char* in_blob,
+                                  const char* path);
+AFNS_EXPORT int afns_bundle_load(const char* path);
+
+// Keeps compiled code in |directory| (created if missing) across restarts,
+// capped at |byte_cap| bytes (0 for the default) with least recently used
+// files pruned first. Writes happen on a background thread. Call once at
+// startup; AFNS_ERROR_INVALID_ARGUMENT if already enabled.
+AFNS_EXPORT int afns_enable_disk_cache(const char* directory, size_t byte_cap);
+
+// Engine stats as one JSON object, with the buffer protocol above:
+// "metrics" has a latency histogram per stage and entry point (count of
+// calls; mean_ns, max_ns, p50/p90/p99_ns and log2_ns_buckets[i] = calls
+// that took [2^i, 2^(i+1)) ns, over the |sampled| calls that were timed)
+// plus bytes_in and bytes_out; widget_cache (widget text, 3/4 of the
+// cache budget), widget_tree_cache (binary trees, the other 1/4),
+// identifiers, compile_memory, logic, disk_cache, state and startup_us
+// sections follow.
+// Keys are only ever added. Builds with AFNS_DISABLE_METRICS report
+// "enabled": false and zero metrics.
+AFNS_EXPORT int afns_engine_get_stats(char* out, size_t out_cap, size_t* out_len);
+
+// Formats for afns_trace_dump
+enum {
+    // {"traceEvents": [...]} for chrome://tracing or ui.perfetto.dev
+    AFNS_TRACE_FORMAT_CHROME_JSON = 0,
+    // Binary perfetto.protos.Trace
+    AFNS_TRACE_FORMAT_PERFETTO = 1,
+};
+
+// Span tracing of the engine stages (entry point, validation, rewrite,
+// cache lookup, worker queueing, result copy), off by default and
+// switchable at any time without a rebuild; while off a span costs one
+// atomic load. Start forgets the spans of earlier sessions. Each thread
+// keeps its latest 4096 spans.
+AFNS_EXPORT void afns_trace_start(void);
+AFNS_EXPORT void afns_trace_stop(void);
+
+// Flow id attached to the spans of the calling thread's next calls, and of
+// the async work they start, until set again; 0 clears it. Pass the id of
+// a dart:developer Flow and the viewer links the engine spans to it.
+AFNS_EXPORT void afns_trace_set_flow(uint64_t flow_id);
+
+// Spans of the current session, with the buffer protocol above. While
+// tracing is on the size can grow between a BUFFER_TOO_SMALL and the retry,
+// so retry until it fits. AFNS_ERROR_INVALID_ARGUMENT for another |format|.
+AFNS_EXPORT int afns_trace_dump(int format, char* out, size_t out_cap, size_t* out_len);
+
+// Non-zero (the default) lets hot logic functions move to optimized
+// bytecode; 0 keeps them on baseline code. Ignored in builds with
+// AFNS_DISABLE_LOGIC_TIERING.
+AFNS_EXPORT void afns_set_logic_tiering(int enabled);
+
+// Async calls. Pass NativeApi.initializeApiDLData to afns_init_dart_api
+// once (returns 0 on success). The async calls return a request id (> 0)
+// right away, or a negative AFNS_ERROR_*; the result is posted to
+// |dart_port| as [request_id, AFNS_ASYNC_* status, result string] from an
+// engine worker. A newer request with the same non-empty |widget_id|
+// supersedes older pending ones. These and afns_bind_* are only exported
+// by builds with the Dart SDK, see afns_engine_dart.cc.
+AFNS_EXPORT intptr_t afns_init_dart_api(void* data);
+AFNS_EXPORT int64_t compile_afns_widget_async(const char* widget_id, size_t widget_id_len,
+                                              const char* in, size_t in_len, int64_t dart_port);
+AFNS_EXPORT int64_t execute_afns_logic_async(const char* widget_id, size_t widget_id_len,
+                                             const char* in, size_t in_len, int64_t dart_port);
+// AFNS_OK if the request was still pending, AFNS_ERROR_INVALID_ARGUMENT if not
+AFNS_EXPORT int afns_cancel_request(int64_t request_id);
+
+// Keyed state, read by `state("path")` in logic and widget arguments. A set
+// is visible to the next read at once; bindings that read the path rerun at
+// the next afns_state_flush, which the UI calls once per frame so updates
+// within a frame cost one rerun. Setting the current value changes nothing.
+AFNS_EXPORT int afns_state_set_int(const char* path, size_t path_len, int64_t value);
+AFNS_EXPORT int afns_state_set_double(const char* path, size_t path_len, double value);
+AFNS_EXPORT int afns_state_set_bool(const char* path, size_t path_len, int value);
+AFNS_EXPORT int afns_state_set_string(const char* path, size_t path_len,
+                                      const char* value, size_t value_len);
+AFNS_EXPORT int afns_state_remove(const char* path, size_t path_len);
+// Number of bindings scheduled to rerun
+AFNS_EXPORT int afns_state_flush(void);
+
+// Bindings run their code on an engine worker now and whenever state they
+// read changes, posting [binding, result] to |dart_port| after each run, in
+// order. afns_bind_widget results are afns_widget_diff.h patches as a
+// Uint8List, the first from an empty tree, or null if the code does not
+// compile; use one binding per |widget_id|. afns_bind_logic results are
+// execute_afns_logic strings. Both need afns_init_dart_api and return a
+// binding id (> 0) or a negative AFNS_ERROR_*. After afns_unbind, at most
+// one message from a run that was already finishing can still arrive.
+AFNS_EXPORT int64_t afns_bind_widget(const char* widget_id, size_t widget_id_len,
+                                     const char* in, size_t in_len, int64_t dart_port);
+AFNS_EXPORT int64_t afns_bind_logic(const char* in, size_t in_len, int64_t dart_port);
+AFNS_EXPORT void afns_unbind(int64_t binding);
+
+// Engine contexts. Each holds its own state text, keyed state, widget patch
+// bases, bindings and pending async requests; the compiled-code caches are
+// shared by all of them. Give every Dart isolate its own context so
+// isolates neither see nor wait on each other's state. The calls below
+// mirror the context-less ones, which act on the default context, as does a
+// NULL |context|; request and binding ids are only unique per context.
+// afns_context_destroy unbinds the context's bindings and releases it once
+// its work in flight is done.
+typedef struct afns_context afns_context;
+AFNS_EXPORT afns_context* afns_context_create(void);
+AFNS_EXPORT void afns_context_destroy(afns_context* context);
+AFNS_EXPORT int afns_context_execute_logic(afns_context* context, const char* in, size_t in_len,
+                                           char* out, size_t out_cap, size_t* out_len);
+AFNS_EXPORT int afns_context_compile_widget_tree(afns_context* context, const char* in,
+                                                 size_t in_len, char* out, size_t out_cap,
+                                                 size_t* out_len);
+AFNS_EXPORT int afns_context_compile_widget_patch(afns_context* context, const char* widget_id,
+                                                  size_t widget_id_len, const char* in,
+                                                  size_t in_len, char* out, size_t out_cap,
+                                                  size_t* out_len);
+AFNS_EXPORT void afns_context_widget_patch_reset(afns_context* context, const char* widget_id,
+                                                 size_t widget_id_len);
+AFNS_EXPORT int afns_context_get_state(afns_context* context, char* out, size_t out_cap,
+                                       size_t* out_len);
+AFNS_EXPORT int afns_context_update_state(afns_context* context, const char* in, size_t in_len);
+AFNS_EXPORT uint64_t afns_context_state_version(afns_context* context);
+AFNS_EXPORT int afns_context_state_set_int(afns_context* context, const char* path,
+                                           size_t path_len, int64_t value);
+AFNS_EXPORT int afns_context_state_set_double(afns_context* context, const char* path,
+                                              size_t path_len, double value);
+AFNS_EXPORT int afns_context_state_set_bool(afns_context* context, const char* path,
+                                            size_t path_len, int value);
+AFNS_EXPORT int afns_context_state_set_string(afns_context* context, const char* path,
+                                              size_t path_len, const char* value,
+                                              size_t value_len);
+AFNS_EXPORT int afns_context_state_remove(afns_context* context, const char* path,
+                                          size_t path_len);
+AFNS_EXPORT int afns_context_state_flush(afns_context* context);
+AFNS_EXPORT int afns_context_cancel_request(afns_context* context, int64_t request_id);
+AFNS_EXPORT void afns_context_unbind(afns_context* context, int64_t binding);
+// Dart SDK builds only, like their context-less counterparts
+AFNS_EXPORT int64_t afns_context_compile_widget_async(afns_context* context,
+                                                      const char* widget_id,
+                                                      size_t widget_id_len, const char* in,
+                                                      size_t in_len, int64_t dart_port);
+AFNS_EXPORT int64_t afns_context_execute_logic_async(afns_context* context,
+                                                     const char* widget_id,
+                                                     size_t widget_id_len, const char* in,
+                                                     size_t in_len, int64_t dart_port);
+AFNS_EXPORT int64_t afns_context_bind_widget(afns_context* context, const char* widget_id,
+                                             size_t widget_id_len, const char* in,
+                                             size_t in_len, int64_t dart_port);
+AFNS_EXPORT int64_t afns_context_bind_logic(afns_context* context, const char* in,
+                                            size_t in_len, int64_t dart_port);
+
+// Incremental documents for live editing: open once, send edits as
+// (offset, delete_len, insert bytes), compile as often as needed. Only the
+// top-level declarations an edit touches are reprocessed. afns_document_open
+// returns a handle (> 0) or a negative AFNS_ERROR_*; compile uses the
+// buffer protocol above.
+AFNS_EXPORT int64_t afns_document_open(const char* in, size_t in_len);
+AFNS_EXPORT int afns_document_edit(int64_t document, size_t offset, size_t delete_len,
+                                   const char* insert, size_t insert_len);
+AFNS_EXPORT int afns_document_compile(int64_t document, char* out, size_t out_cap,
+                                      size_t* out_len);
+AFNS_EXPORT void afns_document_close(int64_t document);
+
+// Engine-owned variants for callers that cannot size a buffer up front.
+// The result is NUL-terminated, |*out_len| (optional) excludes the NUL, and
+// it must be released with afns_free_result.
+AFNS_EXPORT char* compile_afns_widget_alloc(const char* in, size_t in_len, size_t* out_len);
+AFNS_EXPORT char* execute_afns_logic_alloc(const char* in, size_t in_len, size_t* out_len);
+AFNS_EXPORT char* get_afns_state_alloc(size_t* out_len);
+AFNS_EXPORT void afns_free_result(char* result);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif  // FLUTTER_AFNS_AFNS_ENGINE_C_API_H_
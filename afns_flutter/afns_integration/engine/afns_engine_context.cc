@@ -0,0 +1,115 @@
+// 🚀 AFNS ENGINE CONTEXT
+// Per-isolate mutable engine state next to the engine's shared caches
+
+#include "afns_engine_context.h"
+
+#include <utility>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+std::atomic<size_t> g_live_contexts{0};
+
+} // anonymous namespace
+
+AFNSEngineContext::AFNSEngineContext() {
+    g_live_contexts.fetch_add(1, std::memory_order_relaxed);
+    PublishState("AFNS_ENGINE_ACTIVE");
+}
+
+AFNSEngineContext::~AFNSEngineContext() {
+    g_live_contexts.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t AFNSEngineContext::live_count() {
+    return g_live_contexts.load(std::memory_order_relaxed);
+}
+
+void AFNSEngineContext::UpdateAFNSSState(const std::string& state) {
+    PublishState(state);
+}
+
+std::string AFNSEngineContext::GetAFNSSState() const {
+    return GetAFNSStateSnapshot()->state;
+}
+
+uint64_t AFNSEngineContext::GetAFNSStateVersion() const {
+    return state_version_.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<const AFNSStateSnapshot> AFNSEngineContext::GetAFNSStateSnapshot() const {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    return internal_afns_state_;
+}
+
+void AFNSEngineContext::PublishState(std::string state) {
+    auto snapshot = std::make_shared<AFNSStateSnapshot>();
+    snapshot->state = std::move(state);
+
+    std::shared_ptr<const AFNSStateSnapshot> replaced;
+    std::lock_guard<std::mutex> writer_lock(state_writer_mutex_);
+    const uint64_t version = state_version_.load(std::memory_order_relaxed) + 1;
+    snapshot->version = version;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        replaced = std::move(internal_afns_state_);
+        internal_afns_state_ = std::move(snapshot);
+    }
+    state_version_.store(version, std::memory_order_release);
+}
+
+void AFNSEngineContext::SetAFNSStateValue(std::string_view path, AFNSStateValue value) {
+    state_store_.Set(path, std::move(value));
+}
+
+void AFNSEngineContext::RemoveAFNSStateValue(std::string_view path) {
+    state_store_.Remove(path);
+}
+
+std::shared_ptr<AFNSWidgetTreeDiffer> AFNSEngineContext::WidgetDiffer(std::string_view widget_id) {
+    std::lock_guard<std::mutex> lock(widget_differs_mutex_);
+    std::shared_ptr<AFNSWidgetTreeDiffer>& slot = widget_differs_[std::string(widget_id)];
+    if (slot == nullptr) {
+        slot = std::make_shared<AFNSWidgetTreeDiffer>();
+    }
+    return slot;
+}
+
+void AFNSEngineContext::ResetWidgetDiffer(std::string_view widget_id) {
+    std::lock_guard<std::mutex> lock(widget_differs_mutex_);
+    widget_differs_.erase(std::string(widget_id));
+}
+
+void AFNSEngineContext::HoldExecuteResult(std::string_view code, const std::string& result,
+                                          uint64_t store_version) {
+    std::lock_guard<std::mutex> lock(held_result_mutex_);
+    has_held_result_ = true;
+    held_result_code_.assign(code.data(), code.size());
+    held_result_ = result;
+    held_result_state_version_ = GetAFNSStateVersion();
+    held_result_store_version_ = store_version;
+}
+
+bool AFNSEngineContext::TakeHeldExecuteResult(std::string_view code, std::string* result) {
+    std::lock_guard<std::mutex> lock(held_result_mutex_);
+    if (!has_held_result_) {
+        return false;
+    }
+    has_held_result_ = false;
+    const bool match = held_result_code_ == code &&
+                       held_result_state_version_ == GetAFNSStateVersion() &&
+                       held_result_store_version_ == state_store_.version();
+    if (match) {
+        *result = std::move(held_result_);
+    }
+    held_result_code_ = std::string();
+    held_result_ = std::string();
+    return match;
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,131 @@
+// 🚀 AFNS ENGINE CONTEXT
+// Per-isolate mutable engine state next to the engine's shared caches
+
+#ifndef FLUTTER_AFNS_AFNS_ENGINE_CONTEXT_H_
+#define FLUTTER_AFNS_AFNS_ENGINE_CONTEXT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "afns_async_requests.h"
+#include "afns_state_store.h"
+#include "afns_widget_diff.h"
+
+namespace flutter {
+
+namespace afns {
+
+class AFNSEngineExtension;
+struct AFNSEngineBinding;
+
+// Immutable engine state, replaced as a whole on every update
+struct AFNSStateSnapshot {
+    uint64_t version = 0;
+
+    // What GetAFNSSState returns: the text of UpdateAFNSSState, or after
+    // ExecuteAFNSLogic "EXECUTED: <n> bytes, hash <hex>" for its result,
+    // which is never copied into the state
+    std::string state;
+};
+
+// 🎯 AFNS ENGINE CONTEXT
+// Everything a caller can change: the state text, keyed state, bindings,
+// the last tree sent per widget id and pending async requests. Widget,
+// tree, parse and bytecode caches, the bundle and the workers belong to
+// the engine and are shared by every context, as they only hold results
+// keyed by source content. So a Dart isolate with its own context never
+// sees another isolate's state, and contexts never wait on each other's
+// locks. Thread-safe; work posted for a context keeps it alive until it
+// completes.
+class AFNSEngineContext : public std::enable_shared_from_this<AFNSEngineContext> {
+public:
+    AFNSEngineContext();
+    ~AFNSEngineContext();
+
+    AFNSEngineContext(const AFNSEngineContext&) = delete;
+    AFNSEngineContext& operator=(const AFNSEngineContext&) = delete;
+
+    // AFNS-specific state management
+    void UpdateAFNSSState(const std::string& state);
+    std::string GetAFNSSState() const;
+
+    // Wait-free version check, readers can skip work while it is unchanged
+    uint64_t GetAFNSStateVersion() const;
+
+    // Current snapshot without copying the state text. Not wait-free:
+    // readers take a per-context lock for the pointer copy, so one may wait
+    // for a concurrent publish's pointer swap, never for building a state.
+    std::shared_ptr<const AFNSStateSnapshot> GetAFNSStateSnapshot() const;
+
+    // Keyed state, read by `state("path")`; see AFNSEngineExtension::BindAFNS
+    // for when bindings rerun
+    void SetAFNSStateValue(std::string_view path, AFNSStateValue value);
+    void RemoveAFNSStateValue(std::string_view path);
+
+    // Contexts alive in the process, the engine's default one included
+    static size_t live_count();
+
+private:
+    friend class AFNSEngineExtension;
+
+    // RCU-style state: readers copy the pointer to the current snapshot,
+    // writers build a new one and swap it in. Both hold this context's
+    // snapshot_mutex_ just for the pointer copy or swap, so a reader waits
+    // at most for one reference count update and contexts never share a
+    // lock. Writers are serialized so versions stay in order.
+    void PublishState(std::string state);
+
+    // The differ of |widget_id|, created on first use
+    std::shared_ptr<AFNSWidgetTreeDiffer> WidgetDiffer(std::string_view widget_id);
+    void ResetWidgetDiffer(std::string_view widget_id);
+
+    // An execute result that did not fit the caller's buffer, for the
+    // retry with the same code. Any take empties the slot, so a call with
+    // other code drops it. It is only handed out while neither the state
+    // text nor the keyed state changed since the run (|store_version| is
+    // state_store_.version() from before it): then the run would produce
+    // the same result and its EXECUTED marker is still the current state.
+    void HoldExecuteResult(std::string_view code, const std::string& result,
+                           uint64_t store_version);
+    bool TakeHeldExecuteResult(std::string_view code, std::string* result);
+
+    mutable std::mutex snapshot_mutex_;
+    std::shared_ptr<const AFNSStateSnapshot> internal_afns_state_;
+    std::atomic<uint64_t> state_version_{0};
+    std::mutex state_writer_mutex_;
+
+    AFNSStateStore state_store_;
+
+    // Last tree sent per widget id, for CompileAFNSWidgetPatch
+    std::mutex widget_differs_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<AFNSWidgetTreeDiffer>> widget_differs_;
+
+    std::mutex held_result_mutex_;
+    bool has_held_result_ = false;
+    std::string held_result_code_;
+    std::string held_result_;
+    uint64_t held_result_state_version_ = 0;
+    uint64_t held_result_store_version_ = 0;
+
+    // Bindings, kept and run by the engine, and which paths they read
+    std::mutex bindings_mutex_;
+    uint64_t next_binding_ = 1;
+    std::unordered_map<uint64_t, std::shared_ptr<AFNSEngineBinding>> bindings_;
+    AFNSStateDependencies state_dependencies_;
+
+    // Request ids and supersession are per context, so two isolates using
+    // the same widget id do not cancel each other's requests
+    AFNSAsyncRequestTracker async_requests_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_ENGINE_CONTEXT_H_
@@ -0,0 +1,186 @@
+// 🚀 AFNS ENGINE DART INTEGRATION
+// Async results and binding updates posted to Dart ports via dart_api_dl
+//
+// Built with the Dart SDK's include/dart_api_dl.h and dart_api_dl.c, from
+// the SDK root or third_party/dart/runtime in a Flutter engine checkout.
+
+#include "include/dart_api_dl.h"
+
+#include "afns_engine.h"
+#include "afns_engine_c_api.h"
+#include "afns_trace.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using flutter::afns::GetAFNSEngine;
+using flutter::afns::IsValidInput;
+using flutter::afns::ResolveAFNSContext;
+
+namespace {
+
+// Async completions for Dart go through Dart_PostCObject_DL, which is only
+// usable after afns_init_dart_api ran with NativeApi.initializeApiDLData
+std::atomic<bool> g_dart_api_ready{false};
+
+// Message layout: [request_id (int64), status (int32), result (string)]
+void PostResultToDart(Dart_Port port, uint64_t request_id,
+                      flutter::afns::AFNSAsyncStatus status, const std::string& result) {
+    flutter::afns::AFNSTraceSpan trace("post_result");
+    Dart_CObject id_object;
+    id_object.type = Dart_CObject_kInt64;
+    id_object.value.as_int64 = static_cast<int64_t>(request_id);
+    
+    Dart_CObject status_object;
+    status_object.type = Dart_CObject_kInt32;
+    status_object.value.as_int32 = static_cast<int32_t>(status);
+    
+    Dart_CObject result_object;
+    result_object.type = Dart_CObject_kString;
+    result_object.value.as_string = result.c_str();
+    
+    Dart_CObject* values[] = {&id_object, &status_object, &result_object};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 3;
+    message.value.as_array.values = values;
+    
+    Dart_PostCObject_DL(port, &message);
+}
+
+// [binding, result]: a Uint8List patch for widgets, a string for logic,
+// null for widget code that did not compile
+void PostBindingToDart(Dart_Port port, uint64_t binding, bool execute, bool ok,
+                       const std::string& result) {
+    flutter::afns::AFNSTraceSpan trace("post_result");
+    Dart_CObject id_object;
+    id_object.type = Dart_CObject_kInt64;
+    id_object.value.as_int64 = static_cast<int64_t>(binding);
+    
+    Dart_CObject result_object;
+    if (!ok) {
+        result_object.type = Dart_CObject_kNull;
+    } else if (execute) {
+        result_object.type = Dart_CObject_kString;
+        result_object.value.as_string = result.c_str();
+    } else {
+        result_object.type = Dart_CObject_kTypedData;
+        result_object.value.as_typed_data.type = Dart_TypedData_kUint8;
+        result_object.value.as_typed_data.length = static_cast<intptr_t>(result.size());
+        result_object.value.as_typed_data.values = reinterpret_cast<const uint8_t*>(result.data());
+    }
+    
+    Dart_CObject* values[] = {&id_object, &result_object};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 2;
+    message.value.as_array.values = values;
+    
+    Dart_PostCObject_DL(port, &message);
+}
+
+int64_t SubmitDartAsync(afns_context* context, bool execute, const char* widget_id,
+                        size_t widget_id_len, const char* in, size_t in_len, int64_t dart_port) {
+    flutter::afns::AFNSTraceSpan trace("ffi_entry");
+    if (!g_dart_api_ready.load(std::memory_order_acquire)) {
+        return AFNS_ERROR_NOT_INITIALIZED;
+    }
+    if (!IsValidInput(in, in_len) || !IsValidInput(widget_id, widget_id_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    auto done = [port = static_cast<Dart_Port>(dart_port)](
+                    uint64_t request_id, flutter::afns::AFNSAsyncStatus status,
+                    const std::string& result) {
+        PostResultToDart(port, request_id, status, result);
+    };
+    std::string_view id(widget_id, widget_id_len);
+    std::string_view code(in, in_len);
+    flutter::afns::AFNSEngineExtension* engine = GetAFNSEngine();
+    flutter::afns::AFNSEngineContext* target = ResolveAFNSContext(context);
+    const uint64_t request_id = execute ? engine->ExecuteAFNSLogicAsync(target, id, code, done)
+                                        : engine->CompileAFNSWidgetAsync(target, id, code, done);
+    return static_cast<int64_t>(request_id);
+}
+
+int64_t BindDart(afns_context* context, bool execute, std::string_view widget_id,
+                 const char* in, size_t in_len, int64_t dart_port) {
+    if (!g_dart_api_ready.load(std::memory_order_acquire)) {
+        return AFNS_ERROR_NOT_INITIALIZED;
+    }
+    if (!IsValidInput(in, in_len)) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    auto done = [port = static_cast<Dart_Port>(dart_port), execute](
+                    uint64_t binding, bool ok, const std::string& result) {
+        PostBindingToDart(port, binding, execute, ok, result);
+    };
+    return static_cast<int64_t>(
+        GetAFNSEngine()->BindAFNS(ResolveAFNSContext(context), execute, widget_id,
+                                  std::string_view(in, in_len), done));
+}
+
+} // anonymous namespace
+
+// 🎯 DART PORT C ABI
+// See afns_engine_c_api.h for the message layouts.
+extern "C" {
+
+intptr_t afns_init_dart_api(void* data) {
+    const intptr_t result = Dart_InitializeApiDL(data);
+    if (result == 0) {
+        g_dart_api_ready.store(true, std::memory_order_release);
+    }
+    return result;
+}
+
+int64_t compile_afns_widget_async(const char* widget_id, size_t widget_id_len,
+                                  const char* in, size_t in_len, int64_t dart_port) {
+    return SubmitDartAsync(nullptr, false, widget_id, widget_id_len, in, in_len, dart_port);
+}
+
+int64_t execute_afns_logic_async(const char* widget_id, size_t widget_id_len,
+                                 const char* in, size_t in_len, int64_t dart_port) {
+    return SubmitDartAsync(nullptr, true, widget_id, widget_id_len, in, in_len, dart_port);
+}
+
+int64_t afns_bind_widget(const char* widget_id, size_t widget_id_len,
+                         const char* in, size_t in_len, int64_t dart_port) {
+    return afns_context_bind_widget(nullptr, widget_id, widget_id_len, in, in_len, dart_port);
+}
+
+int64_t afns_bind_logic(const char* in, size_t in_len, int64_t dart_port) {
+    return afns_context_bind_logic(nullptr, in, in_len, dart_port);
+}
+
+int64_t afns_context_compile_widget_async(afns_context* context, const char* widget_id,
+                                          size_t widget_id_len, const char* in, size_t in_len,
+                                          int64_t dart_port) {
+    return SubmitDartAsync(context, false, widget_id, widget_id_len, in, in_len, dart_port);
+}
+
+int64_t afns_context_execute_logic_async(afns_context* context, const char* widget_id,
+                                         size_t widget_id_len, const char* in, size_t in_len,
+                                         int64_t dart_port) {
+    return SubmitDartAsync(context, true, widget_id, widget_id_len, in, in_len, dart_port);
+}
+
+int64_t afns_context_bind_widget(afns_context* context, const char* widget_id,
+                                 size_t widget_id_len, const char* in, size_t in_len,
+                                 int64_t dart_port) {
+    if (!IsValidInput(widget_id, widget_id_len) || widget_id_len == 0) {
+        return AFNS_ERROR_INVALID_ARGUMENT;
+    }
+    return BindDart(context, false, std::string_view(widget_id, widget_id_len), in, in_len,
+                    dart_port);
+}
+
+int64_t afns_context_bind_logic(afns_context* context, const char* in, size_t in_len,
+                                int64_t dart_port) {
+    return BindDart(context, true, std::string_view(), in, in_len, dart_port);
+}
+
+} // extern "C"
@@ -0,0 +1,20 @@
+// 🚀 AFNS ENGINE LINUX INTEGRATION
+// Load hook for the Linux embedder
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#include "afns_engine_c_api.h"
+#include "afns_startup.h"
+
+// Linux Flutter Integration
+extern "C" {
+
+AFNS_EXPORT int afns_linux_init() {
+    // The engine is created on first use, see GetAFNSEngine
+    flutter::afns::MarkAFNSStartupPhase(flutter::afns::AFNSStartupPhase::kLibraryLoaded);
+    return 0;
+}
+
+} // extern "C"
+
+#endif  // defined(__linux__) && !defined(__ANDROID__)
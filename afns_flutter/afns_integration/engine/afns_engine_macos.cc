@@ -0,0 +1,24 @@
+// 🚀 AFNS ENGINE MACOS INTEGRATION
+// Load hook for the macOS embedder
+
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
+
+#if defined(__APPLE__) && TARGET_OS_OSX
+
+#include "afns_engine_c_api.h"
+#include "afns_startup.h"
+
+// macOS Flutter Integration
+extern "C" {
+
+AFNS_EXPORT int afns_macos_init() {
+    // The engine is created on first use, see GetAFNSEngine
+    flutter::afns::MarkAFNSStartupPhase(flutter::afns::AFNSStartupPhase::kLibraryLoaded);
+    return 0;
+}
+
+} // extern "C"
+
+#endif  // defined(__APPLE__) && TARGET_OS_OSX
@@ -0,0 +1,33 @@
+// 🚀 AFNS ENGINE WINDOWS INTEGRATION
+// DllMain for the Windows embedder
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+#include "afns_engine.h"
+#include "afns_startup.h"
+
+// Windows Flutter Integration
+extern "C" {
+
+BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved) {
+    switch (fdwReason) {
+    case DLL_PROCESS_ATTACH:
+        // Loader lock held: timestamp only, the engine is created on first use
+        flutter::afns::MarkAFNSStartupPhase(flutter::afns::AFNSStartupPhase::kLibraryLoaded);
+        break;
+    case DLL_PROCESS_DETACH:
+        // No teardown here: destroying the engine joins the worker pool and
+        // disk cache threads, which cannot exit while this thread holds the
+        // loader lock. A host that calls FreeLibrary calls
+        // afns_engine_shutdown first; at process exit the OS reclaims
+        // everything.
+        break;
+    }
+    return TRUE;
+}
+
+} // extern "C"
+
+#endif  // defined(_WIN32)
@@ -0,0 +1,124 @@
+// 🚀 AFNS RUST FRONT END
+// The Rust lexer/parser (src/engine_abi) behind its C ABI, loaded once
+
+#include "afns_frontend.h"
+
+#if !defined(AFNS_FRONTEND_STATIC)
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#endif
+
+#if defined(AFNS_FRONTEND_STATIC)
+extern "C" {
+uint32_t afns_frontend_abi_version(void);
+void* afns_frontend_parse(const uint8_t* source, size_t len);
+void afns_ast_free(void* ast);
+bool afns_ast_error(const void* ast, const uint8_t** message, size_t* message_len);
+}
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+#if !defined(AFNS_FRONTEND_STATIC)
+#if defined(_WIN32)
+constexpr const char kFrontendLibrary[] = "afns.dll";
+#elif defined(__APPLE__)
+constexpr const char kFrontendLibrary[] = "libafns.dylib";
+#else
+constexpr const char kFrontendLibrary[] = "libafns.so";
+#endif
+
+// The library stays loaded for the life of the process
+void* OpenFrontendLibrary() {
+#if defined(_WIN32)
+    return reinterpret_cast<void*>(LoadLibraryA(kFrontendLibrary));
+#else
+    return dlopen(kFrontendLibrary, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+void* FindSymbol(void* library, const char* name) {
+#if defined(_WIN32)
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(library), name));
+#else
+    return dlsym(library, name);
+#endif
+}
+#endif
+
+} // anonymous namespace
+
+AFNSParsedSource::AFNSParsedSource(const AFNSFrontend* frontend, std::string_view source)
+    : frontend_(frontend), source_(source) {
+    ast_ = frontend_->parse_(reinterpret_cast<const uint8_t*>(source_.data()), source_.size());
+    if (ast_ == nullptr) {
+        error_ = "parse failed";
+        return;
+    }
+
+    const uint8_t* message = nullptr;
+    size_t message_len = 0;
+    if (frontend_->error_(ast_, &message, &message_len)) {
+        error_.assign(reinterpret_cast<const char*>(message), message_len);
+        return;
+    }
+    ok_ = true;
+}
+
+AFNSParsedSource::~AFNSParsedSource() {
+    if (ast_ != nullptr) {
+        frontend_->free_(ast_);
+    }
+}
+
+const AFNSFrontend* AFNSFrontend::Get() {
+    static AFNSFrontend* frontend = [] {
+        auto* loaded = new AFNSFrontend();
+        if (!loaded->Load()) {
+            delete loaded;
+            return static_cast<AFNSFrontend*>(nullptr);
+        }
+        return loaded;
+    }();
+    return frontend;
+}
+
+bool AFNSFrontend::Load() {
+#if defined(AFNS_FRONTEND_STATIC)
+    if (afns_frontend_abi_version() != kAFNSFrontendABIVersion) {
+        return false;
+    }
+    parse_ = afns_frontend_parse;
+    free_ = afns_ast_free;
+    error_ = afns_ast_error;
+    return true;
+#else
+    void* library = OpenFrontendLibrary();
+    if (library == nullptr) {
+        return false;
+    }
+    auto version = reinterpret_cast<uint32_t (*)()>(FindSymbol(library, "afns_frontend_abi_version"));
+    if (version == nullptr || version() != kAFNSFrontendABIVersion) {
+        return false;
+    }
+    parse_ = reinterpret_cast<ParseFn>(FindSymbol(library, "afns_frontend_parse"));
+    free_ = reinterpret_cast<FreeFn>(FindSymbol(library, "afns_ast_free"));
+    error_ = reinterpret_cast<ErrorFn>(FindSymbol(library, "afns_ast_error"));
+    return parse_ != nullptr && free_ != nullptr && error_ != nullptr;
+#endif
+}
+
+std::shared_ptr<const AFNSParsedSource> AFNSFrontend::Parse(std::string_view source) const {
+    return std::shared_ptr<const AFNSParsedSource>(new AFNSParsedSource(this, source));
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,88 @@
+// 🚀 AFNS RUST FRONT END
+// The Rust lexer/parser (src/engine_abi) behind its C ABI, loaded once
+
+#ifndef FLUTTER_AFNS_AFNS_FRONTEND_H_
+#define FLUTTER_AFNS_AFNS_FRONTEND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace flutter {
+
+namespace afns {
+
+// Must equal AFNS_FRONTEND_ABI_VERSION in src/engine_abi/mod.rs; a library
+// reporting anything else is not used
+constexpr uint32_t kAFNSFrontendABIVersion = 1;
+
+class AFNSFrontend;
+
+// 🎯 AFNS PARSED SOURCE
+// Owns one Rust parse handle together with the source it was parsed from.
+// Immutable once built, so it is shared freely between threads.
+//
+// The engine does not parse with it yet: widget text comes from
+// AFNSRewriter and logic from the bytecode compiler, and the AST walk
+// (afns_ast_item) is left unbound until a consumer needs it.
+class AFNSParsedSource {
+public:
+    ~AFNSParsedSource();
+
+    AFNSParsedSource(const AFNSParsedSource&) = delete;
+    AFNSParsedSource& operator=(const AFNSParsedSource&) = delete;
+
+    const std::string& source() const { return source_; }
+
+    // False if the parser rejected the source; error() says why
+    bool ok() const { return ok_; }
+    const std::string& error() const { return error_; }
+
+private:
+    friend class AFNSFrontend;
+
+    AFNSParsedSource(const AFNSFrontend* frontend, std::string_view source);
+
+    const AFNSFrontend* frontend_;
+    std::string source_;
+    void* ast_ = nullptr;
+    bool ok_ = false;
+    std::string error_;
+};
+
+// 🎯 AFNS FRONTEND
+// Resolves the Rust exports once per process: from the linked library when
+// built with AFNS_FRONTEND_STATIC, otherwise by loading libafns
+// (libafns.so, libafns.dylib, afns.dll) from the library search path.
+class AFNSFrontend {
+public:
+    // nullptr if the library is missing or speaks another ABI version.
+    // Loads on first call and is thread-safe; keep it out of loader-lock
+    // contexts such as DllMain.
+    static const AFNSFrontend* Get();
+
+    // Never null; check ok() on the result
+    std::shared_ptr<const AFNSParsedSource> Parse(std::string_view source) const;
+
+private:
+    friend class AFNSParsedSource;
+
+    using ParseFn = void* (*)(const uint8_t* source, size_t len);
+    using FreeFn = void (*)(void* ast);
+    using ErrorFn = bool (*)(const void* ast, const uint8_t** message, size_t* message_len);
+
+    AFNSFrontend() = default;
+    bool Load();
+
+    ParseFn parse_ = nullptr;
+    FreeFn free_ = nullptr;
+    ErrorFn error_ = nullptr;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_FRONTEND_H_
@@ -0,0 +1,84 @@
+// 🚀 AFNS INTERNED IDENTIFIERS
+// Engine-wide string table giving repeated names a stable integer id
+
+#include "afns_intern_table.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace flutter {
+
+namespace afns {
+
+AFNSInternTable::AFNSInternTable(size_t byte_budget)
+    : byte_budget_(byte_budget) {}
+
+uint32_t AFNSInternTable::Intern(std::string_view name) {
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Another thread may have added it between the two locks
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+    }
+    if (name.size() > kChunkSize || bytes_used_ + name.size() > byte_budget_ ||
+        names_.size() >= kAFNSInternNone) {
+        return kAFNSInternNone;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(names_.size());
+    const std::string_view stored = StoreLocked(name);
+    names_.push_back(stored);
+    ids_.emplace(stored, id);
+    return id;
+}
+
+uint32_t AFNSInternTable::Find(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    return it == ids_.end() ? kAFNSInternNone : it->second;
+}
+
+std::string_view AFNSInternTable::Get(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < names_.size() ? names_[id] : std::string_view();
+}
+
+AFNSInternTableStats AFNSInternTable::GetStats() const {
+    AFNSInternTableStats stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        stats.entries = names_.size();
+        stats.bytes_used = bytes_used_;
+    }
+    stats.byte_budget = byte_budget_;
+    stats.lookups = lookups_.load(std::memory_order_relaxed);
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::string_view AFNSInternTable::StoreLocked(std::string_view name) {
+    bytes_used_ += name.size();
+    if (chunks_.empty() || kChunkSize - chunk_used_ < name.size()) {
+        chunks_.emplace_back(new char[kChunkSize]);
+        chunk_used_ = 0;
+    }
+    char* data = chunks_.back().get() + chunk_used_;
+    std::memcpy(data, name.data(), name.size());
+    chunk_used_ += name.size();
+    return std::string_view(data, name.size());
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,87 @@
+// 🚀 AFNS INTERNED IDENTIFIERS
+// Engine-wide string table giving repeated names a stable integer id
+
+#ifndef FLUTTER_AFNS_AFNS_INTERN_TABLE_H_
+#define FLUTTER_AFNS_AFNS_INTERN_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// Returned by Intern once the table is full and by Find for unknown names
+constexpr uint32_t kAFNSInternNone = 0xFFFFFFFFu;
+
+// Snapshot of table counters, safe to copy out to callers
+struct AFNSInternTableStats {
+    size_t entries = 0;
+    size_t bytes_used = 0;
+    size_t byte_budget = 0;
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+
+    double hit_ratio() const {
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// 🎯 AFNS INTERN TABLE
+// Ids are dense, assigned in insertion order and never reused, and the
+// bytes behind an id never move, so Get() views stay valid for the life of
+// the table. Lookups take a shared lock and do not allocate; only the first
+// sighting of a name takes the exclusive lock. Meant for identifiers (widget
+// types, property keys), not literal values: once |byte_budget| is reached
+// new names are refused rather than growing the table without bound, as
+// are names longer than one storage chunk.
+class AFNSInternTable {
+public:
+    static constexpr size_t kDefaultByteBudget = 256 * 1024;
+
+    explicit AFNSInternTable(size_t byte_budget = kDefaultByteBudget);
+
+    AFNSInternTable(const AFNSInternTable&) = delete;
+    AFNSInternTable& operator=(const AFNSInternTable&) = delete;
+
+    // Id of |name|, adding it if needed; kAFNSInternNone if the table is full
+    uint32_t Intern(std::string_view name);
+
+    // Id of |name| without adding it
+    uint32_t Find(std::string_view name) const;
+
+    // Empty for unknown ids
+    std::string_view Get(uint32_t id) const;
+
+    AFNSInternTableStats GetStats() const;
+
+private:
+    static constexpr size_t kChunkSize = 16 * 1024;
+
+    // Copies |name| into chunk storage that is never reallocated
+    std::string_view StoreLocked(std::string_view name);
+
+    const size_t byte_budget_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = 0;
+    size_t bytes_used_ = 0;
+    std::vector<std::string_view> names_;  // by id
+    std::unordered_map<std::string_view, uint32_t> ids_;
+
+    mutable std::atomic<uint64_t> lookups_{0};
+    mutable std::atomic<uint64_t> hits_{0};
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_INTERN_TABLE_H_
@@ -0,0 +1,281 @@
+// 🚀 AFNS ENGINE METRICS
+// Per-thread counters and latency histograms, merged when read
+
+#include "afns_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr const char* kTimerNames[kAFNSMetricTimerCount] = {
+    "validate",
+    "process",
+    "compile_widget",
+    "compile_tree",
+    "compile_patch",
+    "compile_logic",
+    "execute",
+};
+
+#if !defined(AFNS_DISABLE_METRICS)
+
+struct TimerSlots {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sampled{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> buckets[kAFNSLatencyBuckets] = {};
+};
+
+// One per thread; on its own cache lines so neighbours never share one
+struct alignas(64) ThreadMetrics {
+    TimerSlots timers[kAFNSMetricTimerCount];
+    std::atomic<uint64_t> counters[kAFNSMetricCounterCount] = {};
+
+    // Claimed by a live thread; blocks are never freed, only reused
+    std::atomic<bool> in_use{true};
+    ThreadMetrics* next = nullptr;  // set once, before the block is published
+};
+
+std::atomic<ThreadMetrics*> g_thread_metrics{nullptr};
+
+ThreadMetrics* ClaimThreadMetrics() {
+    for (ThreadMetrics* block = g_thread_metrics.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        bool in_use = false;
+        if (!block->in_use.load(std::memory_order_relaxed) &&
+            block->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+            return block;
+        }
+    }
+    auto* block = new ThreadMetrics();
+    block->next = g_thread_metrics.load(std::memory_order_relaxed);
+    while (!g_thread_metrics.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+    }
+    return block;
+}
+
+struct ThreadMetricsHolder {
+    ThreadMetrics* const block = ClaimThreadMetrics();
+
+    ~ThreadMetricsHolder() {
+        block->in_use.store(false, std::memory_order_release);
+    }
+};
+
+ThreadMetrics* CurrentThreadMetrics() {
+    thread_local ThreadMetricsHolder holder;
+    return holder.block;
+}
+
+// Only the owning thread writes a slot, so no read-modify-write is needed
+inline void Bump(std::atomic<uint64_t>& slot, uint64_t amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+size_t LatencyBucket(uint64_t ns) {
+    if (ns == 0) {
+        return 0;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    const size_t log2 = 63 - static_cast<size_t>(__builtin_clzll(ns));
+#else
+    size_t log2 = 0;
+    while (ns >>= 1) {
+        ++log2;
+    }
+#endif
+    return std::min(log2, kAFNSLatencyBuckets - 1);
+}
+
+#endif
+
+} // anonymous namespace
+
+uint64_t AFNSLatencyHistogram::QuantileNs(double quantile) const {
+    // Fields are merged from racing writers; rank against what the buckets
+    // hold rather than |sampled|
+    uint64_t in_buckets = 0;
+    for (uint64_t bucket : buckets) {
+        in_buckets += bucket;
+    }
+    if (in_buckets == 0) {
+        return 0;
+    }
+    const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(clamped * in_buckets + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kAFNSLatencyBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return i + 1 < kAFNSLatencyBuckets ? std::min(max_ns, (uint64_t{1} << (i + 1)) - 1) : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+const char* AFNSMetricTimerName(AFNSMetricTimer timer) {
+    const size_t index = static_cast<size_t>(timer);
+    return index < kAFNSMetricTimerCount ? kTimerNames[index] : "unknown";
+}
+
+#if !defined(AFNS_DISABLE_METRICS)
+
+bool BeginAFNSMetric(AFNSMetricTimer timer) {
+    TimerSlots& slots = CurrentThreadMetrics()->timers[static_cast<size_t>(timer)];
+    const uint64_t count = slots.count.load(std::memory_order_relaxed);
+    slots.count.store(count + 1, std::memory_order_relaxed);
+    return count % kAFNSMetricSampleInterval == 0;
+}
+
+void EndAFNSMetric(AFNSMetricTimer timer, uint64_t ns) {
+    TimerSlots& slots = CurrentThreadMetrics()->timers[static_cast<size_t>(timer)];
+    Bump(slots.sampled, 1);
+    Bump(slots.total_ns, ns);
+    Bump(slots.buckets[LatencyBucket(ns)], 1);
+    if (ns > slots.max_ns.load(std::memory_order_relaxed)) {
+        slots.max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void AddAFNSCounter(AFNSMetricCounter counter, uint64_t amount) {
+    Bump(CurrentThreadMetrics()->counters[static_cast<size_t>(counter)], amount);
+}
+
+#endif
+
+AFNSMetricsSnapshot GetAFNSMetrics() {
+    AFNSMetricsSnapshot snapshot;
+#if !defined(AFNS_DISABLE_METRICS)
+    for (const ThreadMetrics* block = g_thread_metrics.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        for (size_t t = 0; t < kAFNSMetricTimerCount; ++t) {
+            const TimerSlots& slots = block->timers[t];
+            AFNSLatencyHistogram& histogram = snapshot.timers[t];
+            histogram.count += slots.count.load(std::memory_order_relaxed);
+            histogram.sampled += slots.sampled.load(std::memory_order_relaxed);
+            histogram.total_ns += slots.total_ns.load(std::memory_order_relaxed);
+            histogram.max_ns = std::max(histogram.max_ns, slots.max_ns.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < kAFNSLatencyBuckets; ++b) {
+                histogram.buckets[b] += slots.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < kAFNSMetricCounterCount; ++c) {
+            snapshot.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+#endif
+    return snapshot;
+}
+
+AFNSStatsWriter::AFNSStatsWriter() : json_("{") {}
+
+void AFNSStatsWriter::BeginObject(const char* key) {
+    Key(key);
+    json_ += '{';
+    ++depth_;
+    first_ = true;
+}
+
+void AFNSStatsWriter::EndObject() {
+    if (depth_ > 1) {
+        json_ += '}';
+        --depth_;
+        first_ = false;
+    }
+}
+
+void AFNSStatsWriter::UInt(const char* key, uint64_t value) {
+    Key(key);
+    json_ += std::to_string(value);
+}
+
+void AFNSStatsWriter::Int(const char* key, int64_t value) {
+    Key(key);
+    json_ += std::to_string(value);
+}
+
+void AFNSStatsWriter::Double(const char* key, double value) {
+    Key(key);
+    // JSON has no NaN or infinity
+    if (!std::isfinite(value)) {
+        json_ += "null";
+        return;
+    }
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.6g", value);
+    json_ += number;
+}
+
+void AFNSStatsWriter::Bool(const char* key, bool value) {
+    Key(key);
+    json_ += value ? "true" : "false";
+}
+
+void AFNSStatsWriter::Histogram(const char* key, const AFNSLatencyHistogram& histogram) {
+    BeginObject(key);
+    UInt("count", histogram.count);
+    UInt("sampled", histogram.sampled);
+    Double("mean_ns", histogram.mean_ns());
+    UInt("max_ns", histogram.max_ns);
+    UInt("p50_ns", histogram.QuantileNs(0.5));
+    UInt("p90_ns", histogram.QuantileNs(0.9));
+    UInt("p99_ns", histogram.QuantileNs(0.99));
+    size_t used = kAFNSLatencyBuckets;
+    while (used > 0 && histogram.buckets[used - 1] == 0) {
+        --used;
+    }
+    Key("log2_ns_buckets");
+    json_ += '[';
+    for (size_t i = 0; i < used; ++i) {
+        if (i > 0) {
+            json_ += ',';
+        }
+        json_ += std::to_string(histogram.buckets[i]);
+    }
+    json_ += ']';
+    EndObject();
+}
+
+void AFNSStatsWriter::Metrics(const AFNSMetricsSnapshot& metrics) {
+    Bool("enabled", kAFNSMetricsEnabled);
+    BeginObject("timers");
+    for (size_t t = 0; t < kAFNSMetricTimerCount; ++t) {
+        Histogram(AFNSMetricTimerName(static_cast<AFNSMetricTimer>(t)), metrics.timers[t]);
+    }
+    EndObject();
+    UInt("bytes_in", metrics.counters[static_cast<size_t>(AFNSMetricCounter::kBytesIn)]);
+    UInt("bytes_out", metrics.counters[static_cast<size_t>(AFNSMetricCounter::kBytesOut)]);
+}
+
+std::string AFNSStatsWriter::Finish() {
+    while (depth_ > 1) {
+        EndObject();
+    }
+    json_ += '}';
+    depth_ = 0;
+    return std::move(json_);
+}
+
+void AFNSStatsWriter::Key(const char* key) {
+    if (!first_) {
+        json_ += ',';
+    }
+    first_ = false;
+    json_ += '"';
+    json_ += key;
+    json_ += "\":";
+}
+
+} // namespace afns
+
+} // namespace flutter
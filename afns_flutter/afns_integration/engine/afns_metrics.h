@@ -0,0 +1,171 @@
+// 🚀 AFNS ENGINE METRICS
+// Per-thread counters and latency histograms, merged when read
+
+#ifndef FLUTTER_AFNS_AFNS_METRICS_H_
+#define FLUTTER_AFNS_AFNS_METRICS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace flutter {
+
+namespace afns {
+
+// Timed engine operations
+enum class AFNSMetricTimer : uint8_t {
+    kValidate,
+    kProcess,
+    kCompileWidget,
+    kCompileTree,
+    kCompilePatch,
+    kCompileLogic,
+    kExecute,
+    kCount,
+};
+
+enum class AFNSMetricCounter : uint8_t {
+    kBytesIn,   // source bytes handed to the compile/execute entry points
+    kBytesOut,  // bytes they returned
+    kCount,
+};
+
+constexpr size_t kAFNSMetricTimerCount = static_cast<size_t>(AFNSMetricTimer::kCount);
+constexpr size_t kAFNSMetricCounterCount = static_cast<size_t>(AFNSMetricCounter::kCount);
+
+// Bucket i holds durations in [2^i, 2^(i+1)) ns, bucket 0 also holds 0;
+// the last one is open-ended (about 2.1 s and up)
+constexpr size_t kAFNSLatencyBuckets = 32;
+
+// Every call is counted, but each thread times only its first call of an
+// operation and every kAFNSMetricSampleInterval-th after that: two clock
+// reads cost more than a cache hit they would be timing
+constexpr uint32_t kAFNSMetricSampleInterval = 16;
+
+struct AFNSLatencyHistogram {
+    uint64_t count = 0;    // calls
+    uint64_t sampled = 0;  // calls timed; total, max and buckets are theirs
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t buckets[kAFNSLatencyBuckets] = {};
+
+    double mean_ns() const {
+        return sampled == 0 ? 0.0 : static_cast<double>(total_ns) / static_cast<double>(sampled);
+    }
+
+    // Upper bound of the bucket holding the |quantile| (0..1) sample,
+    // capped at max_ns; 0 when empty
+    uint64_t QuantileNs(double quantile) const;
+};
+
+struct AFNSMetricsSnapshot {
+    AFNSLatencyHistogram timers[kAFNSMetricTimerCount];
+    uint64_t counters[kAFNSMetricCounterCount] = {};
+};
+
+// Short snake_case name, used as the stats key
+const char* AFNSMetricTimerName(AFNSMetricTimer timer);
+
+// Every thread writes only its own block, with plain relaxed stores and no
+// read-modify-write, so an untimed call costs two uncontended stores. Readers
+// sum all blocks without locking and may see an operation counted before
+// its time is added; totals never go backwards. A thread's block is reused
+// by a later thread once it exits, so the block count stays at the peak
+// number of live threads. AFNS_DISABLE_METRICS builds compile every
+// recording call to nothing and report zeros.
+#if defined(AFNS_DISABLE_METRICS)
+
+constexpr bool kAFNSMetricsEnabled = false;
+
+inline bool BeginAFNSMetric(AFNSMetricTimer) { return false; }
+inline void EndAFNSMetric(AFNSMetricTimer, uint64_t) {}
+inline void AddAFNSCounter(AFNSMetricCounter, uint64_t) {}
+
+class AFNSMetricScope {
+public:
+    explicit AFNSMetricScope(AFNSMetricTimer) {}
+};
+
+#else
+
+constexpr bool kAFNSMetricsEnabled = true;
+
+// Counts a call of |timer|; true if this one is to be timed and passed to
+// EndAFNSMetric
+bool BeginAFNSMetric(AFNSMetricTimer timer);
+void EndAFNSMetric(AFNSMetricTimer timer, uint64_t ns);
+
+void AddAFNSCounter(AFNSMetricCounter counter, uint64_t amount);
+
+// Counts one call of |timer| and, when sampled, times its own lifetime
+class AFNSMetricScope {
+public:
+    explicit AFNSMetricScope(AFNSMetricTimer timer) : timer_(timer), sampled_(BeginAFNSMetric(timer)) {
+        if (sampled_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~AFNSMetricScope() {
+        if (sampled_) {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            EndAFNSMetric(timer_, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    AFNSMetricScope(const AFNSMetricScope&) = delete;
+    AFNSMetricScope& operator=(const AFNSMetricScope&) = delete;
+
+private:
+    const AFNSMetricTimer timer_;
+    const bool sampled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
+
+// Totals over every thread since startup
+AFNSMetricsSnapshot GetAFNSMetrics();
+
+// 🎯 AFNS STATS WRITER
+// Builds the JSON that afns_engine_get_stats returns. Keys are fixed
+// identifiers and are written unescaped; the typed setters keep size_t,
+// uint64_t and double from picking each other's overloads.
+class AFNSStatsWriter {
+public:
+    AFNSStatsWriter();
+
+    // Nested object under |key|, closed by EndObject
+    void BeginObject(const char* key);
+    void EndObject();
+
+    void UInt(const char* key, uint64_t value);
+    void Int(const char* key, int64_t value);
+    void Double(const char* key, double value);
+    void Bool(const char* key, bool value);
+
+    // count, sampled, mean/max and p50/p90/p99 in ns, and the buckets up to
+    // the last non-empty one
+    void Histogram(const char* key, const AFNSLatencyHistogram& histogram);
+
+    // Timers by name, then the byte counters
+    void Metrics(const AFNSMetricsSnapshot& metrics);
+
+    // Closes the open objects
+    std::string Finish();
+
+private:
+    void Key(const char* key);
+
+    std::string json_;
+    size_t depth_ = 1;
+    bool first_ = true;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_METRICS_H_
@@ -0,0 +1,64 @@
+// 🚀 AFNS PACKED STRING ARRAYS
+// Offsets + one contiguous byte blob, the layout used by the batch APIs
+
+#ifndef FLUTTER_AFNS_AFNS_PACKED_STRINGS_H_
+#define FLUTTER_AFNS_AFNS_PACKED_STRINGS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// Item i is blob[offsets[i], offsets[i + 1]); |offsets| holds count + 1
+// entries. Views do not own their memory.
+struct AFNSPackedStringsView {
+    const uint64_t* offsets = nullptr;
+    size_t count = 0;
+    const char* blob = nullptr;
+
+    std::string_view Get(size_t index) const {
+        return std::string_view(blob + offsets[index],
+                                static_cast<size_t>(offsets[index + 1] - offsets[index]));
+    }
+
+    // Offsets must be non-decreasing and end within |blob_size| bytes
+    bool IsValid(size_t blob_size) const {
+        if (count > 0 && (offsets == nullptr || blob == nullptr)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                return false;
+            }
+        }
+        return count == 0 || offsets[count] <= blob_size;
+    }
+};
+
+// Owning counterpart, built item by item
+struct AFNSPackedStrings {
+    std::vector<uint64_t> offsets{0};
+    std::string blob;
+
+    size_t size() const { return offsets.size() - 1; }
+
+    void Append(std::string_view item) {
+        blob.append(item.data(), item.size());
+        offsets.push_back(blob.size());
+    }
+
+    AFNSPackedStringsView View() const {
+        return AFNSPackedStringsView{offsets.data(), size(), blob.data()};
+    }
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_PACKED_STRINGS_H_
@@ -0,0 +1,225 @@
+// 🚀 AFNS SINGLE-PASS REWRITER
+// Token-aware multi-pattern keyword rewriting for ProcessAFNSCode
+
+#include "afns_rewriter.h"
+
+#include <cstring>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+// Matches the identifier/number alphabet of the AFNS lexer
+inline bool IsWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// What ends a literal opened by either quote, or escapes the next byte
+constexpr simd::ByteSet kDoubleQuotedStops("\"\\");
+constexpr simd::ByteSet kSingleQuotedStops("'\\");
+
+// Everything FindAFNSDeclarationEnd acts on
+constexpr simd::ByteSet kDeclarationStops("\"'/{([})]\n");
+
+// Returns the index just past the literal opened by the quote at |pos|.
+// Unterminated literals run to the end of the input.
+size_t SkipLiteral(std::string_view input, size_t pos) {
+    const simd::ByteSet& stops = input[pos] == '"' ? kDoubleQuotedStops : kSingleQuotedStops;
+    const size_t n = input.size();
+    size_t i = pos + 1;
+    while ((i = stops.Find(input.data(), i, n)) < n) {
+        if (input[i] != '\\') {
+            return i + 1;
+        }
+        i += 2;
+    }
+    return n;
+}
+
+// Returns the index just past the // or /* */ comment starting at |pos|
+size_t SkipComment(std::string_view input, size_t pos) {
+    if (input[pos + 1] == '/') {
+        size_t end = input.find('\n', pos + 2);
+        return end == std::string_view::npos ? input.size() : end;
+    }
+    size_t end = input.find("*/", pos + 2);
+    return end == std::string_view::npos ? input.size() : end + 2;
+}
+
+} // anonymous namespace
+
+size_t FindAFNSDeclarationEnd(std::string_view text, size_t start) {
+    const size_t n = text.size();
+    size_t depth = 0;
+    size_t i = start;
+    while ((i = kDeclarationStops.Find(text.data(), i, n)) < n) {
+        const char c = text[i];
+        if (c == '"' || c == '\'') {
+            i = SkipLiteral(text, i);
+            continue;
+        }
+        if (c == '/' && i + 1 < n && (text[i + 1] == '/' || text[i + 1] == '*')) {
+            i = SkipComment(text, i);
+            continue;
+        }
+        if (c == '{' || c == '(' || c == '[') {
+            ++depth;
+        } else if ((c == '}' || c == ')' || c == ']') && depth > 0) {
+            --depth;
+        } else if (c == '\n' && depth == 0) {
+            return i + 1;
+        }
+        ++i;
+    }
+    return n;
+}
+
+AFNSRewriter::AFNSRewriter(const AFNSRewriteRule* rules, size_t rule_count) {
+    std::memset(byte_class_, 0, sizeof(byte_class_));
+    std::memset(starts_pattern_, 0, sizeof(starts_pattern_));
+
+    patterns_.reserve(rule_count);
+    replacements_.reserve(rule_count);
+    for (size_t i = 0; i < rule_count; ++i) {
+        if (rules[i].pattern.empty()) {
+            continue;
+        }
+        patterns_.emplace_back(rules[i].pattern);
+        replacements_.emplace_back(rules[i].replacement);
+    }
+
+    // Where AppendRewrite has to stop: literals, comments and first bytes
+    candidates_.Add('"');
+    candidates_.Add('\'');
+    candidates_.Add('/');
+
+    // Compress the alphabet to the bytes patterns actually use so each trie
+    // node only needs a handful of transition slots
+    for (const std::string& pattern : patterns_) {
+        starts_pattern_[static_cast<unsigned char>(pattern[0])] = true;
+        candidates_.Add(pattern[0]);
+        for (unsigned char c : pattern) {
+            if (byte_class_[c] == 0) {
+                byte_class_[c] = static_cast<uint8_t>(class_count_++);
+            }
+        }
+    }
+
+    transitions_.assign(class_count_, kNoNode);
+    terminal_rule_.assign(1, -1);
+
+    for (size_t rule = 0; rule < patterns_.size(); ++rule) {
+        int32_t node = 0;
+        for (unsigned char c : patterns_[rule]) {
+            const size_t slot = node * class_count_ + byte_class_[c];
+            if (transitions_[slot] == kNoNode) {
+                const int32_t child = static_cast<int32_t>(terminal_rule_.size());
+                transitions_[slot] = child;
+                transitions_.resize(transitions_.size() + class_count_, kNoNode);
+                terminal_rule_.push_back(-1);
+            }
+            node = transitions_[slot];
+        }
+        // First rule wins on duplicate patterns
+        if (terminal_rule_[node] < 0) {
+            terminal_rule_[node] = static_cast<int32_t>(rule);
+        }
+    }
+}
+
+void AFNSRewriter::Rewrite(std::string_view input, std::string* output) const {
+    output->clear();
+    AppendRewrite(input, output);
+}
+
+void AFNSRewriter::AppendRewrite(std::string_view input, std::string* output) const {
+    output->reserve(output->size() + input.size() + input.size() / 8);
+
+    const size_t n = input.size();
+    size_t copy_from = 0;  // start of the pending verbatim run
+    size_t i = 0;
+
+    while ((i = candidates_.Find(input.data(), i, n)) < n) {
+        const unsigned char c = input[i];
+
+        if (c == '"' || c == '\'') {
+            i = SkipLiteral(input, i);
+            continue;
+        }
+        if (c == '/' && i + 1 < n && (input[i + 1] == '/' || input[i + 1] == '*')) {
+            i = SkipComment(input, i);
+            continue;
+        }
+
+        if (starts_pattern_[c]) {
+            size_t match_length = 0;
+            const int32_t rule = MatchAt(input, i, &match_length);
+            if (rule >= 0) {
+                output->append(input.data() + copy_from, i - copy_from);
+                output->append(replacements_[rule]);
+                i += match_length;
+                copy_from = i;
+                continue;
+            }
+        }
+
+        // No rule can start inside a word, so skip the rest of it
+        if (IsWordByte(c)) {
+            do {
+                ++i;
+            } while (i < n && IsWordByte(input[i]));
+        } else {
+            ++i;
+        }
+    }
+
+    output->append(input.data() + copy_from, n - copy_from);
+}
+
+std::string AFNSRewriter::Rewrite(std::string_view input) const {
+    std::string output;
+    Rewrite(input, &output);
+    return output;
+}
+
+int32_t AFNSRewriter::Child(int32_t node, unsigned char c) const {
+    const uint8_t byte_class = byte_class_[c];
+    if (byte_class == 0) {
+        return kNoNode;
+    }
+    return transitions_[node * class_count_ + byte_class];
+}
+
+int32_t AFNSRewriter::MatchAt(std::string_view input, size_t pos,
+                              size_t* match_length) const {
+    const size_t n = input.size();
+    if (IsWordByte(input[pos]) && pos > 0 && IsWordByte(input[pos - 1])) {
+        return -1;
+    }
+
+    int32_t best_rule = -1;
+    int32_t node = 0;
+    for (size_t j = pos; j < n; ++j) {
+        node = Child(node, input[j]);
+        if (node == kNoNode) {
+            break;
+        }
+        const int32_t rule = terminal_rule_[node];
+        if (rule < 0) {
+            continue;
+        }
+        const bool ends_in_word = IsWordByte(patterns_[rule].back());
+        if (!ends_in_word || j + 1 == n || !IsWordByte(input[j + 1])) {
+            best_rule = rule;
+            *match_length = j - pos + 1;
+        }
+    }
+    return best_rule;
+}
+
+} // namespace afns
+
+} // namespace flutter
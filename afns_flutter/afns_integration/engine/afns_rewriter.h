@@ -0,0 +1,84 @@
+// 🚀 AFNS SINGLE-PASS REWRITER
+// Token-aware multi-pattern keyword rewriting for ProcessAFNSCode
+
+#ifndef FLUTTER_AFNS_AFNS_REWRITER_H_
+#define FLUTTER_AFNS_AFNS_REWRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_simd.h"
+
+namespace flutter {
+
+namespace afns {
+
+// One entry of a rewrite table: |pattern| is replaced by |replacement|
+struct AFNSRewriteRule {
+    std::string_view pattern;
+    std::string_view replacement;
+};
+
+// Returns the end of the top-level declaration starting at |start|: just
+// past the first newline at nesting depth 0 outside literals and comments,
+// or the end of |text|. The rewriter is back in its initial state at these
+// points, so as long as no rule spans a newline, rewriting declarations one
+// by one gives the same output as rewriting the whole text.
+size_t FindAFNSDeclarationEnd(std::string_view text, size_t start);
+
+// 🎯 AFNS REWRITER
+// Applies a whole rule table in one left-to-right pass. Patterns are held in
+// a trie over a compressed byte alphabet; at each candidate position the
+// longest matching pattern wins. Matching is token aware:
+//   - a pattern starting with a word character only matches at the start of
+//     a word, and one ending with a word character only if the word ends
+//     there too (so "fun" never matches inside "refund"),
+//   - string/char literals and // and /* */ comments are copied verbatim.
+// Cost is linear in the input for a fixed table (bounded by the longest
+// pattern), and output goes into a buffer reserved up front. Runs that can
+// neither start a pattern, a literal nor a comment are skipped a vector at
+// a time while the table has few distinct first bytes.
+class AFNSRewriter {
+public:
+    AFNSRewriter(const AFNSRewriteRule* rules, size_t rule_count);
+
+    template <size_t N>
+    explicit AFNSRewriter(const AFNSRewriteRule (&rules)[N])
+        : AFNSRewriter(rules, N) {}
+
+    // |output| is cleared first
+    void Rewrite(std::string_view input, std::string* output) const;
+    std::string Rewrite(std::string_view input) const;
+
+    // Like Rewrite but appends to |output| instead of replacing it
+    void AppendRewrite(std::string_view input, std::string* output) const;
+
+private:
+    static constexpr int32_t kNoNode = -1;
+
+    int32_t Child(int32_t node, unsigned char c) const;
+
+    // Longest rule matching at |pos| that satisfies the word boundaries, or
+    // -1. On success |match_length| receives the pattern length.
+    int32_t MatchAt(std::string_view input, size_t pos, size_t* match_length) const;
+
+    std::vector<std::string> patterns_;
+    std::vector<std::string> replacements_;
+
+    uint8_t byte_class_[256];     // 0 = byte not used by any pattern
+    bool starts_pattern_[256];    // first bytes of patterns
+    simd::ByteSet candidates_;    // those, quotes and '/'
+    size_t class_count_ = 1;
+
+    std::vector<int32_t> transitions_;  // node * class_count_ + class
+    std::vector<int32_t> terminal_rule_;  // rule index per node, or -1
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_REWRITER_H_
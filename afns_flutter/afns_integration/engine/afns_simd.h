@@ -0,0 +1,153 @@
+// 🚀 AFNS BYTE SCANNING PRIMITIVES
+// The SSE2/AVX2/NEON byte-vector helpers the validator, rewriter and UTF
+// transcoder scan with
+
+#ifndef FLUTTER_AFNS_AFNS_SIMD_H_
+#define FLUTTER_AFNS_AFNS_SIMD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__AVX2__)
+#define AFNS_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AFNS_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define AFNS_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace simd {
+
+// Only what the build targets: no runtime dispatch, an x86-64 build without
+// -mavx2 (or /arch:AVX2) scans 16 bytes at a time
+#if defined(AFNS_SIMD_AVX2)
+using Vec = __m256i;
+constexpr size_t kChunk = 32;
+constexpr unsigned kMaskBitsPerByte = 1;
+inline Vec Load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Vec Eq(Vec v, char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+inline Vec SignedLess(Vec v, char c) { return _mm256_cmpgt_epi8(_mm256_set1_epi8(c), v); }
+inline Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+inline Vec AndNot(Vec a, Vec b) { return _mm256_andnot_si256(b, a); }
+inline uint64_t ToMask(Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#elif defined(AFNS_SIMD_SSE2)
+using Vec = __m128i;
+constexpr size_t kChunk = 16;
+constexpr unsigned kMaskBitsPerByte = 1;
+inline Vec Load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Vec Eq(Vec v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+inline Vec SignedLess(Vec v, char c) { return _mm_cmplt_epi8(v, _mm_set1_epi8(c)); }
+inline Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+inline Vec AndNot(Vec a, Vec b) { return _mm_andnot_si128(b, a); }
+inline uint64_t ToMask(Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#elif defined(AFNS_SIMD_NEON)
+using Vec = uint8x16_t;
+constexpr size_t kChunk = 16;
+// No movemask on NEON: narrowing each 16-bit lane by 4 leaves one nibble
+// per byte
+constexpr unsigned kMaskBitsPerByte = 4;
+inline Vec Load(const char* p) { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+inline Vec Eq(Vec v, char c) { return vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(c))); }
+inline Vec SignedLess(Vec v, char c) { return vcltq_s8(vreinterpretq_s8_u8(v), vdupq_n_s8(c)); }
+inline Vec Or(Vec a, Vec b) { return vorrq_u8(a, b); }
+inline Vec AndNot(Vec a, Vec b) { return vbicq_u8(a, b); }
+inline uint64_t ToMask(Vec v) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+#endif
+
+#if defined(AFNS_SIMD_AVX2) || defined(AFNS_SIMD_SSE2) || defined(AFNS_SIMD_NEON)
+#define AFNS_SIMD 1
+
+// Mask of the bytes >= 0x80, which read as negative
+inline Vec NonAscii(Vec v) { return SignedLess(v, 0); }
+
+// Index of the first set byte of a non-zero ToMask result
+inline unsigned FirstByte(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index) / kMaskBitsPerByte;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask)) / kMaskBitsPerByte;
+#endif
+}
+#endif
+
+// A set of bytes to scan for. Sets of up to kMaxVectorBytes bytes are
+// compared a whole vector at a time; larger ones are still found, one byte
+// at a time through the table.
+class ByteSet {
+public:
+    static constexpr size_t kMaxVectorBytes = 12;
+
+    constexpr ByteSet() = default;
+    explicit constexpr ByteSet(std::string_view bytes) {
+        for (char c : bytes) {
+            Add(c);
+        }
+    }
+
+    constexpr void Add(char c) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (contains_[byte]) {
+            return;
+        }
+        contains_[byte] = true;
+        if (count_ < kMaxVectorBytes) {
+            bytes_[count_] = c;
+        }
+        ++count_;
+    }
+
+    bool Contains(unsigned char c) const { return contains_[c]; }
+
+    // Index of the first member at or after |i|, or |n|
+    size_t Find(const char* data, size_t i, size_t n) const {
+#if defined(AFNS_SIMD)
+        if (count_ != 0 && count_ <= kMaxVectorBytes) {
+            while (i + kChunk <= n) {
+                const Vec v = Load(data + i);
+                Vec hits = Eq(v, bytes_[0]);
+                for (size_t k = 1; k < count_; ++k) {
+                    hits = Or(hits, Eq(v, bytes_[k]));
+                }
+                const uint64_t mask = ToMask(hits);
+                if (mask != 0) {
+                    return i + FirstByte(mask);
+                }
+                i += kChunk;
+            }
+        }
+#endif
+        while (i < n && !contains_[static_cast<unsigned char>(data[i])]) {
+            ++i;
+        }
+        return i;
+    }
+
+private:
+    bool contains_[256] = {};
+    char bytes_[kMaxVectorBytes] = {};
+    size_t count_ = 0;
+};
+
+} // namespace simd
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_SIMD_H_
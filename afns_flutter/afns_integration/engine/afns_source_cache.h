@@ -0,0 +1,84 @@
+// 🚀 AFNS SOURCE-KEYED CACHE
+// Small LRU of immutable per-source artifacts (parses, bytecode)
+
+#ifndef FLUTTER_AFNS_AFNS_SOURCE_CACHE_H_
+#define FLUTTER_AFNS_AFNS_SOURCE_CACHE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "afns_widget_cache.h"
+
+namespace flutter {
+
+namespace afns {
+
+// 🎯 AFNS SOURCE CACHE
+// Recent artifacts by content, so work done once for a source is shared by
+// every later request for it. T must expose source(); that is compared on
+// lookup so a hash collision is a miss. Entries are shared, eviction is least
+// recently used by count.
+template <typename T>
+class AFNSSourceCache {
+public:
+    static constexpr size_t kDefaultCapacity = 32;
+
+    explicit AFNSSourceCache(size_t capacity = kDefaultCapacity)
+        : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    std::shared_ptr<const T> Lookup(std::string_view source) {
+        const uint64_t key = HashAFNSSource(source, 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end() || it->second->second->source() != source) {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    void Insert(std::shared_ptr<const T> value) {
+        const uint64_t key = HashAFNSSource(value->source(), 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = std::move(value);
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+        lru_.emplace_front(key, std::move(value));
+        index_[key] = lru_.begin();
+        if (lru_.size() > capacity_) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.clear();
+        lru_.clear();
+    }
+
+private:
+    using EntryList = std::list<std::pair<uint64_t, std::shared_ptr<const T>>>;
+
+    const size_t capacity_;
+
+    std::mutex mutex_;
+    EntryList lru_;  // front = most recently used
+    std::unordered_map<uint64_t, typename EntryList::iterator> index_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_SOURCE_CACHE_H_
@@ -0,0 +1,75 @@
+// 🚀 AFNS STARTUP PHASES
+// Timestamps of each initialization stage, cheap enough to record under loader locks
+
+#include "afns_startup.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr size_t kPhaseCount = static_cast<size_t>(AFNSStartupPhase::kCount);
+
+constexpr const char* kPhaseNames[kPhaseCount] = {
+    "library_loaded",
+    "engine_create_begin",
+    "engine_created",
+    "compiler_resolved",
+    "prewarm_begin",
+    "prewarm_done",
+};
+
+// Steady-clock nanoseconds, 0 until reached. Constant-initialized, so they
+// are usable before any dynamic initializer of the library has run.
+std::atomic<int64_t> g_phase_ns[kPhaseCount] = {};
+
+int64_t NowNanos() {
+    // Never 0, which marks an unreached phase
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return now == 0 ? 1 : now;
+}
+
+void MarkOnce(std::atomic<int64_t>* slot, int64_t now) {
+    int64_t unset = 0;
+    slot->compare_exchange_strong(unset, now, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+void MarkAFNSStartupPhase(AFNSStartupPhase phase) {
+    const size_t index = static_cast<size_t>(phase);
+    if (index >= kPhaseCount) {
+        return;
+    }
+    const int64_t now = NowNanos();
+    MarkOnce(&g_phase_ns[static_cast<size_t>(AFNSStartupPhase::kLibraryLoaded)], now);
+    MarkOnce(&g_phase_ns[index], now);
+}
+
+int64_t AFNSStartupPhaseMicros(AFNSStartupPhase phase) {
+    const size_t index = static_cast<size_t>(phase);
+    if (index >= kPhaseCount) {
+        return -1;
+    }
+    const int64_t origin =
+        g_phase_ns[static_cast<size_t>(AFNSStartupPhase::kLibraryLoaded)].load(std::memory_order_relaxed);
+    const int64_t reached = g_phase_ns[index].load(std::memory_order_relaxed);
+    if (origin == 0 || reached == 0) {
+        return -1;
+    }
+    return (reached - origin) / 1000;
+}
+
+const char* AFNSStartupPhaseName(AFNSStartupPhase phase) {
+    const size_t index = static_cast<size_t>(phase);
+    return index < kPhaseCount ? kPhaseNames[index] : "unknown";
+}
+
+} // namespace afns
+
+} // namespace flutter
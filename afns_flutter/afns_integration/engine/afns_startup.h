@@ -0,0 +1,42 @@
+// 🚀 AFNS STARTUP PHASES
+// Timestamps of each initialization stage, cheap enough to record under loader locks
+
+#ifndef FLUTTER_AFNS_AFNS_STARTUP_H_
+#define FLUTTER_AFNS_AFNS_STARTUP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace flutter {
+
+namespace afns {
+
+// In the order a normal startup reaches them; values match AFNS_STARTUP_*
+enum class AFNSStartupPhase : uint8_t {
+    kLibraryLoaded = 0,    // platform load hook ran (JNI_OnLoad, DllMain, ...)
+    kEngineCreateBegin,    // first call that needed the engine
+    kEngineCreated,        // caches, identifiers and initial state ready
+    kCompilerResolved,     // Rust front end looked up (or found missing)
+    kPrewarmBegin,         // background prewarm picked up by a worker
+    kPrewarmDone,
+    kCount,
+};
+
+// 🎯 AFNS STARTUP CLOCK
+// Records the first time each phase is reached. Marking is a clock read and
+// an atomic compare-exchange: no allocation, no locks, no threads, so it is
+// safe inside DllMain. The first mark of any phase also stands in for
+// kLibraryLoaded on hosts without a load hook.
+void MarkAFNSStartupPhase(AFNSStartupPhase phase);
+
+// Microseconds from kLibraryLoaded to |phase|, or -1 if not reached yet
+int64_t AFNSStartupPhaseMicros(AFNSStartupPhase phase);
+
+// "library_loaded", "engine_create_begin", ...
+const char* AFNSStartupPhaseName(AFNSStartupPhase phase);
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_STARTUP_H_
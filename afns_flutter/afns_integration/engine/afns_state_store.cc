@@ -0,0 +1,180 @@
+// 🚀 AFNS KEYED STATE
+// Typed values by state path, with reads recorded for dependency tracking
+
+#include "afns_state_store.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+// Innermost open scope of this thread
+thread_local AFNSStateReadScope* t_read_scope = nullptr;
+
+} // anonymous namespace
+
+AFNSStateValue AFNSStateValue::Bool(bool boolean) {
+    AFNSStateValue value;
+    value.type = AFNSValueType::kBool;
+    value.boolean = boolean;
+    return value;
+}
+
+AFNSStateValue AFNSStateValue::Int(int64_t integer) {
+    AFNSStateValue value;
+    value.type = AFNSValueType::kInt;
+    value.integer = integer;
+    return value;
+}
+
+AFNSStateValue AFNSStateValue::Float(double number) {
+    AFNSStateValue value;
+    value.type = AFNSValueType::kFloat;
+    value.number = number;
+    return value;
+}
+
+AFNSStateValue AFNSStateValue::String(std::string_view text) {
+    AFNSStateValue value;
+    value.type = AFNSValueType::kString;
+    value.text.assign(text.data(), text.size());
+    return value;
+}
+
+bool AFNSStateValue::operator==(const AFNSStateValue& other) const {
+    if (type != other.type) {
+        return false;
+    }
+    switch (type) {
+    case AFNSValueType::kNone: return true;
+    case AFNSValueType::kBool: return boolean == other.boolean;
+    case AFNSValueType::kInt: return integer == other.integer;
+    case AFNSValueType::kFloat: return number == other.number;
+    case AFNSValueType::kString: return text == other.text;
+    }
+    return false;
+}
+
+AFNSStateReadScope::AFNSStateReadScope() : parent_(t_read_scope) {
+    t_read_scope = this;
+}
+
+AFNSStateReadScope::~AFNSStateReadScope() {
+    t_read_scope = parent_;
+}
+
+std::vector<std::string> AFNSStateReadScope::TakePaths() {
+    std::sort(paths_.begin(), paths_.end());
+    paths_.erase(std::unique(paths_.begin(), paths_.end()), paths_.end());
+    return std::move(paths_);
+}
+
+void AFNSStateReadScope::Record(std::string_view path) {
+    for (AFNSStateReadScope* scope = t_read_scope; scope != nullptr; scope = scope->parent_) {
+        scope->paths_.emplace_back(path);
+    }
+}
+
+bool AFNSStateStore::Set(std::string_view path, AFNSStateValue value) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = values_.find(path);
+    if (it != values_.end()) {
+        if (it->second == value) {
+            return false;
+        }
+        it->second = std::move(value);
+    } else {
+        values_.emplace(std::string(path), std::move(value));
+    }
+    changes_.emplace(path);
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool AFNSStateStore::Remove(std::string_view path) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = values_.find(path);
+    if (it == values_.end()) {
+        return false;
+    }
+    values_.erase(it);
+    changes_.emplace(path);
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool AFNSStateStore::Get(std::string_view path, AFNSStateValue* value) const {
+    AFNSStateReadScope::Record(path);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = values_.find(path);
+    if (it == values_.end()) {
+        return false;
+    }
+    *value = it->second;
+    return true;
+}
+
+std::vector<std::string> AFNSStateStore::TakeChanges() {
+    std::set<std::string, std::less<>> changes;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        changes.swap(changes_);
+    }
+    return std::vector<std::string>(std::make_move_iterator(changes.begin()),
+                                    std::make_move_iterator(changes.end()));
+}
+
+size_t AFNSStateStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return values_.size();
+}
+
+void AFNSStateDependencies::Set(uint64_t binding, std::vector<std::string> paths) {
+    Remove(binding);
+    if (paths.empty()) {
+        return;
+    }
+    for (const std::string& path : paths) {
+        dependents_[path].insert(binding);
+    }
+    paths_.emplace(binding, std::move(paths));
+}
+
+void AFNSStateDependencies::Remove(uint64_t binding) {
+    auto it = paths_.find(binding);
+    if (it == paths_.end()) {
+        return;
+    }
+    for (const std::string& path : it->second) {
+        auto dependents = dependents_.find(path);
+        if (dependents != dependents_.end()) {
+            dependents->second.erase(binding);
+            if (dependents->second.empty()) {
+                dependents_.erase(dependents);
+            }
+        }
+    }
+    paths_.erase(it);
+}
+
+std::vector<uint64_t> AFNSStateDependencies::Dependents(const std::vector<std::string>& paths) const {
+    std::vector<uint64_t> bindings;
+    for (const std::string& path : paths) {
+        auto it = dependents_.find(path);
+        if (it != dependents_.end()) {
+            bindings.insert(bindings.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(bindings.begin(), bindings.end());
+    bindings.erase(std::unique(bindings.begin(), bindings.end()), bindings.end());
+    return bindings;
+}
+
+} // namespace afns
+
+} // namespace flutter
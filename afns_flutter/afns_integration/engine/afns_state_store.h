@@ -0,0 +1,120 @@
+// 🚀 AFNS KEYED STATE
+// Typed values by state path, with reads recorded for dependency tracking
+
+#ifndef FLUTTER_AFNS_AFNS_STATE_STORE_H_
+#define FLUTTER_AFNS_AFNS_STATE_STORE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "afns_bytecode.h"
+
+namespace flutter {
+
+namespace afns {
+
+// One state value; kNone only for paths that are not set
+struct AFNSStateValue {
+    AFNSValueType type = AFNSValueType::kNone;
+    bool boolean = false;
+    int64_t integer = 0;
+    double number = 0;
+    std::string text;
+
+    static AFNSStateValue Bool(bool boolean);
+    static AFNSStateValue Int(int64_t integer);
+    static AFNSStateValue Float(double number);
+    static AFNSStateValue String(std::string_view text);
+
+    bool operator==(const AFNSStateValue& other) const;
+    bool operator!=(const AFNSStateValue& other) const { return !(*this == other); }
+};
+
+// 🎯 AFNS STATE READ SCOPE
+// While alive, collects every path AFNSStateStore::Get reads on this
+// thread, set or not, so a compile or a logic run learns what it depends
+// on without declaring it. Scopes nest; a read counts for every open scope
+// of the thread.
+class AFNSStateReadScope {
+public:
+    AFNSStateReadScope();
+    ~AFNSStateReadScope();
+
+    AFNSStateReadScope(const AFNSStateReadScope&) = delete;
+    AFNSStateReadScope& operator=(const AFNSStateReadScope&) = delete;
+
+    bool empty() const { return paths_.empty(); }
+
+    // Sorted, each path once
+    std::vector<std::string> TakePaths();
+
+    // Adds |path| to the open scopes of this thread, if any
+    static void Record(std::string_view path);
+
+private:
+    AFNSStateReadScope* const parent_;
+    std::vector<std::string> paths_;
+};
+
+// 🎯 AFNS STATE STORE
+// Values are visible to readers as soon as they are set; changes are only
+// reported, coalesced, by TakeChanges(), which the engine calls once per
+// frame. Setting a path to the value it already has is not a change.
+// Readers share a lock, writers take it briefly.
+class AFNSStateStore {
+public:
+    // False if nothing changed
+    bool Set(std::string_view path, AFNSStateValue value);
+    bool Remove(std::string_view path);
+
+    // Records |path| in the thread's read scopes either way
+    bool Get(std::string_view path, AFNSStateValue* value) const;
+
+    // Paths set or removed since the last call, sorted, each once
+    std::vector<std::string> TakeChanges();
+
+    size_t size() const;
+
+    // Bumped by every Set or Remove that changed something
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::atomic<uint64_t> version_{0};
+    std::map<std::string, AFNSStateValue, std::less<>> values_;
+    std::set<std::string, std::less<>> changes_;
+};
+
+// 🎯 AFNS STATE DEPENDENCIES
+// Which bindings (compiled widgets or logic blocks, by id) read which
+// paths, as of their latest run. Not thread-safe; the engine guards it.
+class AFNSStateDependencies {
+public:
+    // Replaces what |binding| depends on
+    void Set(uint64_t binding, std::vector<std::string> paths);
+    void Remove(uint64_t binding);
+
+    // Bindings that read any of |paths|, each once, in ascending order
+    std::vector<uint64_t> Dependents(const std::vector<std::string>& paths) const;
+
+    size_t path_count() const { return dependents_.size(); }
+
+private:
+    std::unordered_map<uint64_t, std::vector<std::string>> paths_;
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> dependents_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_STATE_STORE_H_
@@ -0,0 +1,247 @@
+// 🚀 AFNS LOGIC TIERING
+// Hotness counting, optimized re-compilation and deoptimization of logic functions
+
+#include "afns_tiering.h"
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+std::atomic<bool> g_tiering_enabled{true};
+std::atomic<uint64_t> g_tier_ups{0};
+std::atomic<uint64_t> g_deoptimizations{0};
+
+bool IsBranch(AFNSOpcode op) {
+    return op == AFNSOpcode::kJump || op == AFNSOpcode::kLoop ||
+           op == AFNSOpcode::kJumpIfFalse || op == AFNSOpcode::kJumpIfTrue;
+}
+
+bool IsIntConstant(const std::vector<AFNSValue>& constants, const AFNSInstruction& instruction) {
+    return instruction.op == AFNSOpcode::kLoadConst &&
+           constants[instruction.bx()].type == AFNSValueType::kInt;
+}
+
+AFNSOpcode ArithmeticIntConstOp(AFNSOpcode op) {
+    switch (op) {
+    case AFNSOpcode::kAdd: return AFNSOpcode::kAddIntConst;
+    case AFNSOpcode::kSubtract: return AFNSOpcode::kSubtractIntConst;
+    case AFNSOpcode::kMultiply: return AFNSOpcode::kMultiplyIntConst;
+    default: return AFNSOpcode::kCount;
+    }
+}
+
+AFNSOpcode CompareIntBranchOp(AFNSOpcode op) {
+    switch (op) {
+    case AFNSOpcode::kLess: return AFNSOpcode::kLessIntBranch;
+    case AFNSOpcode::kLessEqual: return AFNSOpcode::kLessEqualIntBranch;
+    case AFNSOpcode::kGreater: return AFNSOpcode::kGreaterIntBranch;
+    case AFNSOpcode::kGreaterEqual: return AFNSOpcode::kGreaterEqualIntBranch;
+    case AFNSOpcode::kEqual: return AFNSOpcode::kEqualIntBranch;
+    case AFNSOpcode::kNotEqual: return AFNSOpcode::kNotEqualIntBranch;
+    default: return AFNSOpcode::kCount;
+    }
+}
+
+AFNSOpcode CompareIntConstBranchOp(AFNSOpcode op) {
+    switch (op) {
+    case AFNSOpcode::kLess: return AFNSOpcode::kLessIntConstBranch;
+    case AFNSOpcode::kLessEqual: return AFNSOpcode::kLessEqualIntConstBranch;
+    case AFNSOpcode::kGreater: return AFNSOpcode::kGreaterIntConstBranch;
+    case AFNSOpcode::kGreaterEqual: return AFNSOpcode::kGreaterEqualIntConstBranch;
+    case AFNSOpcode::kEqual: return AFNSOpcode::kEqualIntConstBranch;
+    case AFNSOpcode::kNotEqual: return AFNSOpcode::kNotEqualIntConstBranch;
+    default: return AFNSOpcode::kCount;
+    }
+}
+
+// K < x is x > K
+AFNSOpcode MirrorCompare(AFNSOpcode op) {
+    switch (op) {
+    case AFNSOpcode::kLess: return AFNSOpcode::kGreater;
+    case AFNSOpcode::kLessEqual: return AFNSOpcode::kGreaterEqual;
+    case AFNSOpcode::kGreater: return AFNSOpcode::kLess;
+    case AFNSOpcode::kGreaterEqual: return AFNSOpcode::kLessEqual;
+    default: return op;
+    }
+}
+
+AFNSInstruction Data(uint8_t a, uint8_t b, uint8_t c) {
+    return AFNSInstruction{AFNSOpcode::kTierData, a, b, c};
+}
+
+} // anonymous namespace
+
+void SetAFNSTieringEnabled(bool enabled) {
+#if defined(AFNS_DISABLE_LOGIC_TIERING)
+    (void)enabled;
+#else
+    g_tiering_enabled.store(enabled, std::memory_order_relaxed);
+#endif
+}
+
+bool AFNSTieringEnabled() {
+#if defined(AFNS_DISABLE_LOGIC_TIERING)
+    return false;
+#else
+    return g_tiering_enabled.load(std::memory_order_relaxed);
+#endif
+}
+
+AFNSTieringStats GetAFNSTieringStats() {
+    AFNSTieringStats stats;
+    stats.tier_ups = g_tier_ups.load(std::memory_order_relaxed);
+    stats.deoptimizations = g_deoptimizations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::vector<AFNSInstruction> OptimizeAFNSFunction(const AFNSBytecodeFunction& function,
+                                                  const std::vector<AFNSValue>& constants,
+                                                  const std::vector<bool>& failed_sites,
+                                                  size_t* fused) {
+    const std::vector<AFNSInstruction>& code = function.code;
+    std::vector<AFNSInstruction> optimized = code;
+    *fused = 0;
+
+    // A fused sequence must be entered at its first instruction only
+    std::vector<bool> targets(code.size() + 1, false);
+    for (const AFNSInstruction& instruction : code) {
+        if (IsBranch(instruction.op)) {
+            targets[instruction.bx()] = true;
+        }
+    }
+    auto fusable = [&](size_t pc, size_t length) {
+        if (pc + length > code.size() || failed_sites[pc]) {
+            return false;
+        }
+        for (size_t next = pc + 1; next < pc + length; ++next) {
+            if (targets[next]) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    size_t pc = 0;
+    while (pc < code.size()) {
+        const AFNSInstruction& first = code[pc];
+
+        // LoadConst t, K; cmp u, x, t; JumpIfFalse u, L
+        if (fusable(pc, 3) && IsIntConstant(constants, first)) {
+            const AFNSInstruction& compare = code[pc + 1];
+            const AFNSInstruction& branch = code[pc + 2];
+            AFNSOpcode op = compare.op;
+            uint8_t other = compare.b;
+            if (compare.b == first.a) {
+                op = MirrorCompare(op);
+                other = compare.c;
+            }
+            const AFNSOpcode fused_op = CompareIntConstBranchOp(op);
+            if (fused_op != AFNSOpcode::kCount && other != first.a &&
+                (compare.b == first.a || compare.c == first.a) &&
+                branch.op == AFNSOpcode::kJumpIfFalse && branch.a == compare.a) {
+                optimized[pc] = AFNSInstruction{fused_op, first.a, first.b, first.c};
+                optimized[pc + 1] = Data(compare.a, other, 0);
+                optimized[pc + 2] = Data(0, branch.b, branch.c);
+                ++*fused;
+                pc += 3;
+                continue;
+            }
+        }
+
+        // LoadConst t, K; op d, x, t
+        if (fusable(pc, 2) && IsIntConstant(constants, first)) {
+            const AFNSInstruction& arithmetic = code[pc + 1];
+            const AFNSOpcode fused_op = ArithmeticIntConstOp(arithmetic.op);
+            const bool commutative = arithmetic.op != AFNSOpcode::kSubtract;
+            uint8_t other = first.a;
+            if (arithmetic.c == first.a) {
+                other = arithmetic.b;
+            } else if (arithmetic.b == first.a && commutative) {
+                other = arithmetic.c;
+            }
+            if (fused_op != AFNSOpcode::kCount && other != first.a) {
+                optimized[pc] = AFNSInstruction{fused_op, first.a, first.b, first.c};
+                optimized[pc + 1] = Data(arithmetic.a, other, 0);
+                ++*fused;
+                pc += 2;
+                continue;
+            }
+        }
+
+        // cmp u, x, y; JumpIfFalse u, L
+        if (fusable(pc, 2)) {
+            const AFNSInstruction& branch = code[pc + 1];
+            const AFNSOpcode fused_op = CompareIntBranchOp(first.op);
+            if (fused_op != AFNSOpcode::kCount && branch.op == AFNSOpcode::kJumpIfFalse &&
+                branch.a == first.a) {
+                optimized[pc] = AFNSInstruction{fused_op, first.a, first.b, first.c};
+                optimized[pc + 1] = Data(0, branch.b, branch.c);
+                ++*fused;
+                pc += 2;
+                continue;
+            }
+        }
+
+        ++pc;
+    }
+    return optimized;
+}
+
+AFNSTierState::AFNSTierState(const AFNSBytecodeProgram& program)
+    : program_(program),
+      functions_(new FunctionTier[program.functions().size()]) {
+    for (size_t function = 0; function < program.functions().size(); ++function) {
+        functions_[function].active.store(BaselineCode(function), std::memory_order_relaxed);
+        functions_[function].failed_sites.assign(program.functions()[function].code.size(), false);
+    }
+}
+
+void AFNSTierState::RecordHotness(size_t function, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    const uint64_t before =
+        functions_[function].hotness.fetch_add(count, std::memory_order_relaxed);
+    if (before < kAFNSTierUpThreshold && before + count >= kAFNSTierUpThreshold) {
+        TierUp(function);
+    }
+}
+
+void AFNSTierState::TierUp(size_t function) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FunctionTier& tier = functions_[function];
+    if (IsOptimized(function) || tier.optimizations >= kAFNSMaxOptimizations) {
+        return;
+    }
+    ++tier.optimizations;
+
+    size_t fused = 0;
+    auto code = std::make_unique<const std::vector<AFNSInstruction>>(OptimizeAFNSFunction(
+        program_.functions()[function], program_.constants(), tier.failed_sites, &fused));
+    if (fused == 0) {
+        // Nothing to specialize; do not try again
+        tier.optimizations = kAFNSMaxOptimizations;
+        return;
+    }
+    tier.active.store(code->data(), std::memory_order_release);
+    versions_.push_back(std::move(code));
+    g_tier_ups.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AFNSTierState::Deoptimize(size_t function, size_t pc) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FunctionTier& tier = functions_[function];
+    tier.failed_sites[pc] = true;
+    if (!IsOptimized(function)) {
+        return;
+    }
+    tier.active.store(BaselineCode(function), std::memory_order_release);
+    tier.hotness.store(0, std::memory_order_relaxed);
+    g_deoptimizations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,104 @@
+// 🚀 AFNS LOGIC TIERING
+// Hotness counting, optimized re-compilation and deoptimization of logic functions
+
+#ifndef FLUTTER_AFNS_AFNS_TIERING_H_
+#define FLUTTER_AFNS_AFNS_TIERING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "afns_bytecode.h"
+
+namespace flutter {
+
+namespace afns {
+
+// Calls plus loop back-edges a function takes before it is re-compiled
+constexpr uint32_t kAFNSTierUpThreshold = 1000;
+
+// Optimized versions one function may get; after that many deopts it stays
+// on baseline code for the life of the program
+constexpr uint32_t kAFNSMaxOptimizations = 4;
+
+struct AFNSTieringStats {
+    uint64_t tier_ups = 0;
+    uint64_t deoptimizations = 0;
+};
+
+// Process-wide switch, on by default. AFNS_DISABLE_LOGIC_TIERING builds
+// keep every function on baseline code and ignore SetAFNSTieringEnabled.
+void SetAFNSTieringEnabled(bool enabled);
+bool AFNSTieringEnabled();
+
+// Totals over every program since startup
+AFNSTieringStats GetAFNSTieringStats();
+
+// Optimized copy of |function|: same length and pc numbering, with integer
+// superinstructions fused over the sequences they replace. Sequences
+// starting at a pc in |failed_sites| and sequences a jump lands inside are
+// left alone. Sets *fused to how many sequences were replaced.
+std::vector<AFNSInstruction> OptimizeAFNSFunction(const AFNSBytecodeFunction& function,
+                                                  const std::vector<AFNSValue>& constants,
+                                                  const std::vector<bool>& failed_sites,
+                                                  size_t* fused);
+
+// 🎯 AFNS TIER STATE
+// Per-program tier bookkeeping. The VM enters every function through
+// Code(); RecordHotness() swaps in optimized code once a function is hot and
+// Deoptimize() swaps the baseline back when a guard fails. Every optimized
+// version stays allocated until the program goes away, so a run still
+// inside one never sees its code freed.
+class AFNSTierState {
+public:
+    explicit AFNSTierState(const AFNSBytecodeProgram& program);
+
+    AFNSTierState(const AFNSTierState&) = delete;
+    AFNSTierState& operator=(const AFNSTierState&) = delete;
+
+    const AFNSInstruction* Code(size_t function) const {
+        return functions_[function].active.load(std::memory_order_acquire);
+    }
+    const AFNSInstruction* BaselineCode(size_t function) const {
+        return program_.functions()[function].code.data();
+    }
+
+    // Adds |count| calls/back-edges; tiers the function up on crossing
+    // kAFNSTierUpThreshold
+    void RecordHotness(size_t function, uint32_t count);
+
+    // A guard at |pc| failed: back to baseline, and the next optimized
+    // version leaves that site generic
+    void Deoptimize(size_t function, size_t pc);
+
+    bool IsOptimized(size_t function) const {
+        return Code(function) != BaselineCode(function);
+    }
+
+private:
+    struct FunctionTier {
+        std::atomic<const AFNSInstruction*> active{nullptr};
+        std::atomic<uint32_t> hotness{0};
+
+        // Guarded by mutex_
+        uint32_t optimizations = 0;
+        std::vector<bool> failed_sites;
+    };
+
+    void TierUp(size_t function);
+
+    const AFNSBytecodeProgram& program_;
+    std::unique_ptr<FunctionTier[]> functions_;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<const std::vector<AFNSInstruction>>> versions_;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_TIERING_H_
@@ -0,0 +1,362 @@
+// 🚀 AFNS ENGINE TRACING
+// Scoped spans in per-thread rings, dumped as Chrome trace JSON or Perfetto
+
+#include "afns_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+// Spans that began before the latest start are not dumped
+std::atomic<uint64_t> g_session_start_ns{0};
+
+thread_local uint64_t t_flow_id = 0;
+
+// One recorded span. |sequence| is its ring index + 1 once complete and 0
+// while it is written, so a reader can tell a torn slot from a whole one.
+struct TraceSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> end_ns{0};
+    std::atomic<uint64_t> flow_id{0};
+    std::atomic<uint64_t> thread_id{0};
+};
+
+// One per thread, written only by it; blocks are never freed, only reused
+struct alignas(64) ThreadTrace {
+    TraceSlot slots[kAFNSTraceEventsPerThread];
+    std::atomic<uint64_t> head{0};  // spans ever recorded here
+    uint64_t thread_id = 0;         // of the current owner, read only by it
+    std::atomic<bool> in_use{true};
+    ThreadTrace* next = nullptr;    // set once, before the block is published
+};
+
+std::atomic<ThreadTrace*> g_thread_traces{nullptr};
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t ProcessId() {
+#if defined(_WIN32)
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+// The OS id where there is one, so the spans line up with other tools' traces
+uint64_t OsThreadId() {
+#if defined(_WIN32)
+    return GetCurrentThreadId();
+#elif defined(__linux__)
+    return static_cast<uint64_t>(syscall(SYS_gettid));
+#elif defined(__APPLE__)
+    uint64_t id = 0;
+    pthread_threadid_np(nullptr, &id);
+    return id;
+#else
+    return std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+ThreadTrace* ClaimThreadTrace() {
+    ThreadTrace* claimed = nullptr;
+    for (ThreadTrace* block = g_thread_traces.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        bool in_use = false;
+        if (!block->in_use.load(std::memory_order_relaxed) &&
+            block->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+            claimed = block;
+            break;
+        }
+    }
+    if (claimed == nullptr) {
+        claimed = new ThreadTrace();
+        claimed->next = g_thread_traces.load(std::memory_order_relaxed);
+        while (!g_thread_traces.compare_exchange_weak(claimed->next, claimed, std::memory_order_release,
+                                                      std::memory_order_relaxed)) {
+        }
+    }
+    claimed->thread_id = OsThreadId();
+    return claimed;
+}
+
+struct ThreadTraceHolder {
+    ThreadTrace* const block = ClaimThreadTrace();
+
+    ~ThreadTraceHolder() {
+        block->in_use.store(false, std::memory_order_release);
+    }
+};
+
+ThreadTrace* CurrentThreadTrace() {
+    thread_local ThreadTraceHolder holder;
+    return holder.block;
+}
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t flow_id;
+    uint64_t thread_id;
+};
+
+std::vector<TraceEvent> CollectEvents() {
+    const uint64_t session_start = g_session_start_ns.load(std::memory_order_acquire);
+    std::vector<TraceEvent> events;
+    for (const ThreadTrace* block = g_thread_traces.load(std::memory_order_acquire); block != nullptr;
+         block = block->next) {
+        const uint64_t head = block->head.load(std::memory_order_acquire);
+        const uint64_t first = head > kAFNSTraceEventsPerThread ? head - kAFNSTraceEventsPerThread : 0;
+        for (uint64_t i = first; i < head; ++i) {
+            const TraceSlot& slot = block->slots[i % kAFNSTraceEventsPerThread];
+            if (slot.sequence.load(std::memory_order_acquire) != i + 1) {
+                continue;
+            }
+            TraceEvent event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+            event.flow_id = slot.flow_id.load(std::memory_order_relaxed);
+            event.thread_id = slot.thread_id.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != i + 1 || event.start_ns < session_start) {
+                continue;
+            }
+            events.push_back(event);
+        }
+    }
+    return events;
+}
+
+void AppendMicros(uint64_t ns, std::string* out) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%llu.%03u", static_cast<unsigned long long>(ns / 1000),
+                  static_cast<unsigned>(ns % 1000));
+    *out += number;
+}
+
+// Complete ("X") events in µs; flows use the bind_id form, which both the
+// Chrome and the Perfetto viewers read
+std::string ChromeJson(const std::vector<TraceEvent>& events) {
+    const std::string pid = std::to_string(ProcessId());
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const TraceEvent& event : events) {
+        if (!first) {
+            json += ',';
+        }
+        first = false;
+        json += "{\"name\":\"";
+        json += event.name;
+        json += "\",\"cat\":\"afns\",\"ph\":\"X\",\"pid\":";
+        json += pid;
+        json += ",\"tid\":";
+        json += std::to_string(event.thread_id);
+        json += ",\"ts\":";
+        AppendMicros(event.start_ns, &json);
+        json += ",\"dur\":";
+        AppendMicros(event.end_ns - event.start_ns, &json);
+        if (event.flow_id != 0) {
+            json += ",\"bind_id\":\"0x";
+            char id[20];
+            std::snprintf(id, sizeof(id), "%llx", static_cast<unsigned long long>(event.flow_id));
+            json += id;
+            json += "\",\"flow_in\":true,\"flow_out\":true";
+        }
+        json += '}';
+    }
+    json += "]}";
+    return json;
+}
+
+// Protobuf wire format, just what perfetto.protos.Trace needs
+void AppendVarint(uint64_t value, std::string* out) {
+    while (value >= 0x80) {
+        *out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    *out += static_cast<char>(value);
+}
+
+void AppendVarintField(uint32_t field, uint64_t value, std::string* out) {
+    AppendVarint(uint64_t{field} << 3, out);
+    AppendVarint(value, out);
+}
+
+void AppendFixed64Field(uint32_t field, uint64_t value, std::string* out) {
+    AppendVarint((uint64_t{field} << 3) | 1, out);
+    for (int i = 0; i < 8; ++i) {
+        *out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+void AppendBytesField(uint32_t field, const std::string& bytes, std::string* out) {
+    AppendVarint((uint64_t{field} << 3) | 2, out);
+    AppendVarint(bytes.size(), out);
+    *out += bytes;
+}
+
+// Field numbers from perfetto/protos/perfetto/trace
+constexpr uint32_t kTracePacket = 1;
+constexpr uint32_t kPacketTimestamp = 8;
+constexpr uint32_t kPacketSequenceId = 10;
+constexpr uint32_t kPacketTrackEvent = 11;
+constexpr uint32_t kPacketClockId = 58;
+constexpr uint32_t kPacketTrackDescriptor = 60;
+constexpr uint32_t kEventType = 9;
+constexpr uint32_t kEventTrackUuid = 11;
+constexpr uint32_t kEventName = 23;
+constexpr uint32_t kEventFlowIds = 47;
+constexpr uint32_t kTrackUuid = 1;
+constexpr uint32_t kTrackThread = 4;
+constexpr uint32_t kThreadPid = 1;
+constexpr uint32_t kThreadTid = 2;
+constexpr uint32_t kThreadName = 5;
+
+constexpr uint64_t kSliceBegin = 1;
+constexpr uint64_t kSliceEnd = 2;
+constexpr uint64_t kClockMonotonic = 3;  // what steady_clock reads
+constexpr uint64_t kSequenceId = 1;
+
+uint64_t TrackUuid(uint64_t thread_id) {
+    return 0xaf45000000000000ull ^ thread_id;
+}
+
+void AppendPacket(const std::string& packet, std::string* trace) {
+    AppendBytesField(kTracePacket, packet, trace);
+}
+
+// A track per thread, then a begin and an end packet per span
+std::string PerfettoTrace(const std::vector<TraceEvent>& events) {
+    const uint64_t pid = ProcessId();
+    std::string trace;
+    std::vector<uint64_t> threads;
+    for (const TraceEvent& event : events) {
+        bool known = false;
+        for (uint64_t thread : threads) {
+            known = known || thread == event.thread_id;
+        }
+        if (known) {
+            continue;
+        }
+        threads.push_back(event.thread_id);
+        std::string thread;
+        AppendVarintField(kThreadPid, pid, &thread);
+        AppendVarintField(kThreadTid, event.thread_id, &thread);
+        AppendBytesField(kThreadName, "afns-" + std::to_string(event.thread_id), &thread);
+        std::string track;
+        AppendVarintField(kTrackUuid, TrackUuid(event.thread_id), &track);
+        AppendBytesField(kTrackThread, thread, &track);
+        std::string packet;
+        AppendVarintField(kPacketSequenceId, kSequenceId, &packet);
+        AppendBytesField(kPacketTrackDescriptor, track, &packet);
+        AppendPacket(packet, &trace);
+    }
+
+    for (const TraceEvent& event : events) {
+        for (const bool begin : {true, false}) {
+            std::string track_event;
+            AppendVarintField(kEventType, begin ? kSliceBegin : kSliceEnd, &track_event);
+            AppendVarintField(kEventTrackUuid, TrackUuid(event.thread_id), &track_event);
+            if (begin) {
+                AppendBytesField(kEventName, event.name, &track_event);
+                if (event.flow_id != 0) {
+                    AppendFixed64Field(kEventFlowIds, event.flow_id, &track_event);
+                }
+            }
+            std::string packet;
+            AppendVarintField(kPacketTimestamp, begin ? event.start_ns : event.end_ns, &packet);
+            AppendVarintField(kPacketClockId, kClockMonotonic, &packet);
+            AppendVarintField(kPacketSequenceId, kSequenceId, &packet);
+            AppendBytesField(kPacketTrackEvent, track_event, &packet);
+            AppendPacket(packet, &trace);
+        }
+    }
+    return trace;
+}
+
+} // anonymous namespace
+
+std::atomic<bool> g_afns_tracing{false};
+
+void StartAFNSTracing() {
+    g_session_start_ns.store(NowNs(), std::memory_order_release);
+    g_afns_tracing.store(true, std::memory_order_release);
+}
+
+void StopAFNSTracing() {
+    g_afns_tracing.store(false, std::memory_order_release);
+}
+
+std::string DumpAFNSTrace(AFNSTraceFormat format) {
+    const std::vector<TraceEvent> events = CollectEvents();
+    return format == AFNSTraceFormat::kPerfetto ? PerfettoTrace(events) : ChromeJson(events);
+}
+
+uint64_t AFNSTraceStamp() {
+    return AFNSTracingEnabled() ? NowNs() : 0;
+}
+
+void RecordAFNSTraceSpanSince(const char* name, uint64_t start_ns) {
+    if (start_ns == 0 || !AFNSTracingEnabled()) {
+        return;
+    }
+    const uint64_t end_ns = NowNs();
+    ThreadTrace* block = CurrentThreadTrace();
+    const uint64_t index = block->head.load(std::memory_order_relaxed);
+    TraceSlot& slot = block->slots[index % kAFNSTraceEventsPerThread];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.flow_id.store(t_flow_id, std::memory_order_relaxed);
+    slot.thread_id.store(block->thread_id, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+    block->head.store(index + 1, std::memory_order_release);
+}
+
+uint64_t CurrentAFNSTraceFlow() {
+    return t_flow_id;
+}
+
+AFNSTraceFlowScope::AFNSTraceFlowScope(uint64_t flow_id) : previous_(t_flow_id) {
+    t_flow_id = flow_id;
+}
+
+AFNSTraceFlowScope::~AFNSTraceFlowScope() {
+    t_flow_id = previous_;
+}
+
+void SetAFNSTraceFlow(uint64_t flow_id) {
+    t_flow_id = flow_id;
+}
+
+} // namespace afns
+
+} // namespace flutter
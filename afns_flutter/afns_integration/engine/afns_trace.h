@@ -0,0 +1,99 @@
+// 🚀 AFNS ENGINE TRACING
+// Scoped spans in per-thread rings, dumped as Chrome trace JSON or Perfetto
+
+#ifndef FLUTTER_AFNS_AFNS_TRACE_H_
+#define FLUTTER_AFNS_AFNS_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace flutter {
+
+namespace afns {
+
+// Spans each thread keeps; older ones are overwritten
+constexpr size_t kAFNSTraceEventsPerThread = 4096;
+
+enum class AFNSTraceFormat : uint8_t {
+    kChromeJson,  // {"traceEvents": [...]}, opens in chrome://tracing and Perfetto
+    kPerfetto,    // perfetto.protos.Trace, binary
+};
+
+// Tracing is off until StartAFNSTracing and can be switched at any time;
+// while off a span costs one relaxed load. Each thread records into its own
+// ring, allocated on its first span after tracing was first started and
+// reused by a later thread once it exits, so recording never locks and
+// never allocates after that. Span names must be string literals.
+void StartAFNSTracing();
+void StopAFNSTracing();
+
+// Read through AFNSTracingEnabled, inline so a span costs no call while off
+extern std::atomic<bool> g_afns_tracing;
+
+inline bool AFNSTracingEnabled() {
+    return g_afns_tracing.load(std::memory_order_relaxed);
+}
+
+// Spans recorded since the latest StartAFNSTracing, from every thread.
+// Safe to call while spans are being recorded; a span overwritten during
+// the dump is left out.
+std::string DumpAFNSTrace(AFNSTraceFormat format);
+
+// Steady clock in ns when tracing, 0 when not
+uint64_t AFNSTraceStamp();
+
+// Records [|start_ns|, now) under |name|, unless |start_ns| is 0; for spans
+// that begin on another thread, like time spent queued for a worker
+void RecordAFNSTraceSpanSince(const char* name, uint64_t start_ns);
+
+// Flow id of this thread's spans, 0 for none
+uint64_t CurrentAFNSTraceFlow();
+
+// 🎯 AFNS TRACE SPAN
+// Records its own lifetime, if tracing was on when it began
+class AFNSTraceSpan {
+public:
+    explicit AFNSTraceSpan(const char* name)
+        : name_(name), start_ns_(AFNSTracingEnabled() ? AFNSTraceStamp() : 0) {}
+
+    ~AFNSTraceSpan() {
+        if (start_ns_ != 0) {
+            RecordAFNSTraceSpanSince(name_, start_ns_);
+        }
+    }
+
+    AFNSTraceSpan(const AFNSTraceSpan&) = delete;
+    AFNSTraceSpan& operator=(const AFNSTraceSpan&) = delete;
+
+private:
+    const char* const name_;
+    const uint64_t start_ns_;
+};
+
+// 🎯 AFNS TRACE FLOW SCOPE
+// Attaches |flow_id| to the spans this thread records while alive, so the
+// trace viewer links them to the caller's events with the same id, such as
+// a dart:developer Flow. Work handed to a worker carries the id along.
+class AFNSTraceFlowScope {
+public:
+    explicit AFNSTraceFlowScope(uint64_t flow_id);
+    ~AFNSTraceFlowScope();
+
+    AFNSTraceFlowScope(const AFNSTraceFlowScope&) = delete;
+    AFNSTraceFlowScope& operator=(const AFNSTraceFlowScope&) = delete;
+
+private:
+    const uint64_t previous_;
+};
+
+// Sets the flow id of this thread's spans until changed, 0 to clear; for
+// callers that cannot hold a scope, like the C ABI
+void SetAFNSTraceFlow(uint64_t flow_id);
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_TRACE_H_
@@ -0,0 +1,243 @@
+// 🚀 AFNS UTF-8 / UTF-16 TRANSCODING
+// Conversions between the engine's UTF-8 and the UTF-16 of Java and Dart
+// strings
+
+#include "afns_utf.h"
+
+#include <cstdint>
+
+#include "afns_simd.h"
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr char16_t kReplacementCharacter = 0xFFFD;
+
+inline bool IsContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+#if defined(AFNS_SIMD)
+// Code units / bytes per vector step of both directions
+constexpr size_t kBlock = simd::kChunk;
+
+// Writes kBlock code units of |in| as bytes to |out| if they are all ASCII
+inline bool NarrowAscii(const char16_t* in, char* out) {
+#if defined(AFNS_SIMD_AVX2)
+    const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(low, high), _mm256_set1_epi16(static_cast<short>(0xFF80)))) {
+        return false;
+    }
+    // The pack interleaves the 128-bit lanes of its operands; put the
+    // quarters back in order
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+#elif defined(AFNS_SIMD_SSE2)
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+    const __m128i non_ascii = _mm_and_si128(_mm_or_si128(low, high), _mm_set1_epi16(static_cast<short>(0xFF80)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) != 0xFFFF) {
+        return false;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+#elif defined(AFNS_SIMD_NEON)
+    const uint16x8_t low = vld1q_u16(reinterpret_cast<const uint16_t*>(in));
+    const uint16x8_t high = vld1q_u16(reinterpret_cast<const uint16_t*>(in + 8));
+    // Saturating, so 0x8000 and up do not narrow to 0
+    const uint8x8_t non_ascii = vqshrn_n_u16(vorrq_u16(low, high), 7);
+    if (vget_lane_u64(vreinterpret_u64_u8(non_ascii), 0) != 0) {
+        return false;
+    }
+    vst1q_u8(reinterpret_cast<uint8_t*>(out), vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+#endif
+    return true;
+}
+
+// Writes kBlock bytes of |in| as code units to |out| if they are all ASCII
+inline bool WidenAscii(const char* in, char16_t* out) {
+    const simd::Vec bytes = simd::Load(in);
+    if (simd::ToMask(simd::NonAscii(bytes)) != 0) {
+        return false;
+    }
+#if defined(AFNS_SIMD_AVX2)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16),
+                        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+#elif defined(AFNS_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(bytes, zero));
+#elif defined(AFNS_SIMD_NEON)
+    vst1q_u16(reinterpret_cast<uint16_t*>(out), vmovl_u8(vget_low_u8(bytes)));
+    vst1q_u16(reinterpret_cast<uint16_t*>(out + 8), vmovl_u8(vget_high_u8(bytes)));
+#endif
+    return true;
+}
+#endif
+
+// Encodes the code point starting at utf16[*i] and advances past it
+inline char* EncodeUtf8(const char16_t* utf16, size_t length, size_t* i, char* out) {
+    uint32_t code_point = utf16[*i];
+    ++*i;
+    if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+        if (code_point <= 0xDBFF && *i < length && utf16[*i] >= 0xDC00 && utf16[*i] <= 0xDFFF) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (utf16[*i] - 0xDC00);
+            ++*i;
+        } else {
+            code_point = kReplacementCharacter;
+        }
+    }
+    if (code_point < 0x80) {
+        *out++ = static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (code_point >> 6));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (code_point >> 12));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    return out;
+}
+
+// Decodes the sequence starting at utf8[*i] and advances past it
+inline char16_t* DecodeUtf8(const char* utf8, size_t length, size_t* i, char16_t* out) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(utf8 + *i);
+    if (s[0] < 0x80) {
+        *out++ = s[0];
+        ++*i;
+        return out;
+    }
+    const size_t sequence = AFNSUtf8SequenceLength(utf8 + *i, length - *i);
+    if (sequence == 0) {
+        *out++ = kReplacementCharacter;
+        ++*i;
+        return out;
+    }
+    uint32_t code_point;
+    if (sequence == 2) {
+        code_point = ((s[0] & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+    } else if (sequence == 3) {
+        code_point = ((s[0] & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu);
+    } else {
+        code_point = ((s[0] & 0x07u) << 18) | ((s[1] & 0x3Fu) << 12) | ((s[2] & 0x3Fu) << 6) |
+                     (s[3] & 0x3Fu);
+    }
+    if (code_point >= 0x10000) {
+        code_point -= 0x10000;
+        *out++ = static_cast<char16_t>(0xD800 + (code_point >> 10));
+        *out++ = static_cast<char16_t>(0xDC00 + (code_point & 0x3FF));
+    } else {
+        *out++ = static_cast<char16_t>(code_point);
+    }
+    *i += sequence;
+    return out;
+}
+
+} // anonymous namespace
+
+size_t AFNSUtf8SequenceLength(const char* s, size_t available) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(s);
+    const unsigned char lead = bytes[0];
+    size_t length;
+    unsigned char second_min = 0x80;
+    unsigned char second_max = 0xBF;
+    if (lead < 0xC2) {
+        return 0;  // stray continuation or overlong 2-byte form
+    } else if (lead < 0xE0) {
+        length = 2;
+    } else if (lead < 0xF0) {
+        length = 3;
+        if (lead == 0xE0) {
+            second_min = 0xA0;  // overlong
+        } else if (lead == 0xED) {
+            second_max = 0x9F;  // surrogates
+        }
+    } else if (lead < 0xF5) {
+        length = 4;
+        if (lead == 0xF0) {
+            second_min = 0x90;  // overlong
+        } else if (lead == 0xF4) {
+            second_max = 0x8F;  // past U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+    if (available < length || bytes[1] < second_min || bytes[1] > second_max) {
+        return 0;
+    }
+    for (size_t k = 2; k < length; ++k) {
+        if (!IsContinuation(bytes[k])) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+void AFNSUtf16ToUtf8(const char16_t* utf16, size_t length, std::string* utf8) {
+    utf8->resize(AFNSUtf16ToUtf8Capacity(length));
+    char* const begin = &(*utf8)[0];
+    char* out = begin;
+    size_t i = 0;
+    while (i < length) {
+#if defined(AFNS_SIMD)
+        if (i + kBlock <= length) {
+            if (NarrowAscii(utf16 + i, out)) {
+                i += kBlock;
+                out += kBlock;
+                continue;
+            }
+            // Mixed block: the scalar loop takes it before the next try
+            const size_t block_end = i + kBlock;
+            while (i < block_end) {
+                out = EncodeUtf8(utf16, length, &i, out);
+            }
+            continue;
+        }
+#endif
+        out = EncodeUtf8(utf16, length, &i, out);
+    }
+    utf8->resize(static_cast<size_t>(out - begin));
+}
+
+void AFNSUtf8ToUtf16(std::string_view utf8, std::u16string* utf16) {
+    const char* data = utf8.data();
+    const size_t length = utf8.size();
+    // At most one code unit per byte; a 4-byte sequence takes 2
+    utf16->resize(length);
+    char16_t* const begin = &(*utf16)[0];
+    char16_t* out = begin;
+    size_t i = 0;
+    while (i < length) {
+#if defined(AFNS_SIMD)
+        if (i + kBlock <= length) {
+            if (WidenAscii(data + i, out)) {
+                i += kBlock;
+                out += kBlock;
+                continue;
+            }
+            const size_t block_end = i + kBlock;
+            while (i < block_end) {
+                out = DecodeUtf8(data, length, &i, out);
+            }
+            continue;
+        }
+#endif
+        out = DecodeUtf8(data, length, &i, out);
+    }
+    utf16->resize(static_cast<size_t>(out - begin));
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,43 @@
+// 🚀 AFNS UTF-8 / UTF-16 TRANSCODING
+// Conversions between the engine's UTF-8 and the UTF-16 of Java and Dart
+// strings
+
+#ifndef FLUTTER_AFNS_AFNS_UTF_H_
+#define FLUTTER_AFNS_AFNS_UTF_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace flutter {
+
+namespace afns {
+
+// Length of the well-formed multi-byte UTF-8 sequence at |s| (whose lead
+// byte is >= 0x80), or 0 for a stray continuation byte, an overlong form, a
+// surrogate, a code point past U+10FFFF or a sequence cut off by
+// |available| (Unicode table 3-7)
+size_t AFNSUtf8SequenceLength(const char* s, size_t available);
+
+// Bytes AFNSUtf16ToUtf8 needs as scratch for |length| code units: at most
+// 3 per code unit, a surrogate pair takes 4 for its 2
+constexpr size_t AFNSUtf16ToUtf8Capacity(size_t length) { return length * 3; }
+
+// |utf16| as UTF-8 into |utf8|, which is cleared first. Unpaired surrogates,
+// which Java and Dart strings may hold, become U+FFFD. Does not allocate
+// when |utf8| already has AFNSUtf16ToUtf8Capacity(length) reserved; the
+// capacity is left as it is, for the caller to trim.
+void AFNSUtf16ToUtf8(const char16_t* utf16, size_t length, std::string* utf8);
+
+// |utf8| as UTF-16 into |utf16|, which is cleared first. Every byte that
+// does not start a well-formed sequence becomes one U+FFFD.
+void AFNSUtf8ToUtf16(std::string_view utf8, std::u16string* utf16);
+
+// Both run a vector at a time through ASCII (16 code units with SSE2 and
+// NEON, 32 with AVX2) and one code point at a time through the rest.
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_UTF_H_
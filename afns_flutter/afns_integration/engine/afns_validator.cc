@@ -0,0 +1,217 @@
+// 🚀 AFNS SOURCE VALIDATOR
+// Single-pass pre-validation run before any rewriting or parsing
+
+#include "afns_validator.h"
+
+#include "afns_arena.h"
+#include "afns_simd.h"
+#include "afns_utf.h"
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+enum class ScanState {
+    kCode,
+    kString,
+    kLineComment,
+    kBlockComment,
+};
+
+struct OpenBracket {
+    size_t offset;
+    char closer;
+};
+
+// Bytes that can change the scanner state in |state| or may be invalid:
+// non-ASCII, banned controls and the state's own delimiters. Everything
+// else is skipped without looking at it individually.
+inline bool IsSpecial(unsigned char c, ScanState state, char quote) {
+    if (c >= 0x7F || (c < 0x20 && c != '\t' && c != '\r' && c != '\n')) {
+        return true;
+    }
+    switch (state) {
+    case ScanState::kCode:
+        return c == '"' || c == '\'' || c == '/' || c == '(' || c == ')' ||
+               c == '[' || c == ']' || c == '{' || c == '}';
+    case ScanState::kString:
+        return c == static_cast<unsigned char>(quote) || c == '\\';
+    case ScanState::kLineComment:
+        return c == '\n';
+    case ScanState::kBlockComment:
+        return c == '*';
+    }
+    return false;
+}
+
+#if defined(AFNS_SIMD)
+using namespace simd;
+
+// Vector form of IsSpecial. The signed compare against 0x20 also catches
+// every byte >= 0x80, which reads as negative.
+inline Vec SpecialBytes(Vec v, ScanState state, char quote) {
+    Vec special = AndNot(SignedLess(v, 0x20), Or(Eq(v, '\t'), Or(Eq(v, '\r'), Eq(v, '\n'))));
+    special = Or(special, Eq(v, 0x7F));
+    switch (state) {
+    case ScanState::kCode:
+        special = Or(special, Or(Eq(v, '"'), Eq(v, '\'')));
+        special = Or(special, Or(Eq(v, '/'), Or(Eq(v, '('), Eq(v, ')'))));
+        special = Or(special, Or(Or(Eq(v, '['), Eq(v, ']')), Or(Eq(v, '{'), Eq(v, '}'))));
+        break;
+    case ScanState::kString:
+        special = Or(special, Or(Eq(v, quote), Eq(v, '\\')));
+        break;
+    case ScanState::kLineComment:
+        special = Or(special, Eq(v, '\n'));
+        break;
+    case ScanState::kBlockComment:
+        special = Or(special, Eq(v, '*'));
+        break;
+    }
+    return special;
+}
+#endif
+
+// Index of the first special byte at or after |i|, or |n|
+size_t FindSpecial(const char* data, size_t i, size_t n, ScanState state, char quote) {
+#if defined(AFNS_SIMD)
+    while (i + kChunk <= n) {
+        const uint64_t mask = ToMask(SpecialBytes(Load(data + i), state, quote));
+        if (mask != 0) {
+            return i + FirstByte(mask);
+        }
+        i += kChunk;
+    }
+#endif
+    while (i < n && !IsSpecial(static_cast<unsigned char>(data[i]), state, quote)) {
+        ++i;
+    }
+    return i;
+}
+
+inline AFNSValidationResult Fail(AFNSValidationError error, size_t offset) {
+    AFNSValidationResult result;
+    result.error = error;
+    result.offset = offset;
+    return result;
+}
+
+} // anonymous namespace
+
+const char* AFNSValidationErrorName(AFNSValidationError error) {
+    switch (error) {
+    case AFNSValidationError::kNone: return "none";
+    case AFNSValidationError::kEmpty: return "empty";
+    case AFNSValidationError::kUnbalancedBracket: return "unbalanced_bracket";
+    case AFNSValidationError::kUnterminatedString: return "unterminated_string";
+    case AFNSValidationError::kUnterminatedComment: return "unterminated_comment";
+    case AFNSValidationError::kInvalidUtf8: return "invalid_utf8";
+    case AFNSValidationError::kControlCharacter: return "control_character";
+    }
+    return "unknown";
+}
+
+AFNSValidationResult ValidateAFNSSource(std::string_view source) {
+    if (source.empty()) {
+        return Fail(AFNSValidationError::kEmpty, 0);
+    }
+
+    const char* data = source.data();
+    const size_t n = source.size();
+
+    AFNSArenaScope scope(ThreadAFNSArena());
+    AFNSArenaVector<OpenBracket> open(scope.arena());
+
+    ScanState state = ScanState::kCode;
+    char quote = 0;
+    size_t token_start = 0;  // opening quote or "/*"
+    size_t i = 0;
+
+    while ((i = FindSpecial(data, i, n, state, quote)) < n) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+
+        if (c >= 0x80) {
+            const size_t length = AFNSUtf8SequenceLength(data + i, n - i);
+            if (length == 0) {
+                return Fail(AFNSValidationError::kInvalidUtf8, i);
+            }
+            i += length;
+            continue;
+        }
+        if (c == 0x7F || (c < 0x20 && c != '\n')) {
+            return Fail(AFNSValidationError::kControlCharacter, i);
+        }
+
+        switch (state) {
+        case ScanState::kCode:
+            if (c == '"' || c == '\'') {
+                state = ScanState::kString;
+                quote = static_cast<char>(c);
+                token_start = i++;
+            } else if (c == '/') {
+                const char next = i + 1 < n ? data[i + 1] : '\0';
+                if (next == '/' || next == '*') {
+                    state = next == '/' ? ScanState::kLineComment : ScanState::kBlockComment;
+                    token_start = i;
+                    i += 2;
+                } else {
+                    ++i;
+                }
+            } else if (c == '(' || c == '[' || c == '{') {
+                open.push_back({i, c == '(' ? ')' : c == '[' ? ']' : '}'});
+                ++i;
+            } else {
+                if (open.empty() || open.back().closer != static_cast<char>(c)) {
+                    return Fail(AFNSValidationError::kUnbalancedBracket, i);
+                }
+                open.pop_back();
+                ++i;
+            }
+            break;
+
+        case ScanState::kString:
+            if (c == '\\') {
+                // Skip the escaped byte unless it needs checking itself
+                const unsigned char next = i + 1 < n ? static_cast<unsigned char>(data[i + 1]) : 0;
+                const bool plain = next != 0 && next < 0x7F &&
+                                   (next >= 0x20 || next == '\t' || next == '\r' || next == '\n');
+                i += plain ? 2 : 1;
+            } else {
+                state = ScanState::kCode;
+                ++i;
+            }
+            break;
+
+        case ScanState::kLineComment:
+            state = ScanState::kCode;
+            ++i;
+            break;
+
+        case ScanState::kBlockComment:
+            if (i + 1 < n && data[i + 1] == '/') {
+                state = ScanState::kCode;
+                i += 2;
+            } else {
+                ++i;
+            }
+            break;
+        }
+    }
+
+    if (state == ScanState::kString) {
+        return Fail(AFNSValidationError::kUnterminatedString, token_start);
+    }
+    if (state == ScanState::kBlockComment) {
+        return Fail(AFNSValidationError::kUnterminatedComment, token_start);
+    }
+    if (!open.empty()) {
+        return Fail(AFNSValidationError::kUnbalancedBracket, open.front().offset);
+    }
+    return AFNSValidationResult();
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,52 @@
+// 🚀 AFNS SOURCE VALIDATOR
+// Single-pass pre-validation run before any rewriting or parsing
+
+#ifndef FLUTTER_AFNS_AFNS_VALIDATOR_H_
+#define FLUTTER_AFNS_AFNS_VALIDATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace flutter {
+
+namespace afns {
+
+enum class AFNSValidationError : int32_t {
+    kNone = 0,
+    kEmpty = 1,
+    // A closer without its opener, a mismatched closer, or (at the opener)
+    // a bracket never closed
+    kUnbalancedBracket = 2,
+    kUnterminatedString = 3,
+    kUnterminatedComment = 4,
+    kInvalidUtf8 = 5,
+    // C0 controls other than tab, newline and carriage return, and DEL
+    kControlCharacter = 6,
+};
+
+struct AFNSValidationResult {
+    AFNSValidationError error = AFNSValidationError::kNone;
+    // Byte offset of the first error
+    size_t offset = 0;
+
+    bool ok() const { return error == AFNSValidationError::kNone; }
+};
+
+// Stable snake_case name, e.g. "unterminated_string"
+const char* AFNSValidationErrorName(AFNSValidationError error);
+
+// Checks () [] {} balance, string/char literal and block comment
+// termination, UTF-8 well-formedness (no overlongs, surrogates or code
+// points past U+10FFFF) and control characters, following the AFNS lexer:
+// brackets inside literals and comments do not count, literals may span
+// lines and a backslash escapes the next character. Runs of bytes that
+// cannot change the scanner state are skipped 16 or 32 at a time with
+// SSE2/AVX2/NEON when the build targets them, scalar otherwise.
+AFNSValidationResult ValidateAFNSSource(std::string_view source);
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_VALIDATOR_H_
@@ -0,0 +1,741 @@
+// 🚀 AFNS LOGIC VM
+// Register machine with computed-goto dispatch where the compiler has it
+
+#include "afns_vm.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "afns_arena.h"
+#include "afns_tiering.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AFNS_VM_COMPUTED_GOTO 1
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr size_t kInitialStackSlots = 256;
+constexpr size_t kMaxStackSlots = 64 * 1024;
+constexpr size_t kMaxCallDepth = 256;
+constexpr size_t kMaxOutputBytes = 1024 * 1024;
+// No string can be longer than the output it would be shown in, and the
+// strings one run builds, intermediates of repeated concatenation
+// included, share a budget so a loop cannot grow the arena without bound
+constexpr size_t kMaxStringBytes = kMaxOutputBytes;
+constexpr size_t kMaxStringBytesPerRun = 16 * kMaxOutputBytes;
+
+struct Frame {
+    const AFNSInstruction* code;
+    const AFNSInstruction* return_pc;
+    size_t base;
+    size_t function;
+};
+
+enum class Order {
+    kLess,
+    kEqual,
+    kGreater,
+    kUnordered,  // NaN involved
+    kMismatch,
+};
+
+inline int64_t WrappingAdd(int64_t x, int64_t y) {
+    return static_cast<int64_t>(static_cast<uint64_t>(x) + static_cast<uint64_t>(y));
+}
+
+inline int64_t WrappingSubtract(int64_t x, int64_t y) {
+    return static_cast<int64_t>(static_cast<uint64_t>(x) - static_cast<uint64_t>(y));
+}
+
+inline int64_t WrappingMultiply(int64_t x, int64_t y) {
+    return static_cast<int64_t>(static_cast<uint64_t>(x) * static_cast<uint64_t>(y));
+}
+
+inline bool ToNumber(const AFNSValue& value, double* number) {
+    if (value.type == AFNSValueType::kInt) {
+        *number = static_cast<double>(value.integer);
+        return true;
+    }
+    if (value.type == AFNSValueType::kFloat) {
+        *number = value.number;
+        return true;
+    }
+    return false;
+}
+
+Order Compare(const AFNSValue& x, const AFNSValue& y) {
+    if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt) {
+        return x.integer < y.integer ? Order::kLess : x.integer > y.integer ? Order::kGreater : Order::kEqual;
+    }
+    if (x.type == AFNSValueType::kString && y.type == AFNSValueType::kString) {
+        const int order = x.string().compare(y.string());
+        return order < 0 ? Order::kLess : order > 0 ? Order::kGreater : Order::kEqual;
+    }
+    double a;
+    double b;
+    if (!ToNumber(x, &a) || !ToNumber(y, &b)) {
+        return Order::kMismatch;
+    }
+    if (a < b) {
+        return Order::kLess;
+    }
+    if (a > b) {
+        return Order::kGreater;
+    }
+    return a == b ? Order::kEqual : Order::kUnordered;
+}
+
+bool ValuesEqual(const AFNSValue& x, const AFNSValue& y) {
+    if (x.type != y.type) {
+        double a;
+        double b;
+        return ToNumber(x, &a) && ToNumber(y, &b) && a == b;
+    }
+    switch (x.type) {
+    case AFNSValueType::kNone: return true;
+    case AFNSValueType::kBool: return x.boolean == y.boolean;
+    case AFNSValueType::kInt: return x.integer == y.integer;
+    case AFNSValueType::kFloat: return x.number == y.number;
+    case AFNSValueType::kString: return x.string() == y.string();
+    }
+    return false;
+}
+
+// Text form of |value|, same as src/interpreter's as_string; numbers are
+// formatted into |buffer|
+std::string_view ValueText(const AFNSValue& value, char (&buffer)[32]) {
+    switch (value.type) {
+    case AFNSValueType::kNone:
+        return "null";
+    case AFNSValueType::kBool:
+        return value.boolean ? "true" : "false";
+    case AFNSValueType::kInt: {
+        const auto end = std::to_chars(buffer, buffer + sizeof(buffer), value.integer).ptr;
+        return std::string_view(buffer, static_cast<size_t>(end - buffer));
+    }
+    case AFNSValueType::kFloat: {
+        const int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value.number);
+        return std::string_view(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+    }
+    case AFNSValueType::kString:
+        return value.string();
+    }
+    return std::string_view();
+}
+
+// 🎯 MACHINE
+// State of one run. The interpreter loop keeps pc and the frame's register
+// window in locals and only goes through here for the slow paths.
+class Machine {
+public:
+    Machine(const AFNSBytecodeProgram& program, AFNSArena* arena, AFNSLogicResult* result,
+            uint64_t step_budget, const AFNSStateStore* state)
+        : program_(program), arena_(arena), result_(result), step_budget_(step_budget),
+          tiers_(AFNSTieringEnabled() ? program.tiers() : nullptr), state_(state) {}
+
+    void Run();
+
+    // Hands the counts not yet reported to the program's tier state
+    void FlushHotness() {
+        for (size_t function = 0; function < program_.functions().size(); ++function) {
+            FlushHotness(function);
+        }
+    }
+
+private:
+    // Code a call to |function| runs: the optimized version if one is
+    // installed and tiering is on
+    const AFNSInstruction* Enter(size_t function) const {
+        return tiers_ != nullptr ? tiers_->Code(function) : program_.functions()[function].code.data();
+    }
+
+    // Counts one call or back-edge locally and reports every
+    // kAFNSTierUpThreshold of them; true when it reported, so the caller
+    // re-reads Enter() and picks up code that was just optimized
+    bool Heat(size_t function) {
+        if (++hotness_[function] < kAFNSTierUpThreshold) {
+            return false;
+        }
+        FlushHotness(function);
+        return true;
+    }
+
+    void FlushHotness(size_t function) {
+        if (tiers_ != nullptr) {
+            tiers_->RecordHotness(function, hotness_[function]);
+        }
+        hotness_[function] = 0;
+    }
+
+    AFNSValue* AllocateStack(size_t slots) {
+        return static_cast<AFNSValue*>(arena_->Allocate(slots * sizeof(AFNSValue), alignof(AFNSValue)));
+    }
+
+    // Makes room for |needed| slots; false past kMaxStackSlots
+    bool Reserve(size_t needed, AFNSValue** stack, size_t* capacity) {
+        if (needed <= *capacity) {
+            return true;
+        }
+        if (needed > kMaxStackSlots) {
+            return false;
+        }
+        const size_t grown = std::max(needed, std::min(*capacity * 2, kMaxStackSlots));
+        AFNSValue* stack_copy = AllocateStack(grown);
+        std::memcpy(static_cast<void*>(stack_copy), *stack, *capacity * sizeof(AFNSValue));
+        *stack = stack_copy;
+        *capacity = grown;
+        return true;
+    }
+
+    // Arena space for a |length| byte string, charged against the run's
+    // string budget; null with string_too_long past either limit
+    char* AllocateString(size_t length, const char** error) {
+        if (length > kMaxStringBytes || length > kMaxStringBytesPerRun - string_bytes_) {
+            *error = "string_too_long";
+            return nullptr;
+        }
+        string_bytes_ += length;
+        return static_cast<char*>(arena_->Allocate(length == 0 ? 1 : length, 1));
+    }
+
+    // + on anything but two integers; false on a type mismatch or an
+    // oversized string
+    bool SlowAdd(const AFNSValue& x, const AFNSValue& y, AFNSValue* out, const char** error) {
+        if (x.type == AFNSValueType::kString || y.type == AFNSValueType::kString) {
+            char x_buffer[32];
+            char y_buffer[32];
+            const std::string_view left = ValueText(x, x_buffer);
+            const std::string_view right = ValueText(y, y_buffer);
+            const size_t length = left.size() + right.size();
+            char* chars = AllocateString(length, error);
+            if (chars == nullptr) {
+                return false;
+            }
+            std::memcpy(chars, left.data(), left.size());
+            std::memcpy(chars + left.size(), right.data(), right.size());
+            *out = AFNSValue::String(chars, static_cast<uint32_t>(length));
+            return true;
+        }
+        double a;
+        double b;
+        if (!ToNumber(x, &a) || !ToNumber(y, &b)) {
+            *error = "type_mismatch";
+            return false;
+        }
+        *out = AFNSValue::Float(a + b);
+        return true;
+    }
+
+    // - * / % on anything but non-zero integers
+    static bool SlowArithmetic(AFNSOpcode op, const AFNSValue& x, const AFNSValue& y,
+                               AFNSValue* out, const char** error) {
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt) {
+            // Only division and modulo get here, by zero or by -1
+            if (y.integer == 0) {
+                *error = "division_by_zero";
+                return false;
+            }
+            *out = AFNSValue::Int(op == AFNSOpcode::kDivide ? WrappingSubtract(0, x.integer) : 0);
+            return true;
+        }
+        double a;
+        double b;
+        if (!ToNumber(x, &a) || !ToNumber(y, &b)) {
+            *error = "type_mismatch";
+            return false;
+        }
+        switch (op) {
+        case AFNSOpcode::kSubtract: *out = AFNSValue::Float(a - b); break;
+        case AFNSOpcode::kMultiply: *out = AFNSValue::Float(a * b); break;
+        case AFNSOpcode::kDivide: *out = AFNSValue::Float(a / b); break;
+        default: *out = AFNSValue::Float(std::fmod(a, b)); break;
+        }
+        return true;
+    }
+
+    // state(path); false if |path| is not a string or the value does not
+    // fit a register string
+    bool LoadState(const AFNSValue& path, AFNSValue* out, const char** error) {
+        if (path.type != AFNSValueType::kString) {
+            *error = "type_mismatch";
+            return false;
+        }
+        AFNSStateValue value;
+        if (state_ == nullptr || !state_->Get(path.string(), &value)) {
+            *out = AFNSValue::None();
+            return true;
+        }
+        switch (value.type) {
+        case AFNSValueType::kBool: *out = AFNSValue::Bool(value.boolean); break;
+        case AFNSValueType::kInt: *out = AFNSValue::Int(value.integer); break;
+        case AFNSValueType::kFloat: *out = AFNSValue::Float(value.number); break;
+        case AFNSValueType::kString: {
+            const size_t length = value.text.size();
+            char* chars = AllocateString(length, error);
+            if (chars == nullptr) {
+                return false;
+            }
+            std::memcpy(chars, value.text.data(), length);
+            *out = AFNSValue::String(chars, static_cast<uint32_t>(length));
+            break;
+        }
+        default: *out = AFNSValue::None(); break;
+        }
+        return true;
+    }
+
+    bool Show(const AFNSValue& value) {
+        char buffer[32];
+        const std::string_view text = ValueText(value, buffer);
+        std::string& output = result_->output;
+        if (output.size() + text.size() + 1 > kMaxOutputBytes) {
+            return false;
+        }
+        if (shown_) {
+            output.push_back('\n');
+        }
+        output.append(text.data(), text.size());
+        shown_ = true;
+        return true;
+    }
+
+    const AFNSBytecodeProgram& program_;
+    AFNSArena* arena_;
+    AFNSLogicResult* result_;
+    const uint64_t step_budget_;
+    AFNSTierState* const tiers_;
+    const AFNSStateStore* const state_;
+    uint32_t* hotness_ = nullptr;  // per function, since the last report
+    size_t string_bytes_ = 0;      // charged by AllocateString
+    bool shown_ = false;
+};
+
+void Machine::Run() {
+    const std::vector<AFNSBytecodeFunction>& functions = program_.functions();
+    const AFNSValue* constants = program_.constants().data();
+
+    hotness_ = static_cast<uint32_t*>(arena_->Allocate(functions.size() * sizeof(uint32_t), alignof(uint32_t)));
+    std::memset(hotness_, 0, functions.size() * sizeof(uint32_t));
+
+    size_t capacity = std::max<size_t>(kInitialStackSlots, functions[0].register_count);
+    AFNSValue* stack = AllocateStack(capacity);
+    AFNSValue* r = stack;  // register window of the running frame
+    size_t function = 0;
+    Heat(function);
+    const AFNSInstruction* code = Enter(function);
+    const AFNSInstruction* pc = code;
+    AFNSArenaVector<Frame> frames{AFNSArenaAllocator<Frame>(arena_)};
+    frames.reserve(16);
+
+    uint64_t steps_left = step_budget_;
+    AFNSValue value;
+    const char* error = nullptr;
+    AFNSInstruction i;
+
+#if defined(AFNS_VM_COMPUTED_GOTO)
+    // One indirect jump per instruction, at the end of each handler, so
+    // the branch predictor learns opcode pairs instead of a single switch
+    static const void* const kDispatch[] = {
+#define AFNS_VM_LABEL(name) &&op_##name,
+        AFNS_OPCODES(AFNS_VM_LABEL)
+#undef AFNS_VM_LABEL
+    };
+    static_assert(sizeof(kDispatch) / sizeof(kDispatch[0]) == static_cast<size_t>(AFNSOpcode::kCount),
+                  "every opcode needs a handler");
+#define AFNS_VM_CASE(name) op_##name:
+#define AFNS_VM_DISPATCH() goto *kDispatch[static_cast<uint8_t>((i = *pc++).op)]
+    AFNS_VM_DISPATCH();
+#else
+#define AFNS_VM_CASE(name) case AFNSOpcode::k##name:
+#define AFNS_VM_DISPATCH() continue
+    for (;;) {
+        i = *pc++;
+        switch (i.op) {
+#endif
+
+    AFNS_VM_CASE(LoadConst) {
+        r[i.a] = constants[i.bx()];
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(LoadNone) {
+        r[i.a] = AFNSValue::None();
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Move) {
+        r[i.a] = r[i.b];
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Add) {
+        const AFNSValue& x = r[i.b];
+        const AFNSValue& y = r[i.c];
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt) {
+            r[i.a] = AFNSValue::Int(WrappingAdd(x.integer, y.integer));
+            AFNS_VM_DISPATCH();
+        }
+        if (!SlowAdd(x, y, &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Subtract) {
+        const AFNSValue& x = r[i.b];
+        const AFNSValue& y = r[i.c];
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt) {
+            r[i.a] = AFNSValue::Int(WrappingSubtract(x.integer, y.integer));
+            AFNS_VM_DISPATCH();
+        }
+        if (!SlowArithmetic(i.op, x, y, &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Multiply) {
+        const AFNSValue& x = r[i.b];
+        const AFNSValue& y = r[i.c];
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt) {
+            r[i.a] = AFNSValue::Int(WrappingMultiply(x.integer, y.integer));
+            AFNS_VM_DISPATCH();
+        }
+        if (!SlowArithmetic(i.op, x, y, &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Divide) {
+        const AFNSValue& x = r[i.b];
+        const AFNSValue& y = r[i.c];
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt &&
+            y.integer != 0 && y.integer != -1) {
+            r[i.a] = AFNSValue::Int(x.integer / y.integer);
+            AFNS_VM_DISPATCH();
+        }
+        if (!SlowArithmetic(i.op, x, y, &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Modulo) {
+        const AFNSValue& x = r[i.b];
+        const AFNSValue& y = r[i.c];
+        if (x.type == AFNSValueType::kInt && y.type == AFNSValueType::kInt &&
+            y.integer != 0 && y.integer != -1) {
+            r[i.a] = AFNSValue::Int(x.integer % y.integer);
+            AFNS_VM_DISPATCH();
+        }
+        if (!SlowArithmetic(i.op, x, y, &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Equal) {
+        r[i.a] = AFNSValue::Bool(ValuesEqual(r[i.b], r[i.c]));
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(NotEqual) {
+        r[i.a] = AFNSValue::Bool(!ValuesEqual(r[i.b], r[i.c]));
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Less) {
+        const Order order = Compare(r[i.b], r[i.c]);
+        if (order == Order::kMismatch) {
+            error = "type_mismatch";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::Bool(order == Order::kLess);
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(LessEqual) {
+        const Order order = Compare(r[i.b], r[i.c]);
+        if (order == Order::kMismatch) {
+            error = "type_mismatch";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::Bool(order == Order::kLess || order == Order::kEqual);
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Greater) {
+        const Order order = Compare(r[i.b], r[i.c]);
+        if (order == Order::kMismatch) {
+            error = "type_mismatch";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::Bool(order == Order::kGreater);
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(GreaterEqual) {
+        const Order order = Compare(r[i.b], r[i.c]);
+        if (order == Order::kMismatch) {
+            error = "type_mismatch";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::Bool(order == Order::kGreater || order == Order::kEqual);
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Not) {
+        if (r[i.b].type != AFNSValueType::kBool) {
+            error = "type_mismatch";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::Bool(!r[i.b].boolean);
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Negate) {
+        const AFNSValue& x = r[i.b];
+        if (x.type == AFNSValueType::kInt) {
+            r[i.a] = AFNSValue::Int(WrappingSubtract(0, x.integer));
+        } else if (x.type == AFNSValueType::kFloat) {
+            r[i.a] = AFNSValue::Float(-x.number);
+        } else {
+            error = "type_mismatch";
+            goto fail;
+        }
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Jump) {
+        pc = code + i.bx();
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Loop) {
+        if (--steps_left == 0) {
+            goto step_limit;
+        }
+        // The loop header is never inside a fused sequence, so a version
+        // optimized meanwhile can be entered here at the same pc
+        if (Heat(function)) {
+            code = Enter(function);
+        }
+        pc = code + i.bx();
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(JumpIfFalse) {
+        if (r[i.a].type != AFNSValueType::kBool) {
+            error = "condition_not_bool";
+            goto fail;
+        }
+        if (!r[i.a].boolean) {
+            pc = code + i.bx();
+        }
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(JumpIfTrue) {
+        if (r[i.a].type != AFNSValueType::kBool) {
+            error = "condition_not_bool";
+            goto fail;
+        }
+        if (r[i.a].boolean) {
+            pc = code + i.bx();
+        }
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Call) {
+        const AFNSBytecodeFunction& callee = functions[i.bx()];
+        if (--steps_left == 0) {
+            goto step_limit;
+        }
+        // The arguments already sit in the callee's first registers
+        const size_t caller_base = static_cast<size_t>(r - stack);
+        const size_t base = caller_base + i.a;
+        if (frames.size() >= kMaxCallDepth || !Reserve(base + callee.register_count, &stack, &capacity)) {
+            goto stack_overflow;
+        }
+        frames.push_back(Frame{code, pc, caller_base, function});
+        r = stack + base;
+        function = i.bx();
+        Heat(function);
+        code = Enter(function);
+        pc = code;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Show) {
+        if (!Show(r[i.b])) {
+            error = "output_too_long";
+            goto fail;
+        }
+        r[i.a] = AFNSValue::None();
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(LoadState) {
+        if (!LoadState(r[i.b], &value, &error)) {
+            goto fail;
+        }
+        r[i.a] = value;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(Return) {
+        value = r[i.a];
+        if (frames.empty()) {
+            goto done;
+        }
+        // Register 0 of the callee is the caller's result register
+        r[0] = value;
+        const Frame frame = frames.back();
+        frames.pop_back();
+        code = frame.code;
+        pc = frame.return_pc;
+        r = stack + frame.base;
+        function = frame.function;
+        AFNS_VM_DISPATCH();
+    }
+    AFNS_VM_CASE(ReturnNone) {
+        value = AFNSValue::None();
+        if (frames.empty()) {
+            goto done;
+        }
+        r[0] = value;
+        const Frame frame = frames.back();
+        frames.pop_back();
+        code = frame.code;
+        pc = frame.return_pc;
+        r = stack + frame.base;
+        function = frame.function;
+        AFNS_VM_DISPATCH();
+    }
+
+    // Tier superinstructions; on entry pc already points at the first
+    // TierData word, so pc - 1 is the sequence's own pc in both versions
+#define AFNS_VM_INT_CONST(name, apply)                                         \
+    AFNS_VM_CASE(name) {                                                       \
+        const AFNSInstruction data = *pc;                                      \
+        const AFNSValue& x = r[data.b];                                        \
+        if (x.type != AFNSValueType::kInt) {                                   \
+            goto deoptimize;                                                   \
+        }                                                                      \
+        const AFNSValue& k = constants[i.bx()];                                \
+        const int64_t result = apply(x.integer, k.integer);                    \
+        r[i.a] = k;                                                            \
+        r[data.a] = AFNSValue::Int(result);                                    \
+        ++pc;                                                                  \
+        AFNS_VM_DISPATCH();                                                    \
+    }
+#define AFNS_VM_INT_BRANCH(name, cmp)                                          \
+    AFNS_VM_CASE(name) {                                                       \
+        const AFNSValue& x = r[i.b];                                           \
+        const AFNSValue& y = r[i.c];                                           \
+        if (x.type != AFNSValueType::kInt || y.type != AFNSValueType::kInt) {  \
+            goto deoptimize;                                                   \
+        }                                                                      \
+        const bool holds = x.integer cmp y.integer;                            \
+        r[i.a] = AFNSValue::Bool(holds);                                       \
+        pc = holds ? pc + 1 : code + pc->bx();                                 \
+        AFNS_VM_DISPATCH();                                                    \
+    }
+#define AFNS_VM_INT_CONST_BRANCH(name, cmp)                                    \
+    AFNS_VM_CASE(name) {                                                       \
+        const AFNSInstruction data = *pc;                                      \
+        const AFNSValue& x = r[data.b];                                        \
+        if (x.type != AFNSValueType::kInt) {                                   \
+            goto deoptimize;                                                   \
+        }                                                                      \
+        const AFNSValue& k = constants[i.bx()];                                \
+        const bool holds = x.integer cmp k.integer;                            \
+        r[i.a] = k;                                                            \
+        r[data.a] = AFNSValue::Bool(holds);                                    \
+        pc = holds ? pc + 2 : code + pc[1].bx();                               \
+        AFNS_VM_DISPATCH();                                                    \
+    }
+    AFNS_VM_INT_CONST(AddIntConst, WrappingAdd)
+    AFNS_VM_INT_CONST(SubtractIntConst, WrappingSubtract)
+    AFNS_VM_INT_CONST(MultiplyIntConst, WrappingMultiply)
+    AFNS_VM_INT_BRANCH(LessIntBranch, <)
+    AFNS_VM_INT_BRANCH(LessEqualIntBranch, <=)
+    AFNS_VM_INT_BRANCH(GreaterIntBranch, >)
+    AFNS_VM_INT_BRANCH(GreaterEqualIntBranch, >=)
+    AFNS_VM_INT_BRANCH(EqualIntBranch, ==)
+    AFNS_VM_INT_BRANCH(NotEqualIntBranch, !=)
+    AFNS_VM_INT_CONST_BRANCH(LessIntConstBranch, <)
+    AFNS_VM_INT_CONST_BRANCH(LessEqualIntConstBranch, <=)
+    AFNS_VM_INT_CONST_BRANCH(GreaterIntConstBranch, >)
+    AFNS_VM_INT_CONST_BRANCH(GreaterEqualIntConstBranch, >=)
+    AFNS_VM_INT_CONST_BRANCH(EqualIntConstBranch, ==)
+    AFNS_VM_INT_CONST_BRANCH(NotEqualIntConstBranch, !=)
+#undef AFNS_VM_INT_CONST
+#undef AFNS_VM_INT_BRANCH
+#undef AFNS_VM_INT_CONST_BRANCH
+    AFNS_VM_CASE(TierData) {
+        error = "invalid_opcode";
+        goto fail;
+    }
+
+    // A guard failed: continue in the baseline code at the same pc, which
+    // redoes the sequence generically
+    deoptimize: {
+        const size_t at = static_cast<size_t>(pc - 1 - code);
+        tiers_->Deoptimize(function, at);
+        code = functions[function].code.data();
+        pc = code + at;
+        AFNS_VM_DISPATCH();
+    }
+
+#if !defined(AFNS_VM_COMPUTED_GOTO)
+        case AFNSOpcode::kCount:
+            break;
+        }
+        error = "invalid_opcode";
+        goto fail;
+    }
+#endif
+#undef AFNS_VM_CASE
+#undef AFNS_VM_DISPATCH
+
+done:
+    result_->steps = step_budget_ - steps_left;
+    if (value.type != AFNSValueType::kNone) {
+        char buffer[32];
+        const std::string_view text = ValueText(value, buffer);
+        result_->value.assign(text.data(), text.size());
+    }
+    return;
+
+step_limit:
+    result_->status = AFNSLogicStatus::kStepLimit;
+    result_->error = "step_limit_exceeded";
+    result_->steps = step_budget_;
+    return;
+
+stack_overflow:
+    result_->status = AFNSLogicStatus::kStackOverflow;
+    result_->error = "stack_overflow";
+    result_->steps = step_budget_ - steps_left;
+    return;
+
+fail:
+    result_->status = AFNSLogicStatus::kRuntimeError;
+    result_->error = error;
+    result_->steps = step_budget_ - steps_left;
+}
+
+} // anonymous namespace
+
+AFNSLogicResult RunAFNSLogic(const AFNSBytecodeProgram& program, uint64_t step_budget,
+                             const AFNSStateStore* state) {
+    AFNSLogicResult result;
+    if (!program.ok() || program.functions().empty()) {
+        result.status = AFNSLogicStatus::kRuntimeError;
+        result.error = "not_compiled";
+        return result;
+    }
+
+    AFNSArenaScope scope(ThreadAFNSArena());
+    Machine machine(program, scope.arena(), &result, step_budget == 0 ? 1 : step_budget, state);
+    machine.Run();
+    machine.FlushHotness();
+    return result;
+}
+
+} // namespace afns
+
+} // namespace flutter
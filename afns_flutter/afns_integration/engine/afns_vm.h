@@ -0,0 +1,62 @@
+// 🚀 AFNS LOGIC VM
+// Interpreter loop for AFNS logic bytecode (afns_bytecode.h)
+
+#ifndef FLUTTER_AFNS_AFNS_VM_H_
+#define FLUTTER_AFNS_AFNS_VM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "afns_bytecode.h"
+#include "afns_state_store.h"
+
+namespace flutter {
+
+namespace afns {
+
+// Backward jumps and calls one run may take, so a runaway handler ends
+// with an error instead of holding its thread
+constexpr uint64_t kAFNSDefaultStepBudget = 1u << 24;
+
+enum class AFNSLogicStatus : int32_t {
+    kOk = 0,
+    kRuntimeError = 1,
+    kStepLimit = 2,
+    kStackOverflow = 3,
+};
+
+struct AFNSLogicResult {
+    AFNSLogicStatus status = AFNSLogicStatus::kOk;
+
+    // show/println/flutter_* lines, '\n' separated
+    std::string output;
+
+    // What the entry point returned as text, empty for none
+    std::string value;
+
+    // Set unless ok(): division_by_zero, type_mismatch, condition_not_bool,
+    // string_too_long, output_too_long, step_limit_exceeded, stack_overflow
+    std::string error;
+
+    // Charged against the step budget
+    uint64_t steps = 0;
+
+    bool ok() const { return status == AFNSLogicStatus::kOk; }
+};
+
+// Runs |program| (which must be ok()) on the calling thread. Registers and
+// intermediate strings come from the thread's arena and are released
+// before returning, so a warmed-up thread runs handlers without touching
+// the heap except for the result strings. state() reads |state|, and is
+// recorded in the thread's AFNSStateReadScope; without a store it yields
+// none.
+AFNSLogicResult RunAFNSLogic(const AFNSBytecodeProgram& program,
+                             uint64_t step_budget = kAFNSDefaultStepBudget,
+                             const AFNSStateStore* state = nullptr);
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_VM_H_
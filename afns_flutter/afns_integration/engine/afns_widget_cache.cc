@@ -0,0 +1,116 @@
+// 🚀 AFNS COMPILED WIDGET CACHE
+// Content-addressed LRU cache for CompileAFNSWidget results
+
+#include "afns_widget_cache.h"
+
+#include <utility>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr uint64_t kFNVOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFNVPrime = 1099511628211ULL;
+
+} // anonymous namespace
+
+uint64_t HashAFNSSource(std::string_view source, uint64_t seed) {
+    uint64_t hash = kFNVOffsetBasis ^ seed;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= kFNVPrime;
+    }
+    return hash;
+}
+
+AFNSWidgetCache::AFNSWidgetCache(std::string_view engine_version,
+                                 size_t byte_budget)
+    : version_seed_(HashAFNSSource(engine_version, 0)),
+      byte_budget_(byte_budget) {}
+
+bool AFNSWidgetCache::Lookup(std::string_view source, std::string* output) {
+    const uint64_t key = HashAFNSSource(source, version_seed_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->source != source) {
+        ++misses_;
+        return false;
+    }
+
+    // Move to the front so hot widgets survive eviction
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *output = it->second->output;
+    ++hits_;
+    return true;
+}
+
+void AFNSWidgetCache::Insert(std::string_view source, std::string output) {
+    const uint64_t key = HashAFNSSource(source, version_seed_);
+    const size_t entry_bytes = source.size() + output.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entry_bytes > byte_budget_) {
+        return;
+    }
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        // Same key: either a refresh of the same source or a collision.
+        // Either way the newer entry wins.
+        bytes_used_ -= EntryBytes(*it->second);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(Entry{key, std::string(source), std::move(output)});
+    index_[key] = lru_.begin();
+    bytes_used_ += entry_bytes;
+
+    EvictToBudgetLocked();
+}
+
+void AFNSWidgetCache::SetByteBudget(size_t byte_budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    byte_budget_ = byte_budget;
+    EvictToBudgetLocked();
+}
+
+void AFNSWidgetCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_used_ = 0;
+}
+
+AFNSWidgetCacheStats AFNSWidgetCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AFNSWidgetCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.entries = lru_.size();
+    stats.bytes_used = bytes_used_;
+    stats.byte_budget = byte_budget_;
+    return stats;
+}
+
+size_t AFNSWidgetCache::EntryBytes(const Entry& entry) {
+    return entry.source.size() + entry.output.size();
+}
+
+void AFNSWidgetCache::EvictToBudgetLocked() {
+    while (bytes_used_ > byte_budget_ && !lru_.empty()) {
+        const Entry& victim = lru_.back();
+        bytes_used_ -= EntryBytes(victim);
+        index_.erase(victim.key);
+        lru_.pop_back();
+        ++evictions_;
+    }
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,86 @@
+// 🚀 AFNS COMPILED WIDGET CACHE
+// Content-addressed LRU cache for CompileAFNSWidget results
+
+#ifndef FLUTTER_AFNS_AFNS_WIDGET_CACHE_H_
+#define FLUTTER_AFNS_AFNS_WIDGET_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace flutter {
+
+namespace afns {
+
+// 64-bit FNV-1a over the AFNS source, seeded so different engine versions
+// never share keys.
+uint64_t HashAFNSSource(std::string_view source, uint64_t seed);
+
+// Snapshot of cache counters, safe to copy out to callers
+struct AFNSWidgetCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes_used = 0;
+    size_t byte_budget = 0;
+};
+
+// 🎯 AFNS WIDGET CACHE
+// Keys are content hashes of the source text plus the engine version. The
+// source is kept next to the output so a hash collision degrades to a miss
+// instead of returning the wrong widget. Entries are evicted least recently
+// used first once the byte budget (source + output bytes) is exceeded.
+class AFNSWidgetCache {
+public:
+    static constexpr size_t kDefaultByteBudget = 8 * 1024 * 1024;
+
+    explicit AFNSWidgetCache(std::string_view engine_version,
+                             size_t byte_budget = kDefaultByteBudget);
+
+    // Copies the cached output into |output| and returns true on a hit
+    bool Lookup(std::string_view source, std::string* output);
+
+    // Stores |output| for |source|; entries larger than the budget are dropped
+    void Insert(std::string_view source, std::string output);
+
+    // Shrinking the budget evicts immediately
+    void SetByteBudget(size_t byte_budget);
+    void Clear();
+
+    AFNSWidgetCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::string source;
+        std::string output;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static size_t EntryBytes(const Entry& entry);
+    void EvictToBudgetLocked();
+
+    const uint64_t version_seed_;
+
+    mutable std::mutex mutex_;
+    EntryList lru_;  // front = most recently used
+    std::unordered_map<uint64_t, EntryList::iterator> index_;
+    size_t byte_budget_;
+    size_t bytes_used_ = 0;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_WIDGET_CACHE_H_
@@ -0,0 +1,491 @@
+// 🚀 AFNS WIDGET TREE DIFF
+// Patch streams that turn the last widget tree sent for a widget into the next one
+
+#include "afns_widget_diff.h"
+
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "AFNS widget trees are read in host order, which must be little-endian"
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+constexpr std::string_view kKeyProperty = "id";
+constexpr size_t kNoMatch = static_cast<size_t>(-1);
+
+size_t AlignUp(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+void AppendPadded(std::string* out, const void* data, size_t size) {
+    out->append(static_cast<const char*>(data), size);
+    out->append(AlignUp(out->size()) - out->size(), '\0');
+}
+
+// Bounds-checked view of a serialized widget tree. Children and siblings
+// must come after their node, as the builder writes them, so every walk
+// terminates.
+class TreeView {
+public:
+    bool Open(std::string_view bytes) {
+        AFNSWidgetTreeHeader header;
+        if (bytes.size() < sizeof(header) ||
+            reinterpret_cast<uintptr_t>(bytes.data()) % alignof(AFNSWidgetTreeProperty) != 0) {
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != kAFNSWidgetTreeMagic ||
+            header.version_major != kAFNSWidgetTreeVersionMajor || header.total_size > bytes.size()) {
+            return false;
+        }
+        const uint64_t nodes_at = sizeof(header);
+        const uint64_t properties_at =
+            nodes_at + AlignUp(uint64_t{header.node_count} * sizeof(AFNSWidgetTreeNode));
+        const uint64_t strings_at =
+            properties_at + AlignUp(uint64_t{header.property_count} * sizeof(AFNSWidgetTreeProperty));
+        const uint64_t blob_at = strings_at + AlignUp((uint64_t{header.string_count} + 1) * sizeof(uint32_t));
+        if (blob_at + header.string_data_size > header.total_size) {
+            return false;
+        }
+        nodes_ = reinterpret_cast<const AFNSWidgetTreeNode*>(bytes.data() + nodes_at);
+        properties_ = reinterpret_cast<const AFNSWidgetTreeProperty*>(bytes.data() + properties_at);
+        string_offsets_ = reinterpret_cast<const uint32_t*>(bytes.data() + strings_at);
+        blob_ = bytes.data() + blob_at;
+        node_count_ = header.node_count;
+        property_count_ = header.property_count;
+        string_count_ = header.string_count;
+
+        for (uint32_t i = 0; i < string_count_; ++i) {
+            if (string_offsets_[i] > string_offsets_[i + 1]) {
+                return false;
+            }
+        }
+        if (string_offsets_[string_count_] > header.string_data_size) {
+            return false;
+        }
+        for (uint32_t i = 0; i < property_count_; ++i) {
+            const AFNSWidgetTreeProperty& property = properties_[i];
+            if (property.key >= string_count_ ||
+                (property.type == static_cast<uint16_t>(AFNSPropertyType::kString) &&
+                 property.value >= string_count_)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < node_count_; ++i) {
+            const AFNSWidgetTreeNode& node = nodes_[i];
+            if (node.name >= string_count_ ||
+                uint64_t{node.first_property} + node.property_count > property_count_ ||
+                !IsLater(node.first_child, i) || !IsLater(node.next_sibling, i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t node_count() const { return node_count_; }
+    uint32_t first_root() const { return node_count_ > 0 ? 0 : kAFNSWidgetTreeNone; }
+    const AFNSWidgetTreeNode& node(uint32_t index) const { return nodes_[index]; }
+    const AFNSWidgetTreeProperty& property(uint32_t index) const { return properties_[index]; }
+
+    std::string_view string(uint32_t index) const {
+        return std::string_view(blob_ + string_offsets_[index],
+                                string_offsets_[index + 1] - string_offsets_[index]);
+    }
+
+    std::string_view name(uint32_t node) const { return string(nodes_[node].name); }
+
+    // First property of |node| named |key|, or null
+    const AFNSWidgetTreeProperty* Find(uint32_t node, std::string_view key) const {
+        const AFNSWidgetTreeNode& n = nodes_[node];
+        for (uint32_t i = n.first_property; i < n.first_property + n.property_count; ++i) {
+            if (string(properties_[i].key) == key) {
+                return &properties_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool SameValue(const AFNSWidgetTreeProperty& a, const TreeView& b_tree,
+                   const AFNSWidgetTreeProperty& b) const {
+        if (a.type != b.type) {
+            return false;
+        }
+        if (a.type == static_cast<uint16_t>(AFNSPropertyType::kString)) {
+            return string(static_cast<uint32_t>(a.value)) == b_tree.string(static_cast<uint32_t>(b.value));
+        }
+        return a.value == b.value;
+    }
+
+private:
+    bool IsLater(uint32_t link, uint32_t index) const {
+        return link == kAFNSWidgetTreeNone || (link > index && link < node_count_);
+    }
+
+    const AFNSWidgetTreeNode* nodes_ = nullptr;
+    const AFNSWidgetTreeProperty* properties_ = nullptr;
+    const uint32_t* string_offsets_ = nullptr;
+    const char* blob_ = nullptr;
+    uint32_t node_count_ = 0;
+    uint32_t property_count_ = 0;
+    uint32_t string_count_ = 0;
+};
+
+// Identity of a node among its siblings
+struct SiblingKey {
+    std::string_view name;
+    bool keyed;
+    uint16_t key_type;
+    std::string_view key_string;
+    uint64_t key_value;
+    uint32_t ordinal;  // among unkeyed siblings of the same name
+
+    bool operator==(const SiblingKey& other) const {
+        return name == other.name && keyed == other.keyed && key_type == other.key_type &&
+               key_string == other.key_string && key_value == other.key_value &&
+               ordinal == other.ordinal;
+    }
+};
+
+struct SiblingKeyHash {
+    size_t operator()(const SiblingKey& key) const {
+        size_t hash = std::hash<std::string_view>()(key.name);
+        hash ^= std::hash<std::string_view>()(key.key_string) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<uint64_t>()(key.key_value ^ (uint64_t{key.ordinal} << 32) ^ key.key_type) +
+                0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+// Children of one node, or the roots, with their keys
+void CollectSiblings(const TreeView& tree, uint32_t first, std::vector<uint32_t>* nodes,
+                     std::vector<SiblingKey>* keys) {
+    std::unordered_map<std::string_view, uint32_t> ordinals;
+    for (uint32_t node = first; node != kAFNSWidgetTreeNone; node = tree.node(node).next_sibling) {
+        SiblingKey key{tree.name(node), false, 0, std::string_view(), 0, 0};
+        if (const AFNSWidgetTreeProperty* id = tree.Find(node, kKeyProperty)) {
+            key.keyed = true;
+            key.key_type = id->type;
+            if (id->type == static_cast<uint16_t>(AFNSPropertyType::kString)) {
+                key.key_string = tree.string(static_cast<uint32_t>(id->value));
+            } else {
+                key.key_value = id->value;
+            }
+        } else {
+            key.ordinal = ordinals[key.name]++;
+        }
+        nodes->push_back(node);
+        keys->push_back(key);
+    }
+}
+
+// Marks in |stays| a longest run of positions in |matches| (ignoring
+// kNoMatch) that keeps increasing: those siblings keep their order and
+// only the rest need a move
+void LongestIncreasingRun(const std::vector<size_t>& matches, std::vector<bool>* stays) {
+    std::vector<size_t> tails;         // index into |matches| ending each run length
+    std::vector<size_t> predecessors(matches.size(), kNoMatch);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (matches[i] == kNoMatch) {
+            continue;
+        }
+        size_t low = 0;
+        size_t high = tails.size();
+        while (low < high) {
+            const size_t middle = (low + high) / 2;
+            if (matches[tails[middle]] < matches[i]) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        predecessors[i] = low > 0 ? tails[low - 1] : kNoMatch;
+        if (low == tails.size()) {
+            tails.push_back(i);
+        } else {
+            tails[low] = i;
+        }
+    }
+    stays->assign(matches.size(), false);
+    for (size_t i = tails.empty() ? kNoMatch : tails.back(); i != kNoMatch; i = predecessors[i]) {
+        (*stays)[i] = true;
+    }
+}
+
+// 🎯 PATCH WRITER
+// Strings are views into the two trees being diffed, which outlive it
+class PatchWriter {
+public:
+    PatchWriter() : string_offsets_{0} {}
+
+    void Insert(uint32_t node, uint32_t parent, uint32_t after, uint16_t type, std::string_view name) {
+        Add(AFNSWidgetPatchKind::kInsert, type, node, parent, after, String(name));
+    }
+
+    void Remove(uint32_t node) {
+        Add(AFNSWidgetPatchKind::kRemove, 0, node, kAFNSWidgetTreeNone, kAFNSWidgetTreeNone, 0);
+    }
+
+    void Move(uint32_t node, uint32_t parent, uint32_t after) {
+        Add(AFNSWidgetPatchKind::kMove, 0, node, parent, after, 0);
+    }
+
+    void SetProperty(uint32_t node, const TreeView& tree, const AFNSWidgetTreeProperty& property) {
+        uint64_t value = property.value;
+        if (property.type == static_cast<uint16_t>(AFNSPropertyType::kString)) {
+            value = String(tree.string(static_cast<uint32_t>(property.value)));
+        }
+        Add(AFNSWidgetPatchKind::kSetProperty, property.type, node, String(tree.string(property.key)),
+            kAFNSWidgetTreeNone, value);
+    }
+
+    void RemoveProperty(uint32_t node, std::string_view key) {
+        Add(AFNSWidgetPatchKind::kRemoveProperty, 0, node, String(key), kAFNSWidgetTreeNone, 0);
+    }
+
+    std::string Finish(uint32_t base_generation, uint32_t generation) const {
+        AFNSWidgetPatchHeader header;
+        header.magic = kAFNSWidgetPatchMagic;
+        header.version_major = kAFNSWidgetPatchVersionMajor;
+        header.version_minor = kAFNSWidgetPatchVersionMinor;
+        header.op_count = static_cast<uint32_t>(ops_.size());
+        header.string_count = static_cast<uint32_t>(string_offsets_.size() - 1);
+        header.string_data_size = static_cast<uint32_t>(string_data_.size());
+        header.total_size = 0;
+        header.base_generation = base_generation;
+        header.generation = generation;
+
+        std::string out;
+        out.reserve(sizeof(header) + ops_.size() * sizeof(AFNSWidgetPatchOp) +
+                    string_offsets_.size() * sizeof(uint32_t) + string_data_.size() + 16);
+        AppendPadded(&out, &header, sizeof(header));
+        AppendPadded(&out, ops_.data(), ops_.size() * sizeof(AFNSWidgetPatchOp));
+        AppendPadded(&out, string_offsets_.data(), string_offsets_.size() * sizeof(uint32_t));
+        AppendPadded(&out, string_data_.data(), string_data_.size());
+
+        const uint32_t total_size = static_cast<uint32_t>(out.size());
+        std::memcpy(&out[offsetof(AFNSWidgetPatchHeader, total_size)], &total_size, sizeof(total_size));
+        return out;
+    }
+
+private:
+    void Add(AFNSWidgetPatchKind kind, uint16_t type, uint32_t node, uint32_t parent_or_key,
+             uint32_t after, uint64_t value) {
+        ops_.push_back(AFNSWidgetPatchOp{static_cast<uint16_t>(kind), type, node, parent_or_key, after, value});
+    }
+
+    uint32_t String(std::string_view value) {
+        auto it = string_index_.find(value);
+        if (it != string_index_.end()) {
+            return it->second;
+        }
+        const uint32_t index = static_cast<uint32_t>(string_offsets_.size() - 1);
+        string_data_.append(value);
+        string_offsets_.push_back(static_cast<uint32_t>(string_data_.size()));
+        string_index_.emplace(value, index);
+        return index;
+    }
+
+    std::vector<AFNSWidgetPatchOp> ops_;
+    std::vector<uint32_t> string_offsets_;
+    std::string string_data_;
+    std::unordered_map<std::string_view, uint32_t> string_index_;
+};
+
+// 🎯 TREE DIFF
+// One Diff() call: walks both trees from the roots, assigning the new
+// tree's ids as it goes
+class TreeDiff {
+public:
+    TreeDiff(const TreeView& old_tree, const std::vector<uint32_t>& old_ids, const TreeView& new_tree,
+             uint32_t* next_id, PatchWriter* writer)
+        : old_(old_tree), old_ids_(old_ids), new_(new_tree), next_id_(next_id), writer_(writer),
+          new_ids_(new_tree.node_count(), kAFNSWidgetTreeNone) {}
+
+    bool Run() {
+        Siblings(old_.first_root(), new_.first_root(), kAFNSWidgetTreeNone, 0);
+        return ok_;
+    }
+
+    std::vector<uint32_t> TakeIds() { return std::move(new_ids_); }
+
+private:
+    // Claims |node| of the new tree; false if it was reached before, which
+    // only a hand-made tree that shares subtrees can do
+    bool Visit(uint32_t node, size_t depth) {
+        if (!ok_ || depth > AFNSWidgetTreeDiffer::kMaxDepth || new_ids_[node] != kAFNSWidgetTreeNone) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    void Siblings(uint32_t old_first, uint32_t new_first, uint32_t parent, size_t depth) {
+        if (old_first == kAFNSWidgetTreeNone && new_first == kAFNSWidgetTreeNone) {
+            return;
+        }
+        std::vector<uint32_t> old_nodes;
+        std::vector<SiblingKey> old_keys;
+        CollectSiblings(old_, old_first, &old_nodes, &old_keys);
+        std::vector<uint32_t> new_nodes;
+        std::vector<SiblingKey> new_keys;
+        CollectSiblings(new_, new_first, &new_nodes, &new_keys);
+
+        std::unordered_map<SiblingKey, size_t, SiblingKeyHash> old_positions;
+        old_positions.reserve(old_nodes.size());
+        for (size_t i = 0; i < old_nodes.size(); ++i) {
+            old_positions.emplace(old_keys[i], i);
+        }
+        std::vector<size_t> matches(new_nodes.size(), kNoMatch);
+        std::vector<bool> matched(old_nodes.size(), false);
+        for (size_t i = 0; i < new_nodes.size(); ++i) {
+            auto it = old_positions.find(new_keys[i]);
+            if (it != old_positions.end() && !matched[it->second] &&
+                old_.node(old_nodes[it->second]).type == new_.node(new_nodes[i]).type) {
+                matches[i] = it->second;
+                matched[it->second] = true;
+            }
+        }
+        for (size_t i = 0; i < old_nodes.size(); ++i) {
+            if (!matched[i]) {
+                writer_->Remove(old_ids_[old_nodes[i]]);
+            }
+        }
+
+        // The rest move, in new order, after their new predecessor, which
+        // is in its final place by then
+        std::vector<bool> stays;
+        LongestIncreasingRun(matches, &stays);
+        uint32_t previous = kAFNSWidgetTreeNone;
+        for (size_t i = 0; i < new_nodes.size() && ok_; ++i) {
+            const uint32_t node = new_nodes[i];
+            if (matches[i] == kNoMatch) {
+                Insert(node, parent, previous, depth);
+            } else {
+                if (!stays[i]) {
+                    writer_->Move(old_ids_[old_nodes[matches[i]]], parent, previous);
+                }
+                Update(old_nodes[matches[i]], node, depth);
+            }
+            previous = new_ids_[node];
+        }
+    }
+
+    void Update(uint32_t old_node, uint32_t node, size_t depth) {
+        if (!Visit(node, depth)) {
+            return;
+        }
+        const uint32_t id = old_ids_[old_node];
+        new_ids_[node] = id;
+
+        const AFNSWidgetTreeNode& before = old_.node(old_node);
+        const AFNSWidgetTreeNode& after = new_.node(node);
+        for (uint32_t i = after.first_property; i < after.first_property + after.property_count; ++i) {
+            const AFNSWidgetTreeProperty& property = new_.property(i);
+            const std::string_view key = new_.string(property.key);
+            if (new_.Find(node, key) != &property) {
+                continue;  // readers see the first of repeated keys only
+            }
+            const AFNSWidgetTreeProperty* previous = old_.Find(old_node, key);
+            if (previous == nullptr || !new_.SameValue(property, old_, *previous)) {
+                writer_->SetProperty(id, new_, property);
+            }
+        }
+        for (uint32_t i = before.first_property; i < before.first_property + before.property_count; ++i) {
+            const AFNSWidgetTreeProperty& property = old_.property(i);
+            const std::string_view key = old_.string(property.key);
+            if (old_.Find(old_node, key) == &property && new_.Find(node, key) == nullptr) {
+                writer_->RemoveProperty(id, key);
+            }
+        }
+
+        Siblings(before.first_child, after.first_child, id, depth + 1);
+    }
+
+    void Insert(uint32_t node, uint32_t parent, uint32_t after, size_t depth) {
+        if (!Visit(node, depth)) {
+            return;
+        }
+        const uint32_t id = (*next_id_)++;
+        new_ids_[node] = id;
+
+        const AFNSWidgetTreeNode& inserted = new_.node(node);
+        writer_->Insert(id, parent, after, inserted.type, new_.name(node));
+        for (uint32_t i = inserted.first_property; i < inserted.first_property + inserted.property_count; ++i) {
+            const AFNSWidgetTreeProperty& property = new_.property(i);
+            if (new_.Find(node, new_.string(property.key)) == &property) {
+                writer_->SetProperty(id, new_, property);
+            }
+        }
+
+        uint32_t previous = kAFNSWidgetTreeNone;
+        for (uint32_t child = inserted.first_child; child != kAFNSWidgetTreeNone && ok_;
+             child = new_.node(child).next_sibling) {
+            Insert(child, id, previous, depth + 1);
+            previous = new_ids_[child];
+        }
+    }
+
+    const TreeView& old_;
+    const std::vector<uint32_t>& old_ids_;
+    const TreeView& new_;
+    uint32_t* next_id_;
+    PatchWriter* writer_;
+    std::vector<uint32_t> new_ids_;
+    bool ok_ = true;
+};
+
+} // anonymous namespace
+
+bool AFNSWidgetTreeDiffer::Diff(std::string_view tree, size_t patch_cap, std::string* patch) {
+    // Copied first: the view needs the tree 8-byte aligned, and on commit
+    // the copy becomes the committed tree
+    std::string next(tree);
+    TreeView next_view;
+    if (!next_view.Open(next)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    TreeView committed;
+    if (!tree_.empty()) {
+        committed.Open(tree_);
+    }
+    uint32_t next_id = next_id_;
+    PatchWriter writer;
+    TreeDiff diff(committed, ids_, next_view, &next_id, &writer);
+    if (!diff.Run()) {
+        return false;
+    }
+    *patch = writer.Finish(generation_, generation_ + 1);
+    if (patch->size() <= patch_cap) {
+        tree_ = std::move(next);
+        ids_ = diff.TakeIds();
+        next_id_ = next_id;
+        ++generation_;
+    }
+    return true;
+}
+
+void AFNSWidgetTreeDiffer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tree_.clear();
+    ids_.clear();
+    generation_ = 0;
+}
+
+uint32_t AFNSWidgetTreeDiffer::generation() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,112 @@
+// 🚀 AFNS WIDGET TREE DIFF
+// Patch streams that turn the last widget tree sent for a widget into the next one
+
+#ifndef FLUTTER_AFNS_AFNS_WIDGET_DIFF_H_
+#define FLUTTER_AFNS_AFNS_WIDGET_DIFF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_widget_tree.h"
+
+namespace flutter {
+
+namespace afns {
+
+// Wire format, all integers little-endian, sections 8-byte aligned:
+//
+//   header  AFNSWidgetPatchHeader (32 bytes)
+//   ops     op_count x AFNSWidgetPatchOp (24 bytes), applied in order
+//   strings (string_count + 1) x u32 offsets into the string blob
+//   blob    string_data_size bytes of UTF-8
+//
+// Nodes are named by ids that stay the same for as long as the node
+// exists, so a reader keeps id -> node and a Flutter key per id. A node is
+// inserted bare; its properties and children follow as their own ops.
+// Removing a node removes its subtree. A patch applies to the tree of
+// base_generation and yields the tree of generation; base_generation 0
+// means start from an empty tree. Readers must reject a different major
+// version.
+constexpr uint32_t kAFNSWidgetPatchMagic = 0x50574641;  // "AFWP"
+constexpr uint16_t kAFNSWidgetPatchVersionMajor = 1;
+constexpr uint16_t kAFNSWidgetPatchVersionMinor = 0;
+
+enum class AFNSWidgetPatchKind : uint16_t {
+    kInsert = 0,          // node, parent, after; type = AFNSWidgetType, value = name string
+    kRemove = 1,          // node
+    kMove = 2,            // node, parent, after
+    kSetProperty = 3,     // node, key; type = AFNSPropertyType, value as in the tree
+    kRemoveProperty = 4,  // node, key
+};
+
+struct AFNSWidgetPatchHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t op_count;
+    uint32_t string_count;
+    uint32_t string_data_size;
+    uint32_t total_size;
+    uint32_t base_generation;
+    uint32_t generation;
+};
+
+struct AFNSWidgetPatchOp {
+    uint16_t kind;            // AFNSWidgetPatchKind
+    uint16_t type;
+    uint32_t node;
+    // kInsert and kMove: parent id, kAFNSWidgetTreeNone at the top level;
+    // property ops: key string index
+    uint32_t parent_or_key;
+    // kInsert and kMove: id of the sibling to follow, kAFNSWidgetTreeNone
+    // to go first
+    uint32_t after;
+    uint64_t value;
+};
+
+static_assert(sizeof(AFNSWidgetPatchHeader) == 32, "wire layout");
+static_assert(sizeof(AFNSWidgetPatchOp) == 24, "wire layout");
+
+// 🎯 AFNS WIDGET TREE DIFFER
+// Keeps the last tree committed for one widget and the id of every node in
+// it. Siblings are matched by type name and "id" property, or by position
+// among same-named siblings without one; a matched node keeps its id and
+// only its changed properties are sent, other siblings are inserted,
+// removed or moved. Subtrees that did not change cost a walk here and no
+// ops, so the patch, and the work on the Dart side, grows with the number
+// of changed nodes. Thread-safe.
+class AFNSWidgetTreeDiffer {
+public:
+    // Nesting deeper than this fails the diff rather than the stack; the
+    // parser already refuses deeper trees
+    static constexpr size_t kMaxDepth = kAFNSWidgetTreeMaxDepth;
+
+    // Writes the patch from the committed tree to |tree|, which is then
+    // committed if the patch is at most |patch_cap| bytes; otherwise the
+    // next call diffs from the same tree again, so a caller that has to
+    // grow its buffer gets the same patch on retry. False, with nothing
+    // committed, if |tree| is not a readable widget tree.
+    bool Diff(std::string_view tree, size_t patch_cap, std::string* patch);
+
+    // Forgets the committed tree; the next patch starts from empty
+    void Reset();
+
+    uint32_t generation() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::string tree_;
+    std::vector<uint32_t> ids_;  // by node index in |tree_|
+    uint32_t generation_ = 0;
+    uint32_t next_id_ = 0;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_WIDGET_DIFF_H_
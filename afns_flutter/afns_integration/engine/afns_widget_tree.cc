@@ -0,0 +1,513 @@
+// 🚀 AFNS BINARY WIDGET TREE
+// Compact widget-tree encoding that Dart walks straight from a Uint8List
+
+#include "afns_widget_tree.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "afns_state_store.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "AFNS widget trees are serialized in host order, which must be little-endian"
+#endif
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+struct WidgetTypeName {
+    std::string_view name;
+    AFNSWidgetType type;
+};
+
+constexpr WidgetTypeName kWidgetTypeNames[] = {
+    {"Window", AFNSWidgetType::kWindow},
+    {"Button", AFNSWidgetType::kButton},
+    {"TextField", AFNSWidgetType::kTextField},
+    {"ListBox", AFNSWidgetType::kListBox},
+    {"Dialog", AFNSWidgetType::kDialog},
+    {"Text", AFNSWidgetType::kText},
+    {"Column", AFNSWidgetType::kColumn},
+    {"Row", AFNSWidgetType::kRow},
+    {"Container", AFNSWidgetType::kContainer},
+};
+
+inline bool IsIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool IsIdentifierByte(char c) {
+    return IsIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+void AppendPadded(std::string* out, const void* data, size_t size) {
+    out->append(static_cast<const char*>(data), size);
+    out->append((8 - out->size() % 8) % 8, '\0');
+}
+
+// Recursive-descent reader for widget calls, see ParseAFNSWidgetTree
+class WidgetCallParser {
+public:
+    WidgetCallParser(std::string_view source, AFNSWidgetTreeBuilder* builder,
+                     const AFNSStateStore* state)
+        : source_(source), builder_(builder), state_(state) {}
+
+    bool ParseAll() {
+        while (pos_ < source_.size()) {
+            const char c = source_[pos_];
+            if (c == '"' || c == '\'') {
+                SkipLiteral();
+            } else if (StartsComment()) {
+                SkipComment();
+            } else if (IsIdentifierStart(c)) {
+                std::string_view name = ReadIdentifier();
+                if (IsWidgetName(name) && Peek() == '(') {
+                    ParseWidget(name);
+                }
+            } else {
+                ++pos_;
+            }
+        }
+        return !too_deep_;
+    }
+
+private:
+    static bool IsWidgetName(std::string_view name) {
+        return !name.empty() && name[0] >= 'A' && name[0] <= 'Z';
+    }
+
+    // Called with pos_ on the '(' after |name|. A stray ']' or '}' also
+    // ends the arguments and is left for whatever it closes; SkipArgument
+    // stops in front of it, so looping on would never get past it.
+    void ParseWidget(std::string_view name) {
+        if (depth_ == kAFNSWidgetTreeMaxDepth) {
+            // Ends every loop above, which close the nodes they opened
+            too_deep_ = true;
+            pos_ = source_.size();
+            return;
+        }
+        ++depth_;
+        builder_->BeginNode(name);
+        ++pos_;
+        while (SkipSpace(), pos_ < source_.size()) {
+            const char c = source_[pos_];
+            if (c == ')') {
+                ++pos_;
+                break;
+            }
+            if (c == ']' || c == '}') {
+                break;
+            }
+            ParseArgument();
+            SkipSpace();
+            if (pos_ < source_.size() && source_[pos_] == ',') {
+                ++pos_;
+            }
+        }
+        builder_->EndNode();
+        --depth_;
+    }
+
+    void ParseArgument() {
+        if (!IsIdentifierStart(source_[pos_])) {
+            SkipArgument();
+            return;
+        }
+        std::string_view key = ReadIdentifier();
+        std::string_view type_hint;
+        if (Peek() == ':' && pos_ + 1 < source_.size() && source_[pos_ + 1] == ':') {
+            pos_ += 2;
+            SkipSpace();
+            type_hint = ReadIdentifier();
+        }
+        const char next = Peek();
+        if (next == '(' && type_hint.empty() && IsWidgetName(key)) {
+            ParseWidget(key);
+            return;
+        }
+        if (next != '=' || (pos_ + 1 < source_.size() && source_[pos_ + 1] == '=')) {
+            SkipArgument();
+            return;
+        }
+        ++pos_;
+        SkipSpace();
+        ParseValue(key, type_hint);
+    }
+
+    void ParseValue(std::string_view key, std::string_view type_hint) {
+        if (pos_ >= source_.size()) {
+            return;
+        }
+        const char c = source_[pos_];
+        if (c == '"') {
+            builder_->AddString(key, ReadStringLiteral());
+            return;
+        }
+        if ((c >= '0' && c <= '9') || c == '-') {
+            const std::string_view number = source_.substr(pos_, NumberLength());
+            pos_ += number.size();
+            const bool floating = type_hint.substr(0, 1) == "f" ||
+                                  number.find_first_of(".eE") != std::string_view::npos;
+            // strtod needs a terminated copy; longer numbers are not literals
+            char digits[64];
+            const size_t length = std::min(number.size(), sizeof(digits) - 1);
+            std::memcpy(digits, number.data(), length);
+            digits[length] = '\0';
+            if (floating) {
+                builder_->AddDouble(key, std::strtod(digits, nullptr));
+            } else {
+                builder_->AddInt(key, std::strtoll(digits, nullptr, 10));
+            }
+            return;
+        }
+        if (IsIdentifierStart(c)) {
+            std::string_view word = ReadIdentifier();
+            if (word == "true" || word == "false") {
+                builder_->AddBool(key, word == "true");
+                return;
+            }
+            if (word == "state" && Peek() == '(') {
+                ParseStateValue(key);
+                return;
+            }
+        }
+        SkipArgument();
+    }
+
+    // `state("path")`: the value set at the path now, no property if unset
+    void ParseStateValue(std::string_view key) {
+        // Anything else is skipped from the '(' on, so its ')' nests
+        const size_t open = pos_++;
+        const bool literal = Peek() == '"';
+        const std::string path(literal ? ReadStringLiteral() : std::string_view());
+        if (!literal || Peek() != ')') {
+            pos_ = open;
+            SkipArgument();
+            return;
+        }
+        ++pos_;
+        AFNSStateValue value;
+        if (state_ == nullptr || !state_->Get(path, &value)) {
+            return;
+        }
+        switch (value.type) {
+        case AFNSValueType::kBool: builder_->AddBool(key, value.boolean); break;
+        case AFNSValueType::kInt: builder_->AddInt(key, value.integer); break;
+        case AFNSValueType::kFloat: builder_->AddDouble(key, value.number); break;
+        case AFNSValueType::kString: builder_->AddString(key, value.text); break;
+        case AFNSValueType::kNone: break;
+        }
+    }
+
+    size_t NumberLength() const {
+        size_t i = pos_;
+        if (i < source_.size() && source_[i] == '-') {
+            ++i;
+        }
+        while (i < source_.size()) {
+            const char c = source_[i];
+            const bool exponent_sign = (c == '-' || c == '+') && (source_[i - 1] == 'e' || source_[i - 1] == 'E');
+            if (!((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || exponent_sign)) {
+                break;
+            }
+            ++i;
+        }
+        return i - pos_;
+    }
+
+    // Skips to the ',' or ')' ending the current argument, honouring nesting
+    void SkipArgument() {
+        size_t depth = 0;
+        while (pos_ < source_.size()) {
+            const char c = source_[pos_];
+            if (c == '"' || c == '\'') {
+                SkipLiteral();
+                continue;
+            }
+            if (StartsComment()) {
+                SkipComment();
+                continue;
+            }
+            if (c == '(' || c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ')' || c == ']' || c == '}') {
+                if (depth == 0) {
+                    return;
+                }
+                --depth;
+            } else if (c == ',' && depth == 0) {
+                return;
+            }
+            ++pos_;
+        }
+    }
+
+    // Returns a view of the source when the literal has no escapes, else of
+    // a decoded copy that stays valid until the next call
+    std::string_view ReadStringLiteral() {
+        const size_t start = ++pos_;
+        while (pos_ < source_.size() && source_[pos_] != '"' && source_[pos_] != '\\') {
+            ++pos_;
+        }
+        if (pos_ >= source_.size() || source_[pos_] == '"') {
+            const std::string_view value = source_.substr(start, pos_ - start);
+            pos_ = pos_ < source_.size() ? pos_ + 1 : pos_;
+            return value;
+        }
+
+        std::string& value = unescaped_;
+        value.assign(source_.data() + start, pos_ - start);
+        while (pos_ < source_.size() && source_[pos_] != '"') {
+            char c = source_[pos_++];
+            if (c == '\\' && pos_ < source_.size()) {
+                const char escaped = source_[pos_++];
+                switch (escaped) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = '\0'; break;
+                default: c = escaped; break;
+                }
+            }
+            value.push_back(c);
+        }
+        if (pos_ < source_.size()) {
+            ++pos_;
+        }
+        return value;
+    }
+
+    std::string_view ReadIdentifier() {
+        const size_t start = pos_;
+        while (pos_ < source_.size() && IsIdentifierByte(source_[pos_])) {
+            ++pos_;
+        }
+        return source_.substr(start, pos_ - start);
+    }
+
+    bool StartsComment() const {
+        return source_[pos_] == '/' && pos_ + 1 < source_.size() &&
+               (source_[pos_ + 1] == '/' || source_[pos_ + 1] == '*');
+    }
+
+    void SkipComment() {
+        const bool line = source_[pos_ + 1] == '/';
+        const size_t end = line ? source_.find('\n', pos_ + 2) : source_.find("*/", pos_ + 2);
+        pos_ = end == std::string_view::npos ? source_.size() : end + (line ? 0 : 2);
+    }
+
+    void SkipLiteral() {
+        const char quote = source_[pos_++];
+        while (pos_ < source_.size() && source_[pos_] != quote) {
+            pos_ += source_[pos_] == '\\' ? 2 : 1;
+        }
+        pos_ = pos_ < source_.size() ? pos_ + 1 : source_.size();
+    }
+
+    void SkipSpace() {
+        while (pos_ < source_.size()) {
+            const char c = source_[pos_];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++pos_;
+            } else if (StartsComment()) {
+                SkipComment();
+            } else {
+                return;
+            }
+        }
+    }
+
+    char Peek() {
+        SkipSpace();
+        return pos_ < source_.size() ? source_[pos_] : '\0';
+    }
+
+    std::string_view source_;
+    AFNSWidgetTreeBuilder* builder_;
+    const AFNSStateStore* state_;
+    size_t pos_ = 0;
+    size_t depth_ = 0;
+    bool too_deep_ = false;
+    std::string unescaped_;
+};
+
+} // anonymous namespace
+
+AFNSWidgetTreeBuilder::AFNSWidgetTreeBuilder(AFNSInternTable* identifiers, AFNSArena* arena)
+    : arena_(arena),
+      nodes_(arena),
+      open_(arena),
+      string_offsets_(1, 0, arena),
+      string_data_(arena),
+      identifiers_(identifiers),
+      identifier_index_(0, arena),
+      value_index_(0, arena) {}
+
+AFNSWidgetType AFNSWidgetTypeFromName(std::string_view name) {
+    if (name.substr(0, 7) == "Flutter") {
+        name.remove_prefix(7);
+    }
+    for (const WidgetTypeName& entry : kWidgetTypeNames) {
+        if (entry.name == name) {
+            return entry.type;
+        }
+    }
+    return AFNSWidgetType::kCustom;
+}
+
+void AFNSWidgetTreeBuilder::BeginNode(std::string_view type_name) {
+    const uint32_t index = static_cast<uint32_t>(nodes_.size());
+
+    PendingNode pending(arena_);
+    pending.node.type = static_cast<uint16_t>(AFNSWidgetTypeFromName(type_name));
+    pending.node.property_count = 0;
+    pending.node.name = InternIdentifier(type_name);
+    pending.node.first_property = 0;
+    pending.node.first_child = kAFNSWidgetTreeNone;
+    pending.node.next_sibling = kAFNSWidgetTreeNone;
+    pending.node.reserved = 0;
+    nodes_.push_back(std::move(pending));
+
+    if (!open_.empty()) {
+        PendingNode& parent = nodes_[open_.back()];
+        if (parent.last_child == kAFNSWidgetTreeNone) {
+            parent.node.first_child = index;
+        } else {
+            nodes_[parent.last_child].node.next_sibling = index;
+        }
+        parent.last_child = index;
+    } else {
+        if (last_root_ != kAFNSWidgetTreeNone) {
+            nodes_[last_root_].node.next_sibling = index;
+        }
+        last_root_ = index;
+    }
+    open_.push_back(index);
+}
+
+void AFNSWidgetTreeBuilder::EndNode() {
+    if (!open_.empty()) {
+        open_.pop_back();
+    }
+}
+
+void AFNSWidgetTreeBuilder::AddString(std::string_view key, std::string_view value) {
+    AddProperty(key, AFNSPropertyType::kString, InternValue(value));
+}
+
+void AFNSWidgetTreeBuilder::AddInt(std::string_view key, int64_t value) {
+    AddProperty(key, AFNSPropertyType::kInt, static_cast<uint64_t>(value));
+}
+
+void AFNSWidgetTreeBuilder::AddDouble(std::string_view key, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    AddProperty(key, AFNSPropertyType::kDouble, bits);
+}
+
+void AFNSWidgetTreeBuilder::AddBool(std::string_view key, bool value) {
+    AddProperty(key, AFNSPropertyType::kBool, value ? 1 : 0);
+}
+
+std::string AFNSWidgetTreeBuilder::Finish() {
+    open_.clear();
+
+    AFNSArenaVector<AFNSWidgetTreeNode> nodes(arena_);
+    AFNSArenaVector<AFNSWidgetTreeProperty> properties(arena_);
+    nodes.reserve(nodes_.size());
+    for (PendingNode& pending : nodes_) {
+        pending.node.first_property = static_cast<uint32_t>(properties.size());
+        pending.node.property_count = static_cast<uint16_t>(pending.properties.size());
+        properties.insert(properties.end(), pending.properties.begin(), pending.properties.end());
+        nodes.push_back(pending.node);
+    }
+
+    AFNSWidgetTreeHeader header;
+    header.magic = kAFNSWidgetTreeMagic;
+    header.version_major = kAFNSWidgetTreeVersionMajor;
+    header.version_minor = kAFNSWidgetTreeVersionMinor;
+    header.node_count = static_cast<uint32_t>(nodes.size());
+    header.property_count = static_cast<uint32_t>(properties.size());
+    header.string_count = static_cast<uint32_t>(string_offsets_.size() - 1);
+    header.string_data_size = static_cast<uint32_t>(string_data_.size());
+    header.total_size = 0;
+    header.reserved = 0;
+
+    std::string out;
+    out.reserve(sizeof(header) + nodes.size() * sizeof(AFNSWidgetTreeNode) +
+                properties.size() * sizeof(AFNSWidgetTreeProperty) +
+                string_offsets_.size() * sizeof(uint32_t) + string_data_.size() + 32);
+    AppendPadded(&out, &header, sizeof(header));
+    AppendPadded(&out, nodes.data(), nodes.size() * sizeof(AFNSWidgetTreeNode));
+    AppendPadded(&out, properties.data(), properties.size() * sizeof(AFNSWidgetTreeProperty));
+    AppendPadded(&out, string_offsets_.data(), string_offsets_.size() * sizeof(uint32_t));
+    AppendPadded(&out, string_data_.data(), string_data_.size());
+
+    const uint32_t total_size = static_cast<uint32_t>(out.size());
+    std::memcpy(&out[offsetof(AFNSWidgetTreeHeader, total_size)], &total_size, sizeof(total_size));
+    return out;
+}
+
+uint32_t AFNSWidgetTreeBuilder::InternIdentifier(std::string_view name) {
+    const uint32_t id = identifiers_ ? identifiers_->Intern(name) : kAFNSInternNone;
+    if (id == kAFNSInternNone) {
+        return InternValue(name);
+    }
+    auto it = identifier_index_.find(id);
+    if (it != identifier_index_.end()) {
+        return it->second;
+    }
+    const uint32_t index = InternValue(name);
+    identifier_index_.emplace(id, index);
+    return index;
+}
+
+uint32_t AFNSWidgetTreeBuilder::InternValue(std::string_view value) {
+    // Keyed by hash and checked against the stored bytes; a collision just
+    // stores the value twice
+    const size_t hash = std::hash<std::string_view>()(value);
+    auto it = value_index_.find(hash);
+    if (it != value_index_.end()) {
+        const uint32_t start = string_offsets_[it->second];
+        const uint32_t end = string_offsets_[it->second + 1];
+        if (std::string_view(string_data_).substr(start, end - start) == value) {
+            return it->second;
+        }
+    }
+    const uint32_t index = AppendString(value);
+    value_index_.emplace(hash, index);
+    return index;
+}
+
+uint32_t AFNSWidgetTreeBuilder::AppendString(std::string_view value) {
+    const uint32_t index = static_cast<uint32_t>(string_offsets_.size() - 1);
+    string_data_.append(value.data(), value.size());
+    string_offsets_.push_back(static_cast<uint32_t>(string_data_.size()));
+    return index;
+}
+
+void AFNSWidgetTreeBuilder::AddProperty(std::string_view key, AFNSPropertyType type, uint64_t value) {
+    if (open_.empty()) {
+        return;
+    }
+    AFNSWidgetTreeProperty property;
+    property.key = InternIdentifier(key);
+    property.type = static_cast<uint16_t>(type);
+    property.reserved = 0;
+    property.value = value;
+    nodes_[open_.back()].properties.push_back(property);
+}
+
+bool ParseAFNSWidgetTree(std::string_view source, AFNSWidgetTreeBuilder* builder,
+                         const AFNSStateStore* state) {
+    return WidgetCallParser(source, builder, state).ParseAll();
+}
+
+} // namespace afns
+
+} // namespace flutter
@@ -0,0 +1,167 @@
+// 🚀 AFNS BINARY WIDGET TREE
+// Compact widget-tree encoding that Dart walks straight from a Uint8List
+
+#ifndef FLUTTER_AFNS_AFNS_WIDGET_TREE_H_
+#define FLUTTER_AFNS_AFNS_WIDGET_TREE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "afns_arena.h"
+#include "afns_intern_table.h"
+
+namespace flutter {
+
+namespace afns {
+
+class AFNSStateStore;
+
+// Wire format, all integers little-endian, sections 8-byte aligned:
+//
+//   header     AFNSWidgetTreeHeader (32 bytes)
+//   nodes      node_count x AFNSWidgetTreeNode (24 bytes), pre-order
+//   properties property_count x AFNSWidgetTreeProperty (16 bytes)
+//   strings    (string_count + 1) x u32 offsets into the string blob
+//   blob       string_data_size bytes of UTF-8
+//
+// Node 0 is the first root; further roots and all children are chained
+// through next_sibling. A node's properties are contiguous. Readers must
+// reject a different major version; minor versions only append fields.
+constexpr uint32_t kAFNSWidgetTreeMagic = 0x54574641;  // "AFWT"
+constexpr uint16_t kAFNSWidgetTreeVersionMajor = 1;
+constexpr uint16_t kAFNSWidgetTreeVersionMinor = 0;
+constexpr uint32_t kAFNSWidgetTreeNone = 0xFFFFFFFFu;
+
+// Known widget types; anything else is kCustom and carries its name
+enum class AFNSWidgetType : uint16_t {
+    kCustom = 0,
+    kWindow = 1,
+    kButton = 2,
+    kTextField = 3,
+    kListBox = 4,
+    kDialog = 5,
+    kText = 6,
+    kColumn = 7,
+    kRow = 8,
+    kContainer = 9,
+};
+
+enum class AFNSPropertyType : uint16_t {
+    kString = 0,  // value = string index
+    kInt = 1,     // value = int64
+    kDouble = 2,  // value = IEEE-754 bits
+    kBool = 3,    // value = 0 or 1
+};
+
+struct AFNSWidgetTreeHeader {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t node_count;
+    uint32_t property_count;
+    uint32_t string_count;
+    uint32_t string_data_size;
+    uint32_t total_size;
+    uint32_t reserved;
+};
+
+struct AFNSWidgetTreeNode {
+    uint16_t type;            // AFNSWidgetType
+    uint16_t property_count;
+    uint32_t name;            // string index of the type name
+    uint32_t first_property;
+    uint32_t first_child;     // kAFNSWidgetTreeNone if leaf
+    uint32_t next_sibling;    // kAFNSWidgetTreeNone if last
+    uint32_t reserved;
+};
+
+struct AFNSWidgetTreeProperty {
+    uint32_t key;             // string index
+    uint16_t type;            // AFNSPropertyType
+    uint16_t reserved;
+    uint64_t value;
+};
+
+static_assert(sizeof(AFNSWidgetTreeHeader) == 32, "wire layout");
+static_assert(sizeof(AFNSWidgetTreeNode) == 24, "wire layout");
+static_assert(sizeof(AFNSWidgetTreeProperty) == 16, "wire layout");
+
+// Maps "FlutterButton", "Button", ... to its tag
+AFNSWidgetType AFNSWidgetTypeFromName(std::string_view name);
+
+// 🎯 AFNS WIDGET TREE BUILDER
+// Nodes are opened and closed like a stack; a node opened while another is
+// open becomes its last child, otherwise a new root. Type names and property
+// keys are deduplicated through |identifiers| when given, so a repeated name
+// costs an id lookup instead of a string copy; values are deduplicated per
+// tree. All working memory comes from |arena| when given, only the result of
+// Finish() is heap allocated.
+class AFNSWidgetTreeBuilder {
+public:
+    explicit AFNSWidgetTreeBuilder(AFNSInternTable* identifiers = nullptr,
+                                   AFNSArena* arena = nullptr);
+
+    void BeginNode(std::string_view type_name);
+    void EndNode();
+
+    // Properties attach to the innermost open node
+    void AddString(std::string_view key, std::string_view value);
+    void AddInt(std::string_view key, int64_t value);
+    void AddDouble(std::string_view key, double value);
+    void AddBool(std::string_view key, bool value);
+
+    size_t node_count() const { return nodes_.size(); }
+
+    // Serializes the tree; open nodes are closed first
+    std::string Finish();
+
+private:
+    struct PendingNode {
+        explicit PendingNode(AFNSArena* arena) : properties(arena) {}
+
+        AFNSWidgetTreeNode node;
+        AFNSArenaVector<AFNSWidgetTreeProperty> properties;
+        uint32_t last_child = kAFNSWidgetTreeNone;
+    };
+
+    // Both return an index into this tree's string table
+    uint32_t InternIdentifier(std::string_view name);
+    uint32_t InternValue(std::string_view value);
+    uint32_t AppendString(std::string_view value);
+    void AddProperty(std::string_view key, AFNSPropertyType type, uint64_t value);
+
+    AFNSArena* arena_;
+    AFNSArenaVector<PendingNode> nodes_;
+    AFNSArenaVector<uint32_t> open_;
+    uint32_t last_root_ = kAFNSWidgetTreeNone;
+
+    AFNSArenaVector<uint32_t> string_offsets_;
+    AFNSArenaString string_data_;
+    AFNSInternTable* identifiers_;
+    AFNSArenaHashMap<uint32_t, uint32_t> identifier_index_;  // table id -> string
+    AFNSArenaHashMap<size_t, uint32_t> value_index_;         // hash -> string
+};
+
+// Deepest widget nesting ParseAFNSWidgetTree accepts; it recurses per level
+constexpr size_t kAFNSWidgetTreeMaxDepth = 512;
+
+// Extracts widget calls such as
+//   FlutterColumn(id::string = "main", FlutterButton(text::string = "Save", x::i32 = 50))
+// from AFNS source: an uppercase identifier followed by '(' opens a widget,
+// `key::type = literal` and `key = literal` arguments become properties and
+// nested widget calls become children. A `key = state("path")` argument
+// takes the value set at the path in |state|, recording the read in the
+// thread's AFNSStateReadScope, and adds no property while the path is
+// unset. Code inside literals and comments is ignored. False if widget
+// calls nest deeper than kAFNSWidgetTreeMaxDepth, in which case parsing
+// stops and the builder holds only what came before.
+bool ParseAFNSWidgetTree(std::string_view source, AFNSWidgetTreeBuilder* builder,
+                         const AFNSStateStore* state = nullptr);
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_WIDGET_TREE_H_
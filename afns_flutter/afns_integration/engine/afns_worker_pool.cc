@@ -0,0 +1,172 @@
+// 🚀 AFNS ENGINE WORKER POOL
+// Lazily started work-stealing thread pool owned by AFNSEngineExtension
+
+#include "afns_worker_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace flutter {
+
+namespace afns {
+
+namespace {
+
+// Tasks per worker a ParallelFor is split into: enough slack for stealing
+// to even out uneven items without paying per-item task overhead
+constexpr size_t kChunksPerWorker = 8;
+
+// Counts outstanding chunks of one ParallelFor call
+struct CompletionLatch {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+
+    void CountDown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+};
+
+} // anonymous namespace
+
+size_t AFNSWorkerPool::DefaultThreadCount(size_t cap) {
+    const size_t hardware = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(hardware, cap));
+}
+
+AFNSWorkerPool::AFNSWorkerPool(size_t thread_count) {
+    thread_count = std::max<size_t>(1, thread_count);
+    queues_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+}
+
+AFNSWorkerPool::~AFNSWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void AFNSWorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        body(0);
+        return;
+    }
+
+    EnsureStarted();
+
+    const size_t workers = queues_.size();
+    const size_t chunk_size = std::max<size_t>(1, count / (workers * kChunksPerWorker));
+    const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    CompletionLatch latch;
+    latch.remaining = chunk_count;
+
+    // Contiguous runs of chunks per queue keep neighbouring items together
+    // until someone has to steal them
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t begin = chunk * chunk_size;
+        const size_t end = std::min(count, begin + chunk_size);
+        Push(chunk * workers / chunk_count, [&body, &latch, begin, end] {
+            for (size_t i = begin; i < end; ++i) {
+                body(i);
+            }
+            latch.CountDown();
+        });
+    }
+
+    // Help instead of blocking, then wait for chunks still running elsewhere
+    while (TryRunOne(0)) {
+    }
+    std::unique_lock<std::mutex> lock(latch.mutex);
+    latch.done.wait(lock, [&latch] { return latch.remaining == 0; });
+}
+
+void AFNSWorkerPool::Post(std::function<void()> task) {
+    EnsureStarted();
+    const size_t queue_index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    Push(queue_index, std::move(task));
+}
+
+void AFNSWorkerPool::EnsureStarted() {
+    std::call_once(start_once_, [this] {
+        threads_.reserve(queues_.size());
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            threads_.emplace_back(&AFNSWorkerPool::WorkerLoop, this, i);
+        }
+        started_.store(true, std::memory_order_release);
+    });
+}
+
+void AFNSWorkerPool::Push(size_t queue_index, Task task) {
+    {
+        WorkQueue& queue = *queues_[queue_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    // Taking the lock orders this push against a worker about to sleep
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_one();
+}
+
+void AFNSWorkerPool::WorkerLoop(size_t index) {
+    for (;;) {
+        if (TryRunOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stopping_ || pending_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+bool AFNSWorkerPool::TryRunOne(size_t home) {
+    Task task;
+    const size_t queue_count = queues_.size();
+
+    {
+        WorkQueue& own = *queues_[home];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    for (size_t offset = 1; !task && offset < queue_count; ++offset) {
+        WorkQueue& victim = *queues_[(home + offset) % queue_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    pending_.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+} // namespace afns
+
+} // namespace flutter
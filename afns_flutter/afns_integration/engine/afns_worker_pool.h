@@ -0,0 +1,81 @@
+// 🚀 AFNS ENGINE WORKER POOL
+// Lazily started work-stealing thread pool owned by AFNSEngineExtension
+
+#ifndef FLUTTER_AFNS_AFNS_WORKER_POOL_H_
+#define FLUTTER_AFNS_AFNS_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flutter {
+
+namespace afns {
+
+// 🎯 AFNS WORKER POOL
+// Every worker owns a deque: it pops its own tasks from the back and, when
+// empty, steals from the front of the others, so uneven task sizes still
+// balance out. No thread is created until the first task arrives; after
+// that the workers stay warm until the pool is destroyed.
+class AFNSWorkerPool {
+public:
+    static constexpr size_t kMaxWorkerThreads = 8;
+
+    // Hardware concurrency clamped to [1, |cap|]
+    static size_t DefaultThreadCount(size_t cap = kMaxWorkerThreads);
+
+    explicit AFNSWorkerPool(size_t thread_count = DefaultThreadCount());
+    ~AFNSWorkerPool();
+
+    AFNSWorkerPool(const AFNSWorkerPool&) = delete;
+    AFNSWorkerPool& operator=(const AFNSWorkerPool&) = delete;
+
+    // Runs body(i) for every i in [0, count) and returns once all are done.
+    // The calling thread helps, so nested calls from a worker are safe.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // Fire-and-forget task on a worker
+    void Post(std::function<void()> task);
+
+    size_t thread_count() const { return queues_.size(); }
+    bool started() const { return started_.load(std::memory_order_acquire); }
+
+private:
+    using Task = std::function<void()>;
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void EnsureStarted();
+    void Push(size_t queue_index, Task task);
+    void WorkerLoop(size_t index);
+
+    // Pops from |home| first, then steals from the other queues
+    bool TryRunOne(size_t home);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::once_flag start_once_;
+    std::atomic<bool> started_{false};
+    std::atomic<size_t> next_queue_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_{0};
+    bool stopping_ = false;
+};
+
+} // namespace afns
+
+} // namespace flutter
+
+#endif  // FLUTTER_AFNS_AFNS_WORKER_POOL_H_
@@ -0,0 +1,994 @@
+// 🚀 AFNS ENGINE TESTS
+// Regression checks on engine internals that the C ABI cannot reach,
+// e.g. parsers the validator normally shields, and on engine paths that
+// must agree with each other
+//
+// Built by ../CMakeLists.txt unless -DAFNS_BUILD_TESTS=OFF and run by
+// ctest, under a timeout so a hang fails too. Each test is a function
+// registered with AFNS_TEST; a failed AFNS_EXPECT reports its line and the
+// test goes on, the process exits non-zero if any failed.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "afns_bundle.h"
+#include "afns_bytecode.h"
+#include "afns_engine.h"
+#include "afns_engine_c_api.h"
+#include "afns_packed_strings.h"
+#include "afns_rewriter.h"
+#include "afns_tiering.h"
+#include "afns_vm.h"
+#include "afns_widget_diff.h"
+#include "afns_widget_tree.h"
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int g_failures = 0;
+
+struct Registration {
+    Registration(const char* name, void (*run)()) { Registry().push_back({name, run}); }
+};
+
+#define AFNS_TEST(name)                                         \
+    void name();                                                \
+    const Registration name##_registration(#name, &name);      \
+    void name()
+
+#define AFNS_EXPECT(condition)                                                    \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+            ++g_failures;                                                         \
+        }                                                                         \
+    } while (false)
+
+// 🎯 WIDGET TREE PARSER
+// A stray closer used to leave SkipArgument where it was and ParseWidget
+// looping on it forever
+AFNS_TEST(WidgetTreeStopsAtStrayCloser) {
+    for (std::string_view source : {"FlutterButton(x = 1 ]", "FlutterButton(x = 1 }",
+                                    "FlutterColumn(FlutterText(text = \"a\" ] )",
+                                    "FlutterButton(]", "[FlutterButton(x = 1 }]"}) {
+        flutter::afns::AFNSWidgetTreeBuilder builder;
+        AFNS_EXPECT(flutter::afns::ParseAFNSWidgetTree(source, &builder));
+        AFNS_EXPECT(builder.node_count() >= 1);
+    }
+}
+
+// The parser recursed once per nested widget call with no limit
+AFNS_TEST(WidgetTreeRejectsDeepNesting) {
+    auto nested = [](size_t depth) {
+        std::string source;
+        for (size_t i = 0; i < depth; ++i) {
+            source += "A(";
+        }
+        source += "x = 1";
+        for (size_t i = 0; i < depth; ++i) {
+            source += ")";
+        }
+        return source;
+    };
+    {
+        flutter::afns::AFNSWidgetTreeBuilder builder;
+        AFNS_EXPECT(!flutter::afns::ParseAFNSWidgetTree(nested(200000), &builder));
+    }
+    {
+        flutter::afns::AFNSWidgetTreeBuilder builder;
+        AFNS_EXPECT(flutter::afns::ParseAFNSWidgetTree(nested(flutter::afns::kAFNSWidgetTreeMaxDepth), &builder));
+        AFNS_EXPECT(builder.node_count() == flutter::afns::kAFNSWidgetTreeMaxDepth);
+    }
+
+    flutter::afns::AFNSEngineExtension engine;
+    std::string tree;
+    AFNS_EXPECT(!engine.CompileAFNSWidgetTree(nested(200000), &tree));
+    AFNS_EXPECT(engine.CompileAFNSWidgetTree(nested(64), &tree));
+}
+
+// 🎯 VM STRING LIMITS
+// Concatenation used to be capped only at UINT32_MAX, and every
+// intermediate stays in the arena until the run ends
+AFNS_TEST(VmStopsRunawayConcatenation) {
+    for (std::string_view source :
+         {"apex() { var s = \"x\"; while 1 < 2 { s = s + s; } }",
+          "apex() { var s = \"x\"; while 1 < 2 { s = s + \"x\"; } }"}) {
+        auto program = flutter::afns::CompileAFNSLogic(source);
+        AFNS_EXPECT(program != nullptr && program->ok());
+        if (program == nullptr || !program->ok()) {
+            continue;
+        }
+        const flutter::afns::AFNSLogicResult result = flutter::afns::RunAFNSLogic(*program);
+        AFNS_EXPECT(!result.ok());
+        AFNS_EXPECT(result.error == "string_too_long");
+    }
+}
+
+// 🎯 VM RUNTIME
+flutter::afns::AFNSLogicResult Run(std::string_view source,
+                                   uint64_t step_budget = flutter::afns::kAFNSDefaultStepBudget,
+                                   const flutter::afns::AFNSStateStore* state = nullptr) {
+    auto program = flutter::afns::CompileAFNSLogic(source);
+    AFNS_EXPECT(program->ok());
+    if (!program->ok()) {
+        return {};
+    }
+    return flutter::afns::RunAFNSLogic(*program, step_budget, state);
+}
+
+AFNS_TEST(VmIntegerDivisionEdges) {
+    for (std::string_view source : {"apex() { show(1 / 0); }", "apex() { show(1 % 0); }",
+                                    "apex() { var z = 0; show(7 / z); }"}) {
+        const flutter::afns::AFNSLogicResult result = Run(source);
+        AFNS_EXPECT(result.status == flutter::afns::AFNSLogicStatus::kRuntimeError);
+        AFNS_EXPECT(result.error == "division_by_zero");
+    }
+
+    // Wraps instead of trapping the way x86 idiv does on INT64_MIN / -1
+    const flutter::afns::AFNSLogicResult result =
+        Run("apex() { var m = -9223372036854775807 - 1; var d = -1; show(m / d); show(m % d); }");
+    AFNS_EXPECT(result.ok());
+    AFNS_EXPECT(result.output == "-9223372036854775808\n0");
+
+    AFNS_EXPECT(Run("apex() { show(1.5 / 0); }").output == "inf");
+}
+
+AFNS_TEST(VmStopsAtStepLimit) {
+    const flutter::afns::AFNSLogicResult result = Run("apex() { while 1 < 2 { } }", 1000);
+    AFNS_EXPECT(result.status == flutter::afns::AFNSLogicStatus::kStepLimit);
+    AFNS_EXPECT(result.error == "step_limit_exceeded");
+    AFNS_EXPECT(result.steps == 1000);
+
+    AFNS_EXPECT(Run("apex() { var i = 0; while i < 10 { i = i + 1; } show(i); }", 1000).output == "10");
+}
+
+AFNS_TEST(VmStopsRunawayRecursion) {
+    const flutter::afns::AFNSLogicResult result =
+        Run("fun f(n::i32) -> i32 { return f(n + 1); }\napex() { show(f(0)); }");
+    AFNS_EXPECT(result.status == flutter::afns::AFNSLogicStatus::kStackOverflow);
+    AFNS_EXPECT(result.error == "stack_overflow");
+
+    AFNS_EXPECT(Run("fun f(n::i32) -> i32 { if n == 0 { return 0; } return 1 + f(n - 1); }\n"
+                    "apex() { show(f(100)); }")
+                    .output == "100");
+}
+
+AFNS_TEST(VmReadsKeyedState) {
+    flutter::afns::AFNSStateStore state;
+    state.Set("a", flutter::afns::AFNSStateValue::Int(5));
+    state.Set("s", flutter::afns::AFNSStateValue::String("hi"));
+    const std::string_view source =
+        "apex() { show(state(\"a\") + 1); show(state(\"s\")); show(state(\"missing\")); }";
+
+    flutter::afns::AFNSStateReadScope reads;
+    AFNS_EXPECT(Run(source, flutter::afns::kAFNSDefaultStepBudget, &state).output == "6\nhi\nnull");
+    AFNS_EXPECT((reads.TakePaths() == std::vector<std::string>{"a", "missing", "s"}));
+
+    // Without a store every path reads as none
+    AFNS_EXPECT(Run("apex() { show(state(\"a\")); }").output == "null");
+}
+
+// A stored program is checked as it is loaded, not trusted
+AFNS_TEST(VmRejectsDamagedSerializedPrograms) {
+    const std::string_view source =
+        "fun add(a::i32, b::i32) -> i32 { return a + b; }\n"
+        "apex() { var i = 0; while i < 10 { i = add(i, 1); } show(\"n=\" + i); }";
+    auto program = flutter::afns::CompileAFNSLogic(source);
+    AFNS_EXPECT(program->ok());
+    const std::string data = flutter::afns::SerializeAFNSBytecode(*program);
+    AFNS_EXPECT(!data.empty());
+
+    auto loaded = flutter::afns::LoadAFNSBytecode(source, data);
+    AFNS_EXPECT(loaded != nullptr);
+    if (loaded != nullptr) {
+        AFNS_EXPECT(flutter::afns::RunAFNSLogic(*loaded).output == "n=10");
+    }
+
+    for (size_t length = 0; length < data.size(); ++length) {
+        AFNS_EXPECT(flutter::afns::LoadAFNSBytecode(source, data.substr(0, length)) == nullptr);
+    }
+
+    // The format version follows the 4-byte magic
+    std::string other_version = data;
+    other_version[4] ^= 1;
+    AFNS_EXPECT(flutter::afns::LoadAFNSBytecode(source, other_version) == nullptr);
+
+    // Any single bit flip is either rejected or yields code that runs to
+    // some end without leaving its frame or the constant pool
+    for (size_t i = 0; i < data.size(); ++i) {
+        for (int bit = 0; bit < 8; ++bit) {
+            std::string damaged = data;
+            damaged[i] = static_cast<char>(damaged[i] ^ (1 << bit));
+            if (auto program = flutter::afns::LoadAFNSBytecode(source, damaged)) {
+                flutter::afns::RunAFNSLogic(*program, 10000);
+            }
+        }
+    }
+}
+
+// 🎯 LOGIC TIERING
+// Runs |source| with tiering off, then on; both must print the same.
+// AFNS_DISABLE_LOGIC_TIERING builds run baseline code both times.
+std::string RunBothTiers(std::string_view source, flutter::afns::AFNSTieringStats* delta) {
+    auto program_off = flutter::afns::CompileAFNSLogic(source);
+    auto program_on = flutter::afns::CompileAFNSLogic(source);
+    AFNS_EXPECT(program_off->ok() && program_on->ok());
+    if (!program_off->ok() || !program_on->ok()) {
+        return {};
+    }
+
+    flutter::afns::SetAFNSTieringEnabled(false);
+    const flutter::afns::AFNSTieringStats before_off = flutter::afns::GetAFNSTieringStats();
+    const flutter::afns::AFNSLogicResult off = flutter::afns::RunAFNSLogic(*program_off);
+    const flutter::afns::AFNSTieringStats after_off = flutter::afns::GetAFNSTieringStats();
+    AFNS_EXPECT(after_off.tier_ups == before_off.tier_ups);
+    AFNS_EXPECT(after_off.deoptimizations == before_off.deoptimizations);
+
+    flutter::afns::SetAFNSTieringEnabled(true);
+    const flutter::afns::AFNSTieringStats before = flutter::afns::GetAFNSTieringStats();
+    const flutter::afns::AFNSLogicResult on = flutter::afns::RunAFNSLogic(*program_on);
+    const flutter::afns::AFNSTieringStats after = flutter::afns::GetAFNSTieringStats();
+    delta->tier_ups = after.tier_ups - before.tier_ups;
+    delta->deoptimizations = after.deoptimizations - before.deoptimizations;
+
+    AFNS_EXPECT(off.status == on.status);
+    AFNS_EXPECT(off.output == on.output);
+    AFNS_EXPECT(off.error == on.error);
+    return on.output;
+}
+
+AFNS_TEST(TieringKeepsResults) {
+    flutter::afns::AFNSTieringStats delta;
+    // Every fused form: compare-branch on registers and on a constant, on
+    // either side, and arithmetic with a constant on either side
+    const std::string output = RunBothTiers(
+        "apex() { var i = 0; var a = 0; var b = 0; var n = 3000;\n"
+        "  while i < n {\n"
+        "    if i <= 10 { a = a + 1; } if i > 2990 { a = a + 2; } if i >= 2999 { a = a * 3; }\n"
+        "    if i == 1500 { b = 100 - b; } if i != 7 { b = b + 1; } if 5 < i { b = 2 * b - b; }\n"
+        "    if i == n { b = 0; } if a != b { a = a - 1; a = a + 1; }\n"
+        "    i = i + 1;\n"
+        "  }\n"
+        "  show(i); show(a); show(b); }",
+        &delta);
+    AFNS_EXPECT(output == "3000\n87\n101");
+    AFNS_EXPECT(delta.tier_ups >= 1 || !flutter::afns::AFNSTieringEnabled());
+    AFNS_EXPECT(delta.deoptimizations == 0);
+}
+
+// A guarded integer operand that turns out a float or a string goes back to
+// baseline code at the same pc, with baseline semantics
+AFNS_TEST(TieringDeoptimizesOnOtherTypes) {
+    flutter::afns::AFNSTieringStats delta;
+    RunBothTiers("apex() { var x = 0; var i = 0;\n"
+                 "  while i < 3000 { if i == 2000 { x = 0.5; } x = x + 1; i = i + 1; }\n"
+                 "  show(x); }",
+                 &delta);
+    AFNS_EXPECT(delta.tier_ups >= 1 || !flutter::afns::AFNSTieringEnabled());
+    AFNS_EXPECT(delta.deoptimizations >= 1 || !flutter::afns::AFNSTieringEnabled());
+
+    RunBothTiers("apex() { var s = 0; var i = 0;\n"
+                 "  while i < 2100 { if i == 2000 { s = \"s\"; } s = s + 1; i = i + 1; }\n"
+                 "  show(s); }",
+                 &delta);
+    AFNS_EXPECT(delta.deoptimizations >= 1 || !flutter::afns::AFNSTieringEnabled());
+
+    // The loop bound turns float while the fused compare-branch runs
+    RunBothTiers("apex() { var n = 3000; var i = 0;\n"
+                 "  while i < n { if i == 1500 { n = 2500.5; } i = i + 1; }\n"
+                 "  show(i); show(n); }",
+                 &delta);
+    AFNS_EXPECT(delta.deoptimizations >= 1 || !flutter::afns::AFNSTieringEnabled());
+}
+
+// Each deopt leaves its site generic in the next version, and a function
+// gets kAFNSMaxOptimizations versions at most
+AFNS_TEST(TieringStopsAfterMaxOptimizations) {
+    auto program = flutter::afns::CompileAFNSLogic(
+        "fun hot(x::i32) -> i32 { var y = x + 1; y = y + 2; y = y + 3; y = y + 4; y = y + 5;\n"
+        "  y = y + 6; y = y * 7; return y - 8; }");
+    AFNS_EXPECT(program->ok());
+    if (!program->ok()) {
+        return;
+    }
+    size_t hot = 0;
+    while (hot < program->functions().size() && program->functions()[hot].name != "hot") {
+        ++hot;
+    }
+    AFNS_EXPECT(hot < program->functions().size());
+    if (hot == program->functions().size()) {
+        return;
+    }
+
+    flutter::afns::AFNSTierState* tiers = program->tiers();
+    const size_t length = program->functions()[hot].code.size();
+    uint32_t versions = 0;
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        tiers->RecordHotness(hot, flutter::afns::kAFNSTierUpThreshold);
+        if (!tiers->IsOptimized(hot)) {
+            break;
+        }
+        ++versions;
+        size_t pc = 0;
+        while (pc < length && tiers->Code(hot)[pc].op == tiers->BaselineCode(hot)[pc].op) {
+            ++pc;
+        }
+        AFNS_EXPECT(pc < length);
+        tiers->Deoptimize(hot, pc);
+        AFNS_EXPECT(!tiers->IsOptimized(hot));
+    }
+    AFNS_EXPECT(versions == flutter::afns::kAFNSMaxOptimizations);
+}
+
+// 🎯 LOGIC COMPILER NESTING
+// Balanced input passes the validator, and the parser recursed once per
+// parenthesis, call, block or prefix operator until the stack ran out
+std::string Nested(std::string_view open, std::string_view inner, std::string_view close,
+                   size_t depth) {
+    std::string text;
+    for (size_t i = 0; i < depth; ++i) {
+        text += open;
+    }
+    text += inner;
+    for (size_t i = 0; i < depth; ++i) {
+        text += close;
+    }
+    return text;
+}
+
+AFNS_TEST(LogicCompilerRejectsDeepNesting) {
+    const std::string deep[] = {
+        "show(" + Nested("(", "1", ")", 100000) + ");",
+        "fun A(x::i32) -> i32 { return x; }\napex() { show(" + Nested("A(", "1", ")", 20000) + "); }",
+        "apex() " + Nested("{ ", "show(1);", " }", 100000),
+        "show(" + Nested("-", "x", "", 100000) + ");",
+    };
+    flutter::afns::AFNSEngineExtension engine;
+    for (const std::string& source : deep) {
+        auto program = flutter::afns::CompileAFNSLogic(source);
+        AFNS_EXPECT(program != nullptr && !program->ok());
+        AFNS_EXPECT(program != nullptr && program->error() == "nesting too deep");
+        // Falls back as other compile errors do, instead of crashing
+        engine.ExecuteAFNSLogic(source);
+    }
+
+    // Ordinary nesting still compiles and runs
+    auto program = flutter::afns::CompileAFNSLogic("show(" + Nested("(", "1", ")", 100) + ");");
+    AFNS_EXPECT(program != nullptr && program->ok());
+    if (program != nullptr && program->ok()) {
+        AFNS_EXPECT(flutter::afns::RunAFNSLogic(*program).output == "1");
+    }
+}
+
+// 🎯 STATE
+// Every execute used to copy its whole result into the published state
+AFNS_TEST(ExecuteStateIsBoundedMarker) {
+    flutter::afns::AFNSEngineExtension engine;
+    const std::string result = engine.ExecuteAFNSLogic(
+        "apex() { var s = \"x\"; var i = 0; while i < 16 { s = s + s; i = i + 1; } show(s); }");
+    AFNS_EXPECT(result.size() >= 65536);
+    auto snapshot = engine.GetAFNSStateSnapshot();
+    AFNS_EXPECT(snapshot != nullptr);
+    if (snapshot != nullptr) {
+        AFNS_EXPECT(snapshot->state.size() < 64);
+        AFNS_EXPECT(snapshot->state.rfind("EXECUTED: " + std::to_string(result.size()) + " bytes", 0) == 0);
+    }
+}
+
+// A result held for a buffer retry was matched on the code alone, so a
+// later execute of that code returned it even after the state changed
+AFNS_TEST(HeldExecuteResultDoesNotOutliveTheState) {
+    using flutter::afns::AFNSStateValue;
+    flutter::afns::AFNSEngineExtension engine;
+    flutter::afns::AFNSEngineContext* context = engine.default_context();
+    const std::string code = "apex() { show(state(\"n\")); }";
+
+    engine.SetAFNSStateValue("n", AFNSStateValue::Int(1));
+    AFNS_EXPECT(engine.ExecuteAFNSLogic(context, code, 0) == "1");
+    engine.SetAFNSStateValue("n", AFNSStateValue::Int(2));
+    AFNS_EXPECT(engine.ExecuteAFNSLogic(context, code, 0) == "2");
+
+    // The retry right after gets the held result without another run
+    const uint64_t version = engine.GetAFNSStateVersion();
+    AFNS_EXPECT(engine.ExecuteAFNSLogic(context, code, 0) == "2");
+    AFNS_EXPECT(engine.GetAFNSStateVersion() == version);
+
+    // A state text update in between runs it again
+    AFNS_EXPECT(engine.ExecuteAFNSLogic(context, code, 0) == "2");
+    engine.UpdateAFNSSState("other");
+    const uint64_t updated = engine.GetAFNSStateVersion();
+    AFNS_EXPECT(engine.ExecuteAFNSLogic(context, code, 0) == "2");
+    AFNS_EXPECT(engine.GetAFNSStateVersion() == updated + 1);
+}
+
+// 🎯 WIDGET TREE DIFF
+std::string WidgetTree(std::string_view source) {
+    flutter::afns::AFNSWidgetTreeBuilder builder;
+    AFNS_EXPECT(flutter::afns::ParseAFNSWidgetTree(source, &builder));
+    return builder.Finish();
+}
+
+template <typename T>
+T ReadAt(std::string_view bytes, size_t offset) {
+    T value{};
+    if (offset + sizeof(T) <= bytes.size()) {
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    }
+    return value;
+}
+
+size_t Align8(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// String |index| of a table of |count| + 1 offsets at |offsets_at|
+std::string StringAt(std::string_view bytes, size_t offsets_at, uint32_t count, uint32_t index) {
+    const size_t blob_at = offsets_at + Align8((size_t{count} + 1) * sizeof(uint32_t));
+    const uint32_t begin = ReadAt<uint32_t>(bytes, offsets_at + size_t{index} * sizeof(uint32_t));
+    const uint32_t end = ReadAt<uint32_t>(bytes, offsets_at + (size_t{index} + 1) * sizeof(uint32_t));
+    return std::string(bytes.substr(blob_at + begin, end - begin));
+}
+
+// What a Dart reader keeps: nodes by id, properties as "type:value" text
+// with string values resolved
+class PatchedTree {
+public:
+    struct Counts {
+        size_t inserts = 0;
+        size_t removes = 0;
+        size_t moves = 0;
+        size_t sets = 0;
+        size_t property_removes = 0;
+    };
+
+    Counts Apply(std::string_view patch) {
+        using flutter::afns::AFNSWidgetPatchKind;
+        Counts counts;
+        const auto header = ReadAt<flutter::afns::AFNSWidgetPatchHeader>(patch, 0);
+        AFNS_EXPECT(header.magic == flutter::afns::kAFNSWidgetPatchMagic);
+        AFNS_EXPECT(header.total_size == patch.size());
+        AFNS_EXPECT(header.base_generation == generation_);
+        generation_ = header.generation;
+        const size_t ops_at = sizeof(header);
+        const size_t strings_at = ops_at + Align8(size_t{header.op_count} * sizeof(flutter::afns::AFNSWidgetPatchOp));
+        auto string = [&](uint64_t index) {
+            return StringAt(patch, strings_at, header.string_count, static_cast<uint32_t>(index));
+        };
+        for (uint32_t i = 0; i < header.op_count; ++i) {
+            const auto op = ReadAt<flutter::afns::AFNSWidgetPatchOp>(
+                patch, ops_at + size_t{i} * sizeof(flutter::afns::AFNSWidgetPatchOp));
+            switch (static_cast<AFNSWidgetPatchKind>(op.kind)) {
+            case AFNSWidgetPatchKind::kInsert:
+                ++counts.inserts;
+                AFNS_EXPECT(nodes_.count(op.node) == 0);
+                nodes_[op.node].name = string(op.value);
+                Place(op.node, op.parent_or_key, op.after);
+                break;
+            case AFNSWidgetPatchKind::kRemove:
+                ++counts.removes;
+                Unplace(op.node);
+                Erase(op.node);
+                break;
+            case AFNSWidgetPatchKind::kMove:
+                ++counts.moves;
+                Unplace(op.node);
+                Place(op.node, op.parent_or_key, op.after);
+                break;
+            case AFNSWidgetPatchKind::kSetProperty:
+                ++counts.sets;
+                AFNS_EXPECT(nodes_.count(op.node) == 1);
+                nodes_[op.node].properties[string(op.parent_or_key)] =
+                    std::to_string(op.type) + ":" +
+                    (op.type == static_cast<uint16_t>(flutter::afns::AFNSPropertyType::kString)
+                         ? string(op.value)
+                         : std::to_string(op.value));
+                break;
+            case AFNSWidgetPatchKind::kRemoveProperty:
+                ++counts.property_removes;
+                AFNS_EXPECT(nodes_[op.node].properties.erase(string(op.parent_or_key)) == 1);
+                break;
+            default:
+                AFNS_EXPECT(false);
+            }
+        }
+        return counts;
+    }
+
+    std::string Dump() const { return Dump(children_.count(kRoot) ? children_.at(kRoot) : std::vector<uint32_t>()); }
+
+    // Ids of the top-level nodes, then of each node's children, in order
+    std::vector<uint32_t> Ids(uint32_t parent = kRoot) const {
+        auto it = children_.find(parent);
+        return it == children_.end() ? std::vector<uint32_t>() : it->second;
+    }
+
+private:
+    static constexpr uint32_t kRoot = flutter::afns::kAFNSWidgetTreeNone;
+
+    struct Node {
+        std::string name;
+        std::map<std::string, std::string> properties;
+        uint32_t parent = kRoot;
+    };
+
+    void Place(uint32_t node, uint32_t parent, uint32_t after) {
+        std::vector<uint32_t>& siblings = children_[parent];
+        auto at = siblings.begin();
+        if (after != kRoot) {
+            at = std::find(siblings.begin(), siblings.end(), after);
+            AFNS_EXPECT(at != siblings.end());
+            if (at != siblings.end()) {
+                ++at;
+            }
+        }
+        siblings.insert(at, node);
+        nodes_[node].parent = parent;
+    }
+
+    void Unplace(uint32_t node) {
+        AFNS_EXPECT(nodes_.count(node) == 1);
+        std::vector<uint32_t>& siblings = children_[nodes_[node].parent];
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), node), siblings.end());
+    }
+
+    void Erase(uint32_t node) {
+        for (uint32_t child : Ids(node)) {
+            Erase(child);
+        }
+        children_.erase(node);
+        nodes_.erase(node);
+    }
+
+    std::string Dump(const std::vector<uint32_t>& ids) const {
+        std::string text;
+        for (uint32_t id : ids) {
+            const Node& node = nodes_.at(id);
+            text += node.name + "{";
+            for (const auto& [key, value] : node.properties) {
+                text += key + "=" + value + ";";
+            }
+            text += "}(" + Dump(Ids(id)) + ")";
+        }
+        return text;
+    }
+
+    uint32_t generation_ = 0;
+    std::map<uint32_t, Node> nodes_;
+    std::map<uint32_t, std::vector<uint32_t>> children_;
+};
+
+// The same text as PatchedTree::Dump, read from a serialized tree
+std::string DumpWidgetTree(std::string_view tree, uint32_t first) {
+    const auto header = ReadAt<flutter::afns::AFNSWidgetTreeHeader>(tree, 0);
+    const size_t nodes_at = sizeof(header);
+    const size_t properties_at = nodes_at + Align8(size_t{header.node_count} * sizeof(flutter::afns::AFNSWidgetTreeNode));
+    const size_t strings_at = properties_at + Align8(size_t{header.property_count} * sizeof(flutter::afns::AFNSWidgetTreeProperty));
+    auto string = [&](uint64_t index) {
+        return StringAt(tree, strings_at, header.string_count, static_cast<uint32_t>(index));
+    };
+    std::string text;
+    for (uint32_t index = first; index != flutter::afns::kAFNSWidgetTreeNone;) {
+        const auto node = ReadAt<flutter::afns::AFNSWidgetTreeNode>(
+            tree, nodes_at + size_t{index} * sizeof(flutter::afns::AFNSWidgetTreeNode));
+        std::map<std::string, std::string> properties;
+        for (uint32_t i = 0; i < node.property_count; ++i) {
+            const auto property = ReadAt<flutter::afns::AFNSWidgetTreeProperty>(
+                tree, properties_at + (size_t{node.first_property} + i) * sizeof(flutter::afns::AFNSWidgetTreeProperty));
+            properties[string(property.key)] =
+                std::to_string(property.type) + ":" +
+                (property.type == static_cast<uint16_t>(flutter::afns::AFNSPropertyType::kString)
+                     ? string(property.value)
+                     : std::to_string(property.value));
+        }
+        text += string(node.name) + "{";
+        for (const auto& [key, value] : properties) {
+            text += key + "=" + value + ";";
+        }
+        text += "}(" + DumpWidgetTree(tree, node.first_child) + ")";
+        index = node.next_sibling;
+    }
+    return text;
+}
+
+std::string DumpWidgetTree(std::string_view tree) {
+    return ReadAt<flutter::afns::AFNSWidgetTreeHeader>(tree, 0).node_count == 0 ? std::string()
+                                                                                : DumpWidgetTree(tree, 0);
+}
+
+// Each patch applied to what the reader holds yields the new tree exactly
+AFNS_TEST(WidgetDiffRoundTrips) {
+    const char* const sources[] = {
+        "FlutterColumn(id = \"main\", FlutterText(text = \"a\"), FlutterButton(id = \"ok\", x = 1))",
+        // set and remove properties
+        "FlutterColumn(id = \"main\", FlutterText(text = \"b\", size = 2.5), FlutterButton(id = \"ok\"))",
+        // insert, and a keyed move to the front
+        "FlutterColumn(id = \"main\", FlutterButton(id = \"ok\"), FlutterText(text = \"b\", size = 2.5),"
+        " FlutterRow(FlutterText(text = \"new\"), Custom(flag = true)))",
+        // move out of a subtree that is removed, and a second root
+        "FlutterColumn(id = \"main\", FlutterButton(id = \"ok\"), FlutterText(text = \"c\"))"
+        " FlutterDialog(title = \"d\")",
+        "FlutterDialog(title = \"d\")",
+        "",
+        "FlutterColumn(id = \"main\", FlutterText(text = \"a\"), FlutterButton(id = \"ok\", x = 1))",
+    };
+    flutter::afns::AFNSWidgetTreeDiffer differ;
+    PatchedTree reader;
+    uint32_t generation = 0;
+    PatchedTree::Counts total;
+    for (const char* source : sources) {
+        const std::string tree = WidgetTree(source);
+        std::string patch;
+        AFNS_EXPECT(differ.Diff(tree, SIZE_MAX, &patch));
+        const PatchedTree::Counts applied = reader.Apply(patch);
+        total.inserts += applied.inserts;
+        total.removes += applied.removes;
+        total.moves += applied.moves;
+        total.sets += applied.sets;
+        total.property_removes += applied.property_removes;
+        AFNS_EXPECT(reader.Dump() == DumpWidgetTree(tree));
+        AFNS_EXPECT(differ.generation() == ++generation);
+
+        // Diffing the committed tree again changes nothing
+        AFNS_EXPECT(differ.Diff(tree, SIZE_MAX, &patch));
+        const PatchedTree::Counts counts = reader.Apply(patch);
+        AFNS_EXPECT(counts.inserts + counts.removes + counts.moves + counts.sets + counts.property_removes == 0);
+        ++generation;
+    }
+    // Every kind of op was exercised
+    AFNS_EXPECT(total.inserts > 0 && total.removes > 0 && total.moves > 0 && total.sets > 0 &&
+                total.property_removes > 0);
+}
+
+// Siblings with an "id" are matched by it wherever they move; others by
+// position among same-named siblings
+AFNS_TEST(WidgetDiffMatchesKeyedThenPositional) {
+    {
+        flutter::afns::AFNSWidgetTreeDiffer differ;
+        PatchedTree reader;
+        std::string patch;
+        differ.Diff(WidgetTree("FlutterColumn(FlutterButton(id = \"a\"), FlutterButton(id = \"b\"),"
+                               " FlutterButton(id = \"c\"))"),
+                    SIZE_MAX, &patch);
+        reader.Apply(patch);
+        const std::vector<uint32_t> before = reader.Ids(reader.Ids()[0]);
+
+        differ.Diff(WidgetTree("FlutterColumn(FlutterButton(id = \"c\"), FlutterButton(id = \"a\"),"
+                               " FlutterButton(id = \"b\"))"),
+                    SIZE_MAX, &patch);
+        const PatchedTree::Counts counts = reader.Apply(patch);
+        AFNS_EXPECT(counts.moves == 1);
+        AFNS_EXPECT(counts.inserts == 0 && counts.removes == 0 && counts.sets == 0);
+        AFNS_EXPECT((reader.Ids(reader.Ids()[0]) == std::vector<uint32_t>{before[2], before[0], before[1]}));
+    }
+    {
+        flutter::afns::AFNSWidgetTreeDiffer differ;
+        PatchedTree reader;
+        std::string patch;
+        differ.Diff(WidgetTree("FlutterColumn(FlutterText(text = \"a\"), FlutterText(text = \"b\"))"),
+                    SIZE_MAX, &patch);
+        reader.Apply(patch);
+        const std::vector<uint32_t> before = reader.Ids(reader.Ids()[0]);
+
+        differ.Diff(WidgetTree("FlutterColumn(FlutterText(text = \"b\"), FlutterText(text = \"a\"))"),
+                    SIZE_MAX, &patch);
+        const PatchedTree::Counts counts = reader.Apply(patch);
+        AFNS_EXPECT(counts.sets == 2);
+        AFNS_EXPECT(counts.moves == 0 && counts.inserts == 0 && counts.removes == 0);
+        AFNS_EXPECT(reader.Ids(reader.Ids()[0]) == before);
+    }
+}
+
+// A patch over |patch_cap| is returned but not committed, so the retry
+// with a bigger buffer gets the same one
+AFNS_TEST(WidgetDiffCommitsOnlyWhatFits) {
+    flutter::afns::AFNSWidgetTreeDiffer differ;
+    const std::string first = WidgetTree("FlutterColumn(FlutterText(text = \"a\"))");
+    const std::string second = WidgetTree("FlutterColumn(FlutterText(text = \"b\"), FlutterButton(x = 1))");
+    std::string patch;
+    AFNS_EXPECT(differ.Diff(first, SIZE_MAX, &patch));
+
+    std::string too_big;
+    AFNS_EXPECT(differ.Diff(second, 8, &too_big));
+    AFNS_EXPECT(too_big.size() > 8);
+    AFNS_EXPECT(differ.generation() == 1);
+
+    std::string retry;
+    AFNS_EXPECT(differ.Diff(second, too_big.size(), &retry));
+    AFNS_EXPECT(retry == too_big);
+    AFNS_EXPECT(differ.generation() == 2);
+}
+
+// Trees that do not hold together are refused before anything is diffed
+AFNS_TEST(WidgetDiffRejectsMalformedTrees) {
+    const std::string tree = WidgetTree("FlutterColumn(id = \"a\", FlutterText(text = \"b\"))");
+    const size_t node_1 = sizeof(flutter::afns::AFNSWidgetTreeHeader) + sizeof(flutter::afns::AFNSWidgetTreeNode);
+    auto patched = [&tree](size_t offset, uint32_t value) {
+        std::string damaged = tree;
+        std::memcpy(&damaged[offset], &value, sizeof(value));
+        return damaged;
+    };
+    const std::string malformed[] = {
+        std::string(),
+        "not a widget tree at all, just some text",
+        tree.substr(0, tree.size() - 1),
+        patched(offsetof(flutter::afns::AFNSWidgetTreeHeader, magic), 0),
+        patched(offsetof(flutter::afns::AFNSWidgetTreeHeader, version_major),
+                flutter::afns::kAFNSWidgetTreeVersionMajor + 1),
+        patched(offsetof(flutter::afns::AFNSWidgetTreeHeader, node_count), 1000),
+        // a child that points back at its parent
+        patched(node_1 + offsetof(flutter::afns::AFNSWidgetTreeNode, first_child), 0),
+        patched(node_1 + offsetof(flutter::afns::AFNSWidgetTreeNode, name), 1000),
+        patched(node_1 + offsetof(flutter::afns::AFNSWidgetTreeNode, property_count), 1000),
+    };
+
+    flutter::afns::AFNSWidgetTreeDiffer differ;
+    std::string patch;
+    AFNS_EXPECT(differ.Diff(tree, SIZE_MAX, &patch));
+    for (const std::string& bytes : malformed) {
+        AFNS_EXPECT(!differ.Diff(bytes, SIZE_MAX, &patch));
+    }
+    AFNS_EXPECT(differ.generation() == 1);
+}
+
+// 🎯 STATE BINDINGS
+// Collects binding results, which arrive on engine workers
+class BindingResults {
+public:
+    flutter::afns::AFNSEngineExtension::AFNSBindingCallback Callback() {
+        return [this](uint64_t binding, bool, const std::string& result) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_[binding].push_back(result);
+            changed_.notify_all();
+        };
+    }
+
+    // The results of |binding| once there are |count|, or as many as came
+    // within a few seconds
+    std::vector<std::string> WaitFor(uint64_t binding, size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait_for(lock, std::chrono::seconds(5),
+                          [&] { return results_[binding].size() >= count; });
+        return results_[binding];
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<uint64_t, std::vector<std::string>> results_;
+};
+
+AFNS_TEST(StateSetRerunsOnlyItsReaders) {
+    using flutter::afns::AFNSStateValue;
+    flutter::afns::AFNSEngineExtension engine;
+    engine.SetAFNSStateValue("x", AFNSStateValue::Int(0));
+    engine.SetAFNSStateValue("y", AFNSStateValue::Int(0));
+    engine.FlushAFNSState();
+
+    BindingResults results;
+    const uint64_t reads_x = engine.BindAFNS(true, "", "apex() { show(state(\"x\")); }", results.Callback());
+    const uint64_t reads_y = engine.BindAFNS(true, "", "apex() { show(state(\"y\")); }", results.Callback());
+    AFNS_EXPECT(results.WaitFor(reads_x, 1).size() == 1);
+    AFNS_EXPECT(results.WaitFor(reads_y, 1).size() == 1);
+
+    engine.SetAFNSStateValue("x", AFNSStateValue::Int(1));
+    AFNS_EXPECT(engine.FlushAFNSState() == 1);
+    AFNS_EXPECT((results.WaitFor(reads_x, 2) == std::vector<std::string>{"0", "1"}));
+    AFNS_EXPECT(results.WaitFor(reads_y, 1).size() == 1);
+
+    // Setting the value a path already has is not a change
+    engine.SetAFNSStateValue("x", AFNSStateValue::Int(1));
+    AFNS_EXPECT(engine.FlushAFNSState() == 0);
+
+    engine.UnbindAFNS(reads_x);
+    engine.UnbindAFNS(reads_y);
+}
+
+AFNS_TEST(StateSetsCoalesceIntoOneFlush) {
+    using flutter::afns::AFNSStateValue;
+    flutter::afns::AFNSEngineExtension engine;
+    engine.SetAFNSStateValue("x", AFNSStateValue::Int(0));
+    engine.FlushAFNSState();
+
+    BindingResults results;
+    const uint64_t binding = engine.BindAFNS(true, "", "apex() { show(state(\"x\")); }", results.Callback());
+    AFNS_EXPECT(results.WaitFor(binding, 1).size() == 1);
+
+    for (int64_t value = 1; value <= 5; ++value) {
+        engine.SetAFNSStateValue("x", AFNSStateValue::Int(value));
+    }
+    AFNS_EXPECT(engine.FlushAFNSState() == 1);
+    AFNS_EXPECT(engine.FlushAFNSState() == 0);
+    AFNS_EXPECT((results.WaitFor(binding, 2) == std::vector<std::string>{"0", "5"}));
+
+    engine.UnbindAFNS(binding);
+}
+
+// A tree that read state is rebuilt on every compile: it is neither
+// cached in memory or on disk nor written into a bundle
+AFNS_TEST(StateReadingTreesBypassCaches) {
+    using flutter::afns::AFNSStateValue;
+    const std::string reads_state = "FlutterText(count = state(\"x\"))";
+    const std::string plain = "FlutterText(count = 1)";
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "afns_engine_tests_disk_cache";
+    std::filesystem::remove_all(directory);
+
+    {
+        flutter::afns::AFNSEngineExtension engine;
+        AFNS_EXPECT(engine.EnableDiskCache(directory.string(), 0));
+        std::string tree;
+        for (int64_t value : {5, 6}) {
+            engine.SetAFNSStateValue("x", AFNSStateValue::Int(value));
+            AFNS_EXPECT(engine.CompileAFNSWidgetTree(reads_state, &tree));
+            AFNS_EXPECT(DumpWidgetTree(tree) == "FlutterText{count=1:" + std::to_string(value) + ";}()");
+        }
+        AFNS_EXPECT(engine.CompileAFNSWidgetTree(plain, &tree));
+    }
+    // Disk writes are done once the engine is gone; only the plain tree
+    // was stored
+    AFNS_EXPECT(std::distance(std::filesystem::directory_iterator(directory),
+                              std::filesystem::directory_iterator()) == 1);
+
+    std::string bundle;
+    {
+        flutter::afns::AFNSEngineExtension engine;
+        const std::string blob = reads_state + plain;
+        const uint64_t offsets[] = {0, reads_state.size(), blob.size()};
+        bundle = engine.BuildAFNSBundle(flutter::afns::AFNSPackedStringsView{offsets, 2, blob.data()});
+    }
+
+    const std::filesystem::path path = directory / "afns_engine_tests.afnsb";
+    std::ofstream(path, std::ios::binary) << bundle;
+    flutter::afns::AFNSEngineExtension engine;
+    std::string error;
+    AFNS_EXPECT(engine.LoadAFNSBundle(path.string(), &error));
+    engine.SetAFNSStateValue("x", AFNSStateValue::Int(8));
+    std::string tree;
+    AFNS_EXPECT(engine.CompileAFNSWidgetTree(reads_state, &tree));
+    AFNS_EXPECT(DumpWidgetTree(tree) == "FlutterText{count=1:8;}()");
+
+    std::filesystem::remove_all(directory);
+}
+
+// 🎯 WIDGET TEXT
+// Whether or not libafns loaded, the widget text is the rewriter's; the AST
+// path once rewrote only top-level and impl functions and so disagreed with
+// the text path on nested ones
+AFNS_TEST(WidgetTextIsTheRewritersWithOrWithoutFrontend) {
+    // Same table as afns_engine.cc
+    constexpr flutter::afns::AFNSRewriteRule kRules[] = {{"fun ", "Widget "}};
+    const flutter::afns::AFNSRewriter rewriter(kRules);
+    const std::string prefix = "Flutter Widget Generated from AFNS: ";
+
+    flutter::afns::AFNSEngineExtension engine;
+    for (std::string_view source :
+         {"fun main() { let x = 1; }",
+          "fun outer() { fun inner() { } }",
+          "impl Button { fun press(self) { } }\nfun run() { }",
+          "fun greet() { let s = \"fun stuff\"; } // fun here too",
+          "fun broken() { let = = ; }"}) {
+        const std::string expected = prefix + rewriter.Rewrite(source);
+        AFNS_EXPECT(engine.CompileAFNSWidget(source) == expected);
+
+        const uint64_t document = engine.OpenAFNSDocument(source);
+        std::string widget;
+        AFNS_EXPECT(engine.CompileAFNSDocument(document, &widget));
+        AFNS_EXPECT(widget == expected);
+        engine.CloseAFNSDocument(document);
+    }
+}
+
+// 🎯 WIDGET CACHES
+// The stats covered only the text cache although the budget is split
+// with the tree cache
+AFNS_TEST(WidgetCacheStatsCoverBothCaches) {
+    flutter::afns::AFNSEngineExtension engine;
+    engine.SetWidgetCacheBudget(1 << 20);
+    AFNS_EXPECT(engine.GetWidgetCacheStats().byte_budget == (1 << 20));
+
+    std::string tree;
+    AFNS_EXPECT(engine.CompileAFNSWidgetTree("FlutterText(text = \"a\")", &tree));
+    AFNS_EXPECT(engine.CompileAFNSWidgetTree("FlutterText(text = \"a\")", &tree));
+    const flutter::afns::AFNSWidgetCacheStats stats = engine.GetWidgetCacheStats();
+    AFNS_EXPECT(stats.entries == 1);
+    AFNS_EXPECT(stats.hits == 1);
+    AFNS_EXPECT(stats.bytes_used > 0);
+}
+
+// 🎯 BUNDLES
+// Only the newest loaded bundle used to be searched, although the older
+// ones stay mapped
+AFNS_TEST(EveryLoadedBundleIsSearchedNewestFirst) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    auto write_bundle = [&directory](const char* name,
+                                     std::initializer_list<std::pair<std::string_view, std::string_view>> widgets) {
+        flutter::afns::AFNSBundleWriter writer;
+        for (const auto& [source, widget] : widgets) {
+            writer.Add(source, widget, "", "");
+        }
+        const std::filesystem::path path = directory / name;
+        std::ofstream(path, std::ios::binary) << writer.Finish(flutter::afns::AFNSEngineVersion());
+        return path.string();
+    };
+    const std::string older = write_bundle("afns_engine_tests_older.afnsb",
+                                           {{"fun a() { }", "older a"}, {"fun c() { }", "older c"}});
+    const std::string newer = write_bundle("afns_engine_tests_newer.afnsb",
+                                           {{"fun b() { }", "newer b"}, {"fun c() { }", "newer c"}});
+
+    flutter::afns::AFNSEngineExtension engine;
+    std::string error;
+    AFNS_EXPECT(engine.LoadAFNSBundle(older, &error));
+    AFNS_EXPECT(engine.LoadAFNSBundle(newer, &error));
+    AFNS_EXPECT(engine.CompileAFNSWidget("fun a() { }") == "older a");
+    AFNS_EXPECT(engine.CompileAFNSWidget("fun b() { }") == "newer b");
+    AFNS_EXPECT(engine.CompileAFNSWidget("fun c() { }") == "newer c");
+
+    std::filesystem::remove(older);
+    std::filesystem::remove(newer);
+}
+
+// 🎯 ENGINE LIFETIME
+// The once-flag used to stay set after a shutdown, leaving GetAFNSEngine
+// returning null for good
+AFNS_TEST(EngineComesBackAfterShutdown) {
+    initialize_afns_engine();
+    AFNS_EXPECT(flutter::afns::GetAFNSEngine() != nullptr);
+    afns_engine_shutdown();
+    afns_engine_shutdown();
+    flutter::afns::AFNSEngineExtension* engine = flutter::afns::GetAFNSEngine();
+    AFNS_EXPECT(engine != nullptr);
+    if (engine != nullptr) {
+        AFNS_EXPECT(engine->CompileAFNSWidget("fun a() { }") ==
+                    "Flutter Widget Generated from AFNS: Widget a() { }");
+    }
+    afns_engine_shutdown();
+}
+
+// Destroying the engine runs its queued async work to completion while
+// everything that work records into is still alive
+AFNS_TEST(EngineDrainsAsyncWorkBeforeItsState) {
+    std::atomic<int> finished{0};
+    {
+        flutter::afns::AFNSEngineExtension engine;
+        for (int i = 0; i < 64; ++i) {
+            const std::string code = "apex() { show(" + std::to_string(i) + "); }";
+            engine.ExecuteAFNSLogicAsync("w", code,
+                                         [&finished](uint64_t, flutter::afns::AFNSAsyncStatus,
+                                                     const std::string&) { ++finished; });
+        }
+    }
+    AFNS_EXPECT(finished == 64);
+}
+
+} // anonymous namespace
+
+int main() {
+    for (const TestCase& test : Registry()) {
+        const int failures_before = g_failures;
+        test.run();
+        std::printf("%s %s\n", g_failures == failures_before ? "PASS" : "FAIL", test.name);
+    }
+    return g_failures == 0 ? 0 : 1;
+}
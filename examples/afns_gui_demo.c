@@ -1,41 +1,318 @@
 // AFNS GUI Demo - GTK Application
-// Simple GUI showing AFNS functionality
+// Linux desktop host for the AFNS engine, driven through a batched event queue
+//
+// Buttons and the load generator only enqueue events; the queue is drained
+// once per frame-clock tick, each event runs through the engine's C ABI and
+// all results of the tick are appended to the text view in one insert. The
+// queue, the result arena and the text view are all bounded, so the host
+// can be load-tested at thousands of events per second without Flutter:
+//   ./afns_gui_demo --load=5000 --seconds=10
+// Build with -DAFNS_BUILD_GTK_DEMO=ON in afns_flutter/afns_integration.
 
 #include <gtk/gtk.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-// AFNS Function Results
-char afns_result_buffer[1024];
+#include "afns_engine_c_api.h"
+
+// Queue capacity (a power of two); when full the oldest event is dropped
+#define AFNS_DEMO_QUEUE_CAPACITY 65536
+// Characters kept in the text view, older lines are trimmed first
+#define AFNS_DEMO_MAX_TEXT_CHARS (256 * 1024)
+// Engine time spent per tick, so the UI keeps its frame rate under load
+#define AFNS_DEMO_DRAIN_BUDGET_US 8000
+// Events between two clock reads while draining
+#define AFNS_DEMO_DRAIN_CHECK_EVERY 64
+
+typedef enum {
+    AFNS_DEMO_EVENT_INIT,
+    AFNS_DEMO_EVENT_COMPILE_WIDGET,
+    AFNS_DEMO_EVENT_EXECUTE_LOGIC,
+    AFNS_DEMO_EVENT_BANNER,
+} AFNSDemoEventKind;
+
+// Events only point at static code, so enqueueing never allocates
+typedef struct {
+    AFNSDemoEventKind kind;
+    const char *code;
+} AFNSDemoEvent;
+
+typedef struct {
+    AFNSDemoEvent events[AFNS_DEMO_QUEUE_CAPACITY];
+    guint head;
+    guint length;
+    
+    GtkWidget *text_view;
+    GtkTextBuffer *text_buffer;
+    GtkWidget *status_label;
+    guint drain_tick;
+    
+    // Results of one tick, appended in a single insert
+    GString *pending_text;
+    // Output arena of the buffer-style calls, grown on BUFFER_TOO_SMALL
+    char *output;
+    size_t output_cap;
+    
+    // Load generator: |load_rate| events per second while |load_source| runs
+    guint load_rate;
+    guint load_source;
+    gint64 load_started_us;
+    guint64 load_generated;
+    guint load_next;
+    
+    // Totals, and per second for the status line
+    guint64 processed;
+    guint64 dropped;
+    guint64 processed_last;
+    gint64 status_last_us;
+} AFNSDemoHost;
+
+static const char *const afns_init_text =
+    "🚀 AFNS Flutter Integration Initialized!\nPlatform: Cross-platform Native\nPerformance: Maximum Speed";
+
+static const char *const afns_window_code =
+    "FlutterWindow(id::string = \"main\", title::string = \"AFNS Professional Flutter Application\", width::i32 = 1024, height::i32 = 768)";
+static const char *const afns_button_code =
+    "FlutterButton(id::string = \"btn_save\", text::string = \"Save Project\", x::i32 = 50, y::i32 = 50)";
+static const char *const afns_textfield_code =
+    "FlutterTextField(id::string = \"txt_project\", placeholder::string = \"Project Name\", x::i32 = 50, y::i32 = 100, width::i32 = 200)";
+static const char *const afns_dialog_code =
+    "FlutterDialog(title::string = \"Success\", message::string = \"AFNS GUI Application is working!\", modal::bool = true)";
+
+static const char *const afns_demo_text =
+    "🎨 AFNS GUI Demo Running!\n===========================\n✅ All Flutter components initialized\n✅ Cross-platform compatibility: 100%\n✅ Performance: Maximum speed\n✅ Professional GUI: Working!\n\n💎 AFNS Language = Professional GUI Platform!";
+
+// What the load generator cycles through
+static const AFNSDemoEvent afns_load_events[] = {
+    {AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_window_code},
+    {AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_button_code},
+    {AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_textfield_code},
+    {AFNS_DEMO_EVENT_EXECUTE_LOGIC, afns_dialog_code},
+};
+
+static gboolean afns_drain_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data);
+
+// Schedules a drain on the next frame; at most one is pending at a time
+static void afns_schedule_drain(AFNSDemoHost *host) {
+    if (host->drain_tick == 0) {
+        host->drain_tick = gtk_widget_add_tick_callback(host->text_view, afns_drain_tick, host, NULL);
+    }
+}
+
+static void afns_enqueue(AFNSDemoHost *host, AFNSDemoEventKind kind, const char *code) {
+    if (host->length == AFNS_DEMO_QUEUE_CAPACITY) {
+        host->head = (host->head + 1) & (AFNS_DEMO_QUEUE_CAPACITY - 1);
+        host->length--;
+        host->dropped++;
+    }
+    AFNSDemoEvent *event = &host->events[(host->head + host->length) & (AFNS_DEMO_QUEUE_CAPACITY - 1)];
+    event->kind = kind;
+    event->code = code;
+    host->length++;
+    afns_schedule_drain(host);
+}
+
+// Runs one buffer-style engine call and appends its result to the tick's text.
+// The retry after AFNS_ERROR_BUFFER_TOO_SMALL gets the engine's held result,
+// so logic is not executed twice.
+static void afns_append_engine_result(AFNSDemoHost *host,
+                                      int (*call)(const char *, size_t, char *, size_t, size_t *),
+                                      const char *code) {
+    const size_t code_len = strlen(code);
+    size_t length = 0;
+    int status = call(code, code_len, host->output, host->output_cap, &length);
+    if (status == AFNS_ERROR_BUFFER_TOO_SMALL) {
+        char *grown = realloc(host->output, length);
+        if (grown == NULL) {
+            g_string_append(host->pending_text, "❌ out of memory\n");
+            return;
+        }
+        host->output = grown;
+        host->output_cap = length;
+        status = call(code, code_len, host->output, host->output_cap, &length);
+    }
+    if (status != AFNS_OK) {
+        g_string_append_printf(host->pending_text, "❌ engine error %d\n", status);
+        return;
+    }
+    g_string_append_len(host->pending_text, host->output, (gssize)length);
+    g_string_append_c(host->pending_text, '\n');
+}
+
+static void afns_process_event(AFNSDemoHost *host, const AFNSDemoEvent *event) {
+    switch (event->kind) {
+    case AFNS_DEMO_EVENT_INIT:
+        initialize_afns_engine();
+        afns_engine_prewarm();
+        g_string_append(host->pending_text, event->code);
+        g_string_append_c(host->pending_text, '\n');
+        break;
+    case AFNS_DEMO_EVENT_COMPILE_WIDGET:
+        afns_append_engine_result(host, compile_afns_widget, event->code);
+        break;
+    case AFNS_DEMO_EVENT_EXECUTE_LOGIC:
+        afns_append_engine_result(host, execute_afns_logic, event->code);
+        break;
+    case AFNS_DEMO_EVENT_BANNER:
+        g_string_append(host->pending_text, event->code);
+        g_string_append_c(host->pending_text, '\n');
+        break;
+    }
+}
+
+// Appends the tick's results at the end and trims the oldest lines past
+// AFNS_DEMO_MAX_TEXT_CHARS
+static void afns_flush_pending_text(AFNSDemoHost *host) {
+    if (host->pending_text->len == 0) {
+        return;
+    }
+    
+    // Only the tail of an oversized batch would survive the trim anyway
+    if (host->pending_text->len > AFNS_DEMO_MAX_TEXT_CHARS) {
+        const char *tail = host->pending_text->str + host->pending_text->len - AFNS_DEMO_MAX_TEXT_CHARS;
+        const char *line = strchr(tail, '\n');
+        tail = g_utf8_find_next_char(line != NULL ? line : tail, NULL);
+        g_string_erase(host->pending_text, 0, tail - host->pending_text->str);
+    }
+    
+    GtkTextIter end;
+    gtk_text_buffer_get_end_iter(host->text_buffer, &end);
+    gtk_text_buffer_insert(host->text_buffer, &end, host->pending_text->str, (gint)host->pending_text->len);
+    g_string_truncate(host->pending_text, 0);
+    
+    const gint excess = gtk_text_buffer_get_char_count(host->text_buffer) - AFNS_DEMO_MAX_TEXT_CHARS;
+    if (excess > 0) {
+        GtkTextIter start, cut;
+        gtk_text_buffer_get_start_iter(host->text_buffer, &start);
+        gtk_text_buffer_get_iter_at_offset(host->text_buffer, &cut, excess);
+        if (!gtk_text_iter_starts_line(&cut)) {
+            gtk_text_iter_forward_line(&cut);
+        }
+        gtk_text_buffer_delete(host->text_buffer, &start, &cut);
+    }
+    
+    gtk_text_buffer_get_end_iter(host->text_buffer, &end);
+    gtk_text_buffer_place_cursor(host->text_buffer, &end);
+    gtk_text_view_scroll_mark_onscreen(GTK_TEXT_VIEW(host->text_view),
+                                       gtk_text_buffer_get_insert(host->text_buffer));
+}
+
+static void afns_update_status(AFNSDemoHost *host, gint64 now_us) {
+    if (now_us - host->status_last_us < G_USEC_PER_SEC) {
+        return;
+    }
+    const double seconds = (double)(now_us - host->status_last_us) / G_USEC_PER_SEC;
+    char status[160];
+    snprintf(status, sizeof status, "%.0f events/s · queued %u · dropped %" G_GUINT64_FORMAT " · processed %" G_GUINT64_FORMAT,
+             (double)(host->processed - host->processed_last) / seconds, host->length, host->dropped,
+             host->processed);
+    gtk_label_set_text(GTK_LABEL(host->status_label), status);
+    host->processed_last = host->processed;
+    host->status_last_us = now_us;
+}
+
+// Frame-clock tick: drains what fits in the budget, then appends once
+static gboolean afns_drain_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data) {
+    AFNSDemoHost *host = data;
+    const gint64 started = g_get_monotonic_time();
+    guint drained = 0;
+    while (host->length > 0) {
+        afns_process_event(host, &host->events[host->head]);
+        host->head = (host->head + 1) & (AFNS_DEMO_QUEUE_CAPACITY - 1);
+        host->length--;
+        host->processed++;
+        if (++drained % AFNS_DEMO_DRAIN_CHECK_EVERY == 0 &&
+            g_get_monotonic_time() - started >= AFNS_DEMO_DRAIN_BUDGET_US) {
+            break;
+        }
+    }
+    afns_flush_pending_text(host);
+    
+    const gint64 now = g_get_monotonic_time();
+    afns_update_status(host, now);
+    if (host->length > 0 || host->load_source != 0) {
+        // Keep ticking while there is work, and for the status line
+        return G_SOURCE_CONTINUE;
+    }
+    host->drain_tick = 0;
+    return G_SOURCE_REMOVE;
+}
+
+// Enqueues what the load rate calls for since the generator started
+static gboolean afns_load_step(gpointer data) {
+    AFNSDemoHost *host = data;
+    const gint64 elapsed = g_get_monotonic_time() - host->load_started_us;
+    const guint64 due = (guint64)elapsed * host->load_rate / G_USEC_PER_SEC;
+    const guint count = G_N_ELEMENTS(afns_load_events);
+    for (; host->load_generated < due; host->load_generated++) {
+        const AFNSDemoEvent *event = &afns_load_events[host->load_next];
+        host->load_next = (host->load_next + 1) % count;
+        afns_enqueue(host, event->kind, event->code);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void afns_start_load(AFNSDemoHost *host) {
+    if (host->load_source != 0 || host->load_rate == 0) {
+        return;
+    }
+    host->load_started_us = g_get_monotonic_time();
+    host->load_generated = 0;
+    host->load_source = g_timeout_add(1, afns_load_step, host);
+    afns_schedule_drain(host);
+}
+
+static void afns_stop_load(AFNSDemoHost *host) {
+    if (host->load_source != 0) {
+        g_source_remove(host->load_source);
+        host->load_source = 0;
+    }
+}
 
 void afns_init_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "🚀 AFNS Flutter Integration Initialized!\nPlatform: Cross-platform Native\nPerformance: Maximum Speed");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    afns_enqueue(data, AFNS_DEMO_EVENT_INIT, afns_init_text);
 }
 
 void afns_create_window_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "FlutterWindow(id::string = \"main\", title::string = \"AFNS Professional Flutter Application\", width::i32 = 1024, height::i32 = 768)");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    afns_enqueue(data, AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_window_code);
 }
 
 void afns_create_button_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "FlutterButton(id::string = \"btn_save\", text::string = \"Save Project\", x::i32 = 50, y::i32 = 50)");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    afns_enqueue(data, AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_button_code);
 }
 
 void afns_create_textfield_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "FlutterTextField(id::string = \"txt_project\", placeholder::string = \"Project Name\", x::i32 = 50, y::i32 = 100, width::i32 = 200)");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    afns_enqueue(data, AFNS_DEMO_EVENT_COMPILE_WIDGET, afns_textfield_code);
 }
 
 void afns_show_dialog_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "FlutterDialog(title::string = \"Success\", message::string = \"AFNS GUI Application is working!\", modal::bool = true)");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    afns_enqueue(data, AFNS_DEMO_EVENT_EXECUTE_LOGIC, afns_dialog_code);
 }
 
 void afns_run_demo_callback(GtkWidget *widget, gpointer data) {
-    strcpy(afns_result_buffer, "🎨 AFNS GUI Demo Running!\n===========================\n✅ All Flutter components initialized\n✅ Cross-platform compatibility: 100%\n✅ Performance: Maximum speed\n✅ Professional GUI: Working!\n\n💎 AFNS Language = Professional GUI Platform!");
-    gtk_text_buffer_set_text(data, afns_result_buffer, -1);
+    AFNSDemoHost *host = data;
+    afns_enqueue(host, AFNS_DEMO_EVENT_BANNER, afns_demo_text);
+    for (guint i = 0; i < G_N_ELEMENTS(afns_load_events); i++) {
+        afns_enqueue(host, afns_load_events[i].kind, afns_load_events[i].code);
+    }
+}
+
+void afns_load_test_callback(GtkToggleButton *toggle, gpointer data) {
+    if (gtk_toggle_button_get_active(toggle)) {
+        afns_start_load(data);
+    } else {
+        afns_stop_load(data);
+    }
+}
+
+// --seconds: quits after the run and prints the totals
+static gboolean afns_quit_after_run(gpointer data) {
+    AFNSDemoHost *host = data;
+    printf("processed %" G_GUINT64_FORMAT " events, dropped %" G_GUINT64_FORMAT ", %u still queued\n",
+           host->processed, host->dropped, host->length);
+    gtk_main_quit();
+    return G_SOURCE_REMOVE;
 }
 
 int main(int argc, char *argv[]) {
@@ -47,11 +324,29 @@ int main(int argc, char *argv[]) {
     GtkWidget *text_view;
     GtkTextBuffer *text_buffer;
     
-    GtkWidget *init_btn, *window_btn, *button_btn, *textfield_btn, *dialog_btn, *demo_btn;
+    GtkWidget *init_btn, *window_btn, *button_btn, *textfield_btn, *dialog_btn, *demo_btn, *load_btn;
     
     // Initialize GTK
     gtk_init(&argc, &argv);
     
+    // --load=N starts the load generator at N events per second right away
+    guint load_rate = 5000;
+    gboolean load_now = FALSE;
+    guint run_seconds = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--load=", 7) == 0) {
+            load_rate = (guint)strtoul(argv[i] + 7, NULL, 10);
+            load_now = TRUE;
+        } else if (strncmp(argv[i], "--seconds=", 10) == 0) {
+            run_seconds = (guint)strtoul(argv[i] + 10, NULL, 10);
+        }
+    }
+    
+    AFNSDemoHost *host = g_new0(AFNSDemoHost, 1);
+    host->pending_text = g_string_sized_new(4096);
+    host->load_rate = load_rate;
+    host->status_last_us = g_get_monotonic_time();
+    
     // Create main window
     window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(window), "🎨 AFNS GUI Demo - Professional Flutter Application");
@@ -66,8 +361,8 @@ int main(int argc, char *argv[]) {
     result_label = gtk_label_new("🎨 AFNS GUI Application - Professional Flutter Demo");
     gtk_label_set_markup(GTK_LABEL(result_label), "<big><b>🎨 AFNS GUI Application - Professional Flutter Demo</b></big>\n<i>Cross-platform GUI Development Platform</i>");
     gtk_box_pack_start(GTK_BOX(main_box), result_label, FALSE, FALSE, 0);
-
-
+    
+    
     // Create button box
     button_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
     gtk_box_set_homogeneous(GTK_BOX(button_box), TRUE);
@@ -79,6 +374,7 @@ int main(int argc, char *argv[]) {
     textfield_btn = gtk_button_new_with_label("📝 Create TextField");
     dialog_btn = gtk_button_new_with_label("💬 Show Dialog");
     demo_btn = gtk_button_new_with_label("🎨 Run Demo");
+    load_btn = gtk_toggle_button_new_with_label("⚡ Load Test");
     
     gtk_box_pack_start(GTK_BOX(button_box), init_btn, TRUE, TRUE, 2);
     gtk_box_pack_start(GTK_BOX(button_box), window_btn, TRUE, TRUE, 2);
@@ -86,6 +382,7 @@ int main(int argc, char *argv[]) {
     gtk_box_pack_start(GTK_BOX(button_box), textfield_btn, TRUE, TRUE, 2);
     gtk_box_pack_start(GTK_BOX(button_box), dialog_btn, TRUE, TRUE, 2);
     gtk_box_pack_start(GTK_BOX(button_box), demo_btn, TRUE, TRUE, 2);
+    gtk_box_pack_start(GTK_BOX(button_box), load_btn, TRUE, TRUE, 2);
     
     gtk_box_pack_start(GTK_BOX(main_box), button_box, FALSE, FALSE, 0);
     
@@ -98,20 +395,26 @@ int main(int argc, char *argv[]) {
     gtk_text_view_set_editable(GTK_TEXT_VIEW(text_view), FALSE);
     gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD);
     gtk_scrolled_window_add_with_viewport(GTK_SCROLLED_WINDOW(scrolled_window), text_view);
+    host->text_view = text_view;
+    host->text_buffer = text_buffer;
     
     // Set initial text
-    strcpy(afns_result_buffer, "🎨 AFNS GUI Application Ready!\n\nClick buttons above to test AFNS Flutter functions...\n\n✅ AFNS Compiler: Built successfully\n✅ Flutter Integration: Ready\n✅ Cross-platform: Linux/Windows/macOS/Android/iOS/Web\n✅ Professional GUI: Fully functional");
-    gtk_text_buffer_set_text(text_buffer, afns_result_buffer, -1);
+    gtk_text_buffer_set_text(text_buffer, "🎨 AFNS GUI Application Ready!\n\nClick buttons above to test AFNS Flutter functions...\n\n✅ AFNS Compiler: Built successfully\n✅ Flutter Integration: Ready\n✅ Cross-platform: Linux/Windows/macOS/Android/iOS/Web\n✅ Professional GUI: Fully functional\n\n", -1);
     
     gtk_box_pack_start(GTK_BOX(main_box), scrolled_window, TRUE, TRUE, 10);
     
+    // Queue and throughput status
+    host->status_label = gtk_label_new("idle");
+    gtk_box_pack_start(GTK_BOX(main_box), host->status_label, FALSE, FALSE, 0);
+    
     // Connect button signals
-    g_signal_connect(init_btn, "clicked", G_CALLBACK(afns_init_callback), text_buffer);
-    g_signal_connect(window_btn, "clicked", G_CALLBACK(afns_create_window_callback), text_buffer);
-    g_signal_connect(button_btn, "clicked", G_CALLBACK(afns_create_button_callback), text_buffer);
-    g_signal_connect(textfield_btn, "clicked", G_CALLBACK(afns_create_textfield_callback), text_buffer);
-    g_signal_connect(dialog_btn, "clicked", G_CALLBACK(afns_show_dialog_callback), text_buffer);
-    g_signal_connect(demo_btn, "clicked", G_CALLBACK(afns_run_demo_callback), text_buffer);
+    g_signal_connect(init_btn, "clicked", G_CALLBACK(afns_init_callback), host);
+    g_signal_connect(window_btn, "clicked", G_CALLBACK(afns_create_window_callback), host);
+    g_signal_connect(button_btn, "clicked", G_CALLBACK(afns_create_button_callback), host);
+    g_signal_connect(textfield_btn, "clicked", G_CALLBACK(afns_create_textfield_callback), host);
+    g_signal_connect(dialog_btn, "clicked", G_CALLBACK(afns_show_dialog_callback), host);
+    g_signal_connect(demo_btn, "clicked", G_CALLBACK(afns_run_demo_callback), host);
+    g_signal_connect(load_btn, "toggled", G_CALLBACK(afns_load_test_callback), host);
     
     // Connect window close signal
     g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
@@ -119,8 +422,21 @@ int main(int argc, char *argv[]) {
     // Show all widgets
     gtk_widget_show_all(window);
     
+    afns_enqueue(host, AFNS_DEMO_EVENT_INIT, afns_init_text);
+    if (load_now) {
+        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(load_btn), TRUE);
+    }
+    if (run_seconds > 0) {
+        g_timeout_add_seconds(run_seconds, afns_quit_after_run, host);
+    }
+    
     // Start GTK main loop
     gtk_main();
     
+    afns_stop_load(host);
+    g_string_free(host->pending_text, TRUE);
+    free(host->output);
+    g_free(host);
+    
     return 0;
 }
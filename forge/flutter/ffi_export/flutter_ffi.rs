@@ -7,6 +7,31 @@
 use std::ffi::{CStr, CString};
 use std::os::raw::{c_char, c_int, c_void};
 use std::panic;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Instant;
+
+// 🎯 PERFORMANCE COUNTERS
+// Totals since the library was loaded, reported by
+// get_flutter_performance_metrics; relaxed atomics, one add per call
+
+static WIDGETS_CREATED: AtomicU64 = AtomicU64::new(0);
+static WORKFLOWS_EXECUTED: AtomicU64 = AtomicU64::new(0);
+static WORKFLOW_TOTAL_NS: AtomicU64 = AtomicU64::new(0);
+static WORKFLOW_MAX_NS: AtomicU64 = AtomicU64::new(0);
+static EVENTS_HANDLED: AtomicU64 = AtomicU64::new(0);
+static EVENTS_REJECTED: AtomicU64 = AtomicU64::new(0);
+static BYTES_IN: AtomicU64 = AtomicU64::new(0);
+static BYTES_OUT: AtomicU64 = AtomicU64::new(0);
+
+fn record_widget(input_len: usize, output: &str) {
+    WIDGETS_CREATED.fetch_add(1, Ordering::Relaxed);
+    BYTES_IN.fetch_add(input_len as u64, Ordering::Relaxed);
+    BYTES_OUT.fetch_add(output.len() as u64, Ordering::Relaxed);
+}
+
+fn millis(ns: u64) -> f64 {
+    ns as f64 / 1_000_000.0
+}
 
 // 🎯 FFI STRUCTURE DEFINITIONS FOR FLUTTER INTEGRATION
 
@@ -72,6 +97,7 @@ pub extern "C" fn create_flutter_window(title: *mut c_char, width: c_int, height
             "FlutterWindow(title::string = \"{}\", width::i32 = {}, height::i32 = {}, visible::bool = true)",
             title_str, width, height
         );
+        record_widget(title_str.len(), &window_info);
 
         CString::new(window_info).unwrap()
     });
@@ -98,6 +124,7 @@ pub extern "C" fn create_flutter_button(text: *mut c_char, x: c_int, y: c_int) -
             "FlutterButton(text::string = \"{}\", x::i32 = {}, y::i32 = {}, enabled::bool = true)",
             text_str, x, y
         );
+        record_widget(text_str.len(), &button_info);
 
         CString::new(button_info).unwrap()
     });
@@ -155,6 +182,7 @@ pub extern "C" fn update_flutter_ui_state(state: *mut c_char) {
 #[no_mangle]
 pub extern "C" fn execute_afns_gui_workflow(afns_code: *mut c_char) -> *mut c_char {
     let result = panic::catch_unwind(|| {
+        let started = Instant::now();
         let afns_code_str = unsafe {
             CStr::from_ptr(afns_code).to_string_lossy().into_owned()
         };
@@ -186,11 +214,17 @@ pub extern "C" fn execute_afns_gui_workflow(afns_code: *mut c_char) -> *mut c_ch
         }
         
         // Add performance summary
-        results.push("⚡ AFNS execution time: 4ms".to_string());
+        let elapsed_ns = started.elapsed().as_nanos() as u64;
+        WORKFLOWS_EXECUTED.fetch_add(1, Ordering::Relaxed);
+        WORKFLOW_TOTAL_NS.fetch_add(elapsed_ns, Ordering::Relaxed);
+        WORKFLOW_MAX_NS.fetch_max(elapsed_ns, Ordering::Relaxed);
+        BYTES_IN.fetch_add(afns_code_str.len() as u64, Ordering::Relaxed);
+        results.push(format!("⚡ AFNS execution time: {:.3}ms", millis(elapsed_ns)));
         results.push("💾 Memory usage: Optimized".to_string());
         results.push("🎯 Cross-platform: Ready".to_string());
         
         let final_result = results.join("\n");
+        BYTES_OUT.fetch_add(final_result.len() as u64, Ordering::Relaxed);
         CString::new(final_result).unwrap()
     });
 
@@ -288,6 +322,7 @@ pub extern "C" fn create_flutter_textfield(
             "FlutterTextField(placeholder::string = \"{}\", x::i32 = {}, y::i32 = {}, width::i32 = {})",
             placeholder_str, x, y, width
         );
+        record_widget(placeholder_str.len(), &textfield_info);
 
         CString::new(textfield_info).unwrap()
     });
@@ -320,6 +355,7 @@ pub extern "C" fn create_flutter_listbox(
             "FlutterListBox(items::Array<string> = [{}], x::i32 = {}, y::i32 = {}, width::i32 = {}, height::i32 = {})",
             items_str, x, y, width, height
         );
+        record_widget(items_str.len(), &listbox_info);
 
         CString::new(listbox_info).unwrap()
     });
@@ -368,24 +404,39 @@ pub extern "C" fn execute_afns_gui_event(event_type: *mut c_char, event_data: *m
         }
     });
 
-    match result {
+    let status = match result {
         Ok(status) => status,
         Err(_) => -1 // Error
-    }
+    };
+    let counter = if status == 0 { &EVENTS_HANDLED } else { &EVENTS_REJECTED };
+    counter.fetch_add(1, Ordering::Relaxed);
+    status
 }
 
 // Get Flutter Performance Metrics
 #[no_mangle]
 pub extern "C" fn get_flutter_performance_metrics() -> *mut c_char {
     let metrics = panic::catch_unwind(|| {
+        // Measured by this library; the C++ engine's own numbers come from
+        // afns_engine_get_stats
+        let workflows = WORKFLOWS_EXECUTED.load(Ordering::Relaxed);
+        let total_ns = WORKFLOW_TOTAL_NS.load(Ordering::Relaxed);
+        let average_ns = if workflows == 0 { 0 } else { total_ns / workflows };
         let performance_data = format!(
             "Flutter Performance Metrics:
-- GUI Creation Time: 4ms
-- Memory Usage: Optimized  
-- FPS: 60+ fps
-- Bundle Size: Minimal
-- Platform Support: Complete
-- AFNS Integration: Native Speed"
+- Widgets Created: {}
+- GUI Workflows: {} (avg {:.3}ms, max {:.3}ms)
+- GUI Events: {} handled, {} rejected
+- Bytes In: {}
+- Bytes Out: {}",
+            WIDGETS_CREATED.load(Ordering::Relaxed),
+            workflows,
+            millis(average_ns),
+            millis(WORKFLOW_MAX_NS.load(Ordering::Relaxed)),
+            EVENTS_HANDLED.load(Ordering::Relaxed),
+            EVENTS_REJECTED.load(Ordering::Relaxed),
+            BYTES_IN.load(Ordering::Relaxed),
+            BYTES_OUT.load(Ordering::Relaxed)
         );
 
         CString::new(performance_data).unwrap()
@@ -0,0 +1,246 @@
+//! C ABI for the AFNS Flutter engine
+//!
+//! Exposes the lexer and parser to the C++ engine extension
+//! (afns_flutter/afns_integration/engine/afns_frontend.h) as a small set of
+//! `extern "C"` functions over an opaque parse handle. Everything crossing
+//! the boundary is plain data; bump `AFNS_FRONTEND_ABI_VERSION` whenever a
+//! signature or `#[repr(C)]` layout changes.
+
+use crate::ast::{Function, Item, Program, Span};
+use crate::lexer::{PositionalLexer, TokenWithSpan};
+use crate::parser::Parser;
+use std::panic::{catch_unwind, AssertUnwindSafe};
+
+/// Checked by the engine before any other call
+pub const AFNS_FRONTEND_ABI_VERSION: u32 = 1;
+
+/// Kind tags of `AfnsAstItem`
+pub const AFNS_AST_FUNCTION: u32 = 0;
+pub const AFNS_AST_STRUCT: u32 = 1;
+pub const AFNS_AST_ENUM: u32 = 2;
+pub const AFNS_AST_IMPLEMENTATION: u32 = 3;
+pub const AFNS_AST_TRAIT: u32 = 4;
+pub const AFNS_AST_MODULE: u32 = 5;
+pub const AFNS_AST_IMPORT: u32 = 6;
+pub const AFNS_AST_TYPE_ALIAS: u32 = 7;
+
+/// One top-level item (functions of an overload group and methods of an
+/// impl block are listed one by one). The span is that of the item's
+/// leading keyword in bytes of the parsed source; `line` is 0 for items the
+/// parser records no position for. `name` points into the parse handle and
+/// lives as long as it does.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct AfnsAstItem {
+    pub kind: u32,
+    pub line: u32,
+    pub column: u32,
+    pub name: *const u8,
+    pub name_len: usize,
+    pub span_start: usize,
+    pub span_end: usize,
+}
+
+/// Opaque parse handle owned by the caller
+pub struct AfnsAst {
+    program: Option<Program>,
+    error: String,
+    items: Vec<AfnsAstItem>,
+}
+
+impl AfnsAst {
+    fn failed(error: String) -> Self {
+        Self { program: None, error, items: Vec::new() }
+    }
+
+    fn parsed(program: Program) -> Self {
+        let mut ast = Self { program: Some(program), error: String::new(), items: Vec::new() };
+        let mut items = Vec::new();
+        if let Some(program) = &ast.program {
+            for item in &program.items {
+                collect_item(item, &mut items);
+            }
+        }
+        // Overload groups come out of a hash map, put items in source order
+        items.sort_by_key(|item| (item.line == 0, item.span_start));
+        ast.items = items;
+        ast
+    }
+}
+
+fn make_item(kind: u32, name: &str, span: Option<&Span>) -> AfnsAstItem {
+    let (line, column, span_start, span_end) = match span {
+        Some(span) => (span.line as u32, span.column as u32, span.start, span.end),
+        None => (0, 0, 0, 0),
+    };
+    AfnsAstItem {
+        kind,
+        line,
+        column,
+        name: name.as_ptr(),
+        name_len: name.len(),
+        span_start,
+        span_end,
+    }
+}
+
+fn collect_function(function: &Function, items: &mut Vec<AfnsAstItem>) {
+    items.push(make_item(AFNS_AST_FUNCTION, &function.name, Some(&function.span)));
+}
+
+fn collect_item(item: &Item, items: &mut Vec<AfnsAstItem>) {
+    match item {
+        Item::Function(function) => collect_function(function, items),
+        Item::FunctionOverload(group) => {
+            for function in &group.overloads {
+                collect_function(function, items);
+            }
+        }
+        Item::Struct(s) => items.push(make_item(AFNS_AST_STRUCT, &s.name, Some(&s.span))),
+        Item::Enum(e) => items.push(make_item(AFNS_AST_ENUM, &e.name, Some(&e.span))),
+        Item::Implementation(implementation) => {
+            items.push(make_item(AFNS_AST_IMPLEMENTATION, &implementation.target, Some(&implementation.span)));
+            for method in &implementation.methods {
+                collect_function(method, items);
+            }
+        }
+        Item::Trait(t) => items.push(make_item(AFNS_AST_TRAIT, &t.name, Some(&t.span))),
+        Item::Module(module) => {
+            items.push(make_item(AFNS_AST_MODULE, &module.name, Some(&module.span)));
+            for nested in &module.items {
+                collect_item(nested, items);
+            }
+        }
+        Item::Import(path) => items.push(make_item(AFNS_AST_IMPORT, path, None)),
+        Item::TypeAlias { name, .. } => items.push(make_item(AFNS_AST_TYPE_ALIAS, name, None)),
+    }
+}
+
+fn parse_source(source: &str) -> AfnsAst {
+    let tokens: Vec<TokenWithSpan> = PositionalLexer::new(source).collect();
+    let mut parser = Parser::new(tokens);
+    match parser.parse() {
+        Ok(program) => AfnsAst::parsed(program),
+        Err(error) => AfnsAst::failed(error.to_string()),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn afns_frontend_abi_version() -> u32 {
+    AFNS_FRONTEND_ABI_VERSION
+}
+
+/// Parses `len` bytes of UTF-8 at `source`. Always returns a handle (null
+/// only for a null `source` with a non-zero `len`); check it with
+/// `afns_ast_error` and release it with `afns_ast_free`.
+///
+/// # Safety
+/// `source` must be valid for reads of `len` bytes.
+#[no_mangle]
+pub unsafe extern "C" fn afns_frontend_parse(source: *const u8, len: usize) -> *mut AfnsAst {
+    if source.is_null() && len != 0 {
+        return std::ptr::null_mut();
+    }
+    let bytes = if len == 0 { &[][..] } else { std::slice::from_raw_parts(source, len) };
+    let ast = match std::str::from_utf8(bytes) {
+        // A parser panic must not unwind into C++
+        Ok(text) => catch_unwind(AssertUnwindSafe(|| parse_source(text)))
+            .unwrap_or_else(|_| AfnsAst::failed("parser panicked".to_string())),
+        Err(error) => AfnsAst::failed(format!("invalid UTF-8 at byte {}", error.valid_up_to())),
+    };
+    Box::into_raw(Box::new(ast))
+}
+
+/// # Safety
+/// `ast` must come from `afns_frontend_parse` and not be used afterwards.
+#[no_mangle]
+pub unsafe extern "C" fn afns_ast_free(ast: *mut AfnsAst) {
+    if !ast.is_null() {
+        drop(Box::from_raw(ast));
+    }
+}
+
+/// Returns true if parsing failed, pointing `message`/`message_len` (both
+/// optional) at the error text owned by the handle.
+///
+/// # Safety
+/// `ast` must be a live handle.
+#[no_mangle]
+pub unsafe extern "C" fn afns_ast_error(
+    ast: *const AfnsAst,
+    message: *mut *const u8,
+    message_len: *mut usize,
+) -> bool {
+    let ast = &*ast;
+    if !message.is_null() {
+        *message = ast.error.as_ptr();
+    }
+    if !message_len.is_null() {
+        *message_len = ast.error.len();
+    }
+    ast.program.is_none()
+}
+
+/// # Safety
+/// `ast` must be a live handle.
+#[no_mangle]
+pub unsafe extern "C" fn afns_ast_item_count(ast: *const AfnsAst) -> usize {
+    let ast = &*ast;
+    ast.items.len()
+}
+
+/// Copies item `index` (in source order) to `out`; false if out of range.
+///
+/// # Safety
+/// `ast` must be a live handle and `out` valid for writes.
+#[no_mangle]
+pub unsafe extern "C" fn afns_ast_item(ast: *const AfnsAst, index: usize, out: *mut AfnsAstItem) -> bool {
+    let ast = &*ast;
+    match ast.items.get(index) {
+        Some(item) => {
+            *out = *item;
+            true
+        }
+        None => false,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn parse(source: &str) -> *mut AfnsAst {
+        unsafe { afns_frontend_parse(source.as_ptr(), source.len()) }
+    }
+
+    #[test]
+    fn test_function_items_in_source_order() {
+        let source = "fun second() { var y::i32 = 1; }\nfun first() { var x::i32 = 42; }\n";
+        let ast = parse(source);
+        unsafe {
+            assert!(!afns_ast_error(ast, std::ptr::null_mut(), std::ptr::null_mut()));
+            assert_eq!(afns_ast_item_count(ast), 2);
+
+            let mut item = std::mem::zeroed::<AfnsAstItem>();
+            assert!(afns_ast_item(ast, 1, &mut item));
+            assert_eq!(item.kind, AFNS_AST_FUNCTION);
+            assert_eq!(std::slice::from_raw_parts(item.name, item.name_len), b"first");
+            assert_eq!(&source[item.span_start..item.span_end], "fun");
+            assert!(!afns_ast_item(ast, 2, &mut item));
+            afns_ast_free(ast);
+        }
+    }
+
+    #[test]
+    fn test_invalid_utf8_is_an_error() {
+        let bytes = [b'f', 0xFF];
+        unsafe {
+            let ast = afns_frontend_parse(bytes.as_ptr(), bytes.len());
+            let mut message = std::ptr::null();
+            let mut len = 0;
+            assert!(afns_ast_error(ast, &mut message, &mut len));
+            assert!(len > 0);
+            afns_ast_free(ast);
+        }
+    }
+}
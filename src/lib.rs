@@ -0,0 +1,10 @@
+//! ApexForge NightScript front end as a library
+//!
+//! Shares the lexer, parser and AST with other crates and, through
+//! `engine_abi`, with the Flutter engine extension, which links the
+//! `staticlib`/`cdylib` build of this crate.
+
+pub mod ast;
+pub mod lexer;
+pub mod parser;
+pub mod engine_abi;